@@ -0,0 +1,216 @@
+#include "ir_analyzer.h"
+#include <string.h>
+
+static const int MAX_VALUES = BundleEntry::MAX_PULSES / 2 + 1;
+static const uint32_t SPLIT_RATIO_PCT = 150;   // 排序后相邻时长相差1.5倍以上视为不同类别
+static const uint32_t HEADER_RATIO = 2;        // 首个mark达到mark中位数的2倍视为引导码
+static const uint32_t MIN_GAP_US = 10000;
+
+const char* analyzeStatusName(AnalyzeStatus status) {
+    switch (status) {
+        case ANALYZE_OK: return "ok";
+        case ANALYZE_TOO_SHORT: return "too short";
+        case ANALYZE_NO_STRUCTURE: return "no structure";
+        case ANALYZE_INCONSISTENT: return "inconsistent";
+        case ANALYZE_TOO_WIDE: return "too wide";
+        case ANALYZE_BAD_REPEAT: return "bad repeat";
+        default: return "?";
+    }
+}
+
+const char* pulseCodeKindName(PulseCodeKind kind) {
+    switch (kind) {
+        case PULSE_CODE_DISTANCE: return "pulse-distance";
+        case PULSE_CODE_WIDTH: return "pulse-width";
+        default: return "none";
+    }
+}
+
+// 一组时长的聚类结果
+struct Clusters {
+    int count;                    // 1或2类，0表示没有数据，3表示超过两类
+    uint32_t shortAvg;
+    uint32_t longAvg;             // 只有一类时与shortAvg相同
+    uint32_t threshold;           // 两类之间的分界
+};
+
+static void sortValues(uint16_t* values, int n) {
+    for (int i = 1; i < n; i++) {
+        uint16_t v = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+}
+
+static bool spreadOk(const uint16_t* sorted, int from, int to) {
+    uint32_t lo = sorted[from] > 0 ? sorted[from] : 1;
+    return (uint32_t)sorted[to] * 100 <= lo * SPLIT_RATIO_PCT;
+}
+
+static uint32_t average(const uint16_t* values, int from, int to) {
+    uint32_t sum = 0;
+    for (int i = from; i <= to; i++) sum += values[i];
+    int n = to - from + 1;
+    return (sum + n / 2) / n;
+}
+
+// 取pulses[first], pulses[first+2], ... 共n个时长，按排序后最大的相邻比值分为一类或两类
+static Clusters clusterValues(const uint16_t* pulses, int first, int n) {
+    Clusters result = {0, 0, 0, 0};
+    if (n <= 0) return result;
+
+    uint16_t sorted[MAX_VALUES];
+    for (int i = 0; i < n; i++) sorted[i] = pulses[first + i * 2];
+    sortValues(sorted, n);
+
+    int split = -1;
+    uint32_t bestRatio = 0;
+    for (int i = 0; i + 1 < n; i++) {
+        uint32_t lo = sorted[i] > 0 ? sorted[i] : 1;
+        uint32_t ratio = (uint32_t)sorted[i + 1] * 100 / lo;
+        if (ratio > bestRatio) {
+            bestRatio = ratio;
+            split = i;
+        }
+    }
+
+    if (split < 0 || bestRatio < SPLIT_RATIO_PCT) {
+        result.count = spreadOk(sorted, 0, n - 1) ? 1 : 3;
+        result.shortAvg = result.longAvg = average(sorted, 0, n - 1);
+        result.threshold = result.longAvg;
+        return result;
+    }
+
+    result.count = spreadOk(sorted, 0, split) && spreadOk(sorted, split + 1, n - 1) ? 2 : 3;
+    result.shortAvg = average(sorted, 0, split);
+    result.longAvg = average(sorted, split + 1, n - 1);
+    result.threshold = ((uint32_t)sorted[split] + sorted[split + 1]) / 2;
+    return result;
+}
+
+// 检查实测时长是否在容差内，并记录最大偏差
+static bool within(uint32_t measured, uint32_t expected, const AnalyzerConfig& config, uint32_t& maxErrorPct) {
+    uint32_t delta = measured > expected ? measured - expected : expected - measured;
+    uint32_t allowed = expected * config.tolerancePct / 100;
+    if (allowed < config.toleranceMinUs) allowed = config.toleranceMinUs;
+
+    uint32_t errorPct = expected > 0 ? delta * 100 / expected : 100;
+    if (errorPct > maxErrorPct) maxErrorPct = errorPct;
+    return delta <= allowed;
+}
+
+AnalyzeStatus analyzeEntry(const BundleEntry& entry, PulseAnalysis& out, const AnalyzerConfig& config) {
+    memset(&out, 0, sizeof(out));
+    const uint16_t* p = entry.rawData;
+
+    // 以space结尾时最后一个即帧尾间隔
+    int length = entry.rawLength;
+    if (length % 2 == 0) length--;
+    if (length < config.minBits * 2 + 1) return ANALYZE_TOO_SHORT;
+
+    // 引导码：首个mark明显长于mark的中位数
+    uint16_t marks[MAX_VALUES];
+    int markTotal = (length + 1) / 2;
+    for (int i = 0; i < markTotal; i++) marks[i] = p[i * 2];
+    sortValues(marks, markTotal);
+    int start = (uint32_t)p[0] >= (uint32_t)marks[markTotal / 2] * HEADER_RATIO ? 2 : 0;
+
+    // 数据区：mark/space交替，以mark结束；最后一个mark可能是结束mark，单独判断
+    int markCount = (length - start + 1) / 2;
+    int spaceCount = markCount - 1;
+    Clusters markClusters = clusterValues(p, start, markCount - 1);
+    Clusters spaceClusters = clusterValues(p, start + 1, spaceCount);
+    if (markClusters.count == 3 || spaceClusters.count == 3) return ANALYZE_NO_STRUCTURE;
+
+    PulseCodeKind kind;
+    if (markClusters.count == 1 && spaceClusters.count == 2) {
+        kind = PULSE_CODE_DISTANCE;
+    } else if (markClusters.count == 2 && spaceClusters.count == 1) {
+        kind = PULSE_CODE_WIDTH;
+    } else if (markClusters.count == 2 && spaceClusters.count == 2) {
+        // mark与space互补(长mark配短space)时仍为脉冲宽度编码
+        for (int i = start; i + 1 < length; i += 2) {
+            bool longMark = p[i] > markClusters.threshold;
+            bool longSpace = p[i + 1] > spaceClusters.threshold;
+            if (longMark == longSpace) return ANALYZE_NO_STRUCTURE;
+        }
+        kind = PULSE_CODE_WIDTH;
+    } else {
+        return ANALYZE_NO_STRUCTURE;
+    }
+
+    ProtocolDescriptor& d = out.desc;
+    d.encoding = PulseEncoding::PULSE_DISTANCE;   // 描述符的逐位mark+space编码同时覆盖两种方式
+    d.repeatMode = RepeatMode::FULL_FRAME;
+    d.hdrMark = start ? p[0] : 0;
+    d.hdrSpace = start ? p[1] : 0;
+    d.msbFirst = true;
+    d.freq = entry.carrierFreq > 0 ? entry.carrierFreq : 38;
+    d.duty = entry.dutyCycle > 0 ? entry.dutyCycle : 33;
+
+    uint16_t bits;
+    if (kind == PULSE_CODE_DISTANCE) {
+        d.oneMark = d.zeroMark = (uint16_t)markClusters.shortAvg;
+        d.oneSpace = (uint16_t)spaceClusters.longAvg;
+        d.zeroSpace = (uint16_t)spaceClusters.shortAvg;
+        d.footerMark = p[length - 1];
+        bits = spaceCount;
+    } else {
+        d.oneMark = (uint16_t)markClusters.longAvg;
+        d.zeroMark = (uint16_t)markClusters.shortAvg;
+        d.oneSpace = (uint16_t)spaceClusters.shortAvg;
+        d.zeroSpace = (uint16_t)spaceClusters.longAvg;
+        d.footerMark = 0;
+        bits = markCount;
+    }
+    if (bits < config.minBits) return ANALYZE_TOO_SHORT;
+    if (bits > config.maxBits) return ANALYZE_TOO_WIDE;
+
+    // 逐位判定并核对每个脉冲
+    uint32_t maxErrorPct = 0;
+    uint64_t value = 0;
+    for (uint16_t b = 0; b < bits; b++) {
+        int i = start + b * 2;
+        bool hasSpace = i + 1 < length;
+        int bit;
+        if (kind == PULSE_CODE_DISTANCE) {
+            bit = p[i + 1] > spaceClusters.threshold ? 1 : 0;
+        } else {
+            bit = p[i] > markClusters.threshold ? 1 : 0;
+        }
+        if (!within(p[i], bit ? d.oneMark : d.zeroMark, config, maxErrorPct)) return ANALYZE_INCONSISTENT;
+        if (hasSpace && !within(p[i + 1], bit ? d.oneSpace : d.zeroSpace, config, maxErrorPct)) {
+            return ANALYZE_INCONSISTENT;
+        }
+        value = (value << 1) | bit;
+    }
+
+    // 重复帧：只支持NEC式重复码(引导mark + 短space + 结束mark)
+    if (entry.repeatLength > 0) {
+        uint32_t ignored = 0;
+        if (kind != PULSE_CODE_DISTANCE || !d.hdrMark || entry.repeatLength != 3 ||
+            !within(entry.repeatData[0], d.hdrMark, config, ignored) ||
+            !within(entry.repeatData[2], d.footerMark, config, ignored)) {
+            return ANALYZE_BAD_REPEAT;
+        }
+        d.repeatMode = RepeatMode::NEC_REPEAT_CODE;
+        d.rptSpace = entry.repeatData[1];
+    }
+
+    // 帧尾间隔需明显长于任何数据space，解码时才能识别帧尾
+    uint32_t longest = d.hdrSpace;
+    if (d.oneSpace > longest) longest = d.oneSpace;
+    if (d.zeroSpace > longest) longest = d.zeroSpace;
+    d.minGap = longest * 4 > MIN_GAP_US ? longest * 4 : MIN_GAP_US;
+    d.minFrameLength = (uint32_t)entry.repeatPeriod * 1000;
+
+    out.kind = kind;
+    out.value = value;
+    out.bits = bits;
+    out.maxErrorPct = maxErrorPct > 255 ? 255 : (uint8_t)maxErrorPct;
+    return ANALYZE_OK;
+}
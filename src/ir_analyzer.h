@@ -0,0 +1,51 @@
+#ifndef IR_ANALYZER_H
+#define IR_ANALYZER_H
+
+#include <stdint.h>
+#include "ir_protocol_descriptor.h"
+#include "ir_bundle.h"
+
+// 未知协议结构分析：从原始脉冲推断引导码、位时序和数据，得到可由描述符编码的参数化记录
+//   脉冲间隔编码  mark等长，space长短表示1/0，帧尾有结束mark(NEC类)
+//   脉冲宽度编码  mark长短表示1/0，space等长或与mark互补，没有结束mark(Sony类)
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+enum PulseCodeKind : uint8_t {
+    PULSE_CODE_NONE = 0,
+    PULSE_CODE_DISTANCE,
+    PULSE_CODE_WIDTH
+};
+
+enum AnalyzeStatus {
+    ANALYZE_OK = 0,
+    ANALYZE_TOO_SHORT,            // 数据位少于minBits
+    ANALYZE_NO_STRUCTURE,         // mark和space都只有一种长度，或某一类超过两种长度
+    ANALYZE_INCONSISTENT,         // 有脉冲偏离推断出的时序超过容差
+    ANALYZE_TOO_WIDE,             // 数据位超过maxBits
+    ANALYZE_BAD_REPEAT            // 重复帧无法用描述符表示
+};
+
+struct AnalyzerConfig {
+    uint8_t tolerancePct;         // 单个脉冲与所属类别平均值的相对容差(%)
+    uint16_t toleranceMinUs;      // 最小绝对容差(微秒)
+    uint16_t minBits;
+    uint16_t maxBits;
+};
+
+const AnalyzerConfig kDefaultAnalyzerConfig = {25, 100, 8, 64};
+
+struct PulseAnalysis {
+    PulseCodeKind kind;
+    ProtocolDescriptor desc;      // 推断出的描述符(高位先发，载波取自原信号，未测量时为38kHz/33%)
+    uint64_t value;
+    uint16_t bits;
+    uint8_t maxErrorPct;          // 原始脉冲与推断时序的最大偏差(%)
+};
+
+const char* analyzeStatusName(AnalyzeStatus status);
+const char* pulseCodeKindName(PulseCodeKind kind);
+
+// 分析一个信号的主帧(及重复帧、重复周期、载波)，成功时填写out
+AnalyzeStatus analyzeEntry(const BundleEntry& entry, PulseAnalysis& out,
+                           const AnalyzerConfig& config = kDefaultAnalyzerConfig);
+
+#endif
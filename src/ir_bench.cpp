@@ -0,0 +1,762 @@
+#include "ir_bench.h"
+#include "ir_latency.h"
+#include "ir_learning.h"
+#include "ir_command.h"
+#include "ir_signal_match.h"
+#include "ir_storage.h"
+#include "ir_protocol_encoder.h"
+#include "ir_pulse_filter.h"
+#include "ir_bundle.h"
+#include "ir_code_import.h"
+#include "ir_analyzer.h"
+#include "ir_lsh_index.h"
+#include "ir_parallel_match.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 类NEC帧：引导码 + 32位 + 结束脉冲，共67个脉冲
+static const int FRAME_PULSES = 67;
+static const int FRAME_COUNT = 8;
+
+static uint32_t mix(uint32_t hash, uint32_t value) {
+    hash ^= value;
+    hash *= 16777619UL;
+    return hash;
+}
+
+static uint32_t nsPerOp(uint32_t cycles, uint32_t iterations) {
+    if (iterations == 0) return 0;
+    uint64_t ns = (uint64_t)cycles * 1000 / LatencyStats::cyclesPerUs();
+    return (uint32_t)(ns / iterations);
+}
+
+// 带±jitterPct%抖动的随机NEC帧
+static void generateFrame(BenchRng& rng, uint16_t* pulses, uint8_t jitterPct) {
+    uint32_t data = rng.next();
+    int n = 0;
+    pulses[n++] = 9000;
+    pulses[n++] = 4500;
+    for (int bit = 0; bit < 32; bit++) {
+        pulses[n++] = 560;
+        pulses[n++] = (data >> bit) & 1 ? 1690 : 560;
+    }
+    pulses[n++] = 560;
+
+    if (jitterPct == 0) return;
+    for (int i = 0; i < FRAME_PULSES; i++) {
+        int32_t span = pulses[i] * jitterPct / 100;
+        int32_t offset = (int32_t)rng.range(0, span * 2) - span;
+        pulses[i] = (uint16_t)(pulses[i] + offset);
+    }
+}
+
+BenchSuite::BenchSuite(uint32_t seed) : seed(seed), match_workers(nullptr) {
+}
+
+void BenchSuite::benchRmtConvert(BenchResult& result) {
+    const uint32_t iterations = 500;
+    BenchRng rng(seed ^ 0x01);
+
+    uint16_t* frames = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES * FRAME_COUNT);
+    rmt_item32_t items[FRAME_PULSES / 2 + 2];
+    result.name = "rmt.convert";
+    result.iterations = 0;
+    if (!frames) return;
+
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        generateFrame(rng, frames + f * FRAME_PULSES, 10);
+    }
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        const uint16_t* frame = frames + (i % FRAME_COUNT) * FRAME_PULSES;
+        size_t count = convertRawPulses(frame, FRAME_PULSES, items, FRAME_PULSES / 2 + 2);
+        checksum = mix(checksum, count);
+        checksum = mix(checksum, items[count / 2].duration1);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(frames);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+int BenchSuite::benchStorage(BenchResult* results, int capacity) {
+    if (capacity < 4) return 0;
+
+    const int rounds = 3;
+    BenchRng rng(seed ^ 0x02);
+
+    RamStorageBackend* flash = new RamStorageBackend();
+    IRStorage* storage = new IRStorage(flash);
+    uint16_t* pulses = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES);
+    int written = 0;
+
+    if (storage && flash && pulses) {
+        storage->setQuiet(true);
+        storage->begin();
+
+        uint32_t addCycles = 0, deleteCycles = 0, addCount = 0, deleteCount = 0;
+        uint32_t addSum = 0, deleteSum = 0;
+
+        for (int round = 0; round < rounds; round++) {
+            // 填满全部槽位(每次添加都会写回整个存储映像)
+            for (int i = 0; i < IRStorage::MAX_SIGNALS; i++) {
+                generateFrame(rng, pulses, 10);
+                uint32_t start = LatencyStats::now();
+                int id = storage->addSignal(UNKNOWN, rng.next(), 32, pulses, FRAME_PULSES);
+                addCycles += LatencyStats::now() - start;
+                addSum = mix(addSum, id);
+                addCount++;
+            }
+            // 按随机顺序删除
+            for (int i = 0; i < IRStorage::MAX_SIGNALS; i++) {
+                int id = (int)rng.range(1, IRStorage::MAX_SIGNALS);
+                while (!storage->isValidId(id)) {
+                    id = id % IRStorage::MAX_SIGNALS + 1;
+                }
+                uint32_t start = LatencyStats::now();
+                bool ok = storage->deleteSignal(id);
+                deleteCycles += LatencyStats::now() - start;
+                deleteSum = mix(deleteSum, ok ? id : 0);
+                deleteCount++;
+            }
+        }
+
+        // 保存与加载半满的存储
+        for (int i = 0; i < IRStorage::MAX_SIGNALS / 2; i++) {
+            generateFrame(rng, pulses, 10);
+            storage->addSignal(UNKNOWN, rng.next(), 32, pulses, FRAME_PULSES);
+        }
+
+        const uint32_t ioIterations = 50;
+        uint32_t start = LatencyStats::now();
+        for (uint32_t i = 0; i < ioIterations; i++) {
+            storage->saveToEEPROM();
+        }
+        uint32_t saveCycles = LatencyStats::now() - start;
+
+        uint32_t loadSum = 0;
+        start = LatencyStats::now();
+        for (uint32_t i = 0; i < ioIterations; i++) {
+            storage->loadFromEEPROM();
+            loadSum = mix(loadSum, storage->getSignalCount());
+        }
+        uint32_t loadCycles = LatencyStats::now() - start;
+        loadSum = mix(loadSum, storage->getSignal(1) ? storage->getSignal(1)->value : 0);
+
+        results[0] = {"store.add", addCount, nsPerOp(addCycles, addCount), addSum};
+        results[1] = {"store.delete", deleteCount, nsPerOp(deleteCycles, deleteCount), deleteSum};
+        results[2] = {"store.save", ioIterations, nsPerOp(saveCycles, ioIterations), flash->getCommitCount()};
+        results[3] = {"store.load", ioIterations, nsPerOp(loadCycles, ioIterations), loadSum};
+        written = 4;
+    }
+
+    free(pulses);
+    delete storage;
+    delete flash;
+    return written;
+}
+
+void BenchSuite::benchLearner(BenchResult& result, const char* name, int sampleCount) {
+    const uint32_t iterations = 200;
+    BenchRng rng(seed ^ (0x100 + sampleCount));
+
+    StreamingLearner* learner = new StreamingLearner();
+    uint32_t* values = (uint32_t*)malloc(sizeof(uint32_t) * sampleCount);
+    uint16_t* frame = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES);
+    result.name = name;
+    result.iterations = 0;
+    if (!learner || !values || !frame) {
+        delete learner;
+        free(values);
+        free(frame);
+        return;
+    }
+
+    // 约70%为主信号，其余为几种误码；主信号每次附带一帧带抖动的波形
+    uint32_t dominant = rng.next();
+    for (int i = 0; i < sampleCount; i++) {
+        bool noise = rng.range(0, 99) >= 70;
+        values[i] = noise ? dominant ^ (1UL << rng.range(0, 31)) : dominant;
+    }
+    generateFrame(rng, frame, 10);
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        learner->reset();
+        for (int s = 0; s < sampleCount; s++) {
+            int candidate = learner->addSample(NEC, values[s], 32);
+            if (values[s] == dominant) learner->addWaveform(candidate, frame, FRAME_PULSES);
+        }
+        int best = learner->bestCandidate();
+        checksum = mix(checksum, learner->candidateCount());
+        checksum = mix(checksum, best >= 0 ? learner->candidate(best).value : 0);
+        checksum = mix(checksum, learner->confidencePercent());
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    delete learner;
+    free(values);
+    free(frame);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchBatchSession(BenchResult& result) {
+    const int keyCount = BatchSession::MAX_KEYS;
+    const int frameCount = keyCount * 2;
+    const uint32_t iterations = 50;
+    BenchRng rng(seed ^ 0x06);
+
+    // 整个遥控器依次按一遍：每个按键一帧+一个重复码，约十分之一的按键后紧跟一个误码帧
+    BatchSession* session = new BatchSession();
+    uint32_t* values = (uint32_t*)malloc(sizeof(uint32_t) * frameCount);
+    uint32_t* times = (uint32_t*)malloc(sizeof(uint32_t) * frameCount);
+    uint16_t* frame = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES);
+    result.name = "learn.batch.20";
+    result.iterations = 0;
+    if (!session || !values || !times || !frame) {
+        delete session;
+        free(values);
+        free(times);
+        free(frame);
+        return;
+    }
+
+    int n = 0;
+    uint32_t now = 0;
+    uint32_t base = rng.next();
+    for (int k = 0; k < keyCount; k++) {
+        now += rng.range(400, 1500);
+        values[n] = base + k;
+        times[n++] = now;
+        if (rng.range(0, 9) == 0) {
+            values[n] = (base + k) ^ (1UL << rng.range(0, 31));
+            times[n++] = now + 40;
+        }
+    }
+    generateFrame(rng, frame, 10);
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        session->reset();
+        for (int f = 0; f < n; f++) {
+            int key = session->addFrame(NEC, values[f], 32, times[f]);
+            session->addWaveform(key, frame, FRAME_PULSES);
+            session->addRepeat(times[f] + 108, 108, nullptr, 0);
+        }
+        session->closeSegment();
+        checksum = mix(checksum, session->keyCount());
+        checksum = mix(checksum, session->acceptedCount());
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    delete session;
+    free(values);
+    free(times);
+    free(frame);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+// 信号库包基准：IRStorage满载数量的类NEC信号，一半带重复码
+struct BenchBundleState {
+    uint16_t* frames;
+    uint8_t* buffer;
+    size_t length;
+    int decoded;
+    uint32_t checksum;
+};
+
+static bool benchBundleSource(int index, BundleEntry& out, void* ctx) {
+    BenchBundleState* state = static_cast<BenchBundleState*>(ctx);
+    static const uint16_t repeatCode[] = {9000, 2250, 560};
+    out.protocol = NEC;
+    out.bits = 32;
+    out.value = 0x20DF0000UL + index;
+    out.carrierFreq = 38;
+    out.dutyCycle = 33;
+    out.rawLength = FRAME_PULSES;
+    memcpy(out.rawData, state->frames + index * FRAME_PULSES, FRAME_PULSES * sizeof(uint16_t));
+    if (index % 2 == 0) {
+        out.repeatPeriod = 108;
+        out.repeatLength = 3;
+        memcpy(out.repeatData, repeatCode, sizeof(repeatCode));
+    }
+    snprintf(out.name, sizeof(out.name), "key_%02d", index + 1);
+    return true;
+}
+
+static void benchBundleSink(const uint8_t* data, size_t length, void* ctx) {
+    BenchBundleState* state = static_cast<BenchBundleState*>(ctx);
+    memcpy(state->buffer + state->length, data, length);
+    state->length += length;
+}
+
+static bool benchBundleEntry(const BundleEntry& entry, void* ctx) {
+    BenchBundleState* state = static_cast<BenchBundleState*>(ctx);
+    state->decoded++;
+    state->checksum = mix(state->checksum, entry.value ^ entry.rawData[entry.rawLength - 1]);
+    return true;
+}
+
+void BenchSuite::benchBundle(BenchResult& result) {
+    const int count = IRStorage::MAX_SIGNALS;
+    const uint32_t iterations = 20;
+    BenchRng rng(seed ^ 0x07);
+
+    BenchBundleState state = {nullptr, nullptr, 0, 0, 0};
+    state.frames = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES * count);
+    BundleReader* reader = new BundleReader(benchBundleEntry, &state);
+    result.name = "bundle.roundtrip";
+    result.iterations = 0;
+    if (state.frames && reader) {
+        for (int i = 0; i < count; i++) {
+            generateFrame(rng, state.frames + i * FRAME_PULSES, 0);
+        }
+        state.buffer = (uint8_t*)malloc(bundleSize(count, benchBundleSource, &state));
+    }
+    if (!state.frames || !reader || !state.buffer) {
+        free(state.frames);
+        free(state.buffer);
+        delete reader;
+        return;
+    }
+
+    // 每次迭代：整库写出到内存，再流式读回
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        state.length = 0;
+        state.decoded = 0;
+        writeBundle(count, benchBundleSource, benchBundleSink, &state);
+        reader->reset();
+        BundleStatus status = reader->feed(state.buffer, state.length);
+        checksum = mix(checksum, state.length);
+        checksum = mix(checksum, status);
+        checksum = mix(checksum, state.decoded);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+    checksum = mix(checksum, state.checksum);
+
+    free(state.frames);
+    free(state.buffer);
+    delete reader;
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchCommandParse(BenchResult& result) {
+    static const char* templates[] = {
+        "send %u", "repeat <%u> %u", "delete [%u]", "info %u",
+        "detail (%u)", "raw %u", "verify %u", "continuous <%u>"
+    };
+    const int lineCount = 16;
+    const uint32_t iterations = 2000;
+    BenchRng rng(seed ^ 0x03);
+
+    char lines[lineCount][32];
+    for (int i = 0; i < lineCount; i++) {
+        const char* format = templates[rng.range(0, 7)];
+        snprintf(lines[i], sizeof(lines[i]), format, rng.range(1, 20), rng.range(1, 10));
+    }
+
+    uint32_t checksum = 0;
+    ParsedCommand parsed;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        parseCommand(lines[i % lineCount], parsed);
+        checksum = mix(checksum, parsed.arg(0) + parsed.argc * 100 + parsed.verb[0]);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    result.name = "cmd.parse";
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchRawMatch(BenchResult& result) {
+    const uint32_t iterations = 500;
+    BenchRng rng(seed ^ 0x04);
+
+    // 每对：原始帧 + 带抖动的回波，最后一对使用不相关的帧
+    uint16_t* frames = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES * FRAME_COUNT * 2);
+    result.name = "match.raw";
+    result.iterations = 0;
+    if (!frames) return;
+
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        uint16_t* a = frames + f * 2 * FRAME_PULSES;
+        uint16_t* b = a + FRAME_PULSES;
+        BenchRng frameRng(rng.next());
+        generateFrame(frameRng, a, 0);
+        if (f == FRAME_COUNT - 1) {
+            generateFrame(rng, b, 15);
+        } else {
+            for (int i = 0; i < FRAME_PULSES; i++) {
+                int32_t span = a[i] * 15 / 100;
+                b[i] = (uint16_t)(a[i] + (int32_t)rng.range(0, span * 2) - span);
+            }
+        }
+    }
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        const uint16_t* a = frames + (i % FRAME_COUNT) * 2 * FRAME_PULSES;
+        uint8_t similarity = rawPulsesSimilarity(a, FRAME_PULSES, a + FRAME_PULSES, FRAME_PULSES);
+        checksum = mix(checksum, similarity);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(frames);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchPulseFilter(BenchResult& result) {
+    const uint32_t iterations = 500;
+    const int maxPulses = FRAME_PULSES * 2;
+    BenchRng rng(seed ^ 0x05);
+
+    // 带抖动的帧，约十分之一的长脉冲被毛刺拆成三段
+    uint16_t* frames = (uint16_t*)malloc(sizeof(uint16_t) * maxPulses * (FRAME_COUNT + 1));
+    uint16_t lengths[FRAME_COUNT];
+    result.name = "filter.noisy";
+    result.iterations = 0;
+    if (!frames) return;
+
+    uint16_t* output = frames + maxPulses * FRAME_COUNT;
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        uint16_t* frame = frames + f * maxPulses;
+        generateFrame(rng, output, 10);
+        int n = 0;
+        for (int i = 0; i < FRAME_PULSES; i++) {
+            uint16_t pulse = output[i];
+            if (pulse > 1000 && rng.range(0, 9) == 0) {
+                uint16_t glitch = (uint16_t)rng.range(10, 80);
+                uint16_t head = (uint16_t)rng.range(200, pulse - glitch - 200);
+                frame[n++] = head;
+                frame[n++] = glitch;
+                frame[n++] = pulse - head - glitch;
+            } else {
+                frame[n++] = pulse;
+            }
+        }
+        lengths[f] = n;
+    }
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        int f = i % FRAME_COUNT;
+        PulseFilterResult filtered = filterPulses(frames + f * maxPulses, lengths[f], output,
+                                                  kDefaultPulseFilterConfig);
+        checksum = mix(checksum, filtered.verdict * 1000 + filtered.outputLength);
+        checksum = mix(checksum, output[filtered.outputLength / 2]);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(frames);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+// 以Pronto学习格式(38kHz)写出一帧，帧尾补40ms间隔
+static void formatPronto(const uint16_t* pulses, int length, char* out, size_t size) {
+    const uint64_t unitPs = 0x6D * 241246ULL;
+    int pairs = (length + 1) / 2;
+    int n = snprintf(out, size, "0000 006D %04X 0000", pairs);
+    for (int i = 0; i < pairs * 2 && n < (int)size; i++) {
+        uint32_t us = i < length ? pulses[i] : 40000;
+        uint32_t count = (uint32_t)((us * 1000000ULL + unitPs / 2) / unitPs);
+        n += snprintf(out + n, size - n, " %04X", count);
+    }
+}
+
+void BenchSuite::benchProntoImport(BenchResult& result) {
+    const uint32_t iterations = 500;
+    const size_t textSize = (4 + FRAME_PULSES + 1) * 5 + 1;
+    BenchRng rng(seed ^ 0x08);
+
+    char* texts = (char*)malloc(textSize * FRAME_COUNT);
+    BundleEntry* entry = (BundleEntry*)malloc(sizeof(BundleEntry));
+    result.name = "import.pronto";
+    result.iterations = 0;
+    if (!texts || !entry) {
+        free(texts);
+        free(entry);
+        return;
+    }
+
+    uint16_t frame[FRAME_PULSES];
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        generateFrame(rng, frame, 5);
+        formatPronto(frame, FRAME_PULSES, texts + f * textSize, textSize);
+    }
+
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ProntoStatus status = parsePronto(texts + (i % FRAME_COUNT) * textSize, *entry);
+        checksum = mix(checksum, status * 1000 + entry->rawLength);
+        checksum = mix(checksum, entry->carrierFreq ^ entry->rawData[entry->rawLength / 2]);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(texts);
+    free(entry);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchCodeImport(BenchResult& result) {
+    static const char* formats[] = {"NEC:0x%08lX:32", "SONY:0x%03lX:12", "RC5:0x%03lX:12", "SAMSUNG:0x%08lX"};
+    static const uint32_t masks[] = {0xFFFFFFFFUL, 0xFFF, 0x7FF, 0xFFFFFFFFUL};
+    const int lineCount = 16;
+    const uint32_t iterations = 200;
+    BenchRng rng(seed ^ 0x09);
+
+    char lines[lineCount][32];
+    for (int i = 0; i < lineCount; i++) {
+        int kind = rng.range(0, 3);
+        snprintf(lines[i], sizeof(lines[i]), formats[kind], (unsigned long)(rng.next() & masks[kind]));
+    }
+
+    BundleEntry* entry = (BundleEntry*)malloc(sizeof(BundleEntry));
+    rmt_item32_t* items = (rmt_item32_t*)malloc(sizeof(rmt_item32_t) * RAW_PULSE_ITEMS);
+    result.name = "import.code";
+    result.iterations = 0;
+    if (!entry || !items) {
+        free(entry);
+        free(items);
+        return;
+    }
+
+    // 每次迭代：解析 + 按描述符编码为原始脉冲 + 预构建RMT数据项
+    uint32_t checksum = 0;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        CodeImportStatus status = importCode(lines[i % lineCount], *entry);
+        size_t count = convertRawPulses(entry->rawData, entry->rawLength, items, RAW_PULSE_ITEMS);
+        checksum = mix(checksum, status * 1000 + entry->rawLength);
+        checksum = mix(checksum, entry->repeatPeriod * 1000 + count);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(entry);
+    free(items);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchAnalyze(BenchResult& result) {
+    const uint32_t iterations = 200;
+    BenchRng rng(seed ^ 0x0A);
+
+    BundleEntry* entries = (BundleEntry*)malloc(sizeof(BundleEntry) * FRAME_COUNT);
+    result.name = "analyze.raw";
+    result.iterations = 0;
+    if (!entries) return;
+
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        memset(&entries[f], 0, sizeof(BundleEntry));
+        entries[f].protocol = -1;
+        entries[f].rawLength = FRAME_PULSES;
+        generateFrame(rng, entries[f].rawData, 10);
+    }
+
+    // 每次迭代：聚类 + 推断描述符 + 逐位核对
+    uint32_t checksum = 0;
+    PulseAnalysis analysis;
+    uint32_t start = LatencyStats::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        AnalyzeStatus status = analyzeEntry(entries[i % FRAME_COUNT], analysis);
+        checksum = mix(checksum, status * 1000 + analysis.bits);
+        checksum = mix(checksum, (uint32_t)analysis.value ^ analysis.desc.oneSpace);
+    }
+    uint32_t cycles = LatencyStats::now() - start;
+
+    free(entries);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+void BenchSuite::benchLshNearest(BenchResult& result) {
+    const int captures = 300;
+    const int buckets = 256;
+    const uint32_t iterations = 200;
+    BenchRng rng(seed ^ 0x0B);
+
+    // 几百个原始捕获的LSH最近邻查找，需在一个帧间隔(NEC约40ms)内完成
+    uint16_t* frames = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES * captures);
+    int32_t* heads = (int32_t*)malloc(sizeof(int32_t) * buckets * kDefaultLsh.tables);
+    LshIndex::Slot* slots = (LshIndex::Slot*)malloc(sizeof(LshIndex::Slot) * captures * kDefaultLsh.tables);
+    result.name = "lsh.nearest";
+    result.iterations = 0;
+    if (!frames || !heads || !slots) {
+        free(frames);
+        free(heads);
+        free(slots);
+        return;
+    }
+
+    LshIndex index(heads, buckets, slots, captures);
+    uint8_t levels[FRAME_PULSES];
+    for (int c = 0; c < captures; c++) {
+        uint16_t* frame = frames + c * FRAME_PULSES;
+        generateFrame(rng, frame, 0);
+        uint16_t length = levelPulses(frame, FRAME_PULSES, levels, FRAME_PULSES);
+        index.insert(c, levels, length);
+    }
+
+    // 每次迭代：量化带抖动的帧 + 查候选 + 逐个比较，得到最接近的捕获和置信度
+    uint16_t query[FRAME_PULSES];
+    int32_t candidates[captures];
+    uint32_t checksum = 0;
+    uint32_t cycles = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const uint16_t* target = frames + (i * 7 % captures) * FRAME_PULSES;
+        for (int p = 0; p < FRAME_PULSES; p++) {
+            int32_t span = target[p] * 8 / 100;
+            query[p] = (uint16_t)(target[p] + (int32_t)rng.range(0, span * 2) - span);
+        }
+
+        uint32_t start = LatencyStats::now();
+        uint16_t length = levelPulses(query, FRAME_PULSES, levels, FRAME_PULSES);
+        int count = index.candidates(levels, length, candidates, nullptr, captures);
+        int best = -1;
+        uint8_t bestScore = 0, runnerUp = 0;
+        for (int c = 0; c < count; c++) {
+            uint8_t score = rawPulsesSimilarity(frames + candidates[c] * FRAME_PULSES, FRAME_PULSES,
+                                                query, FRAME_PULSES);
+            if (score > bestScore) {
+                runnerUp = bestScore;
+                bestScore = score;
+                best = candidates[c];
+            } else if (score > runnerUp) {
+                runnerUp = score;
+            }
+        }
+        cycles += LatencyStats::now() - start;
+        checksum = mix(checksum, (uint32_t)best);
+        checksum = mix(checksum, LshIndex::confidence(bestScore, runnerUp));
+    }
+
+    free(frames);
+    free(heads);
+    free(slots);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+struct BenchCaptures {
+    const uint16_t* frames;
+};
+
+static const uint16_t* benchCapturePulses(int32_t id, uint16_t& length, void* ctx) {
+    length = FRAME_PULSES;
+    return ((const BenchCaptures*)ctx)->frames + id * FRAME_PULSES;
+}
+
+void BenchSuite::benchParallelMatch(BenchResult& result, const char* name, MatchWorkers* workers) {
+    const int captures = 300;
+    const uint32_t iterations = 20;
+    BenchRng rng(seed ^ 0x0C);
+
+    // 不经索引逐个比较几百个捕获，两个用例输入相同，耗时之比即并行加速比
+    uint16_t* frames = (uint16_t*)malloc(sizeof(uint16_t) * FRAME_PULSES * captures);
+    result.name = name;
+    result.iterations = 0;
+    if (!frames) return;
+    for (int c = 0; c < captures; c++) generateFrame(rng, frames + c * FRAME_PULSES, 0);
+
+    BenchCaptures ctx = {frames};
+    ParallelMatcher matcher(workers);
+    uint16_t query[FRAME_PULSES];
+    uint32_t checksum = 0;
+    uint32_t cycles = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const uint16_t* target = frames + (i * 13 % captures) * FRAME_PULSES;
+        for (int p = 0; p < FRAME_PULSES; p++) {
+            int32_t span = target[p] * 8 / 100;
+            query[p] = (uint16_t)(target[p] + (int32_t)rng.range(0, span * 2) - span);
+        }
+
+        // 不提前结束，比较次数固定，输出摘要与工作者数无关
+        uint32_t start = LatencyStats::now();
+        ParallelMatchResult match = matcher.match(query, FRAME_PULSES, nullptr, captures, benchCapturePulses, &ctx);
+        cycles += LatencyStats::now() - start;
+        checksum = mix(checksum, (uint32_t)match.best);
+        checksum = mix(checksum, match.similarity * 1000 + match.compared);
+    }
+
+    free(frames);
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp(cycles, iterations);
+    result.checksum = checksum;
+}
+
+int BenchSuite::run(BenchResult* results, int capacity) {
+    int count = 0;
+
+    if (count < capacity) benchRmtConvert(results[count++]);
+    count += benchStorage(results + count, capacity - count);
+    if (count < capacity) benchLearner(results[count++], "learn.stream.5", 5);
+    if (count < capacity) benchLearner(results[count++], "learn.stream.20", 20);
+    if (count < capacity) benchLearner(results[count++], "learn.stream.64", 64);
+    if (count < capacity) benchBatchSession(results[count++]);
+    if (count < capacity) benchBundle(results[count++]);
+    if (count < capacity) benchCommandParse(results[count++]);
+    if (count < capacity) benchRawMatch(results[count++]);
+    if (count < capacity) benchPulseFilter(results[count++]);
+    if (count < capacity) benchProntoImport(results[count++]);
+    if (count < capacity) benchCodeImport(results[count++]);
+    if (count < capacity) benchAnalyze(results[count++]);
+    if (count < capacity) benchLshNearest(results[count++]);
+    SerialMatchWorkers serial;
+    if (count < capacity) benchParallelMatch(results[count++], "match.workers.1", &serial);
+    if (count < capacity) {
+        benchParallelMatch(results[count++], "match.workers.2", match_workers ? match_workers : &serial);
+    }
+
+    return count;
+}
+
+BenchVerdict BenchSuite::compare(const BenchResult& result, const BenchBaselineEntry* baseline,
+                                 bool sameSeed, uint32_t& ratioPct) {
+    ratioPct = 0;
+    if (!baseline || baseline->nsPerOp == 0) return BENCH_NEW;
+
+    ratioPct = (uint32_t)((uint64_t)result.nsPerOp * 100 / baseline->nsPerOp);
+    if (sameSeed && result.checksum != baseline->checksum) return BENCH_MISMATCH;
+    if (ratioPct > REGRESSION_PCT) return BENCH_REGRESSION;
+    if (ratioPct < FASTER_PCT) return BENCH_FASTER;
+    return BENCH_OK;
+}
+
+const char* BenchSuite::verdictName(BenchVerdict verdict) {
+    switch (verdict) {
+        case BENCH_OK: return "ok";
+        case BENCH_FASTER: return "faster";
+        case BENCH_REGRESSION: return "REGRESSION";
+        case BENCH_MISMATCH: return "MISMATCH";
+        default: return "new";
+    }
+}
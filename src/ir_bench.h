@@ -0,0 +1,94 @@
+#ifndef IR_BENCH_H
+#define IR_BENCH_H
+
+#include <stdint.h>
+
+class MatchWorkers;
+
+// 固定种子的伪随机数发生器(xorshift32)，保证每次运行的输入完全相同
+class BenchRng {
+private:
+    uint32_t state;
+
+public:
+    explicit BenchRng(uint32_t seed) : state(seed ? seed : 0x9E3779B9UL) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // [lo, hi] 范围内的整数
+    uint32_t range(uint32_t lo, uint32_t hi) {
+        return lo + next() % (hi - lo + 1);
+    }
+};
+
+// 单个基准用例的结果
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;
+    uint32_t nsPerOp;
+    uint32_t checksum;            // 输出摘要：同一种子下应保持不变，变化说明行为改变
+};
+
+// 基线中的单项(按用例顺序保存)
+struct BenchBaselineEntry {
+    uint32_t nsPerOp;
+    uint32_t checksum;
+};
+
+// 与基线比较的结论
+enum BenchVerdict {
+    BENCH_NEW = 0,                // 无基线
+    BENCH_OK,
+    BENCH_FASTER,
+    BENCH_REGRESSION,
+    BENCH_MISMATCH                // 同种子下输出摘要不同
+};
+
+// 基准测试套件：覆盖RMT转换、存储增删加载保存、流式学习、批量学习、信号库包、命令解析、原始脉冲匹配、脉冲过滤、红外码导入、LSH最近邻查找、并行匹配
+// 由主机端工具的bench命令运行(pio run -e native)，结果与src/tools/bench_baseline.csv比较
+class BenchSuite {
+public:
+    static const int MAX_CASES = 24;
+    static const uint32_t DEFAULT_SEED = 20240601;
+    static const uint32_t REGRESSION_PCT = 120;   // 慢于基线20%以上判为退化
+    static const uint32_t FASTER_PCT = 80;
+
+private:
+    uint32_t seed;
+    MatchWorkers* match_workers;
+
+    void benchRmtConvert(BenchResult& result);
+    int benchStorage(BenchResult* results, int capacity);
+    void benchLearner(BenchResult& result, const char* name, int sampleCount);
+    void benchBatchSession(BenchResult& result);
+    void benchBundle(BenchResult& result);
+    void benchCommandParse(BenchResult& result);
+    void benchRawMatch(BenchResult& result);
+    void benchPulseFilter(BenchResult& result);
+    void benchProntoImport(BenchResult& result);
+    void benchCodeImport(BenchResult& result);
+    void benchAnalyze(BenchResult& result);
+    void benchLshNearest(BenchResult& result);
+    void benchParallelMatch(BenchResult& result, const char* name, MatchWorkers* workers);
+
+public:
+    explicit BenchSuite(uint32_t seed = DEFAULT_SEED);
+
+    // 并行匹配用例使用的工作者(主机端工具为两个线程)，未设置时该用例退化为单工作者
+    void setMatchWorkers(MatchWorkers* workers) { match_workers = workers; }
+
+    // 依次运行全部用例，返回写入results的用例数
+    int run(BenchResult* results, int capacity);
+
+    // 与基线比较，ratioPct输出当前耗时相对基线的百分比
+    static BenchVerdict compare(const BenchResult& result, const BenchBaselineEntry* baseline,
+                                bool sameSeed, uint32_t& ratioPct);
+    static const char* verdictName(BenchVerdict verdict);
+};
+
+#endif
@@ -0,0 +1,386 @@
+#include "ir_bundle.h"
+#include "ir_pulse_filter.h"
+#include <string.h>
+
+static const uint8_t BUNDLE_MAGIC[4] = {'I', 'R', 'B', 'D'};
+static const int MAX_DICT = 16;              // 4位下标
+
+// ============== 小端读写 ==============
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+const char* bundleStatusName(BundleStatus status) {
+    switch (status) {
+        case BUNDLE_OK: return "ok";
+        case BUNDLE_IN_PROGRESS: return "in progress";
+        case BUNDLE_BAD_MAGIC: return "bad magic";
+        case BUNDLE_BAD_VERSION: return "bad version";
+        case BUNDLE_TOO_LARGE: return "too large";
+        case BUNDLE_CORRUPT: return "corrupt";
+        case BUNDLE_CRC_MISMATCH: return "crc mismatch";
+        case BUNDLE_REJECTED: return "rejected";
+        default: return "?";
+    }
+}
+
+uint32_t bundleCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// ============== 脉冲块 ==============
+
+// 量化：与捕获预处理相同的聚类吸附，不合并毛刺(长度不变)、不拒绝。
+// 容差小于解码容差(25%)，吸附后的波形仍能按原协议解码
+static const PulseFilterConfig kBundleQuantize = {true, 0, 10, 0, 100, 100};
+
+// 建立字典，超过MAX_DICT种时长返回0(按原始格式写出)
+static int buildDictionary(const uint16_t* pulses, uint16_t length, uint16_t* dict) {
+    int size = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        int d = 0;
+        while (d < size && dict[d] != pulses[i]) d++;
+        if (d < size) continue;
+        if (size >= MAX_DICT) return 0;
+        dict[size++] = pulses[i];
+    }
+    return size;
+}
+
+// 选择写出的脉冲并建立字典：未经过滤的捕获带有抖动，时长种类超过MAX_DICT时先量化到scratch，
+// 量化后放得下字典则写出量化结果，否则仍写出原始脉冲(size为0)
+static const uint16_t* blockPulses(const uint16_t* pulses, uint16_t length, uint16_t* scratch,
+                                   uint16_t* dict, int& size) {
+    size = buildDictionary(pulses, length, dict);
+    if (size > 0 || length > BundleEntry::MAX_PULSES) return pulses;
+
+    filterPulses(pulses, length, scratch, kBundleQuantize);
+    size = buildDictionary(scratch, length, dict);
+    return size > 0 ? scratch : pulses;
+}
+
+static size_t blockSize(const uint16_t* pulses, uint16_t length) {
+    uint16_t scratch[BundleEntry::MAX_PULSES];
+    uint16_t dict[MAX_DICT];
+    int size;
+    blockPulses(pulses, length, scratch, dict, size);
+    if (size == 0) return 1 + (size_t)length * 2;
+    return 1 + (size_t)size * 2 + (length + 1) / 2;
+}
+
+// 写出脉冲块到out(容量至少为blockSize)，返回写入字节数
+static size_t encodeBlock(const uint16_t* pulses, uint16_t length, uint8_t* out) {
+    uint16_t scratch[BundleEntry::MAX_PULSES];
+    uint16_t dict[MAX_DICT];
+    int size;
+    pulses = blockPulses(pulses, length, scratch, dict, size);
+    uint8_t* p = out;
+    *p++ = (uint8_t)size;
+
+    if (size == 0) {
+        for (uint16_t i = 0; i < length; i++, p += 2) put16(p, pulses[i]);
+        return p - out;
+    }
+
+    for (int d = 0; d < size; d++, p += 2) put16(p, dict[d]);
+    for (uint16_t i = 0; i < length; i += 2) {
+        uint8_t packed = 0;
+        for (int half = 0; half < 2 && i + half < length; half++) {
+            int d = 0;
+            while (dict[d] != pulses[i + half]) d++;
+            packed |= d << (half * 4);
+        }
+        *p++ = packed;
+    }
+    return p - out;
+}
+
+// 从data解码length个脉冲，返回使用的字节数，数据不足或下标越界返回0
+static size_t decodeBlock(const uint8_t* data, size_t available, uint16_t* pulses, uint16_t length) {
+    if (available < 1) return 0;
+    int size = data[0];
+    if (size > MAX_DICT) return 0;
+
+    size_t needed = size == 0 ? 1 + (size_t)length * 2 : 1 + (size_t)size * 2 + (length + 1) / 2;
+    if (available < needed) return 0;
+
+    const uint8_t* p = data + 1;
+    if (size == 0) {
+        for (uint16_t i = 0; i < length; i++, p += 2) pulses[i] = get16(p);
+        return needed;
+    }
+
+    uint16_t dict[MAX_DICT];
+    for (int d = 0; d < size; d++, p += 2) dict[d] = get16(p);
+    for (uint16_t i = 0; i < length; i++) {
+        int d = (p[i / 2] >> ((i % 2) * 4)) & 0x0F;
+        if (d >= size) return 0;
+        pulses[i] = dict[d];
+    }
+    return needed;
+}
+
+// ============== 写出 ==============
+
+static size_t entryDataSize(const BundleEntry& entry) {
+    return blockSize(entry.rawData, entry.rawLength) + blockSize(entry.repeatData, entry.repeatLength) +
+           entry.stateLength;
+}
+
+static void encodeIndex(const BundleEntry& entry, uint32_t dataOffset, uint32_t dataLength, uint8_t* out) {
+    memset(out, 0, BUNDLE_INDEX_SIZE);
+    put16(out + 0, (uint16_t)entry.protocol);
+    put16(out + 2, entry.bits);
+    put32(out + 4, (uint32_t)entry.value);
+    put16(out + 8, entry.carrierFreq);
+    out[10] = entry.dutyCycle;
+    out[11] = entry.stateLength;
+    put16(out + 12, entry.repeatPeriod);
+    put16(out + 14, entry.rawLength);
+    put16(out + 16, entry.repeatLength);
+    put32(out + 20, dataOffset);
+    put32(out + 24, dataLength);
+    strncpy((char*)out + 28, entry.name, BundleEntry::MAX_NAME - 1);
+    put32(out + 60, (uint32_t)(entry.value >> 32));
+}
+
+// 取出合法的信号，长度超出上限的截断
+static bool fetchEntry(BundleSourceFn source, int index, BundleEntry& entry, void* ctx) {
+    memset(&entry, 0, sizeof(entry));
+    if (!source(index, entry, ctx)) return false;
+    if (entry.rawLength > BundleEntry::MAX_PULSES) entry.rawLength = BundleEntry::MAX_PULSES;
+    if (entry.repeatLength > BundleEntry::MAX_REPEAT) entry.repeatLength = BundleEntry::MAX_REPEAT;
+    if (entry.stateLength > BundleEntry::MAX_STATE) entry.stateLength = BundleEntry::MAX_STATE;
+    entry.name[BundleEntry::MAX_NAME - 1] = '\0';
+    return true;
+}
+
+// 写出一段并累计CRC
+struct BundleOutput {
+    BundleSinkFn sink;
+    void* ctx;
+    uint32_t crc;
+    size_t written;
+
+    void write(const uint8_t* data, size_t length) {
+        crc = bundleCrc32(crc, data, length);
+        written += length;
+        if (sink) sink(data, length, ctx);
+    }
+};
+
+static size_t emitBundle(int count, BundleSourceFn source, BundleSinkFn sink, void* ctx) {
+    if (!source || count < 0 || count > BundleReader::MAX_ENTRIES) return 0;
+
+    // 第一遍：统计可用信号和数据区大小
+    static BundleEntry entry;
+    int usable = 0;
+    uint32_t dataSize = 0;
+    for (int i = 0; i < count; i++) {
+        if (!fetchEntry(source, i, entry, ctx)) continue;
+        usable++;
+        dataSize += entryDataSize(entry);
+    }
+
+    uint32_t dataStart = BUNDLE_HEADER_SIZE + usable * BUNDLE_INDEX_SIZE;
+    uint32_t total = dataStart + dataSize + BUNDLE_CRC_SIZE;
+    if (!sink) return total;
+
+    BundleOutput out = {sink, ctx, 0, 0};
+    uint8_t header[BUNDLE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, BUNDLE_MAGIC, 4);
+    header[4] = BUNDLE_VERSION;
+    header[5] = (uint8_t)usable;
+    put32(header + 8, total);
+    put32(header + 12, dataStart);
+    out.write(header, sizeof(header));
+
+    // 第二遍：索引
+    uint32_t offset = 0;
+    uint8_t record[BUNDLE_INDEX_SIZE];
+    for (int i = 0; i < count; i++) {
+        if (!fetchEntry(source, i, entry, ctx)) continue;
+        uint32_t length = entryDataSize(entry);
+        encodeIndex(entry, offset, length, record);
+        out.write(record, sizeof(record));
+        offset += length;
+    }
+
+    // 第三遍：数据块
+    static uint8_t block[BundleReader::MAX_BLOCK];
+    for (int i = 0; i < count; i++) {
+        if (!fetchEntry(source, i, entry, ctx)) continue;
+        size_t length = encodeBlock(entry.rawData, entry.rawLength, block);
+        length += encodeBlock(entry.repeatData, entry.repeatLength, block + length);
+        memcpy(block + length, entry.state, entry.stateLength);
+        length += entry.stateLength;
+        out.write(block, length);
+    }
+
+    uint8_t trailer[BUNDLE_CRC_SIZE];
+    put32(trailer, out.crc);
+    out.write(trailer, sizeof(trailer));
+    return out.written;
+}
+
+size_t writeBundle(int count, BundleSourceFn source, BundleSinkFn sink, void* ctx) {
+    if (!sink) return 0;
+    return emitBundle(count, source, sink, ctx);
+}
+
+size_t bundleSize(int count, BundleSourceFn source, void* ctx) {
+    return emitBundle(count, source, nullptr, ctx);
+}
+
+// ============== BundleReader 实现 ==============
+
+BundleReader::BundleReader(BundleEntryFn onEntry, void* ctx) : on_entry(onEntry), entry_ctx(ctx) {
+    reset();
+}
+
+void BundleReader::reset() {
+    stage = STAGE_HEADER;
+    status = BUNDLE_IN_PROGRESS;
+    filled = 0;
+    needed = BUNDLE_HEADER_SIZE;
+    received = 0;
+    total_length = 0;
+    entry_count = 0;
+    current_entry = 0;
+    data_offset = 0;
+    crc = 0;
+}
+
+BundleStatus BundleReader::feed(const uint8_t* data, size_t length, size_t* consumed) {
+    size_t used = 0;
+    while (status == BUNDLE_IN_PROGRESS && used < length) {
+        uint8_t* target = stage == STAGE_HEADER ? header :
+                          stage == STAGE_INDEX ? index :
+                          stage == STAGE_DATA ? block : trailer;
+        size_t take = needed - filled;
+        if (take > length - used) take = length - used;
+        memcpy(target + filled, data + used, take);
+
+        // CRC不覆盖尾部自身
+        if (stage != STAGE_TRAILER) crc = bundleCrc32(crc, data + used, take);
+        filled += take;
+        used += take;
+        received += take;
+
+        if (filled == needed) status = finishStage();
+    }
+    if (consumed) *consumed = used;
+    return status;
+}
+
+BundleStatus BundleReader::finishStage() {
+    filled = 0;
+    switch (stage) {
+        case STAGE_HEADER: {
+            if (memcmp(header, BUNDLE_MAGIC, 4) != 0) return BUNDLE_BAD_MAGIC;
+            if (header[4] < BUNDLE_MIN_VERSION || header[4] > BUNDLE_VERSION) return BUNDLE_BAD_VERSION;
+            entry_count = header[5];
+            total_length = get32(header + 8);
+            uint32_t dataStart = get32(header + 12);
+            if (entry_count > MAX_ENTRIES) return BUNDLE_TOO_LARGE;
+            if (dataStart != BUNDLE_HEADER_SIZE + entry_count * BUNDLE_INDEX_SIZE ||
+                total_length < dataStart + BUNDLE_CRC_SIZE) {
+                return BUNDLE_CORRUPT;
+            }
+            if (entry_count == 0) {
+                stage = STAGE_TRAILER;
+                needed = BUNDLE_CRC_SIZE;
+                return total_length == dataStart + BUNDLE_CRC_SIZE ? BUNDLE_IN_PROGRESS : BUNDLE_CORRUPT;
+            }
+            stage = STAGE_INDEX;
+            needed = entry_count * BUNDLE_INDEX_SIZE;
+            return BUNDLE_IN_PROGRESS;
+        }
+        case STAGE_INDEX:
+            stage = STAGE_DATA;
+            return beginEntry();
+        case STAGE_DATA: {
+            BundleStatus result = decodeEntry();
+            if (result != BUNDLE_IN_PROGRESS) return result;
+            current_entry++;
+            if (current_entry < entry_count) return beginEntry();
+
+            // 数据区之后只剩尾部
+            uint32_t dataStart = BUNDLE_HEADER_SIZE + entry_count * BUNDLE_INDEX_SIZE;
+            if (total_length != dataStart + data_offset + BUNDLE_CRC_SIZE) return BUNDLE_CORRUPT;
+            stage = STAGE_TRAILER;
+            needed = BUNDLE_CRC_SIZE;
+            return BUNDLE_IN_PROGRESS;
+        }
+        case STAGE_TRAILER:
+            stage = STAGE_DONE;
+            return get32(trailer) == crc ? BUNDLE_OK : BUNDLE_CRC_MISMATCH;
+        default:
+            return status;
+    }
+}
+
+BundleStatus BundleReader::beginEntry() {
+    const uint8_t* record = index + current_entry * BUNDLE_INDEX_SIZE;
+    uint32_t offset = get32(record + 20);
+    uint32_t length = get32(record + 24);
+    // 数据块必须按索引顺序紧密排列
+    if (offset != data_offset) return BUNDLE_CORRUPT;
+    if (length == 0 || length > MAX_BLOCK) return BUNDLE_TOO_LARGE;
+    needed = length;
+    data_offset += length;
+    return BUNDLE_IN_PROGRESS;
+}
+
+BundleStatus BundleReader::decodeEntry() {
+    const uint8_t* record = index + current_entry * BUNDLE_INDEX_SIZE;
+    memset(&entry, 0, sizeof(entry));
+    entry.protocol = (int16_t)get16(record + 0);
+    entry.bits = get16(record + 2);
+    entry.value = get32(record + 4) | ((uint64_t)get32(record + 60) << 32);
+    entry.carrierFreq = get16(record + 8);
+    entry.dutyCycle = record[10];
+    entry.stateLength = record[11];
+    entry.repeatPeriod = get16(record + 12);
+    entry.rawLength = get16(record + 14);
+    entry.repeatLength = get16(record + 16);
+    memcpy(entry.name, record + 28, BundleEntry::MAX_NAME - 1);
+    entry.name[BundleEntry::MAX_NAME - 1] = '\0';
+
+    if (entry.rawLength > BundleEntry::MAX_PULSES || entry.repeatLength > BundleEntry::MAX_REPEAT ||
+        entry.stateLength > BundleEntry::MAX_STATE) {
+        return BUNDLE_TOO_LARGE;
+    }
+
+    size_t used = decodeBlock(block, needed, entry.rawData, entry.rawLength);
+    if (used == 0) return BUNDLE_CORRUPT;
+    size_t repeatUsed = decodeBlock(block + used, needed - used, entry.repeatData, entry.repeatLength);
+    if (repeatUsed == 0 || used + repeatUsed + entry.stateLength != needed) return BUNDLE_CORRUPT;
+    memcpy(entry.state, block + used + repeatUsed, entry.stateLength);
+
+    if (on_entry && !on_entry(entry, entry_ctx)) return BUNDLE_REJECTED;
+    return BUNDLE_IN_PROGRESS;
+}
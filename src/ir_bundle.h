@@ -0,0 +1,129 @@
+#ifndef IR_BUNDLE_H
+#define IR_BUNDLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 信号库二进制包(小端)，用于批量烧录同一套信号：
+//   头部(16字节)  magic "IRBD" | 版本 | 信号数 | 保留(2) | 总长度(4) | 数据区偏移(4)
+//   索引(每个信号64字节)  协议、值、位数、载波、重复参数、名称及数据块位置
+//   数据区  每个信号依次为原始脉冲块、重复帧块和状态字节(有状态协议，逐字节原样保存)
+//   尾部(4字节)  CRC32，覆盖之前的全部字节
+// 脉冲块：字典项数(1字节)，>0时为字典(每项2字节) + 每脉冲4位下标(两个一字节)，
+//         =0时为逐个2字节的原始脉冲。过滤量化后的波形通常只有少数几种时长，可压缩到约三分之一；
+//         时长超过16种(未经过滤的抖动捕获)时写出前先按10%容差聚类吸附，吸附后放得下字典则写出吸附后的脉冲
+// 版本2在索引中增加了值的高32位和状态字节数，版本1的包仍可读取(这两项为0)
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+static const uint8_t BUNDLE_VERSION = 2;
+static const uint8_t BUNDLE_MIN_VERSION = 1;
+static const size_t BUNDLE_HEADER_SIZE = 16;
+static const size_t BUNDLE_INDEX_SIZE = 64;
+static const size_t BUNDLE_CRC_SIZE = 4;
+
+// 包中的一个信号(与存储格式无关的中间表示)
+struct BundleEntry {
+    static const int MAX_NAME = 32;
+    static const int MAX_PULSES = 256;
+    static const int MAX_REPEAT = 32;
+    static const int MAX_STATE = 53;          // 与IRremoteESP8266的kStateSizeMax一致
+
+    int16_t protocol;             // decode_type_t的数值
+    uint16_t bits;
+    uint64_t value;
+    uint16_t carrierFreq;
+    uint8_t dutyCycle;
+    uint16_t repeatPeriod;
+    uint16_t rawLength;
+    uint16_t repeatLength;
+    uint8_t stateLength;          // >0时为有状态协议(空调等)，value只是状态的指纹
+    char name[MAX_NAME];
+    uint16_t rawData[MAX_PULSES];
+    uint16_t repeatData[MAX_REPEAT];
+    uint8_t state[MAX_STATE];
+};
+
+enum BundleStatus {
+    BUNDLE_OK = 0,
+    BUNDLE_IN_PROGRESS,           // 读取中，需要更多数据
+    BUNDLE_BAD_MAGIC,
+    BUNDLE_BAD_VERSION,
+    BUNDLE_TOO_LARGE,             // 信号数或数据块超出上限
+    BUNDLE_CORRUPT,               // 长度、偏移或脉冲块不一致
+    BUNDLE_CRC_MISMATCH,
+    BUNDLE_REJECTED               // 回调拒绝了某个信号(如存储已满)
+};
+
+const char* bundleStatusName(BundleStatus status);
+
+// CRC32(IEEE 802.3，多项式0xEDB88320)，crc传入上一段的结果以分段计算，首段传0
+uint32_t bundleCrc32(uint32_t crc, const uint8_t* data, size_t length);
+
+// ============== 写出 ==============
+
+// 按下标取第index个信号，返回false表示该信号不可用(写出过程中不应变化)
+typedef bool (*BundleSourceFn)(int index, BundleEntry& out, void* ctx);
+// 接收写出的字节
+typedef void (*BundleSinkFn)(const uint8_t* data, size_t length, void* ctx);
+
+// 流式写出count个信号，不需要整包缓冲。返回总字节数，失败返回0
+size_t writeBundle(int count, BundleSourceFn source, BundleSinkFn sink, void* ctx);
+
+// 只计算包大小，不写出
+size_t bundleSize(int count, BundleSourceFn source, void* ctx);
+
+// ============== 读取 ==============
+
+// 收到一个完整解码的信号；返回false中止读取(BUNDLE_REJECTED)
+// 注意：回调发生在整包CRC校验之前，调用方应在feed返回BUNDLE_OK后才提交
+typedef bool (*BundleEntryFn)(const BundleEntry& entry, void* ctx);
+
+// 流式读取：数据可以任意分段送入，内存占用固定(索引缓冲 + 一个数据块 + 一个信号)
+class BundleReader {
+public:
+    static const int MAX_ENTRIES = 64;
+    static const size_t MAX_BLOCK = 1 + 16 * 2 + BundleEntry::MAX_PULSES * 2 +
+                                    1 + 16 * 2 + BundleEntry::MAX_REPEAT * 2 +
+                                    BundleEntry::MAX_STATE;
+
+private:
+    enum Stage { STAGE_HEADER, STAGE_INDEX, STAGE_DATA, STAGE_TRAILER, STAGE_DONE };
+
+    BundleEntryFn on_entry;
+    void* entry_ctx;
+    Stage stage;
+    BundleStatus status;
+    uint8_t header[BUNDLE_HEADER_SIZE];
+    uint8_t index[MAX_ENTRIES * BUNDLE_INDEX_SIZE];
+    uint8_t block[MAX_BLOCK];
+    uint8_t trailer[BUNDLE_CRC_SIZE];
+    BundleEntry entry;
+    size_t filled;                // 当前阶段已收到的字节
+    size_t needed;                // 当前阶段需要的字节
+    uint32_t received;            // 已收到的总字节(不含超出总长度的部分)
+    uint32_t total_length;
+    uint8_t entry_count;
+    uint8_t current_entry;
+    uint32_t data_offset;         // 下一个数据块应在数据区中的偏移
+    uint32_t crc;
+
+    BundleStatus finishStage();
+    BundleStatus beginEntry();
+    BundleStatus decodeEntry();
+
+public:
+    BundleReader(BundleEntryFn onEntry = nullptr, void* ctx = nullptr);
+
+    void reset();
+
+    // 送入一段数据，返回BUNDLE_IN_PROGRESS、BUNDLE_OK(整包读完且CRC正确)或错误
+    // 出错或完成后继续送入的数据被忽略；consumed输出本次实际使用的字节数
+    BundleStatus feed(const uint8_t* data, size_t length, size_t* consumed = nullptr);
+
+    BundleStatus getStatus() const { return status; }
+    uint32_t bytesReceived() const { return received; }
+    uint32_t totalLength() const { return total_length; }   // 头部读完前为0
+    int entryCount() const { return entry_count; }
+    int entriesDecoded() const { return current_entry; }
+};
+
+#endif
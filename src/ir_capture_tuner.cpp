@@ -0,0 +1,62 @@
+#include "ir_capture_tuner.h"
+
+CaptureTuner::CaptureTuner(const CaptureTunerConfig& config) : config(config) {
+    reset(CAPTURE_DEFAULT_TIMEOUT_MS);
+}
+
+void CaptureTuner::reset(uint8_t timeoutMs) {
+    timeout_ms = timeoutMs;
+    target_timeout_ms = timeoutMs;
+    longest_space_us = 0;
+    last_decoded = true;
+    last_pulses = 0;
+    stats = {0, 0, 0, 0};
+    latency.reset();
+}
+
+bool CaptureTuner::observe(const CaptureObservation& frame) {
+    stats.frames++;
+    latency.record(frame.durationUs + (uint32_t)timeout_ms * 1000);
+
+    // 被截断的一帧：两段都无法解码，间隔只比当前超时稍长
+    if (!frame.decoded && !last_decoded && !frame.overflow && frame.gapUs > 0 &&
+        frame.gapUs <= (uint32_t)config.maxTimeoutMs * 1000 && frame.pulses != last_pulses) {
+        stats.splits++;
+        if (frame.gapUs > longest_space_us) longest_space_us = frame.gapUs;
+    }
+    last_decoded = frame.decoded;
+    last_pulses = frame.pulses;
+
+    if (frame.longestSpaceUs > longest_space_us) longest_space_us = frame.longestSpaceUs;
+    if (frame.overflow) stats.overflows++;
+
+    retarget();
+    return pending();
+}
+
+void CaptureTuner::retarget() {
+    uint32_t timeoutUs = longest_space_us * (100 + config.marginPct) / 100;
+    uint32_t timeout = (timeoutUs + 999) / 1000;
+    if (timeout < config.minTimeoutMs) timeout = config.minTimeoutMs;
+    if (timeout > config.maxTimeoutMs) timeout = config.maxTimeoutMs;
+
+    // 预热期间只增不减
+    if (stats.frames < config.warmupFrames && timeout < timeout_ms) timeout = timeout_ms;
+    target_timeout_ms = (uint8_t)timeout;
+}
+
+bool CaptureTuner::pending() const {
+    if (target_timeout_ms > timeout_ms) return true;
+    return timeout_ms - target_timeout_ms >= TIMEOUT_STEP_MS;
+}
+
+void CaptureTuner::apply() {
+    if (target_timeout_ms == timeout_ms) return;
+    timeout_ms = target_timeout_ms;
+    stats.retunes++;
+}
+
+uint16_t CaptureTuner::overflowPermille() const {
+    if (stats.frames == 0) return 0;
+    return (uint16_t)((uint64_t)stats.overflows * 1000 / stats.frames);
+}
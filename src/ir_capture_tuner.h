@@ -0,0 +1,83 @@
+#ifndef IR_CAPTURE_TUNER_H
+#define IR_CAPTURE_TUNER_H
+
+#include <stdint.h>
+#include "ir_latency.h"
+
+// 捕获参数自适应：按本次会话(通常是一个遥控器)观察到的帧调整IRrecv的帧结束超时
+//   超时越短，短帧(NEC等)结束后越早解码；太短则一帧被截成几段。取帧内最长space加余量
+// 相邻两段都未能解码、间隔不超过超时上限且脉冲数不同时，视为一帧被超时截断，超时提高到能覆盖该间隔；
+// 脉冲数相同的两段更可能是按住按键时的重复帧
+// 会话的前warmupFrames帧只增不减，之后变化超过门限才调整，由调用者在帧间空闲时进行。
+// 捕获缓冲不调整：设备上按CAPTURE_BUFFER_SIZE一次分配，缩小有效长度只会让长帧溢出而不省内存，溢出只做统计
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+struct CaptureTunerConfig {
+    uint8_t minTimeoutMs;
+    uint8_t maxTimeoutMs;
+    uint8_t marginPct;            // 相对观察值的余量
+    uint8_t warmupFrames;
+};
+
+const CaptureTunerConfig kDefaultCaptureTuner = {6, 60, 25, 3};
+static const uint8_t CAPTURE_DEFAULT_TIMEOUT_MS = 15;     // 与IRrecv的默认超时kTimeoutMs相同
+static const uint16_t CAPTURE_BUFFER_SIZE = 1024;         // 捕获缓冲项数(含IRrecv的rawbuf[0])，容纳最长的空调帧
+
+// 一段捕获的摘要，时间单位为微秒
+struct CaptureObservation {
+    uint16_t pulses;
+    uint32_t durationUs;          // 第一个mark开始到最后一个mark结束
+    uint32_t longestSpaceUs;      // 帧内最长的space
+    uint32_t gapUs;               // 与上一段捕获之间的间隔，未知时为0
+    bool overflow;                // 缓冲已满，帧被截断
+    bool decoded;                 // 解码出了协议
+};
+
+struct CaptureTunerStats {
+    uint32_t frames;
+    uint32_t overflows;
+    uint32_t splits;              // 判定为被超时截断的帧
+    uint32_t retunes;             // 实际调整的次数
+};
+
+class CaptureTuner {
+public:
+    static const uint8_t TIMEOUT_STEP_MS = 2;     // 超时缩短至少这么多才调整
+
+    explicit CaptureTuner(const CaptureTunerConfig& config = kDefaultCaptureTuner);
+
+    void setConfig(const CaptureTunerConfig& config) { this->config = config; }
+    const CaptureTunerConfig& getConfig() const { return config; }
+
+    // 开始新会话：清除观察值和统计，从当前使用的超时开始
+    void reset(uint8_t timeoutMs);
+
+    // 记录一段捕获，需要调整时返回true
+    bool observe(const CaptureObservation& frame);
+    bool pending() const;
+    // 调用者按targetTimeoutMs重建捕获后调用
+    void apply();
+
+    uint8_t getTimeoutMs() const { return timeout_ms; }
+    uint8_t targetTimeoutMs() const { return target_timeout_ms; }
+
+    const CaptureTunerStats& getStats() const { return stats; }
+    uint16_t overflowPermille() const;
+    // 按键到解码的延迟(微秒)：帧长加超时，不含调用者发现整帧的检查间隔
+    const LatencyHistogram& getLatency() const { return latency; }
+
+private:
+    CaptureTunerConfig config;
+    uint8_t timeout_ms;
+    uint8_t target_timeout_ms;
+
+    uint32_t longest_space_us;    // 本会话帧内最长的space(含判定为截断处的间隔)
+    bool last_decoded;
+    uint16_t last_pulses;
+
+    CaptureTunerStats stats;
+    LatencyHistogram latency;
+
+    void retarget();
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "ir_carrier.h"
+
+// ============== CarrierDetector 实现 ==============
+
+CarrierDetector::CarrierDetector(uint8_t pin, rmt_channel_t ch, bool activeLow)
+    : pin(pin), channel(ch), active_low(activeLow), initialized(false), running(false),
+      ringbuf(nullptr), estimator(80000000UL / CLK_DIV) {
+}
+
+CarrierDetector::~CarrierDetector() {
+    if (initialized) {
+        end();
+    }
+}
+
+bool CarrierDetector::begin() {
+    if (initialized) return true;
+
+    rmt_config_t config = {
+        .rmt_mode = RMT_MODE_RX,
+        .channel = channel,
+        .gpio_num = (gpio_num_t)pin,
+        .clk_div = CLK_DIV,
+        .mem_block_num = 2,
+        .flags = 0,
+        .rx_config = {
+            .idle_threshold = IDLE_THRESHOLD,
+            .filter_ticks_thresh = FILTER_TICKS,
+            .filter_en = true
+        }
+    };
+
+    esp_err_t ret = rmt_config(&config);
+    if (ret != ESP_OK) {
+        Serial.printf("[Carrier] 配置失败: %s\n", esp_err_to_name(ret));
+        return false;
+    }
+
+    ret = rmt_driver_install(channel, 4096, 0);
+    if (ret != ESP_OK) {
+        Serial.printf("[Carrier] 驱动安装失败: %s\n", esp_err_to_name(ret));
+        return false;
+    }
+
+    rmt_get_ringbuf_handle(channel, &ringbuf);
+    initialized = true;
+    Serial.printf("[Carrier] 载波检测器初始化成功，通道: %d, 引脚: GPIO%d\n", channel, pin);
+    return true;
+}
+
+void CarrierDetector::end() {
+    if (initialized) {
+        stop();
+        rmt_driver_uninstall(channel);
+        ringbuf = nullptr;
+        initialized = false;
+    }
+}
+
+bool CarrierDetector::start() {
+    if (!initialized) return false;
+
+    estimator.reset();
+    if (!running) {
+        rmt_rx_start(channel, true);
+        running = true;
+    }
+    return true;
+}
+
+void CarrierDetector::stop() {
+    if (running) {
+        rmt_rx_stop(channel);
+        running = false;
+    }
+}
+
+bool CarrierDetector::isRunning() const {
+    return running;
+}
+
+void CarrierDetector::poll() {
+    if (!running || !ringbuf) return;
+
+    size_t size = 0;
+    rmt_item32_t* items;
+    // 每个环形缓冲区条目对应一个载波突发(一个mark)
+    while ((items = (rmt_item32_t*)xRingbufferReceive(ringbuf, &size, 0)) != nullptr) {
+        size_t count = size / sizeof(rmt_item32_t);
+        uint32_t t = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (items[i].duration0 == 0) break;
+            estimator.addEdge(t, (items[i].level0 != 0) != active_low);
+            t += items[i].duration0;
+            if (items[i].duration1 == 0) break;
+            estimator.addEdge(t, (items[i].level1 != 0) != active_low);
+            t += items[i].duration1;
+        }
+        estimator.endBurst();
+        vRingbufferReturnItem(ringbuf, items);
+    }
+}
+
+CarrierEstimate CarrierDetector::getEstimate() {
+    poll();
+    return estimator.estimate();
+}
@@ -0,0 +1,41 @@
+#ifndef IR_CARRIER_H
+#define IR_CARRIER_H
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "ir_carrier_estimator.h"
+
+// 载波检测器 - 通过RMT RX对原始光电二极管输入进行高分辨率采样
+class CarrierDetector {
+private:
+    static const uint8_t CLK_DIV = 1;              // 80MHz / 1 = 12.5ns分辨率
+    static const uint16_t IDLE_THRESHOLD = 16000;  // 200us无边沿视为一个突发结束
+    static const uint8_t FILTER_TICKS = 20;        // 滤除250ns以下的毛刺
+
+    uint8_t pin;
+    rmt_channel_t channel;
+    bool active_low;              // 光电管输出是否低电平有效
+    bool initialized;
+    bool running;
+    RingbufHandle_t ringbuf;
+    CarrierEstimator estimator;
+
+public:
+    CarrierDetector(uint8_t pin, rmt_channel_t ch = RMT_CHANNEL_2, bool activeLow = true);
+    ~CarrierDetector();
+
+    bool begin();
+    void end();
+
+    // 开始/停止一次测量，start会清空之前的统计
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    // 从RMT环形缓冲区取出数据送入估计器(非阻塞)
+    void poll();
+
+    CarrierEstimate getEstimate();
+};
+
+#endif
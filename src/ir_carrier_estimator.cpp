@@ -0,0 +1,98 @@
+#include "ir_carrier_estimator.h"
+#include <string.h>
+#include <algorithm>
+
+// ============== CarrierEstimator 实现 ==============
+
+CarrierEstimator::CarrierEstimator(uint32_t tickHz) : tick_hz(tickHz) {
+    reset();
+}
+
+void CarrierEstimator::reset() {
+    cycle_count = 0;
+    next_index = 0;
+    has_rise = false;
+    has_fall = false;
+    last_rise = 0;
+    last_fall = 0;
+}
+
+uint32_t CarrierEstimator::minPeriodTicks() const {
+    return tick_hz / MAX_FREQ_HZ;
+}
+
+uint32_t CarrierEstimator::maxPeriodTicks() const {
+    return tick_hz / MIN_FREQ_HZ;
+}
+
+void CarrierEstimator::addEdge(uint32_t timestamp, bool level) {
+    if (level) {
+        // 上升沿：与上一个上升沿、下降沿组成一个完整周期
+        if (has_rise && has_fall) {
+            uint32_t high = last_fall - last_rise;
+            uint32_t low = timestamp - last_fall;
+            addCycle(high, low);
+        }
+        last_rise = timestamp;
+        has_rise = true;
+        has_fall = false;
+    } else if (has_rise) {
+        last_fall = timestamp;
+        has_fall = true;
+    }
+}
+
+void CarrierEstimator::addCycle(uint32_t highTicks, uint32_t lowTicks) {
+    if (highTicks == 0 || lowTicks == 0) return;
+
+    // 周期超出载波范围的是数据位之间的间隔(或毛刺)，不参与统计
+    uint32_t period = highTicks + lowTicks;
+    if (period < minPeriodTicks() || period > maxPeriodTicks()) return;
+
+    periods[next_index] = period;
+    highs[next_index] = highTicks;
+    next_index = (next_index + 1) % MAX_CYCLES;
+    if (cycle_count < MAX_CYCLES) cycle_count++;
+}
+
+void CarrierEstimator::endBurst() {
+    has_rise = false;
+    has_fall = false;
+}
+
+uint16_t CarrierEstimator::getCycleCount() const {
+    return cycle_count;
+}
+
+CarrierEstimate CarrierEstimator::estimate() {
+    CarrierEstimate result = {false, 0, 0, 0, 0};
+    if (cycle_count < MIN_CYCLES) return result;
+
+    // 先取周期中位数，排除偶发的畸变周期
+    uint32_t sorted[MAX_CYCLES];
+    memcpy(sorted, periods, cycle_count * sizeof(uint32_t));
+    std::nth_element(sorted, sorted + cycle_count / 2, sorted + cycle_count);
+    uint32_t median = sorted[cycle_count / 2];
+
+    // 再对中位数±10%范围内的周期求平均，得到频率和占空比
+    uint32_t tolerance = median / 10;
+    uint64_t periodSum = 0;
+    uint64_t highSum = 0;
+    uint16_t used = 0;
+    for (uint16_t i = 0; i < cycle_count; i++) {
+        uint32_t diff = periods[i] > median ? periods[i] - median : median - periods[i];
+        if (diff <= tolerance) {
+            periodSum += periods[i];
+            highSum += highs[i];
+            used++;
+        }
+    }
+    if (used < MIN_CYCLES) return result;
+
+    result.frequencyHz = (uint32_t)(((uint64_t)tick_hz * used + periodSum / 2) / periodSum);
+    result.frequency = (uint16_t)((result.frequencyHz + 500) / 1000);
+    result.dutyCycle = (uint8_t)((highSum * 100 + periodSum / 2) / periodSum);
+    result.cycles = used;
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef IR_CARRIER_ESTIMATOR_H
+#define IR_CARRIER_ESTIMATOR_H
+
+#include <stdint.h>
+
+// 载波测量结果
+struct CarrierEstimate {
+    bool valid;                   // 是否得到可信结果
+    uint16_t frequency;           // 载波频率(kHz)
+    uint32_t frequencyHz;         // 载波频率(Hz)，用于显示精确值
+    uint8_t dutyCycle;            // 占空比(%)
+    uint16_t cycles;              // 参与统计的载波周期数
+};
+
+// 载波估计器 - 只依赖边沿时间戳，不依赖Arduino和硬件，主机端测试用合成边沿流验证
+class CarrierEstimator {
+public:
+    static const int MAX_CYCLES = 256;          // 最多保留的载波周期样本
+    static const int MIN_CYCLES = 16;           // 得出结论所需的最少周期数
+    static const uint32_t MIN_FREQ_HZ = 20000;  // 可接受的最低载波频率
+    static const uint32_t MAX_FREQ_HZ = 100000; // 可接受的最高载波频率
+
+private:
+    uint32_t tick_hz;             // 时间戳计数频率
+    uint32_t periods[MAX_CYCLES]; // 每个载波周期的长度(ticks)
+    uint32_t highs[MAX_CYCLES];   // 每个载波周期的有效电平长度(ticks)
+    uint16_t cycle_count;
+    uint16_t next_index;          // 环形写入位置，满后覆盖最旧的周期
+    bool has_rise;
+    bool has_fall;
+    uint32_t last_rise;
+    uint32_t last_fall;
+
+    uint32_t minPeriodTicks() const;
+    uint32_t maxPeriodTicks() const;
+
+public:
+    explicit CarrierEstimator(uint32_t tickHz = 80000000UL);
+
+    void reset();
+
+    // 输入一个边沿：level为边沿之后的电平(true=有效/发光)
+    void addEdge(uint32_t timestamp, bool level);
+
+    // 直接输入一个完整载波周期(有效电平长度 + 无效电平长度)
+    void addCycle(uint32_t highTicks, uint32_t lowTicks);
+
+    // 标记一段突发(burst)结束，下一个边沿不与之前的边沿配对
+    void endBurst();
+
+    uint16_t getCycleCount() const;
+    CarrierEstimate estimate();
+};
+
+#endif
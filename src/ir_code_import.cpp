@@ -0,0 +1,155 @@
+#include "ir_code_import.h"
+#include <IRsend.h>
+#include <IRutils.h>
+#include "ir_protocol_decoder.h"
+#include "ir_protocol_encoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+const char* codeImportStatusName(CodeImportStatus status) {
+    switch (status) {
+        case CODE_OK: return "ok";
+        case CODE_SYNTAX: return "syntax";
+        case CODE_PRONTO: return "pronto";
+        case CODE_UNKNOWN_PROTOCOL: return "unknown protocol";
+        case CODE_BAD_BITS: return "bad bits";
+        case CODE_BAD_VALUE: return "bad value";
+        case CODE_ENCODE_FAILED: return "encode failed";
+        default: return "?";
+    }
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 有状态协议：值为按发送顺序排列的状态字节(十六进制，可带0x)，字节数必须与位数一致
+static CodeImportStatus importStateCode(decode_type_t protocol, const char* p, BundleEntry& out) {
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+    uint16_t digits = 0;
+    while (hexDigit(p[digits]) >= 0) digits++;
+    if (digits == 0) return CODE_SYNTAX;
+    const char* hex = p;
+    p += digits;
+
+    uint32_t bits = IRsend::defaultBits(protocol);
+    if (*p == ':') {
+        char* end = nullptr;
+        p++;
+        bits = strtoul(p, &end, 10);
+        if (end == p) return CODE_SYNTAX;
+        p = end;
+    }
+    while (isspace((unsigned char)*p)) p++;
+    if (*p != '\0') return CODE_SYNTAX;
+
+    if (bits == 0 || bits % 8 != 0 || bits / 8 > BundleEntry::MAX_STATE) return CODE_BAD_BITS;
+    if (digits != bits / 4) return CODE_BAD_VALUE;
+
+    out.protocol = (int16_t)protocol;
+    out.bits = (uint16_t)bits;
+    out.stateLength = (uint8_t)(bits / 8);
+    for (uint8_t i = 0; i < out.stateLength; i++) {
+        out.state[i] = (uint8_t)(hexDigit(hex[i * 2]) << 4 | hexDigit(hex[i * 2 + 1]));
+    }
+    out.value = stateFingerprint(out.state, out.stateLength);
+    out.carrierFreq = 0;
+    out.dutyCycle = 0;
+    out.repeatPeriod = 0;
+    out.rawLength = 0;
+    out.repeatLength = 0;
+    return CODE_OK;
+}
+
+static CodeImportStatus importProtocolCode(const char* text, BundleEntry& out) {
+    // 协议名
+    char name[24];
+    size_t n = 0;
+    const char* p = text;
+    while (*p && *p != ':') {
+        if (n + 1 >= sizeof(name)) return CODE_UNKNOWN_PROTOCOL;
+        name[n++] = *p++;
+    }
+    name[n] = '\0';
+    if (*p != ':' || n == 0) return CODE_SYNTAX;
+    p++;
+
+    decode_type_t protocol = strToDecodeType(name);
+    if (protocol == UNKNOWN) return CODE_UNKNOWN_PROTOCOL;
+    if (hasACState(protocol)) return importStateCode(protocol, p, out);
+
+    // 值(十六进制，可带0x)
+    char* end = nullptr;
+    uint64_t value = strtoull(p, &end, 16);
+    if (end == p) return CODE_SYNTAX;
+    p = end;
+
+    // 位数
+    uint32_t bits = IRsend::defaultBits(protocol);
+    if (*p == ':') {
+        p++;
+        bits = strtoul(p, &end, 10);
+        if (end == p) return CODE_SYNTAX;
+        p = end;
+    }
+    while (isspace((unsigned char)*p)) p++;
+    if (*p != '\0') return CODE_SYNTAX;
+
+    if (bits == 0 || bits > 64) return CODE_BAD_BITS;
+    if (bits < 64 && (value >> bits) != 0) return CODE_BAD_VALUE;
+
+    out.protocol = (int16_t)protocol;
+    out.value = value;
+    out.bits = (uint16_t)bits;
+    out.stateLength = 0;
+    out.carrierFreq = 0;
+    out.dutyCycle = 0;
+    out.repeatPeriod = 0;
+    out.rawLength = 0;
+    out.repeatLength = 0;
+
+    const ProtocolDescriptor* desc = descriptorForProtocol(protocol);
+    if (!desc) return CODE_OK;
+
+    out.carrierFreq = desc->freq;
+    out.dutyCycle = desc->duty;
+    uint32_t periodUs = encodeFramePulses(*desc, false, out.value, out.bits, out.rawData,
+                                          BundleEntry::MAX_PULSES, out.rawLength);
+    if (periodUs == 0) return CODE_ENCODE_FAILED;
+
+    // NEC按住时发送重复码，其他协议重复发送主帧
+    if (desc->repeatMode == RepeatMode::NEC_REPEAT_CODE) {
+        periodUs = encodeFramePulses(*desc, true, out.value, out.bits, out.repeatData,
+                                     BundleEntry::MAX_REPEAT, out.repeatLength);
+        if (periodUs == 0) return CODE_ENCODE_FAILED;
+    }
+    out.repeatPeriod = (uint16_t)((periodUs + 500) / 1000);
+    return CODE_OK;
+}
+
+CodeImportStatus importCode(const char* text, BundleEntry& out, ProntoStatus* prontoStatus) {
+    if (prontoStatus) *prontoStatus = PRONTO_OK;
+    if (!text) return CODE_SYNTAX;
+    while (isspace((unsigned char)*text)) text++;
+
+    if (strchr(text, ':')) {
+        return importProtocolCode(text, out);
+    }
+
+    ProntoStatus status = parsePronto(text, out);
+    if (prontoStatus) *prontoStatus = status;
+    if (status != PRONTO_OK) return CODE_PRONTO;
+
+    // 能按描述符解码的Pronto码标注协议，发射时走协议编码
+    DecodedSignal decoded;
+    if (decodePulses(out.rawData, out.rawLength, decoded) && !decoded.repeat) {
+        out.protocol = (int16_t)decoded.protocol;
+        out.value = decoded.value;
+        out.bits = decoded.bits;
+    }
+    return CODE_OK;
+}
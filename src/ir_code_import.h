@@ -0,0 +1,31 @@
+#ifndef IR_CODE_IMPORT_H
+#define IR_CODE_IMPORT_H
+
+#include <stdint.h>
+#include <IRremoteESP8266.h>
+#include "ir_bundle.h"
+#include "ir_pronto.h"
+
+// 红外码导入：不经过学习，直接把文本形式的红外码转换为存储用的原始脉冲和载波
+// 支持两种写法：
+//   Pronto码         0000 006D 0022 0002 0157 00AC ...
+//   协议:值[:位数]   NEC:0x20DF10EF:32、SONY:0xA90:12、SAMSUNG:E0E040BF(位数缺省取协议默认值，最多64位)
+//   空调等有状态协议的值为按发送顺序排列的状态字节，如 DAIKIN:0x11DA2700...，字节数须与位数一致
+// 有编码描述符的协议(NEC/SONY/RC5)按描述符编码为原始脉冲和重复帧；其他协议只保存协议/值/位数，
+// 发射时由IRsend::send生成波形。Pronto码能按描述符解码时同时标注协议和值
+enum CodeImportStatus {
+    CODE_OK = 0,
+    CODE_SYNTAX,                  // 不是 协议:值[:位数] 格式
+    CODE_PRONTO,                  // Pronto码解析失败，详见prontoStatus
+    CODE_UNKNOWN_PROTOCOL,
+    CODE_BAD_BITS,                // 位数缺省且协议没有默认位数，超过64位，或状态位数不是整字节
+    CODE_BAD_VALUE,               // 值超出位数，或状态字节数与位数不符
+    CODE_ENCODE_FAILED            // 编码结果超出原始脉冲容量
+};
+
+const char* codeImportStatusName(CodeImportStatus status);
+
+// 解析一个红外码写入out(名称不变)，Pronto解析失败时prontoStatus输出具体原因
+CodeImportStatus importCode(const char* text, BundleEntry& out, ProntoStatus* prontoStatus = nullptr);
+
+#endif
@@ -0,0 +1,92 @@
+#include "ir_command.h"
+#include <string.h>
+#include <ctype.h>
+
+static bool isBracket(char c) {
+    return c == '<' || c == '>' || c == '[' || c == ']' || c == '(' || c == ')';
+}
+
+static const char* skipSpaces(const char* p) {
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+bool ParsedCommand::is(const char* name) const {
+    return strcmp(verb, name) == 0;
+}
+
+int32_t ParsedCommand::arg(int index, int32_t fallback) const {
+    if (index < 0 || index >= argc || index >= MAX_ARGS) return fallback;
+    return args[index];
+}
+
+bool ParsedCommand::equals(const char* text) const {
+    return strcmp(line, text) == 0;
+}
+
+bool ParsedCommand::startsWith(const char* prefix) const {
+    return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+const char* ParsedCommand::tail(int words) const {
+    const char* p = skipSpaces(line);
+    for (int i = 0; i < words && *p; i++) {
+        while (*p && !isspace((unsigned char)*p)) p++;
+        p = skipSpaces(p);
+    }
+    return p;
+}
+
+bool parseCommand(const char* line, ParsedCommand& out) {
+    memset(&out, 0, sizeof(out));
+    if (!line) return false;
+
+    const char* p = skipSpaces(line);
+    if (!*p) return false;
+
+    // 整行副本：小写，去掉末尾空白
+    int used = 0;
+    for (const char* c = p; *c && used < ParsedCommand::MAX_LINE - 1; c++) {
+        out.line[used++] = (char)tolower((unsigned char)*c);
+    }
+    while (used > 0 && isspace((unsigned char)out.line[used - 1])) used--;
+    out.line[used] = '\0';
+
+    // 命令字
+    int length = 0;
+    while (*p && !isspace((unsigned char)*p)) {
+        if (length < ParsedCommand::MAX_VERB - 1) {
+            out.verb[length++] = (char)tolower((unsigned char)*p);
+        }
+        p++;
+    }
+    out.verb[length] = '\0';
+
+    // 参数：逐个按十进制解析，括号字符跳过
+    while (*(p = skipSpaces(p))) {
+        int32_t value = 0;
+        bool negative = false;
+        bool stopped = false;     // 与String::toInt一致，遇到非数字字符后停止
+        bool hasDigit = false;
+
+        while (*p && !isspace((unsigned char)*p)) {
+            char c = *p++;
+            if (isBracket(c) || stopped) continue;
+            if (c == '-' && !hasDigit && !negative) {
+                negative = true;
+            } else if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                hasDigit = true;
+            } else {
+                stopped = true;
+            }
+        }
+
+        if (out.argc < ParsedCommand::MAX_ARGS) {
+            out.args[out.argc] = hasDigit ? (negative ? -value : value) : 0;
+        }
+        if (out.argc < 255) out.argc++;
+    }
+
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef IR_COMMAND_H
+#define IR_COMMAND_H
+
+#include <stdint.h>
+
+// 解析后的串口命令：命令字 + 整数参数
+struct ParsedCommand {
+    static const int MAX_VERB = 16;
+    static const int MAX_ARGS = 4;
+    static const int MAX_LINE = 128;
+
+    char line[MAX_LINE];          // 去掉首尾空白并转为小写的整行，供整行匹配和取文本参数
+    char verb[MAX_VERB];          // 小写命令字
+    uint8_t argc;                 // 命令字之后的参数个数(含无法解析为数字的参数)
+    int32_t args[MAX_ARGS];       // 数字参数，无法解析时为0
+
+    bool is(const char* name) const;
+    int32_t arg(int index, int32_t fallback = 0) const;
+
+    // 整行匹配，替代对String命令的 == 与 startsWith
+    bool equals(const char* text) const;
+    bool startsWith(const char* prefix) const;
+
+    // 跳过前words个词之后的文本(已去掉首尾空白)，没有时返回空串
+    const char* tail(int words) const;
+};
+
+// 解析一行命令。参数中的 <>[]() 会被忽略，以兼容 "send <1>" 这类照抄帮助文本的输入
+// 空行返回false
+bool parseCommand(const char* line, ParsedCommand& out);
+
+#endif
@@ -0,0 +1,261 @@
+#include "ir_corpus.h"
+#include <IRutils.h>
+#include "ir_protocol_name.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef UNIT_TEST
+#include <IRrecv.h>
+#endif
+
+// ============== 文本格式 ==============
+
+size_t formatCorpusFrame(const CorpusFrame& frame, char* buffer, size_t size) {
+    if (!buffer || size == 0) return 0;
+
+    // 型号中的分隔符替换为下划线，保证可以解析回来
+    char model[CorpusFrame::MAX_MODEL];
+    strncpy(model, frame.model[0] ? frame.model : "unknown", sizeof(model) - 1);
+    model[sizeof(model) - 1] = '\0';
+    for (char* c = model; *c; c++) {
+        if (*c == ',' || *c == ':' || isspace((unsigned char)*c)) *c = '_';
+    }
+
+    uint16_t length = frame.length > CorpusFrame::MAX_PULSES ? CorpusFrame::MAX_PULSES : frame.length;
+    int n = snprintf(buffer, size, "%lu,%s,%u,%u,%s,0x%llX,%u,%u:",
+                     (unsigned long)frame.timestampMs, model, frame.carrierFreq, frame.dutyCycle,
+                     protocolName(frame.protocol),
+                     (unsigned long long)frame.value, frame.bits, length);
+    if (n < 0 || (size_t)n >= size) return 0;
+
+    size_t used = n;
+    for (uint16_t i = 0; i < length; i++) {
+        n = snprintf(buffer + used, size - used, i == 0 ? "%u" : " %u", frame.pulses[i]);
+        if (n < 0 || used + n >= size) return 0;
+        used += n;
+    }
+    return used;
+}
+
+// 读取到分隔符为止的字段
+static const char* readField(const char* p, char delimiter, char* out, size_t size) {
+    size_t n = 0;
+    while (*p && *p != delimiter) {
+        if (n + 1 < size) out[n++] = *p;
+        p++;
+    }
+    out[n] = '\0';
+    return *p == delimiter ? p + 1 : nullptr;
+}
+
+bool parseCorpusFrame(const char* line, CorpusFrame& frame) {
+    if (!line) return false;
+    while (isspace((unsigned char)*line)) line++;
+    if (*line == '\0' || *line == '#') return false;
+
+    memset(&frame, 0, sizeof(frame));
+
+    char field[32];
+    const char* p = line;
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.timestampMs = strtoul(field, nullptr, 10);
+
+    if (!(p = readField(p, ',', frame.model, sizeof(frame.model)))) return false;
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.carrierFreq = (uint16_t)strtoul(field, nullptr, 10);
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.dutyCycle = (uint8_t)strtoul(field, nullptr, 10);
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.protocol = strToDecodeType(field);
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.value = strtoull(field, nullptr, 16);
+
+    if (!(p = readField(p, ',', field, sizeof(field)))) return false;
+    frame.bits = (uint16_t)strtoul(field, nullptr, 10);
+
+    if (!(p = readField(p, ':', field, sizeof(field)))) return false;
+    uint32_t declared = strtoul(field, nullptr, 10);
+    if (declared > CorpusFrame::MAX_PULSES) return false;
+
+    // 脉冲列表
+    char* end = nullptr;
+    while (frame.length < declared) {
+        unsigned long pulse = strtoul(p, &end, 10);
+        if (end == p) break;
+        frame.pulses[frame.length++] = pulse > 0xFFFF ? 0xFFFF : (uint16_t)pulse;
+        p = end;
+    }
+    return frame.length == declared;
+}
+
+// ============== CaptureRing 实现 ==============
+
+CaptureRing::CaptureRing() : head(0), count(0), total(0) {
+}
+
+CorpusFrame* CaptureRing::next() {
+    CorpusFrame* frame = &frames[head];
+    head = (head + 1) % CAPACITY;
+    if (count < CAPACITY) count++;
+    total++;
+    return frame;
+}
+
+const CorpusFrame* CaptureRing::at(int index) const {
+    if (index < 0 || index >= count) return nullptr;
+    int oldest = (head + CAPACITY - count) % CAPACITY;
+    return &frames[(oldest + index) % CAPACITY];
+}
+
+void CaptureRing::annotateCarrier(uint32_t sinceMs, uint16_t freq, uint8_t duty) {
+    for (int i = 0; i < count; i++) {
+        CorpusFrame* frame = const_cast<CorpusFrame*>(at(i));
+        if (frame->carrierFreq == 0 && (int32_t)(frame->timestampMs - sinceMs) >= 0) {
+            frame->carrierFreq = freq;
+            frame->dutyCycle = duty;
+        }
+    }
+}
+
+void CaptureRing::clear() {
+    head = 0;
+    count = 0;
+}
+
+// ============== CorpusReplay 实现 ==============
+
+CorpusReplay::CorpusReplay(DecodeFn decode, void* ctx, ClockFn clock, WaitFn wait)
+    : decode_fn(decode), decode_ctx(ctx), clock_fn(clock), wait_fn(wait),
+      speed_pct(0), started(false), start_us(0), first_timestamp(0),
+      session_protocol(UNKNOWN), session_value(0), session_bits(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void CorpusReplay::begin(uint16_t speedPct) {
+    memset(&stats, 0, sizeof(stats));
+    speed_pct = speedPct;
+    started = false;
+    session.reset();
+    session_protocol = UNKNOWN;
+}
+
+void CorpusReplay::closeSession() {
+    if (session.totalSamples() > 0 && session_protocol != UNKNOWN) {
+        stats.sessions++;
+        int best = session.bestCandidate();
+        if (best >= 0) {
+            const LearnCandidate& candidate = session.candidate(best);
+            if (candidate.protocol == session_protocol && candidate.value == (uint32_t)session_value &&
+                candidate.bits == session_bits) {
+                stats.sessionsCorrect++;
+            }
+        }
+    }
+    session.reset();
+}
+
+void CorpusReplay::feed(const CorpusFrame& frame) {
+    if (!started) {
+        started = true;
+        start_us = clock_fn();
+        first_timestamp = frame.timestampMs;
+    }
+
+    // 按原始时间间隔(除以加速倍数)等待
+    if (speed_pct > 0 && wait_fn) {
+        uint32_t offsetUs = (uint32_t)((uint64_t)(frame.timestampMs - first_timestamp) * 1000 * 100 / speed_pct);
+        int32_t remain = (int32_t)(start_us + offsetUs - clock_fn());
+        if (remain > 0) wait_fn((uint32_t)remain);
+    }
+
+    DecodedSignal result;
+    memset(&result, 0, sizeof(result));
+    result.protocol = UNKNOWN;
+    bool ok = decode_fn && decode_fn(frame, result, decode_ctx) && result.protocol != UNKNOWN;
+
+    stats.frames++;
+    if (ok) stats.decoded++;
+
+    bool labeled = frame.protocol != UNKNOWN;
+    if (labeled) {
+        stats.labeled++;
+        if (!ok) {
+            stats.missed++;
+        } else if (result.protocol == frame.protocol && result.value == frame.value &&
+                   result.bits == frame.bits) {
+            stats.correct++;
+        } else {
+            stats.mismatched++;
+        }
+
+        // 期望值变化时结束上一次学习会话
+        if (session.totalSamples() > 0 && (frame.protocol != session_protocol || frame.value != session_value ||
+                                  frame.bits != session_bits)) {
+            closeSession();
+        }
+        session_protocol = frame.protocol;
+        session_value = frame.value;
+        session_bits = frame.bits;
+
+        // 与学习模式一致：只有解码成功且非重复码的帧成为样本
+        if (ok && !result.repeat) {
+            int candidate = session.addSample(result.protocol, (uint32_t)result.value, result.bits);
+            session.addWaveform(candidate, frame.pulses, frame.length);
+        }
+    }
+
+    stats.elapsedUs = clock_fn() - start_us;
+}
+
+void CorpusReplay::end() {
+    closeSession();
+    if (started) {
+        stats.elapsedUs = clock_fn() - start_us;
+    }
+}
+
+uint32_t CorpusReplay::framesPerSecond() const {
+    if (stats.elapsedUs == 0) return 0;
+    return (uint32_t)((uint64_t)stats.frames * 1000000 / stats.elapsedUs);
+}
+
+// ============== 回放解码函数 ==============
+
+bool replayDecodePulses(const CorpusFrame& frame, DecodedSignal& out, void* ctx) {
+    const DecodeTolerance* tolerance = static_cast<const DecodeTolerance*>(ctx);
+    return decodePulses(frame.pulses, frame.length, out,
+                        tolerance ? *tolerance : kDefaultDecodeTolerance);
+}
+
+#ifdef UNIT_TEST
+bool replayDecodeIRrecv(const CorpusFrame& frame, DecodedSignal& out, void* ctx) {
+    IRrecv* irrecv = static_cast<IRrecv*>(ctx);
+    if (!irrecv) return false;
+
+    // rawbuf[0]为帧前间隔，其后为tick单位的脉冲
+    static uint16_t rawbuf[CorpusFrame::MAX_PULSES + 1];
+    rawbuf[0] = 0;
+    for (uint16_t i = 0; i < frame.length; i++) {
+        rawbuf[i + 1] = (frame.pulses[i] + kRawTick / 2) / kRawTick;
+    }
+
+    decode_results results;
+    results.rawbuf = rawbuf;
+    results.rawlen = frame.length + 1;
+    results.overflow = false;
+    if (!irrecv->decode(&results)) return false;
+
+    out.protocol = results.decode_type;
+    out.value = results.value;
+    out.bits = results.bits;
+    out.repeat = results.repeat;
+    return out.protocol != UNKNOWN;
+}
+#endif
@@ -0,0 +1,128 @@
+#ifndef IR_CORPUS_H
+#define IR_CORPUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <IRremoteESP8266.h>
+#include "ir_protocol_decoder.h"
+#include "ir_learning.h"
+
+// 语料帧：一次捕获的原始脉冲及元数据
+//
+// 文本格式(每帧一行，可直接经串口保存为文件)：
+//   # ircorpus v1
+//   <时间戳ms>,<遥控器型号>,<载波kHz>,<占空比%>,<期望协议>,<期望值hex>,<位数>,<脉冲数>:<p0> <p1> ...
+// 脉冲为微秒，mark开头、mark/space交替；载波为0表示未测量，型号中不含逗号和空白
+struct CorpusFrame {
+    static const int MAX_PULSES = 256;
+    static const int MAX_MODEL = 24;
+
+    uint32_t timestampMs;
+    char model[MAX_MODEL];
+    uint16_t carrierFreq;         // kHz
+    uint8_t dutyCycle;            // %
+    decode_type_t protocol;       // 期望解码结果，UNKNOWN表示未标注
+    uint64_t value;
+    uint16_t bits;
+    uint16_t length;
+    uint16_t pulses[MAX_PULSES];
+};
+
+static const char* const CORPUS_HEADER = "# ircorpus v1";
+static const size_t CORPUS_MAX_LINE = 64 + CorpusFrame::MAX_PULSES * 6;
+
+// 格式化为一行(不含换行符)，返回写入长度，缓冲区不足时返回0
+size_t formatCorpusFrame(const CorpusFrame& frame, char* buffer, size_t size);
+
+// 解析一行，注释行和空行返回false
+bool parseCorpusFrame(const char* line, CorpusFrame& frame);
+
+// 设备端捕获环：保留最近的若干帧，供dump导出
+class CaptureRing {
+public:
+    static const int CAPACITY = 8;
+
+private:
+    CorpusFrame frames[CAPACITY];
+    uint8_t head;                 // 下一个写入位置
+    uint8_t count;
+    uint32_t total;               // 累计捕获数
+
+public:
+    CaptureRing();
+
+    // 取得下一个写入槽位(覆盖最旧的帧)
+    CorpusFrame* next();
+
+    int size() const { return count; }
+    uint32_t totalCaptured() const { return total; }
+
+    // 按时间顺序访问，0为最旧
+    const CorpusFrame* at(int index) const;
+
+    // 为sinceMs之后尚未标注载波的帧补充载波参数
+    void annotateCarrier(uint32_t sinceMs, uint16_t freq, uint8_t duty);
+
+    void clear();
+};
+
+// 回放统计
+struct ReplayStats {
+    uint32_t frames;
+    uint32_t labeled;             // 有期望解码结果的帧
+    uint32_t decoded;             // 解码出协议的帧
+    uint32_t correct;             // 与期望完全一致
+    uint32_t mismatched;          // 解码成功但与期望不同
+    uint32_t missed;              // 有期望但未能解码
+    uint32_t sessions;            // 学习会话数(连续相同期望值的帧为一次学习)
+    uint32_t sessionsCorrect;     // 学习器选出期望值的会话数
+    uint32_t elapsedUs;
+};
+
+// 语料回放引擎：按时间戳(可加速)把帧送入解码器，并按会话模拟学习流程
+class CorpusReplay {
+public:
+    typedef bool (*DecodeFn)(const CorpusFrame& frame, DecodedSignal& out, void* ctx);
+    typedef uint32_t (*ClockFn)();                  // 微秒
+    typedef void (*WaitFn)(uint32_t us);
+
+private:
+    DecodeFn decode_fn;
+    void* decode_ctx;
+    ClockFn clock_fn;
+    WaitFn wait_fn;
+    uint16_t speed_pct;           // 100为实时，0为不等待
+    bool started;
+    uint32_t start_us;
+    uint32_t first_timestamp;
+    ReplayStats stats;
+
+    // 当前学习会话：与学习模式使用相同的流式学习器
+    decode_type_t session_protocol;
+    uint64_t session_value;
+    uint16_t session_bits;
+    StreamingLearner session;
+
+    void closeSession();
+
+public:
+    CorpusReplay(DecodeFn decode, void* ctx, ClockFn clock, WaitFn wait);
+
+    void begin(uint16_t speedPct);
+    void feed(const CorpusFrame& frame);
+    void end();
+
+    const ReplayStats& getStats() const { return stats; }
+    uint32_t framesPerSecond() const;
+};
+
+// 使用描述符解码器的回放解码函数(设备与主机均可用)
+bool replayDecodePulses(const CorpusFrame& frame, DecodedSignal& out, void* ctx);
+
+#ifdef UNIT_TEST
+class IRrecv;
+// 主机构建：把帧转换为decode_results送入IRrecv完整解码(ctx为IRrecv*)
+bool replayDecodeIRrecv(const CorpusFrame& frame, DecodedSignal& out, void* ctx);
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+#include "ir_event_loop.h"
+#include <string.h>
+
+// ============== EventLoop 实现 ==============
+
+EventLoop::EventLoop(ClockFn clock, WaitFn wait, WakeFn wake)
+    : clock_fn(clock), wait_fn(wait), wake_fn(wake), pending(0) {
+    memset(timers, 0, sizeof(timers));
+    memset(handlers, 0, sizeof(handlers));
+    for (int i = 0; i < EVENT_TYPE_COUNT; i++) {
+        post_time[i] = 0;
+    }
+    resetLatency();
+}
+
+uint32_t EventLoop::now() const {
+    return clock_fn();
+}
+
+uint32_t EventLoop::nowMs() const {
+    return clock_fn() / 1000;
+}
+
+void EventLoop::onEvent(EventType type, Callback callback, void* ctx) {
+    if (type >= EVENT_TYPE_COUNT) return;
+    handlers[type].callback = callback;
+    handlers[type].ctx = ctx;
+}
+
+void EventLoop::post(EventType type) {
+    if (type >= EVENT_TYPE_COUNT) return;
+
+    uint32_t bit = 1UL << type;
+    if (!(pending.load() & bit)) {
+        post_time[type] = clock_fn();
+    }
+    pending.fetch_or(bit);
+
+    if (wake_fn) wake_fn();
+}
+
+int EventLoop::startTimer(uint32_t delayMs, Callback callback, void* ctx, uint32_t periodMs) {
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        if (!timers[i].active) {
+            timers[i].active = true;
+            timers[i].deadline = clock_fn() + delayMs * 1000;
+            timers[i].period = periodMs * 1000;
+            timers[i].callback = callback;
+            timers[i].ctx = ctx;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void EventLoop::cancelTimer(int id) {
+    if (id >= 0 && id < MAX_TIMERS) {
+        timers[id].active = false;
+    }
+}
+
+bool EventLoop::isTimerActive(int id) const {
+    return id >= 0 && id < MAX_TIMERS && timers[id].active;
+}
+
+void EventLoop::dispatchEvents() {
+    // 处理时间在清除挂起位之前取，投递时间在之后取：本轮的投递都已写入post_time。
+    // 清除之后的投递(中断或前面的处理函数)可能覆盖post_time，晚于处理时间的按0计，不会下溢
+    uint32_t dispatchTime = clock_fn();
+    uint32_t events = pending.exchange(0);
+    if (!events) return;
+
+    for (int type = 0; type < EVENT_TYPE_COUNT; type++) {
+        if (!(events & (1UL << type))) continue;
+
+        // 记录事件从投递到开始处理的延迟
+        EventLatencyStats& stats = latency[type];
+        int32_t elapsed = (int32_t)(dispatchTime - post_time[type]);
+        uint32_t delay = elapsed > 0 ? (uint32_t)elapsed : 0;
+        stats.count++;
+        stats.lastUs = delay;
+        stats.totalUs += delay;
+        if (delay > stats.maxUs) stats.maxUs = delay;
+
+        if (handlers[type].callback) {
+            handlers[type].callback(handlers[type].ctx);
+        }
+    }
+}
+
+void EventLoop::fireTimers() {
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        Timer& timer = timers[i];
+        if (!timer.active) continue;
+
+        uint32_t current = clock_fn();
+        if ((int32_t)(timer.deadline - current) > 0) continue;
+
+        Callback callback = timer.callback;
+        void* ctx = timer.ctx;
+        if (timer.period > 0) {
+            timer.deadline += timer.period;
+            // 落后超过一个周期时不补发，直接从当前时间重新计时
+            if ((int32_t)(timer.deadline - current) <= 0) {
+                timer.deadline = current + timer.period;
+            }
+        } else {
+            timer.active = false;
+        }
+
+        // 回调中可能启动或取消定时器
+        callback(ctx);
+    }
+}
+
+void EventLoop::runOnce(uint32_t maxWaitMs) {
+    dispatchEvents();
+    fireTimers();
+
+    if (pending.load()) return;
+
+    // 等待到最近的定时器截止时间，期间有事件投递会被提前唤醒
+    uint32_t waitUs = maxWaitMs * 1000;
+    uint32_t current = clock_fn();
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        if (!timers[i].active) continue;
+        int32_t remain = (int32_t)(timers[i].deadline - current);
+        if (remain <= 0) return;
+        if ((uint32_t)remain < waitUs) waitUs = remain;
+    }
+
+    if (wait_fn) wait_fn(waitUs);
+}
+
+const EventLatencyStats& EventLoop::getLatency(EventType type) const {
+    return latency[type < EVENT_TYPE_COUNT ? type : 0];
+}
+
+void EventLoop::resetLatency() {
+    memset(latency, 0, sizeof(latency));
+}
+
+// ============== VirtualClock 实现 ==============
+
+uint32_t VirtualClock::now_us = 0;
+
+uint32_t VirtualClock::now() {
+    return now_us;
+}
+
+void VirtualClock::wait(uint32_t maxWaitUs) {
+    now_us += maxWaitUs;
+}
+
+void VirtualClock::wake() {
+}
+
+void VirtualClock::advance(uint32_t us) {
+    now_us += us;
+}
+
+void VirtualClock::set(uint32_t us) {
+    now_us = us;
+}
+
+// ============== LedPattern 实现 ==============
+
+LedPattern::LedPattern(EventLoop* loop, WriteFn write)
+    : write_fn(write), loop(loop), timer_id(-1), step_count(0), step_index(0),
+      level(false), end_level(false) {
+}
+
+void LedPattern::onTimer(void* ctx) {
+    LedPattern* self = static_cast<LedPattern*>(ctx);
+    self->timer_id = -1;
+    self->advance();
+}
+
+void LedPattern::advance() {
+    step_index++;
+    if (step_index >= step_count) {
+        write_fn(end_level);
+        return;
+    }
+
+    level = !level;
+    write_fn(level);
+    timer_id = loop->startTimer(steps[step_index], onTimer, this);
+}
+
+void LedPattern::play(bool startLevel, const uint16_t* durations, uint8_t count, bool endLevel) {
+    loop->cancelTimer(timer_id);
+    timer_id = -1;
+
+    step_count = count > MAX_STEPS ? MAX_STEPS : count;
+    memcpy(steps, durations, step_count * sizeof(uint16_t));
+    step_index = 0;
+    end_level = endLevel;
+
+    if (step_count == 0) {
+        write_fn(end_level);
+        return;
+    }
+
+    level = startLevel;
+    write_fn(level);
+    timer_id = loop->startTimer(steps[0], onTimer, this);
+}
+
+void LedPattern::set(bool lvl) {
+    loop->cancelTimer(timer_id);
+    timer_id = -1;
+    step_count = 0;
+    write_fn(lvl);
+}
+
+bool LedPattern::isPlaying() const {
+    return timer_id >= 0;
+}
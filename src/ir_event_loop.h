@@ -0,0 +1,127 @@
+#ifndef IR_EVENT_LOOP_H
+#define IR_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <atomic>
+
+// 事件类型
+enum EventType : uint8_t {
+    EVENT_UART = 0,      // 串口收到数据
+    EVENT_IR_RX,         // 红外接收器有完整帧
+    EVENT_TX_DONE,       // RMT发射完成
+    EVENT_TYPE_COUNT
+};
+
+// 事件延迟统计(投递到处理的时间，微秒)
+struct EventLatencyStats {
+    uint32_t count;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+// 协作式事件循环：定时器 + 截止时间 + 事件唤醒，替代固定的delay轮询
+class EventLoop {
+public:
+    static const int MAX_TIMERS = 10;
+
+    typedef void (*Callback)(void* ctx);
+    typedef uint32_t (*ClockFn)();                  // 返回微秒时间
+    typedef void (*WaitFn)(uint32_t maxWaitUs);     // 阻塞等待事件或超时
+    typedef void (*WakeFn)();                       // 唤醒正在等待的循环
+
+private:
+    struct Timer {
+        bool active;
+        uint32_t deadline;   // 微秒
+        uint32_t period;     // 微秒，0表示单次
+        Callback callback;
+        void* ctx;
+    };
+
+    struct Handler {
+        Callback callback;
+        void* ctx;
+    };
+
+    ClockFn clock_fn;
+    WaitFn wait_fn;
+    WakeFn wake_fn;
+    Timer timers[MAX_TIMERS];
+    Handler handlers[EVENT_TYPE_COUNT];
+    std::atomic<uint32_t> pending;
+    volatile uint32_t post_time[EVENT_TYPE_COUNT];
+    EventLatencyStats latency[EVENT_TYPE_COUNT];
+
+    void dispatchEvents();
+    void fireTimers();
+
+public:
+    EventLoop(ClockFn clock, WaitFn wait, WakeFn wake);
+
+    uint32_t now() const;
+    uint32_t nowMs() const;
+
+    // 注册事件处理函数
+    void onEvent(EventType type, Callback callback, void* ctx = nullptr);
+
+    // 投递事件(可在中断或其他任务中调用)，同一事件未处理前重复投递只记录第一次的时间
+    void post(EventType type);
+
+    // 定时器：delayMs后触发，periodMs>0时周期触发，返回定时器ID(-1表示已满)
+    int startTimer(uint32_t delayMs, Callback callback, void* ctx = nullptr, uint32_t periodMs = 0);
+    void cancelTimer(int id);
+    bool isTimerActive(int id) const;
+
+    // 执行一轮：处理事件和到期定时器，然后等待到下一个截止时间(最长maxWaitMs)
+    void runOnce(uint32_t maxWaitMs = 1000);
+
+    const EventLatencyStats& getLatency(EventType type) const;
+    void resetLatency();
+};
+
+// 虚拟时钟：主机(native)构建时代替micros()，等待即直接推进时间
+class VirtualClock {
+private:
+    static uint32_t now_us;
+
+public:
+    static uint32_t now();
+    static void wait(uint32_t maxWaitUs);
+    static void wake();
+    static void advance(uint32_t us);
+    static void set(uint32_t us);
+};
+
+// 非阻塞LED模式引擎：按时长表交替切换电平，由事件循环定时驱动
+class LedPattern {
+public:
+    static const int MAX_STEPS = 16;
+    typedef void (*WriteFn)(bool level);
+
+private:
+    WriteFn write_fn;
+    EventLoop* loop;
+    int timer_id;
+    uint16_t steps[MAX_STEPS];
+    uint8_t step_count;
+    uint8_t step_index;
+    bool level;
+    bool end_level;
+
+    static void onTimer(void* ctx);
+    void advance();
+
+public:
+    LedPattern(EventLoop* loop, WriteFn write);
+
+    // 以startLevel开始，每段持续durations[i]毫秒后翻转电平，结束后保持endLevel
+    void play(bool startLevel, const uint16_t* durations, uint8_t count, bool endLevel);
+
+    // 直接设置电平(取消正在播放的模式)
+    void set(bool level);
+
+    bool isPlaying() const;
+};
+
+#endif
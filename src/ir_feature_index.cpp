@@ -0,0 +1,135 @@
+#include "ir_feature_index.h"
+#include <string.h>
+
+// 直方图分档上限(微秒)：分界放在常见时长(560/890/1690/2250/4500/9000)之间
+static const uint16_t FEATURE_BIN_LIMITS[FEATURE_BINS - 1] = {720, 1150, 1450, 2000, 3300, 6500, 12000};
+
+static bool withinPct(uint32_t a, uint32_t b, uint8_t pct) {
+    uint32_t delta = a > b ? a - b : b - a;
+    uint32_t larger = a > b ? a : b;
+    return delta * 100 <= larger * pct;
+}
+
+void computeFeatures(const uint16_t* pulses, uint16_t length, SignalFeatures& out) {
+    memset(&out, 0, sizeof(out));
+    if (length % 2 == 0 && length > 0) length--;
+    if (!pulses || length == 0) return;
+
+    out.edges = length;
+    out.leaderMark = pulses[0];
+    out.leaderSpace = length > 1 ? pulses[1] : 0;
+
+    // 短脉冲单位：最短脉冲1.5倍以内的脉冲均值，长短分界取1.5倍单位，与整体时长缩放无关
+    uint16_t shortest = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        if (pulses[i] > 0 && pulses[i] < shortest) shortest = pulses[i];
+    }
+    uint32_t sum = 0, n = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        out.totalUs += pulses[i];
+        int bin = 0;
+        while (bin < FEATURE_BINS - 1 && pulses[i] >= FEATURE_BIN_LIMITS[bin]) bin++;
+        if (out.histogram[bin] < 255) out.histogram[bin]++;
+        if (pulses[i] > 0 && (uint32_t)pulses[i] * 2 <= (uint32_t)shortest * 3) {
+            sum += pulses[i];
+            n++;
+        }
+    }
+    uint32_t threshold = n > 0 ? sum * 3 / (n * 2) : 0;
+    for (uint16_t i = 0; i < length; i++) {
+        if (pulses[i] >= threshold) out.shape ^= 1ULL << (i % 64);
+    }
+}
+
+FeatureIndex::FeatureIndex(Entry* storage, int capacity) : entries(storage), capacity(capacity), count(0) {}
+
+void FeatureIndex::clear() {
+    count = 0;
+}
+
+static bool lessThan(const SignalFeatures& a, const SignalFeatures& b) {
+    if (a.edges != b.edges) return a.edges < b.edges;
+    if (a.shape != b.shape) return a.shape < b.shape;
+    return a.totalUs < b.totalUs;
+}
+
+int FeatureIndex::lowerBound(const SignalFeatures& key) const {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (lessThan(entries[mid].features, key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool FeatureIndex::insert(int32_t id, const SignalFeatures& features) {
+    if (count >= capacity) return false;
+    int pos = lowerBound(features);
+    memmove(&entries[pos + 1], &entries[pos], (count - pos) * sizeof(Entry));
+    entries[pos].features = features;
+    entries[pos].id = id;
+    count++;
+    return true;
+}
+
+bool FeatureIndex::remove(int32_t id) {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].id != id) continue;
+        memmove(&entries[i], &entries[i + 1], (count - i - 1) * sizeof(Entry));
+        count--;
+        return true;
+    }
+    return false;
+}
+
+int FeatureIndex::candidates(const SignalFeatures& query, int32_t* out, int outCapacity, bool broad,
+                             int* scanned, const FeatureMatchConfig& config) const {
+    int found = 0;
+    int examined = 0;
+    if (query.edges == 0) {
+        if (scanned) *scanned = 0;
+        return 0;
+    }
+
+    uint32_t lowTotal = (uint64_t)query.totalUs * (100 - config.totalTolerancePct) / 100;
+    uint32_t highTotal = (uint64_t)query.totalUs * (100 + config.totalTolerancePct) / 100;
+    uint32_t maxHistogram = (uint32_t)query.edges * config.histogramDiffPct / 100;
+    int firstEdges = broad && query.edges > config.maxEdgeDiff ? query.edges - config.maxEdgeDiff : query.edges;
+    int lastEdges = broad ? query.edges + config.maxEdgeDiff : query.edges;
+
+    SignalFeatures key;
+    memset(&key, 0, sizeof(key));
+    for (int edges = firstEdges; edges <= lastEdges; edges++) {
+        // 精确查找从相同形状开始，宽松查找扫描该脉冲数的全部形状
+        key.edges = (uint16_t)edges;
+        key.shape = broad ? 0 : query.shape;
+        key.totalUs = broad ? 0 : lowTotal;
+        for (int i = lowerBound(key); i < count; i++) {
+            const SignalFeatures& f = entries[i].features;
+            if (f.edges != edges) break;
+            if (!broad && (f.shape != query.shape || f.totalUs > highTotal)) break;
+            examined++;
+            if (f.totalUs < lowTotal || f.totalUs > highTotal) continue;
+            if (!withinPct(f.leaderMark, query.leaderMark, config.leaderTolerancePct) ||
+                !withinPct(f.leaderSpace, query.leaderSpace, config.leaderTolerancePct)) {
+                continue;
+            }
+            // 一维推土距离：抖动把脉冲推到相邻档只计1
+            uint32_t distance = 0;
+            int carry = 0;
+            for (int b = 0; b < FEATURE_BINS; b++) {
+                carry += (int)f.histogram[b] - (int)query.histogram[b];
+                distance += carry > 0 ? carry : -carry;
+            }
+            if (distance > maxHistogram) continue;
+            if (found < outCapacity) out[found] = entries[i].id;
+            found++;
+        }
+    }
+    if (scanned) *scanned = examined;
+    return found;
+}
@@ -0,0 +1,63 @@
+#ifndef IR_FEATURE_INDEX_H
+#define IR_FEATURE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 信号特征向量：插入时计算一次，匹配时先按特征筛出少量候选，再逐个脉冲比较
+// 结尾间隔(偶数个脉冲时的最后一个space)不计入，是否录到结尾间隔不影响特征
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+static const int FEATURE_BINS = 8;
+
+struct SignalFeatures {
+    uint16_t edges;               // 脉冲数
+    uint32_t totalUs;             // 总时长
+    uint16_t leaderMark;          // 引导码
+    uint16_t leaderSpace;
+    uint8_t histogram[FEATURE_BINS];   // 时长分布，每档最多255
+    uint64_t shape;               // 形状：每个脉冲相对短脉冲单位是长(1)还是短(0)，超过64个时折叠
+};
+
+void computeFeatures(const uint16_t* pulses, uint16_t length, SignalFeatures& out);
+
+// 候选筛选参数，需比逐脉冲比较(kDefaultPulseMatch)宽松，不漏掉能匹配的信号
+struct FeatureMatchConfig {
+    uint8_t maxEdgeDiff;          // 允许的脉冲数差异
+    uint8_t totalTolerancePct;    // 总时长相对容差
+    uint8_t leaderTolerancePct;   // 引导码相对容差
+    uint8_t histogramDiffPct;     // 直方图推土距离上限(占脉冲数的百分比)
+};
+
+const FeatureMatchConfig kDefaultFeatureMatch = {2, 15, 30, 30};
+
+// 按(脉冲数, 形状, 总时长)排序的特征索引
+//   精确查找  二分定位脉冲数和形状都相同的一段，通常只有一两个候选
+//   宽松查找  形状不同(有脉冲被抖动推过长短分界)时使用，扫描脉冲数相近的信号，按总时长、引导码和直方图筛选
+// 存储由调用者提供，设备端随信号库静态分配，主机端基准可放入上万个信号
+class FeatureIndex {
+public:
+    struct Entry {
+        SignalFeatures features;
+        int32_t id;
+    };
+
+    FeatureIndex(Entry* storage, int capacity);
+
+    void clear();
+    bool insert(int32_t id, const SignalFeatures& features);   // 已满时返回false
+    bool remove(int32_t id);
+    int size() const { return count; }
+
+    // 输出候选ID(最多capacity个)，返回候选总数；scanned输出检查过的条目数
+    int candidates(const SignalFeatures& query, int32_t* out, int capacity, bool broad = false,
+                   int* scanned = nullptr, const FeatureMatchConfig& config = kDefaultFeatureMatch) const;
+
+private:
+    Entry* entries;
+    int capacity;
+    int count;
+
+    int lowerBound(const SignalFeatures& key) const;
+};
+
+#endif
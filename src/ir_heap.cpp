@@ -0,0 +1,107 @@
+#include "ir_heap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+#ifdef IR_HEAP_COUNT_ALLOCATIONS
+#include <atomic>
+#include <new>
+
+static std::atomic<uint32_t> allocation_count(0);
+
+// 链接器把对malloc/calloc/realloc的引用重定向到__wrap_*，__real_*为原函数
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (size > 0) allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+}
+
+#ifndef ARDUINO
+// 主机上libstdc++是动态库，其operator new内部的malloc不经过链接重定向，这里替换为经由malloc的版本
+void* operator new(size_t size) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+#endif
+#endif
+
+uint32_t heapAllocationCount() {
+#ifdef IR_HEAP_COUNT_ALLOCATIONS
+    return allocation_count.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+bool heapAllocationCounting() {
+    uint32_t before = heapAllocationCount();
+    void* volatile probe = malloc(1);
+    free(probe);
+    return heapAllocationCount() != before;
+}
+
+HeapSnapshot takeHeapSnapshot() {
+    HeapSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+#ifdef ARDUINO
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    snapshot.freeBytes = info.total_free_bytes;
+    snapshot.minFreeBytes = info.minimum_free_bytes;
+    snapshot.largestBlock = info.largest_free_block;
+    snapshot.allocatedBlocks = info.allocated_blocks;
+#endif
+    snapshot.allocations = heapAllocationCount();
+    return snapshot;
+}
+
+int32_t heapBlockDelta(const HeapSnapshot& before, const HeapSnapshot& after) {
+    return (int32_t)after.allocatedBlocks - (int32_t)before.allocatedBlocks;
+}
+
+int32_t heapFreeDelta(const HeapSnapshot& before, const HeapSnapshot& after) {
+    return (int32_t)after.freeBytes - (int32_t)before.freeBytes;
+}
+
+uint32_t heapAllocationDelta(const HeapSnapshot& before, const HeapSnapshot& after) {
+    return after.allocations - before.allocations;
+}
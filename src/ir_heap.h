@@ -0,0 +1,30 @@
+#ifndef IR_HEAP_H
+#define IR_HEAP_H
+
+#include <stdint.h>
+
+// 堆状态快照(8位可访问内存)
+struct HeapSnapshot {
+    uint32_t freeBytes;           // 当前空闲字节
+    uint32_t minFreeBytes;        // 启动以来的最低空闲字节(水位线)
+    uint32_t largestBlock;        // 最大连续空闲块，远小于freeBytes说明碎片化
+    uint32_t allocatedBlocks;     // 已分配块数，前后不变说明期间没有残留分配
+    uint32_t allocations;         // 启动以来的分配次数，包括已释放的临时分配
+};
+
+HeapSnapshot takeHeapSnapshot();
+
+// 两次快照之间已分配块数和空闲字节的变化，用于判断某段操作是否在堆上留下分配
+int32_t heapBlockDelta(const HeapSnapshot& before, const HeapSnapshot& after);
+int32_t heapFreeDelta(const HeapSnapshot& before, const HeapSnapshot& after);
+// 两次快照之间的分配次数。分配后又释放的临时缓冲(如Print::printf格式化64字节以上的行)不改变
+// 块数和空闲字节，只能由此发现
+uint32_t heapAllocationDelta(const HeapSnapshot& before, const HeapSnapshot& after);
+
+// 分配计数：定义IR_HEAP_COUNT_ALLOCATIONS并以 -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc 链接时，
+// 所有经由malloc/calloc/realloc的分配(包括new和Arduino String)都计数；统计所有任务，不只是调用者
+uint32_t heapAllocationCount();
+// 实际分配一次检查计数是否生效，缺少链接选项时返回false
+bool heapAllocationCounting();
+
+#endif
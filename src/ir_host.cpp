@@ -0,0 +1,46 @@
+#include "ir_host.h"
+
+#ifndef ARDUINO
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+HostSerial Serial;
+
+static std::chrono::steady_clock::time_point startTime() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+unsigned long millis() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - startTime()).count();
+}
+
+unsigned long micros() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - startTime()).count();
+}
+
+size_t HostSerial::print(const char* text) {
+    if (quiet || !text) return 0;
+    return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HostSerial::println(const char* text) {
+    if (quiet) return 0;
+    size_t written = print(text);
+    fputc('\n', stdout);
+    return written + 1;
+}
+
+size_t HostSerial::printf(const char* format, ...) {
+    if (quiet) return 0;
+    va_list args;
+    va_start(args, format);
+    int written = vprintf(format, args);
+    va_end(args);
+    return written < 0 ? 0 : (size_t)written;
+}
+#endif
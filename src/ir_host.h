@@ -0,0 +1,29 @@
+#ifndef IR_HOST_H
+#define IR_HOST_H
+
+// 主机端(native)构建的Arduino替代：只提供存储等模块用到的millis/micros和输出到stdout的Serial
+// 设备端使用Arduino.h，不包含本文件
+#ifndef ARDUINO
+#include <stdint.h>
+#include <stddef.h>
+
+unsigned long millis();
+unsigned long micros();
+
+class HostSerial {
+public:
+    size_t print(const char* text);
+    size_t println(const char* text = "");
+    size_t printf(const char* format, ...);
+
+    // 关闭后不输出(基准和测试只关心结果，不打印存储日志)
+    void setQuiet(bool quiet) { this->quiet = quiet; }
+
+private:
+    bool quiet = false;
+};
+
+extern HostSerial Serial;
+#endif
+
+#endif
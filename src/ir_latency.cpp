@@ -0,0 +1,118 @@
+#include "ir_latency.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+// ============== LatencyHistogram 实现 ==============
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(uint32_t value) {
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    // 最高位决定区间，其后SUB_BITS位决定子桶
+    int msb = 31 - __builtin_clz(value);
+    int sub = (value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return (uint32_t)index;
+    }
+    if (index >= BUCKETS - 1) {
+        return 0xFFFFFFFFUL;
+    }
+    int msb = index / SUB_BUCKETS + SUB_BITS - 1;
+    int sub = index % SUB_BUCKETS;
+    uint32_t lower = (uint32_t)(SUB_BUCKETS + sub) << (msb - SUB_BITS);
+    return lower + (1UL << (msb - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(uint32_t value) {
+    buckets[bucketIndex(value)]++;
+    total++;
+    if (value > max_value) max_value = value;
+}
+
+void LatencyHistogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    total = 0;
+    max_value = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint16_t permille) const {
+    if (total == 0) return 0;
+
+    // 第rank个样本(从1开始)所在的桶
+    uint32_t rank = (uint32_t)(((uint64_t)total * permille + 999) / 1000);
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = bucketUpperBound(i);
+            return upper < max_value ? upper : max_value;
+        }
+    }
+    return max_value;
+}
+
+// ============== LatencyStats 实现 ==============
+
+LatencyHistogram LatencyStats::histograms[STAGE_COUNT];
+
+#ifdef ARDUINO
+uint32_t LatencyStats::now() {
+    return ESP.getCycleCount();
+}
+
+uint32_t LatencyStats::cyclesPerUs() {
+    return ESP.getCpuFreqMHz();
+}
+#else
+// 主机构建：以纳秒计数代替CPU周期
+uint32_t LatencyStats::now() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t LatencyStats::cyclesPerUs() {
+    return 1000;
+}
+#endif
+
+uint32_t LatencyStats::toMicros(uint32_t cycles) {
+    return cycles / cyclesPerUs();
+}
+
+void LatencyStats::record(LatencyStage stage, uint32_t startCycles) {
+    if (stage >= STAGE_COUNT) return;
+    histograms[stage].record(now() - startCycles);
+}
+
+const LatencyHistogram& LatencyStats::get(LatencyStage stage) {
+    return histograms[stage < STAGE_COUNT ? stage : 0];
+}
+
+const char* LatencyStats::stageName(LatencyStage stage) {
+    static const char* names[STAGE_COUNT] = {
+        "command", "tx.signal", "rmt.convert", "rmt.write",
+        "rmt.wait", "rx.decode", "rx.report", "store.save"
+    };
+    return stage < STAGE_COUNT ? names[stage] : "?";
+}
+
+void LatencyStats::resetAll() {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        histograms[i].reset();
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef IR_LATENCY_H
+#define IR_LATENCY_H
+
+#include <stdint.h>
+
+// 热路径阶段
+enum LatencyStage : uint8_t {
+    STAGE_COMMAND = 0,     // processCommand 整条命令
+    STAGE_TX_SIGNAL,       // IRTransmitter::sendSignal
+    STAGE_RMT_CONVERT,     // 脉冲/协议 -> RMT数据项
+    STAGE_RMT_WRITE,       // rmt_write_items
+    STAGE_RMT_WAIT,        // rmt_wait_tx_done (最后一个边沿发出)
+    STAGE_RX_DECODE,       // IRrecv协议解码(有完整帧时)
+    STAGE_RX_REPORT,       // IRReceiver::decode 去重与信息输出
+    STAGE_STORAGE_SAVE,    // IRStorage 写入EEPROM并提交
+    STAGE_COUNT
+};
+
+// 固定桶对数直方图：每个2倍区间分4个子桶，相对误差不超过25%
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 2;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = (32 - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+    uint32_t buckets[BUCKETS];
+    uint32_t total;
+    uint32_t max_value;
+
+public:
+    LatencyHistogram();
+
+    static int bucketIndex(uint32_t value);
+    static uint32_t bucketUpperBound(int index);
+
+    void record(uint32_t value);
+    void reset();
+
+    uint32_t count() const { return total; }
+    uint32_t max() const { return max_value; }
+
+    // 百分位(千分比，例如500=p50, 990=p99)，返回所在桶的上界且不超过最大值
+    uint32_t percentile(uint16_t permille) const;
+};
+
+// 各阶段延迟统计，时间单位为CPU周期
+class LatencyStats {
+private:
+    static LatencyHistogram histograms[STAGE_COUNT];
+
+public:
+    static uint32_t now();              // 周期计数器
+    static uint32_t cyclesPerUs();
+    static uint32_t toMicros(uint32_t cycles);
+
+    static void record(LatencyStage stage, uint32_t startCycles);
+    static const LatencyHistogram& get(LatencyStage stage);
+    static const char* stageName(LatencyStage stage);
+    static void resetAll();
+};
+
+// 作用域计时：构造时记录起点，析构时写入对应阶段
+class ScopedLatency {
+private:
+    LatencyStage stage;
+    uint32_t start;
+
+public:
+    explicit ScopedLatency(LatencyStage s) : stage(s), start(LatencyStats::now()) {}
+    ~ScopedLatency() { LatencyStats::record(stage, start); }
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "ir_learning.h"
+#include <math.h>
+#include <string.h>
+
+StreamingLearner::StreamingLearner() {
+    reset();
+}
+
+void StreamingLearner::reset() {
+    memset(candidates, 0, sizeof(candidates));
+    candidate_count = 0;
+    total = 0;
+    wave_rejected = 0;
+}
+
+int StreamingLearner::findCandidate(decode_type_t protocol, uint64_t value, uint16_t bits) const {
+    for (int i = 0; i < candidate_count; i++) {
+        const LearnCandidate& c = candidates[i];
+        if (c.protocol == protocol && c.value == value && c.bits == bits) return i;
+    }
+    return -1;
+}
+
+int StreamingLearner::addSample(decode_type_t protocol, uint64_t value, uint16_t bits,
+                                const uint8_t* state, uint16_t stateLength) {
+    total++;
+
+    int index = findCandidate(protocol, value, bits);
+    if (index >= 0) {
+        candidates[index].count++;
+        return index;
+    }
+
+    uint32_t inherited = 0;
+    if (candidate_count < TOP_K) {
+        index = candidate_count++;
+    } else {
+        // 表满：替换计数最小的候选，新候选继承其计数作为误差上限
+        index = 0;
+        for (int i = 1; i < TOP_K; i++) {
+            if (candidates[i].count < candidates[index].count) index = i;
+        }
+        inherited = candidates[index].count;
+    }
+
+    LearnCandidate& c = candidates[index];
+    c.protocol = protocol;
+    c.value = value;
+    c.bits = bits;
+    c.count = inherited + 1;
+    c.error = inherited;
+    c.waveLength = 0;
+    c.waveCount = 0;
+    c.stateLength = state ? (stateLength > kStateSizeMax ? kStateSizeMax : stateLength) : 0;
+    if (c.stateLength > 0) memcpy(c.state, state, c.stateLength);
+    return index;
+}
+
+bool StreamingLearner::addWaveform(int candidate, const uint16_t* pulses, uint16_t length) {
+    if (candidate < 0 || candidate >= candidate_count || !pulses || length == 0) return false;
+    if (length > MAX_PULSES) length = MAX_PULSES;
+
+    LearnCandidate& c = candidates[candidate];
+    if (c.waveCount == 0) {
+        c.waveLength = length;
+    } else if (c.waveLength != length) {
+        wave_rejected++;
+        return false;
+    }
+
+    // Welford：逐个样本更新均值和离差平方和，不保存历史样本
+    c.waveCount++;
+    float* mean = wave_mean[candidate];
+    float* m2 = wave_m2[candidate];
+    if (c.waveCount == 1) {
+        for (uint16_t i = 0; i < length; i++) {
+            mean[i] = pulses[i];
+            m2[i] = 0;
+        }
+        return true;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        float delta = pulses[i] - mean[i];
+        mean[i] += delta / c.waveCount;
+        m2[i] += delta * (pulses[i] - mean[i]);
+    }
+    return true;
+}
+
+int StreamingLearner::bestCandidate() const {
+    int best = -1;
+    for (int i = 0; i < candidate_count; i++) {
+        if (best < 0 || candidates[i].count > candidates[best].count ||
+            (candidates[i].count == candidates[best].count && candidates[i].error < candidates[best].error)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+uint8_t StreamingLearner::confidencePercent() const {
+    int best = bestCandidate();
+    if (best < 0 || total == 0) return 0;
+    return (uint8_t)((uint64_t)candidates[best].count * 100 / total);
+}
+
+uint8_t StreamingLearner::guaranteedPercent() const {
+    int best = bestCandidate();
+    if (best < 0 || total == 0) return 0;
+    const LearnCandidate& c = candidates[best];
+    return (uint8_t)((uint64_t)(c.count - c.error) * 100 / total);
+}
+
+uint16_t StreamingLearner::waveform(int candidate, uint16_t* out, uint16_t capacity) const {
+    if (candidate < 0 || candidate >= candidate_count || !out) return 0;
+    const LearnCandidate& c = candidates[candidate];
+    if (c.waveCount == 0) return 0;
+
+    uint16_t length = c.waveLength < capacity ? c.waveLength : capacity;
+    for (uint16_t i = 0; i < length; i++) {
+        float value = wave_mean[candidate][i] + 0.5f;
+        out[i] = value >= 65535.0f ? 65535 : (uint16_t)value;
+    }
+    return length;
+}
+
+uint16_t StreamingLearner::maxDeviation(int candidate) const {
+    if (candidate < 0 || candidate >= candidate_count) return 0;
+    const LearnCandidate& c = candidates[candidate];
+    if (c.waveCount < 2) return 0;
+
+    float worst = 0;
+    for (uint16_t i = 0; i < c.waveLength; i++) {
+        float variance = wave_m2[candidate][i] / (c.waveCount - 1);
+        if (variance > worst) worst = variance;
+    }
+    return (uint16_t)sqrtf(worst);
+}
+
+// ============== BatchSession 实现 ==============
+
+BatchSession::BatchSession() {
+    reset();
+}
+
+void BatchSession::reset(uint16_t gapMs, int maxKeys) {
+    memset(keys, 0, sizeof(keys));
+    key_count = 0;
+    key_limit = (uint8_t)(maxKeys < 0 ? 0 : (maxKeys > MAX_KEYS ? MAX_KEYS : maxKeys));
+    gap_ms = gapMs;
+    total_frames = 0;
+    dropped_frames = 0;
+    wave_rejected = 0;
+    current = -1;
+    segment_frames = 0;
+    segment_suspect = false;
+    last_frame_ms = 0;
+}
+
+int BatchSession::findKey(decode_type_t protocol, uint64_t value, uint16_t bits) const {
+    for (int i = 0; i < key_count; i++) {
+        const BatchKey& k = keys[i];
+        if (k.protocol == protocol && k.value == value && k.bits == bits) return i;
+    }
+    return -1;
+}
+
+void BatchSession::closeSegment() {
+    if (current >= 0 && segment_suspect && segment_frames == 1) {
+        keys[current].suspectPresses++;
+    }
+    current = -1;
+    segment_frames = 0;
+    segment_suspect = false;
+}
+
+int BatchSession::addFrame(decode_type_t protocol, uint64_t value, uint16_t bits, uint32_t nowMs,
+                           const uint8_t* state, uint16_t stateLength) {
+    total_frames++;
+    bool withinGap = current >= 0 && nowMs - last_frame_ms <= gap_ms;
+    last_frame_ms = nowMs;
+
+    int index = findKey(protocol, value, bits);
+    if (withinGap && index == current) {
+        // 同一按压中的完整重复帧(如Sony按住时重复发送主帧)
+        segment_frames++;
+        keys[index].frames++;
+        return index;
+    }
+
+    // 编码变化或间隔足够长：开始新的按压分段
+    closeSegment();
+    if (index < 0) {
+        if (key_count >= key_limit) {
+            dropped_frames++;
+            return -1;
+        }
+        index = key_count++;
+        BatchKey& k = keys[index];
+        k.protocol = protocol;
+        k.value = value;
+        k.bits = bits;
+        k.stateLength = state ? (stateLength > kStateSizeMax ? kStateSizeMax : stateLength) : 0;
+        if (k.stateLength > 0) memcpy(k.state, state, k.stateLength);
+    }
+
+    current = index;
+    segment_frames = 1;
+    segment_suspect = withinGap;
+    keys[index].presses++;
+    keys[index].frames++;
+    return index;
+}
+
+void BatchSession::addRepeat(uint32_t nowMs, uint16_t periodMs, const uint16_t* repeatCode, uint16_t length) {
+    // 表满后丢弃的按压或间隔过长的重复帧无法确定归属
+    if (current < 0 || nowMs - last_frame_ms > gap_ms) return;
+    last_frame_ms = nowMs;
+    segment_frames++;
+
+    BatchKey& k = keys[current];
+    k.repeats++;
+    if (periodMs > 0) {
+        k.periodSum += periodMs;
+        k.periodCount++;
+    }
+    if (repeatCode && length > 0 && length <= MAX_REPEAT_PULSES) {
+        memcpy(k.repeatData, repeatCode, length * sizeof(uint16_t));
+        k.repeatLength = length;
+    }
+}
+
+bool BatchSession::addWaveform(int key, const uint16_t* pulses, uint16_t length) {
+    if (key < 0 || key >= key_count || !pulses || length == 0) return false;
+    if (length > MAX_PULSES) length = MAX_PULSES;
+
+    BatchKey& k = keys[key];
+    if (k.waveCount == 0) {
+        memcpy(k.wave, pulses, length * sizeof(uint16_t));
+        k.waveLength = length;
+        k.waveCount = 1;
+        return true;
+    }
+    if (k.waveLength != length) {
+        wave_rejected++;
+        return false;
+    }
+
+    // 整数增量均值：每个按键只保留一份波形
+    k.waveCount++;
+    for (uint16_t i = 0; i < length; i++) {
+        int32_t delta = (int32_t)pulses[i] - k.wave[i];
+        k.wave[i] = (uint16_t)(k.wave[i] + delta / (int32_t)k.waveCount);
+    }
+    return true;
+}
+
+bool BatchSession::isAccepted(int index) const {
+    if (index < 0 || index >= key_count) return false;
+    const BatchKey& k = keys[index];
+    // 当前分段尚未结束时按未结束计算
+    uint16_t suspect = k.suspectPresses;
+    if (index == current && segment_suspect && segment_frames == 1) suspect++;
+    if (k.presses <= suspect) return false;
+    // UNKNOWN只能靠原始波形发射
+    return k.protocol != UNKNOWN || k.waveCount > 0;
+}
+
+int BatchSession::acceptedCount() const {
+    int count = 0;
+    for (int i = 0; i < key_count; i++) {
+        if (isAccepted(i)) count++;
+    }
+    return count;
+}
+
+uint16_t BatchSession::repeatPeriod(int index) const {
+    if (index < 0 || index >= key_count || keys[index].periodCount == 0) return 0;
+    const BatchKey& k = keys[index];
+    return (k.periodSum + k.periodCount / 2) / k.periodCount;
+}
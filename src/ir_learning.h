@@ -0,0 +1,149 @@
+#ifndef IR_LEARNING_H
+#define IR_LEARNING_H
+
+#include <stdint.h>
+#include <IRremoteESP8266.h>
+#include "ir_storage.h"
+
+// 候选码：一组相同(协议, 值, 位数)的样本
+struct LearnCandidate {
+    decode_type_t protocol;
+    uint64_t value;               // 有状态协议为状态字节指纹
+    uint16_t bits;
+    uint32_t count;               // 估计出现次数(可能偏大)
+    uint32_t error;               // 计数偏大的上限：替换进表时继承的次数
+    uint16_t waveLength;          // 参与波形统计的帧脉冲数，0表示还没有波形
+    uint32_t waveCount;           // 参与波形统计的帧数
+    uint16_t stateLength;         // 有状态协议的状态字节数，0表示无
+    uint8_t state[kStateSizeMax];
+};
+
+// 流式学习器：样本数不限，内存固定
+//   - 候选码按Space-Saving算法保留前TOP_K个，表满时替换计数最小的候选
+//   - 每个候选按脉冲位置用Welford算法累计均值和方差，样本越多波形越准
+class StreamingLearner {
+public:
+    static const int TOP_K = 4;
+    static const int MAX_PULSES = 256;
+
+private:
+    LearnCandidate candidates[TOP_K];
+    float wave_mean[TOP_K][MAX_PULSES];
+    float wave_m2[TOP_K][MAX_PULSES];
+    uint8_t candidate_count;
+    uint32_t total;               // 全部样本数
+    uint32_t wave_rejected;       // 长度与候选波形不一致而未计入的帧数
+
+    int findCandidate(decode_type_t protocol, uint64_t value, uint16_t bits) const;
+
+public:
+    StreamingLearner();
+
+    void reset();
+
+    // 记录一个解码样本，返回所属候选的下标；有状态协议同时给出状态字节(新候选时保存)
+    int addSample(decode_type_t protocol, uint64_t value, uint16_t bits,
+                  const uint8_t* state = nullptr, uint16_t stateLength = 0);
+
+    // 为候选累计一帧原始脉冲(微秒)，帧长与已有波形不同时忽略并返回false
+    bool addWaveform(int candidate, const uint16_t* pulses, uint16_t length);
+
+    uint32_t totalSamples() const { return total; }
+    uint32_t rejectedWaveforms() const { return wave_rejected; }
+    int candidateCount() const { return candidate_count; }
+    const LearnCandidate& candidate(int index) const { return candidates[index]; }
+
+    // 计数最多的候选(并列时取误差较小者)，无样本时返回-1
+    int bestCandidate() const;
+
+    // 最佳候选占全部样本的百分比，以及扣除误差后的保守值
+    uint8_t confidencePercent() const;
+    uint8_t guaranteedPercent() const;
+
+    // 按均值取整输出候选波形，返回脉冲数
+    uint16_t waveform(int candidate, uint16_t* out, uint16_t capacity) const;
+
+    // 候选波形各位置标准差的最大值(微秒)，反映样本间抖动
+    uint16_t maxDeviation(int candidate) const;
+};
+
+// 批量学习中的一个按键：相同(协议, 值, 位数)的所有按压
+struct BatchKey {
+    decode_type_t protocol;
+    uint64_t value;
+    uint16_t bits;
+    uint16_t presses;             // 按压次数(分段数)
+    uint16_t suspectPresses;      // 疑似误码的按压：紧接在其他按键之后且只有一帧
+    uint16_t frames;              // 完整帧数
+    uint16_t repeats;             // 按住时的重复帧数
+    uint32_t periodSum;           // 测得的帧周期累计(ms)
+    uint16_t periodCount;
+    uint16_t repeatLength;        // NEC式重复码长度
+    uint16_t repeatData[MAX_REPEAT_PULSES];
+    uint16_t waveLength;          // 0表示还没有通过过滤的波形
+    uint16_t waveCount;
+    uint16_t wave[256];           // 各帧逐位置的平均波形(微秒)
+    uint16_t stateLength;         // 有状态协议的状态字节数，0表示无
+    uint8_t state[kStateSizeMax];
+};
+
+// 批量学习会话：一次学习整个遥控器
+//   - 按键间隔超过gapMs或编码变化时开始新的按压分段
+//   - 分段按(协议, 值, 位数)归并为按键，同一按键只需按一次，耗时与按键数成正比
+//   - 紧接在其他按键之后出现、且只有一帧的分段视为误码，按键的全部按压都可疑时不入库
+class BatchSession {
+public:
+    static const int MAX_KEYS = 20;           // 与存储的信号数上限相同，每个按键约670字节静态内存
+    static const int MAX_PULSES = 256;
+    static const uint16_t DEFAULT_GAP_MS = 250;
+
+private:
+    BatchKey keys[MAX_KEYS];
+    uint8_t key_count;
+    uint8_t key_limit;            // 本次会话最多记录的按键数(不超过MAX_KEYS)
+    uint16_t gap_ms;
+    uint32_t total_frames;
+    uint32_t dropped_frames;      // 按键表已满而丢弃的帧
+    uint32_t wave_rejected;       // 长度与已有波形不一致而未计入的帧
+    int current;                  // 当前分段所属按键，-1表示没有分段
+    uint16_t segment_frames;      // 当前分段的帧数(含重复帧)
+    bool segment_suspect;         // 当前分段是否紧接在另一按键之后开始
+    uint32_t last_frame_ms;
+
+    int findKey(decode_type_t protocol, uint64_t value, uint16_t bits) const;
+
+public:
+    BatchSession();
+
+    // maxKeys限制本次会话的按键数，例如存储剩余的槽位数，超出MAX_KEYS时按MAX_KEYS
+    void reset(uint16_t gapMs = DEFAULT_GAP_MS, int maxKeys = MAX_KEYS);
+
+    // 记录一个新帧，返回所属按键下标；按键表已满时返回-1。有状态协议同时给出状态字节
+    int addFrame(decode_type_t protocol, uint64_t value, uint16_t bits, uint32_t nowMs,
+                 const uint8_t* state = nullptr, uint16_t stateLength = 0);
+
+    // 记录按住产生的重复帧，归入当前分段；repeatCode为NEC式重复码(可为空)
+    void addRepeat(uint32_t nowMs, uint16_t periodMs, const uint16_t* repeatCode, uint16_t length);
+
+    // 为按键累计一帧已过滤的原始脉冲，帧长与已有波形不同时忽略并返回false
+    bool addWaveform(int key, const uint16_t* pulses, uint16_t length);
+
+    // 结束当前分段(入库前调用)
+    void closeSegment();
+
+    int keyCount() const { return key_count; }
+    int keyLimit() const { return key_limit; }
+    const BatchKey& key(int index) const { return keys[index]; }
+    bool isAccepted(int index) const;
+    int acceptedCount() const;
+    // 当前分段是否为按键的新按压(addFrame之后查询)
+    bool isNewPress() const { return segment_frames == 1; }
+    uint32_t totalFrames() const { return total_frames; }
+    uint32_t droppedFrames() const { return dropped_frames; }
+    uint32_t rejectedWaveforms() const { return wave_rejected; }
+
+    // 平均帧周期(ms)，未测得时返回0
+    uint16_t repeatPeriod(int index) const;
+};
+
+#endif
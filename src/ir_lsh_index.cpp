@@ -0,0 +1,158 @@
+#include "ir_lsh_index.h"
+#include <algorithm>
+
+static const int32_t SLOT_END = -1;
+static const int32_t SLOT_ABSENT = -2;
+static const uint16_t LSH_MAX_PULSES = 256;
+// 主要的类至少有3个成员且占脉冲数的十分之一，几个被干扰的脉冲聚在一起也不算
+static const uint16_t LSH_MIN_CLASS = 3;
+static const uint16_t LSH_MAJOR_SHARE = 10;
+
+// 32位整数混合(murmur3终结步骤)，用于选取位置和打散键
+static uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+uint16_t levelPulses(const uint16_t* pulses, uint16_t length, uint8_t* out, uint16_t capacity) {
+    if (length % 2 == 0 && length > 0) length--;
+    if (!pulses || length == 0) return 0;
+    if (length > capacity) length = capacity;
+    if (length > LSH_MAX_PULSES) length = LSH_MAX_PULSES;
+
+    uint16_t sorted[LSH_MAX_PULSES];
+    for (uint16_t i = 0; i < length; i++) sorted[i] = pulses[i];
+    std::sort(sorted, sorted + length);
+
+    // 每一类的上界和成员数
+    uint16_t bounds[LSH_MAX_PULSES];
+    uint16_t sizes[LSH_MAX_PULSES];
+    uint16_t classes = 0;
+    uint16_t first = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        if (i + 1 == length || (uint32_t)sorted[i + 1] * 100 > (uint32_t)sorted[i] * LSH_SPLIT_PCT) {
+            bounds[classes] = sorted[i];
+            sizes[classes++] = i + 1 - first;
+            first = i + 1;
+        }
+    }
+
+    // 主要的类(数据位的时长)按序号编档；引导码等零散时长按位于哪两个主要类之间编档，
+    // 零散时长与相邻的类时分时合也不改变其他脉冲的档位
+    uint16_t minMajor = length / LSH_MAJOR_SHARE > LSH_MIN_CLASS ? length / LSH_MAJOR_SHARE : LSH_MIN_CLASS;
+    uint8_t levels[LSH_MAX_PULSES];
+    uint8_t major = 0;
+    for (uint16_t c = 0; c < classes; c++) {
+        if (sizes[c] >= minMajor) {
+            levels[c] = major < 0x7F ? major++ : major;
+        } else {
+            levels[c] = 0x80 | major;
+        }
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        out[i] = levels[std::lower_bound(bounds, bounds + classes, pulses[i]) - bounds];
+    }
+    return length;
+}
+
+LshIndex::LshIndex(int32_t* heads, int buckets, Slot* slots, int capacity, const LshConfig& config)
+    : heads(heads), buckets(buckets), slots(slots), capacity(capacity), config(config), count(0) {
+    if (this->config.tables > MAX_TABLES) this->config.tables = MAX_TABLES;
+    if (this->config.tables == 0) this->config.tables = 1;
+    if (this->config.samples == 0) this->config.samples = 1;
+    clear();
+}
+
+void LshIndex::clear() {
+    for (int i = 0; i < config.tables * buckets; i++) heads[i] = SLOT_END;
+    for (int32_t id = 0; id < capacity; id++) slot(id, 0).next = SLOT_ABSENT;
+    count = 0;
+}
+
+// 取样位置只取决于表号、序号和序列长度，插入和查询选取的位置相同
+uint32_t LshIndex::tableKey(int table, const uint8_t* levels, uint16_t length) const {
+    uint32_t hash = mix32(((uint32_t)table << 16 | length) + 0x9E3779B9u);
+    for (int s = 0; s < config.samples; s++) {
+        uint32_t position = mix32((uint32_t)table << 8 | s) % length;
+        hash = (hash ^ levels[position]) * 16777619u;
+    }
+    return mix32(hash);
+}
+
+bool LshIndex::insert(int32_t id, const uint8_t* levels, uint16_t length) {
+    if (id < 0 || id >= capacity || !levels || length == 0) return false;
+    remove(id);
+
+    for (int t = 0; t < config.tables; t++) {
+        uint32_t key = tableKey(t, levels, length);
+        int32_t& head = heads[t * buckets + (key & (buckets - 1))];
+        Slot& s = slot(id, t);
+        s.key = key;
+        s.next = head;
+        head = id;
+    }
+    count++;
+    return true;
+}
+
+bool LshIndex::remove(int32_t id) {
+    if (!contains(id)) return false;
+
+    for (int t = 0; t < config.tables; t++) {
+        Slot& s = slot(id, t);
+        int32_t* link = &heads[t * buckets + (s.key & (buckets - 1))];
+        while (*link != SLOT_END) {
+            if (*link == id) {
+                *link = s.next;
+                break;
+            }
+            link = &slot(*link, t).next;
+        }
+    }
+    slot(id, 0).next = SLOT_ABSENT;
+    count--;
+    return true;
+}
+
+bool LshIndex::contains(int32_t id) const {
+    return id >= 0 && id < capacity && slot(id, 0).next != SLOT_ABSENT;
+}
+
+int LshIndex::candidates(const uint8_t* levels, uint16_t length, int32_t* out, uint8_t* votes, int capacity) const {
+    if (!levels || length == 0 || capacity <= 0) return 0;
+
+    // 先收集每张表的碰撞(含重复)，排序后合并，重复次数即碰撞的表数
+    int n = 0;
+    for (int t = 0; t < config.tables && n < capacity; t++) {
+        uint32_t key = tableKey(t, levels, length);
+        int32_t id = heads[t * buckets + (key & (buckets - 1))];
+        while (id != SLOT_END && n < capacity) {
+            const Slot& s = slot(id, t);
+            if (s.key == key) out[n++] = id;
+            id = s.next;
+        }
+    }
+    std::sort(out, out + n);
+
+    int unique = 0;
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && out[j] == out[i]) j++;
+        out[unique] = out[i];
+        if (votes) votes[unique] = (uint8_t)(j - i);
+        unique++;
+        i = j;
+    }
+    return unique;
+}
+
+uint8_t LshIndex::confidence(uint8_t similarity, uint8_t runnerUp) {
+    uint8_t margin = similarity > runnerUp ? similarity - runnerUp : 0;
+    if (margin >= CONFIDENCE_MARGIN) return similarity;
+    return (uint8_t)((uint32_t)similarity * (CONFIDENCE_MARGIN + margin) / (CONFIDENCE_MARGIN * 2));
+}
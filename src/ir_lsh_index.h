@@ -0,0 +1,73 @@
+#ifndef IR_LSH_INDEX_H
+#define IR_LSH_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 局部敏感哈希(LSH)索引：在大量原始捕获中查找与给定帧最接近的信号，容忍抖动
+// 脉冲先由levelPulses量化为档位序列，每张哈希表从序列中取samples个位置(按表号和序号伪随机选取，
+// 对序列长度取模)，连同序列长度组成键。两个序列有比例d的位置档位不同时，一张表碰撞的概率约为
+// (1-d)^samples，任一张表碰撞即成为候选：
+//   samples越多  不相关的信号越少成为候选，但能容忍的不同位置也越少
+//   tables越多   漏检越少，插入和查询的开销随表数增加
+// 档位是帧内时长聚类的序号而不是固定分档，各类之间相差足够大时抖动不改变档位，
+// 默认参数在匹配阈值(95%脉冲一致)附近仍能召回
+// 脉冲数不同的序列不会碰撞；候选由调用者逐脉冲比较，按最高相似度和次优候选的差距给出置信度
+// 存储由调用者提供，设备端随信号库静态分配，主机端可放入上百万个捕获
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+static const uint8_t LSH_DEFAULT_TABLES = 8;
+static const uint8_t LSH_DEFAULT_SAMPLES = 24;
+
+struct LshConfig {
+    uint8_t tables;               // 哈希表数，最多LshIndex::MAX_TABLES
+    uint8_t samples;              // 每张表取样的位置数
+};
+
+const LshConfig kDefaultLsh = {LSH_DEFAULT_TABLES, LSH_DEFAULT_SAMPLES};
+
+// 把脉冲量化为档位：按时长排序，相邻时长相差LSH_SPLIT_PCT以上处分为不同的类，档位由类的序号决定
+// 结尾间隔(偶数个脉冲时的最后一个space)不计入。写入out(最多capacity个)，返回写入的个数
+static const uint16_t LSH_SPLIT_PCT = 130;
+uint16_t levelPulses(const uint16_t* pulses, uint16_t length, uint8_t* out, uint16_t capacity);
+
+class LshIndex {
+public:
+    static const int MAX_TABLES = 16;
+
+    // 每个条目在每张表中占一个槽位
+    struct Slot {
+        uint32_t key;
+        int32_t next;             // 同一个桶中的下一个条目，-1为链尾，-2表示条目不在索引中(只用第0张表的槽位)
+    };
+
+    // heads容量为tables * buckets，buckets必须是2的幂；slots容量为capacity * tables
+    LshIndex(int32_t* heads, int buckets, Slot* slots, int capacity, const LshConfig& config = kDefaultLsh);
+
+    void clear();
+    // id为0~capacity-1，已在索引中时先移除；序列为空或id越界时返回false
+    bool insert(int32_t id, const uint8_t* levels, uint16_t length);
+    bool remove(int32_t id);
+    bool contains(int32_t id) const;
+    int size() const { return count; }
+    const LshConfig& getConfig() const { return config; }
+
+    // 输出候选ID及其碰撞的表数(votes可为nullptr)，按ID排序，最多capacity个，返回输出的个数
+    int candidates(const uint8_t* levels, uint16_t length, int32_t* out, uint8_t* votes, int capacity) const;
+
+    // 置信度(0~100)：最高相似度，与次优候选相差不足CONFIDENCE_MARGIN时按差距降低，相同时减半
+    static const uint8_t CONFIDENCE_MARGIN = 10;
+    static uint8_t confidence(uint8_t similarity, uint8_t runnerUp);
+
+private:
+    int32_t* heads;
+    int buckets;
+    Slot* slots;
+    int capacity;
+    LshConfig config;
+    int count;
+
+    uint32_t tableKey(int table, const uint8_t* levels, uint16_t length) const;
+    Slot& slot(int32_t id, int table) const { return slots[(size_t)id * config.tables + table]; }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "ir_parallel_match.h"
+
+ParallelMatcher::ParallelMatcher(MatchWorkers* workers) : workers(workers), stop(false) {
+}
+
+int ParallelMatcher::workerCount() const {
+    int n = workers ? workers->count() : 1;
+    return n < MAX_WORKERS ? n : MAX_WORKERS;
+}
+
+ParallelMatchResult ParallelMatcher::match(const uint16_t* pulses, uint16_t length, const int32_t* candidates,
+                                           int count, PulsesFn pulsesOf, void* ctx, uint8_t stopSimilarity,
+                                           const PulseMatchConfig& config) {
+    ParallelMatchResult result = {-1, 0, 0, false};
+    if (!pulses || length == 0 || count <= 0 || !pulsesOf) return result;
+
+    // 候选比工作者少时多余的工作者直接返回
+    int stride = workerCount();
+    for (int w = 0; w < stride; w++) {
+        partials[w].best = -1;
+        partials[w].similarity = 0;
+        partials[w].compared = 0;
+    }
+    job_pulses = pulses;
+    job_length = length;
+    job_candidates = candidates;
+    job_count = count;
+    job_stride = stride;
+    job_pulses_of = pulsesOf;
+    job_ctx = ctx;
+    job_stop = stopSimilarity;
+    job_config = &config;
+    stop.store(false, std::memory_order_relaxed);
+
+    MatchWorkers* runner = workers ? workers : &serial;
+    runner->run(work, this);
+
+    for (int w = 0; w < stride; w++) {
+        const Partial& p = partials[w];
+        result.compared += p.compared;
+        if (p.best < 0) continue;
+        if (result.best < 0 || p.similarity > result.similarity ||
+            (p.similarity == result.similarity && p.best < result.best)) {
+            result.best = p.best;
+            result.similarity = p.similarity;
+        }
+    }
+    result.stopped = stop.load(std::memory_order_relaxed);
+    return result;
+}
+
+void ParallelMatcher::work(int worker, void* ctx) {
+    ParallelMatcher* self = (ParallelMatcher*)ctx;
+    if (worker >= self->job_stride) return;
+
+    Partial& partial = self->partials[worker];
+    for (int i = worker; i < self->job_count; i += self->job_stride) {
+        if (self->stop.load(std::memory_order_relaxed)) break;
+
+        int32_t id = self->job_candidates ? self->job_candidates[i] : i;
+        uint16_t length = 0;
+        const uint16_t* stored = self->job_pulses_of(id, length, self->job_ctx);
+        if (!stored) continue;
+
+        uint8_t score = rawPulsesSimilarity(stored, length, self->job_pulses, self->job_length, *self->job_config);
+        partial.compared++;
+        if (partial.best < 0 || score > partial.similarity || (score == partial.similarity && id < partial.best)) {
+            partial.best = id;
+            partial.similarity = score;
+        }
+        if (score >= self->job_stop) {
+            self->stop.store(true, std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+#ifndef ARDUINO
+
+ThreadPoolMatchWorkers::ThreadPoolMatchWorkers(int workers)
+    : generation(0), pending(0), quit(false), work_fn(nullptr), work_ctx(nullptr) {
+    if (workers < 1) workers = 1;
+    for (int i = 0; i < workers; i++) threads.emplace_back(&ThreadPoolMatchWorkers::threadMain, this, i);
+}
+
+ThreadPoolMatchWorkers::~ThreadPoolMatchWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    start_cv.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+void ThreadPoolMatchWorkers::run(WorkFn work, void* ctx) {
+    std::unique_lock<std::mutex> lock(mutex);
+    work_fn = work;
+    work_ctx = ctx;
+    pending = (int)threads.size();
+    generation++;
+    start_cv.notify_all();
+    done_cv.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPoolMatchWorkers::threadMain(int worker) {
+    uint64_t seen = 0;
+    while (true) {
+        WorkFn work;
+        void* ctx;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this, seen] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+            work = work_fn;
+            ctx = work_ctx;
+        }
+        work(worker, ctx);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done_cv.notify_one();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef IR_PARALLEL_MATCH_H
+#define IR_PARALLEL_MATCH_H
+
+#include <stdint.h>
+#include <atomic>
+#include "ir_signal_match.h"
+
+// 匹配工作者：在count()个工作者上并行执行同一个函数，全部返回后run才返回
+// 主机端为线程池，单个工作者时直接在调用者中执行
+class MatchWorkers {
+public:
+    typedef void (*WorkFn)(int worker, void* ctx);
+
+    virtual ~MatchWorkers() {}
+    virtual int count() const = 0;
+    virtual void run(WorkFn work, void* ctx) = 0;
+};
+
+// 单个工作者，在调用者的任务中顺序执行(并行的基线)
+class SerialMatchWorkers : public MatchWorkers {
+public:
+    int count() const override { return 1; }
+    void run(WorkFn work, void* ctx) override { work(0, ctx); }
+};
+
+// 并行匹配结果
+struct ParallelMatchResult {
+    int32_t best;                 // 最相似的候选ID，没有可比较的候选时为-1
+    uint8_t similarity;
+    uint32_t compared;            // 实际比较的候选数，提前结束时少于候选数
+    bool stopped;                 // 有工作者达到stopSimilarity后提前结束
+};
+
+// 并行逐脉冲匹配：候选按下标交错分给各工作者(第w个取w, w+W, ...)，各自记录最相似的候选后合并，
+// 相似度相同时取ID小的。任一工作者达到stopSimilarity即设置共享的结束标志，其他工作者比较完当前候选后停止，
+// 此时结果是达到阈值的某个候选而不一定是全局最相似的
+// 比较期间候选的脉冲不能被修改，由调用者保证
+// 只用于主机端的bench和parbench：设备上信号库最多20个，特征索引筛选后的候选远少于值得分给两个核心的规模，
+// IRStorage::matchPulses在调用者中逐个比较
+class ParallelMatcher {
+public:
+    static const int MAX_WORKERS = 16;
+    static const uint8_t NO_STOP = 101;           // 不提前结束
+
+    // 取候选的脉冲，无效ID返回nullptr
+    typedef const uint16_t* (*PulsesFn)(int32_t id, uint16_t& length, void* ctx);
+
+    explicit ParallelMatcher(MatchWorkers* workers = nullptr);
+
+    void setWorkers(MatchWorkers* workers) { this->workers = workers; }
+    int workerCount() const;
+
+    // candidates为nullptr时比较ID为0~count-1的全部条目
+    ParallelMatchResult match(const uint16_t* pulses, uint16_t length, const int32_t* candidates, int count,
+                              PulsesFn pulsesOf, void* ctx, uint8_t stopSimilarity = NO_STOP,
+                              const PulseMatchConfig& config = kDefaultPulseMatch);
+
+private:
+    // 各工作者的部分结果各占一个缓存行，避免互相写同一行
+    struct alignas(64) Partial {
+        int32_t best;
+        uint8_t similarity;
+        uint32_t compared;
+    };
+
+    MatchWorkers* workers;
+    SerialMatchWorkers serial;
+    Partial partials[MAX_WORKERS];
+    std::atomic<bool> stop;
+
+    // 当前作业(match期间有效)
+    const uint16_t* job_pulses;
+    uint16_t job_length;
+    const int32_t* job_candidates;
+    int job_count;
+    int job_stride;
+    PulsesFn job_pulses_of;
+    void* job_ctx;
+    uint8_t job_stop;
+    const PulseMatchConfig* job_config;
+
+    static void work(int worker, void* ctx);
+};
+
+#ifndef ARDUINO
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 主机端：固定数量的线程，每次run唤醒全部线程并等待它们完成
+class ThreadPoolMatchWorkers : public MatchWorkers {
+public:
+    explicit ThreadPoolMatchWorkers(int workers);
+    ~ThreadPoolMatchWorkers() override;
+
+    int count() const override { return (int)threads.size(); }
+    void run(WorkFn work, void* ctx) override;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation;
+    int pending;
+    bool quit;
+    WorkFn work_fn;
+    void* work_ctx;
+
+    void threadMain(int worker);
+};
+#endif
+
+#endif
@@ -0,0 +1,235 @@
+#include "ir_pattern_table.h"
+#include <string.h>
+
+PatternTable::PatternTable() {
+    clear();
+}
+
+void PatternTable::clear() {
+    memset(pairs, 0, sizeof(pairs));
+    memset(segments, 0, sizeof(segments));
+}
+
+uint8_t PatternTable::findPair(uint16_t mark, uint16_t space) const {
+    for (int i = 0; i < MAX_PAIRS; i++) {
+        if (pairs[i].refs > 0 && pairs[i].mark == mark && pairs[i].space == space) return (uint8_t)i;
+    }
+    return PATTERN_NONE;
+}
+
+uint8_t PatternTable::internPair(uint16_t mark, uint16_t space) {
+    uint8_t index = findPair(mark, space);
+    if (index != PATTERN_NONE) {
+        pairs[index].refs++;
+        return index;
+    }
+    for (int i = 0; i < MAX_PAIRS; i++) {
+        if (pairs[i].refs > 0) continue;
+        pairs[i].mark = mark;
+        pairs[i].space = space;
+        pairs[i].refs = 1;
+        return (uint8_t)i;
+    }
+    return PATTERN_NONE;
+}
+
+void PatternTable::releasePair(uint8_t index) {
+    if (index < MAX_PAIRS && pairs[index].refs > 0) pairs[index].refs--;
+}
+
+// pulses为片段的脉冲(最多SEGMENT_PAIRS * 2个)，奇数个时最后一对的space为0
+uint8_t PatternTable::internSegment(const uint16_t* pulses, uint16_t length) {
+    uint8_t count = (uint8_t)((length + 1) / 2);
+    uint8_t index[SEGMENT_PAIRS];
+
+    // 脉冲对都已存在时先查找相同的片段
+    bool known = true;
+    for (uint8_t i = 0; i < count && known; i++) {
+        uint16_t space = i * 2 + 1 < length ? pulses[i * 2 + 1] : 0;
+        index[i] = findPair(pulses[i * 2], space);
+        known = index[i] != PATTERN_NONE;
+    }
+    if (known) {
+        for (int s = 0; s < MAX_SEGMENTS; s++) {
+            Segment& segment = segments[s];
+            if (segment.refs > 0 && segment.length == count && memcmp(segment.pairs, index, count) == 0) {
+                segment.refs++;
+                return (uint8_t)s;
+            }
+        }
+    }
+
+    // 新片段：占用空闲项，并为每个脉冲对增加一次引用
+    int slot = -1;
+    for (int s = 0; s < MAX_SEGMENTS && slot < 0; s++) {
+        if (segments[s].refs == 0) slot = s;
+    }
+    if (slot < 0) return PATTERN_NONE;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t space = i * 2 + 1 < length ? pulses[i * 2 + 1] : 0;
+        index[i] = internPair(pulses[i * 2], space);
+        if (index[i] == PATTERN_NONE) {
+            while (i > 0) releasePair(index[--i]);
+            return PATTERN_NONE;
+        }
+    }
+    Segment& segment = segments[slot];
+    segment.length = count;
+    memcpy(segment.pairs, index, count);
+    segment.refs = 1;
+    return (uint8_t)slot;
+}
+
+void PatternTable::releaseSegment(uint8_t index) {
+    if (index >= MAX_SEGMENTS || segments[index].refs == 0) return;
+    Segment& segment = segments[index];
+    if (--segment.refs > 0) return;
+    for (uint8_t i = 0; i < segment.length; i++) releasePair(segment.pairs[i]);
+    segment.length = 0;
+}
+
+bool PatternTable::acquire(const uint16_t* pulses, uint16_t length, uint8_t* out, uint8_t capacity,
+                           uint8_t& count) {
+    count = 0;
+    uint16_t needed = segmentsFor(length);
+    if (needed > capacity) return false;
+
+    const uint16_t span = SEGMENT_PAIRS * 2;
+    for (uint16_t start = 0; start < length; start += span) {
+        uint16_t n = length - start < span ? length - start : span;
+        uint8_t index = internSegment(pulses + start, n);
+        if (index == PATTERN_NONE) {
+            release(out, count);
+            count = 0;
+            return false;
+        }
+        out[count++] = index;
+    }
+    return true;
+}
+
+void PatternTable::release(const uint8_t* refs, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) releaseSegment(refs[i]);
+}
+
+bool PatternTable::retain(const uint8_t* refs, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (refs[i] >= MAX_SEGMENTS) return false;
+        Segment& segment = segments[refs[i]];
+        if (segment.length == 0) return false;
+        if (segment.refs++ == 0) {
+            for (uint8_t p = 0; p < segment.length; p++) pairs[segment.pairs[p]].refs++;
+        }
+    }
+    return true;
+}
+
+bool PatternTable::expand(const uint8_t* refs, uint8_t count, uint16_t length, uint16_t* out) const {
+    uint16_t written = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (refs[i] >= MAX_SEGMENTS) return false;
+        const Segment& segment = segments[refs[i]];
+        if (segment.length == 0) return false;
+        for (uint8_t p = 0; p < segment.length; p++) {
+            const Pair& pair = pairs[segment.pairs[p]];
+            if (written < length) out[written++] = pair.mark;
+            if (written < length) out[written++] = pair.space;
+        }
+    }
+    return written == length;
+}
+
+int PatternTable::pairCount() const {
+    int n = 0;
+    for (int i = 0; i < MAX_PAIRS; i++) {
+        if (pairs[i].refs > 0) n++;
+    }
+    return n;
+}
+
+int PatternTable::segmentCount() const {
+    int n = 0;
+    for (int s = 0; s < MAX_SEGMENTS; s++) {
+        if (segments[s].refs > 0) n++;
+    }
+    return n;
+}
+
+size_t PatternTable::serializedSize() const {
+    int pairEnd = 0;
+    int segmentEnd = 0;
+    for (int i = 0; i < MAX_PAIRS; i++) {
+        if (pairs[i].refs > 0) pairEnd = i + 1;
+    }
+    for (int s = 0; s < MAX_SEGMENTS; s++) {
+        if (segments[s].refs > 0) segmentEnd = s + 1;
+    }
+
+    // 片段之间的空闲项只占长度字节
+    size_t size = 2 + pairEnd * 4 + segmentEnd;
+    for (int s = 0; s < segmentEnd; s++) {
+        if (segments[s].refs > 0) size += segments[s].length;
+    }
+    return size;
+}
+
+size_t PatternTable::serialize(uint8_t* out) const {
+    int pairEnd = 0;
+    int segmentEnd = 0;
+    for (int i = 0; i < MAX_PAIRS; i++) {
+        if (pairs[i].refs > 0) pairEnd = i + 1;
+    }
+    for (int s = 0; s < MAX_SEGMENTS; s++) {
+        if (segments[s].refs > 0) segmentEnd = s + 1;
+    }
+
+    uint8_t* p = out;
+    *p++ = (uint8_t)pairEnd;
+    for (int i = 0; i < pairEnd; i++) {
+        uint16_t mark = pairs[i].refs > 0 ? pairs[i].mark : 0;
+        uint16_t space = pairs[i].refs > 0 ? pairs[i].space : 0;
+        *p++ = (uint8_t)mark;
+        *p++ = (uint8_t)(mark >> 8);
+        *p++ = (uint8_t)space;
+        *p++ = (uint8_t)(space >> 8);
+    }
+    *p++ = (uint8_t)segmentEnd;
+    for (int s = 0; s < segmentEnd; s++) {
+        uint8_t length = segments[s].refs > 0 ? segments[s].length : 0;
+        *p++ = length;
+        memcpy(p, segments[s].pairs, length);
+        p += length;
+    }
+    return p - out;
+}
+
+size_t PatternTable::deserialize(const uint8_t* in, size_t available) {
+    clear();
+    const uint8_t* p = in;
+    const uint8_t* end = in + available;
+
+    if (p >= end) return 0;
+    int pairEnd = *p++;
+    if (pairEnd > MAX_PAIRS || (size_t)(end - p) < (size_t)pairEnd * 4) return 0;
+    for (int i = 0; i < pairEnd; i++, p += 4) {
+        pairs[i].mark = (uint16_t)(p[0] | (p[1] << 8));
+        pairs[i].space = (uint16_t)(p[2] | (p[3] << 8));
+    }
+
+    if (p >= end) return 0;
+    int segmentEnd = *p++;
+    if (segmentEnd > MAX_SEGMENTS) return 0;
+    for (int s = 0; s < segmentEnd; s++) {
+        if (p >= end) return 0;
+        uint8_t length = *p++;
+        if (length > SEGMENT_PAIRS || end - p < length) return 0;
+        for (uint8_t i = 0; i < length; i++) {
+            if (p[i] >= pairEnd) return 0;
+        }
+        segments[s].length = length;
+        memcpy(segments[s].pairs, p, length);
+        p += length;
+    }
+    return p - in;
+}
@@ -0,0 +1,82 @@
+#ifndef IR_PATTERN_TABLE_H
+#define IR_PATTERN_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 信号库共享模式表：同一遥控器的码有相同的引导码、位时序和结束码，只在整库中保存一次
+//   脉冲对  一个(mark, space)组合，帧尾单独的mark记为(mark, 0)
+//   片段    最多SEGMENT_PAIRS个连续脉冲对的下标
+// 信号的脉冲按脉冲对切分成片段，只保存片段下标序列。表项带引用计数：插入时去重，
+// 删除时引用减到0即回收，不需要改写其他信号。片段只有4个脉冲对，数据位的组合很快饱和，
+// 同一品牌的几百个码通常只需要几十个片段
+// 无损：脉冲必须完全相同才能共享，经过脉冲过滤量化的波形效果最好
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+static const uint8_t PATTERN_NONE = 0xFF;
+
+class PatternTable {
+public:
+    static const int MAX_PAIRS = 64;
+    static const int MAX_SEGMENTS = 254;          // 下标1字节，0xFF表示无
+    static const int SEGMENT_PAIRS = 4;
+    // 序列化：脉冲对数(1) + 每对4字节 + 片段数(1) + 每个片段 长度(1) + 下标
+    static const size_t MAX_SERIALIZED = 2 + MAX_PAIRS * 4 + MAX_SEGMENTS * (1 + SEGMENT_PAIRS);
+
+    // length个脉冲需要的片段数
+    static uint16_t segmentsFor(uint16_t length) {
+        uint16_t pairs = (length + 1) / 2;
+        return (pairs + SEGMENT_PAIRS - 1) / SEGMENT_PAIRS;
+    }
+
+private:
+    struct Pair {
+        uint16_t mark;
+        uint16_t space;
+        uint16_t refs;            // 引用它的片段数，0表示空闲
+    };
+
+    struct Segment {
+        uint8_t length;           // 脉冲对数，0表示空闲
+        uint8_t pairs[SEGMENT_PAIRS];
+        uint16_t refs;            // 引用它的信号片段数
+    };
+
+    Pair pairs[MAX_PAIRS];
+    Segment segments[MAX_SEGMENTS];
+
+    uint8_t findPair(uint16_t mark, uint16_t space) const;
+    uint8_t internPair(uint16_t mark, uint16_t space);
+    void releasePair(uint8_t index);
+    uint8_t internSegment(const uint16_t* pulses, uint16_t length);
+    void releaseSegment(uint8_t index);
+
+public:
+    PatternTable();
+
+    void clear();
+
+    // 把length个脉冲映射为片段下标写入out(容量capacity)并增加引用，count输出片段数
+    // 表已满或容量不足时不改变表并返回false
+    bool acquire(const uint16_t* pulses, uint16_t length, uint8_t* out, uint8_t capacity, uint8_t& count);
+
+    // 减少片段引用，引用为0的片段及其不再使用的脉冲对被回收
+    void release(const uint8_t* refs, uint8_t count);
+
+    // 加载后恢复引用：片段下标无效时返回false(已恢复的引用不回退)
+    bool retain(const uint8_t* refs, uint8_t count);
+
+    // 按片段下标还原length个脉冲，下标无效或片段不足时返回false
+    bool expand(const uint8_t* refs, uint8_t count, uint16_t length, uint16_t* out) const;
+
+    int pairCount() const;
+    int segmentCount() const;
+
+    // 序列化只写出仍被引用的表项，下标保持不变(中间的空闲项写为空)
+    size_t serializedSize() const;
+    size_t serialize(uint8_t* out) const;
+
+    // 读取序列化的表，表项引用计数为0，之后由retain恢复。返回使用的字节数，格式错误返回0
+    size_t deserialize(const uint8_t* in, size_t available);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "ir_pronto.h"
+#include <string.h>
+
+// 频率字单位：0.241246us，即 1 / (4.145146MHz)
+static const uint64_t PRONTO_UNIT_PS = 241246;   // 皮秒
+static const uint16_t MIN_CARRIER_KHZ = 10;
+static const uint16_t MAX_CARRIER_KHZ = 500;
+
+const char* prontoStatusName(ProntoStatus status) {
+    switch (status) {
+        case PRONTO_OK: return "ok";
+        case PRONTO_SYNTAX: return "syntax";
+        case PRONTO_UNSUPPORTED: return "unsupported";
+        case PRONTO_BAD_FREQUENCY: return "bad frequency";
+        case PRONTO_LENGTH_MISMATCH: return "length mismatch";
+        case PRONTO_TOO_LONG: return "too long";
+        default: return "?";
+    }
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 逐字读取：跳过空白，读取1~4位十六进制数字
+// 返回1读到一个字，0到达末尾，-1语法错误
+static int readWord(const char*& p, uint16_t& word) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    if (*p == '\0') return 0;
+
+    uint16_t value = 0;
+    int digits = 0;
+    int d;
+    while ((d = hexDigit(*p)) >= 0) {
+        if (++digits > 4) return -1;
+        value = (uint16_t)(value << 4 | d);
+        p++;
+    }
+    if (digits == 0 || (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')) return -1;
+    word = value;
+    return 1;
+}
+
+bool looksLikePronto(const char* text) {
+    if (!text) return false;
+    while (*text == ' ' || *text == '\t') text++;
+    return strncmp(text, "0000", 4) == 0 && (text[4] == ' ' || text[4] == '\t');
+}
+
+ProntoStatus parsePronto(const char* text, BundleEntry& out) {
+    if (!text) return PRONTO_SYNTAX;
+    const char* p = text;
+
+    uint16_t header[4];
+    for (int i = 0; i < 4; i++) {
+        int r = readWord(p, header[i]);
+        if (r < 0) return PRONTO_SYNTAX;
+        if (r == 0) return PRONTO_LENGTH_MISMATCH;
+    }
+    if (header[0] != 0x0000) return PRONTO_UNSUPPORTED;
+
+    uint16_t freqWord = header[1];
+    if (freqWord == 0) return PRONTO_BAD_FREQUENCY;
+    uint32_t khz = (uint32_t)((1000000000ULL + freqWord * PRONTO_UNIT_PS / 2) / (freqWord * PRONTO_UNIT_PS));
+    if (khz < MIN_CARRIER_KHZ || khz > MAX_CARRIER_KHZ) return PRONTO_BAD_FREQUENCY;
+
+    uint16_t pairs1 = header[2];
+    uint16_t pairs2 = header[3];
+    if (pairs1 == 0 && pairs2 == 0) return PRONTO_LENGTH_MISMATCH;
+
+    // 主帧：序列1，没有序列1时为序列2；去掉帧尾间隔后必须能放下
+    uint16_t mainPairs = pairs1 > 0 ? pairs1 : pairs2;
+    if (mainPairs * 2 - 1 > BundleEntry::MAX_PULSES) return PRONTO_TOO_LONG;
+
+    out.protocol = -1;
+    out.bits = 0;
+    out.value = 0;
+    out.carrierFreq = (uint16_t)khz;
+    out.dutyCycle = 0;
+    out.repeatPeriod = 0;
+    out.rawLength = 0;
+    out.repeatLength = 0;
+
+    uint64_t unitPs = freqWord * PRONTO_UNIT_PS;
+    uint32_t totalPulses = (uint32_t)(pairs1 + pairs2) * 2;
+    uint32_t repeatUs = 0;          // 序列2总时长(含帧尾间隔)
+    bool sameAsMain = pairs2 == pairs1;
+    bool repeatFits = pairs2 > 0 && pairs2 * 2 - 1 <= BundleEntry::MAX_REPEAT;
+
+    for (uint32_t i = 0; i < totalPulses; i++) {
+        uint16_t count;
+        int r = readWord(p, count);
+        if (r < 0) return PRONTO_SYNTAX;
+        if (r == 0) return PRONTO_LENGTH_MISMATCH;
+
+        uint64_t us = (count * unitPs + 500000) / 1000000;
+        uint16_t pulse = us > 0xFFFF ? 0xFFFF : (uint16_t)us;
+
+        if (i < (uint32_t)pairs1 * 2) {
+            out.rawData[i] = pulse;
+            continue;
+        }
+
+        // 序列2
+        uint32_t j = i - (uint32_t)pairs1 * 2;
+        repeatUs += (uint32_t)us;
+        if (pairs1 == 0) {
+            out.rawData[j] = pulse;
+            continue;
+        }
+        // 帧尾间隔不参与比较
+        if (sameAsMain && j + 1 < totalPulses - (uint32_t)pairs1 * 2 && out.rawData[j] != pulse) {
+            sameAsMain = false;
+        }
+        if (repeatFits && j < BundleEntry::MAX_REPEAT) out.repeatData[j] = pulse;
+    }
+
+    uint16_t trailing;
+    int r = readWord(p, trailing);
+    if (r < 0) return PRONTO_SYNTAX;
+    if (r > 0) return PRONTO_LENGTH_MISMATCH;
+
+    out.rawLength = mainPairs * 2 - 1;
+    if (pairs2 > 0) {
+        if (pairs1 == 0 || sameAsMain) {
+            // 按住时重复发送主帧
+            out.repeatPeriod = (uint16_t)((repeatUs + 500) / 1000);
+        } else if (repeatFits) {
+            out.repeatLength = pairs2 * 2 - 1;
+            out.repeatPeriod = (uint16_t)((repeatUs + 500) / 1000);
+        }
+    }
+    return PRONTO_OK;
+}
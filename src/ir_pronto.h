@@ -0,0 +1,31 @@
+#ifndef IR_PRONTO_H
+#define IR_PRONTO_H
+
+#include <stdint.h>
+#include "ir_bundle.h"
+
+// Pronto十六进制码(学习格式，首字为0000)：
+//   0000 | 频率字 | 序列1对数 | 序列2对数 | 序列1(mark,space)... | 序列2(mark,space)...
+// 载波周期 = 频率字 × 0.241246us，每个时长以载波周期为单位
+// 序列1发送一次，序列2为按住时的重复帧；只有序列2时主帧即重复帧
+// 不依赖Arduino和IRremoteESP8266，同一份代码也用于主机端工具
+enum ProntoStatus {
+    PRONTO_OK = 0,
+    PRONTO_SYNTAX,                // 含非十六进制字或字长超过4位
+    PRONTO_UNSUPPORTED,           // 非学习格式(如5000 RC5、900A NEC等预定义格式)
+    PRONTO_BAD_FREQUENCY,
+    PRONTO_LENGTH_MISMATCH,       // 字数与序列对数不符
+    PRONTO_TOO_LONG               // 主帧超过BundleEntry::MAX_PULSES
+};
+
+const char* prontoStatusName(ProntoStatus status);
+
+// 解析Pronto码为原始脉冲(微秒，mark开头，去掉帧尾间隔)和载波
+// 输出的protocol为-1(UNKNOWN)，名称不变；repeatPeriod为重复帧的帧首到帧首时长(ms)
+// 序列2超出重复帧容量时：与序列1相同则改为重复主帧，否则不保留重复帧
+ProntoStatus parsePronto(const char* text, BundleEntry& out);
+
+// 粗略判断文本是否为Pronto码(以4位十六进制字0000开头)
+bool looksLikePronto(const char* text);
+
+#endif
@@ -0,0 +1,318 @@
+#include "ir_protocol_decoder.h"
+
+static bool matchTime(uint32_t measured, uint32_t expected, const DecodeTolerance& tolerance) {
+    uint32_t delta = expected * tolerance.percent / 100;
+    if (delta < tolerance.minimum) delta = tolerance.minimum;
+    return measured + delta >= expected && measured <= expected + delta;
+}
+
+// 数据位之后明显长于任何数据space的间隔视为帧尾
+static bool isFrameGap(uint32_t space, const ProtocolDescriptor& desc) {
+    uint32_t longest = desc.oneSpace > desc.zeroSpace ? desc.oneSpace : desc.zeroSpace;
+    return space > longest * 2;
+}
+
+static bool decodePulseDistance(const ProtocolDescriptor& desc, const uint16_t* pulses, uint16_t length,
+                                DecodedSignal& out, const DecodeTolerance& tolerance) {
+    uint16_t i = 0;
+
+    if (desc.hdrMark) {
+        if (length < 2 || !matchTime(pulses[0], desc.hdrMark, tolerance)) return false;
+
+        // NEC重复码：头部mark + 短space + 结束mark
+        if (desc.repeatMode == RepeatMode::NEC_REPEAT_CODE && length >= 3 &&
+            matchTime(pulses[1], desc.rptSpace, tolerance) &&
+            matchTime(pulses[2], desc.footerMark, tolerance)) {
+            out.value = ~0ULL;
+            out.bits = 0;
+            out.repeat = true;
+            return true;
+        }
+
+        if (!matchTime(pulses[1], desc.hdrSpace, tolerance)) return false;
+        i = 2;
+    }
+
+    // mark长度不同的协议(Sony)由mark区分0/1，否则由space区分
+    bool markEncodes = desc.oneMark != desc.zeroMark;
+    uint64_t value = 0;
+    uint16_t bits = 0;
+
+    while (i < length && bits < 64) {
+        uint16_t mark = pulses[i];
+        bool hasSpace = i + 1 < length;
+        uint16_t space = hasSpace ? pulses[i + 1] : 0;
+        bool last = !hasSpace || isFrameGap(space, desc);
+
+        // 有结束mark的协议，最后一个mark不是数据位
+        if (desc.footerMark && last) break;
+
+        int bit;
+        if (markEncodes) {
+            if (matchTime(mark, desc.oneMark, tolerance)) {
+                bit = 1;
+            } else if (matchTime(mark, desc.zeroMark, tolerance)) {
+                bit = 0;
+            } else {
+                return false;
+            }
+            if (!last && !matchTime(space, bit ? desc.oneSpace : desc.zeroSpace, tolerance)) {
+                return false;
+            }
+        } else {
+            if (last || !matchTime(mark, desc.oneMark, tolerance)) return false;
+            if (matchTime(space, desc.oneSpace, tolerance)) {
+                bit = 1;
+            } else if (matchTime(space, desc.zeroSpace, tolerance)) {
+                bit = 0;
+            } else {
+                return false;
+            }
+        }
+
+        if (desc.msbFirst) {
+            value = (value << 1) | bit;
+        } else {
+            value |= (uint64_t)bit << bits;
+        }
+        bits++;
+        i += 2;
+
+        if (last) break;
+    }
+
+    if (desc.footerMark) {
+        if (i >= length || !matchTime(pulses[i], desc.footerMark, tolerance)) return false;
+    }
+    if (bits == 0) return false;
+
+    out.value = value;
+    out.bits = bits;
+    out.repeat = false;
+    return true;
+}
+
+// RC5：展开为半位电平序列后按对解码，1 = space+mark，0 = mark+space
+static bool decodeBiphaseRc5(const ProtocolDescriptor& desc, const uint16_t* pulses, uint16_t length,
+                             DecodedSignal& out, const DecodeTolerance& tolerance) {
+    static const int MAX_HALVES = (64 + 2) * 2;
+    const uint16_t t1 = desc.oneMark;
+    uint8_t halves[MAX_HALVES];
+    int count = 0;
+
+    // 第一个起始位的前半(space)与空闲电平相同，捕获中不可见
+    halves[count++] = 0;
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t level = (i % 2 == 0) ? 1 : 0;
+        int span;
+        if (matchTime(pulses[i], t1, tolerance)) {
+            span = 1;
+        } else if (matchTime(pulses[i], t1 * 2, tolerance)) {
+            span = 2;
+        } else if (level == 0 && pulses[i] > t1 * 3) {
+            break;   // 帧尾间隔
+        } else {
+            return false;
+        }
+
+        for (int k = 0; k < span; k++) {
+            if (count >= MAX_HALVES) return false;
+            halves[count++] = level;
+        }
+    }
+
+    // 最后一位为0时，其后半(space)并入帧尾间隔
+    if (count % 2 == 1) {
+        if (count >= MAX_HALVES) return false;
+        halves[count++] = 0;
+    }
+
+    int pairs = count / 2;
+    if (pairs < 3) return false;
+
+    uint64_t data = 0;
+    bool fieldBit = true;
+    for (int p = 0; p < pairs; p++) {
+        uint8_t first = halves[p * 2];
+        uint8_t second = halves[p * 2 + 1];
+        int bit;
+        if (first == 0 && second == 1) {
+            bit = 1;
+        } else if (first == 1 && second == 0) {
+            bit = 0;
+        } else {
+            return false;
+        }
+
+        if (p == 0) {
+            if (bit != 1) return false;     // 起始位
+        } else if (p == 1) {
+            fieldBit = bit;                 // 场位，0表示RC5X
+        } else {
+            data = (data << 1) | bit;
+        }
+    }
+
+    uint16_t nbits = pairs - 2;
+    if (fieldBit) {
+        out.protocol = RC5;
+        out.value = data;
+        out.bits = nbits;
+    } else {
+        out.protocol = RC5X;
+        out.value = (1ULL << nbits) | data;
+        out.bits = nbits + 1;
+    }
+    out.repeat = false;
+    return true;
+}
+
+bool decodeWithDescriptor(const ProtocolDescriptor& desc, const uint16_t* pulses, uint16_t length,
+                          DecodedSignal& out, const DecodeTolerance& tolerance) {
+    if (!pulses || length == 0) return false;
+
+    switch (desc.encoding) {
+        case PulseEncoding::BIPHASE_RC5:
+            return decodeBiphaseRc5(desc, pulses, length, out, tolerance);
+        case PulseEncoding::PULSE_DISTANCE:
+        default:
+            return decodePulseDistance(desc, pulses, length, out, tolerance);
+    }
+}
+
+bool decodePulses(const uint16_t* pulses, uint16_t length, DecodedSignal& out,
+                  const DecodeTolerance& tolerance) {
+    out.protocol = UNKNOWN;
+    out.value = 0;
+    out.bits = 0;
+    out.repeat = false;
+
+    if (decodeWithDescriptor(kNecDescriptor, pulses, length, out, tolerance)) {
+        out.protocol = NEC;
+        return true;
+    }
+    if (decodeWithDescriptor(kSonyDescriptor, pulses, length, out, tolerance)) {
+        out.protocol = SONY;
+        return true;
+    }
+    // RC5在解码时根据场位写入RC5/RC5X
+    if (decodeWithDescriptor(kRc5Descriptor, pulses, length, out, tolerance)) {
+        return true;
+    }
+
+    out.protocol = UNKNOWN;
+    return false;
+}
+
+const char* decoderSlotName(DecoderSlot slot) {
+    switch (slot) {
+        case DECODER_NEC: return "NEC";
+        case DECODER_SONY: return "SONY";
+        case DECODER_RC5: return "RC5";
+        default: return "?";
+    }
+}
+
+DecoderSlot decoderSlotFor(decode_type_t protocol) {
+    switch (protocol) {
+        case NEC: return DECODER_NEC;
+        case SONY: return DECODER_SONY;
+        case RC5:
+        case RC5X: return DECODER_RC5;
+        default: return DECODER_COUNT;
+    }
+}
+
+uint64_t stateFingerprint(const uint8_t* state, uint16_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint16_t i = 0; i < length; i++) {
+        hash ^= state[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const ProtocolDescriptor* descriptorForProtocol(decode_type_t protocol) {
+    switch (protocol) {
+        case NEC:
+        case NEC_LIKE: return &kNecDescriptor;
+        case SONY: return &kSonyDescriptor;
+        case RC5:
+        case RC5X: return &kRc5Descriptor;
+        default: return nullptr;
+    }
+}
+
+static const ProtocolDescriptor& descriptorOf(DecoderSlot slot) {
+    switch (slot) {
+        case DECODER_SONY: return kSonyDescriptor;
+        case DECODER_RC5: return kRc5Descriptor;
+        case DECODER_NEC:
+        default: return kNecDescriptor;
+    }
+}
+
+AdaptiveDecoder::AdaptiveDecoder() : enabled(ALL) {
+    // 初始顺序与decodePulses相同
+    for (int i = 0; i < DECODER_COUNT; i++) order[i] = (uint8_t)i;
+    resetStats();
+}
+
+void AdaptiveDecoder::resetStats() {
+    for (int i = 0; i < DECODER_COUNT; i++) hits[i] = 0;
+    frames = 0;
+    attempts = 0;
+    first_try_hits = 0;
+    misses = 0;
+}
+
+bool AdaptiveDecoder::accepts(decode_type_t protocol) const {
+    DecoderSlot slot = decoderSlotFor(protocol);
+    if (slot == DECODER_COUNT) return enabled == ALL;
+    return isEnabled(slot);
+}
+
+bool AdaptiveDecoder::decode(const uint16_t* pulses, uint16_t length, DecodedSignal& out,
+                             const DecodeTolerance& tolerance) {
+    out.protocol = UNKNOWN;
+    out.value = 0;
+    out.bits = 0;
+    out.repeat = false;
+    frames++;
+
+    int tried = 0;
+    for (int rank = 0; rank < DECODER_COUNT; rank++) {
+        DecoderSlot slot = (DecoderSlot)order[rank];
+        if (!isEnabled(slot)) continue;
+        tried++;
+        attempts++;
+        if (!decodeWithDescriptor(descriptorOf(slot), pulses, length, out, tolerance)) continue;
+
+        // RC5在解码时根据场位写入RC5/RC5X
+        if (slot == DECODER_NEC) out.protocol = NEC;
+        else if (slot == DECODER_SONY) out.protocol = SONY;
+        if (tried == 1) first_try_hits++;
+        recordHit(slot);
+        return true;
+    }
+
+    out.protocol = UNKNOWN;
+    misses++;
+    return false;
+}
+
+void AdaptiveDecoder::recordHit(DecoderSlot slot) {
+    if (slot >= DECODER_COUNT) return;
+    if (++hits[slot] >= HIT_DECAY_LIMIT) {
+        for (int i = 0; i < DECODER_COUNT; i++) hits[i] /= 2;
+    }
+
+    // 命中的解码器前移到命中次数比它少的解码器之前，次数相同时保持原顺序
+    int rank = 0;
+    while (order[rank] != slot) rank++;
+    while (rank > 0 && hits[order[rank - 1]] < hits[slot]) {
+        order[rank] = order[rank - 1];
+        order[--rank] = slot;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef IR_PROTOCOL_DECODER_H
+#define IR_PROTOCOL_DECODER_H
+
+#include <stdint.h>
+#include <IRremoteESP8266.h>
+#include "ir_protocol_descriptor.h"
+
+// 解码结果
+struct DecodedSignal {
+    decode_type_t protocol;
+    uint64_t value;
+    uint16_t bits;
+    bool repeat;                  // NEC重复码
+};
+
+// 状态字节的64位FNV-1a指纹：有状态协议的results.value与state共用内存，不能直接比较，
+// 以指纹代替值参与学习比对和显示
+uint64_t stateFingerprint(const uint8_t* state, uint16_t length);
+
+// 时序匹配容差
+struct DecodeTolerance {
+    uint8_t percent;              // 相对容差(%)
+    uint16_t minimum;             // 最小绝对容差(微秒)
+};
+
+const DecodeTolerance kDefaultDecodeTolerance = {25, 100};
+
+// 按描述符解码原始脉冲(微秒，mark开头，mark/space交替)，是编码器的逆过程
+// 成功时写入value/bits/repeat(协议类型由调用方决定)
+bool decodeWithDescriptor(const ProtocolDescriptor& desc, const uint16_t* pulses, uint16_t length,
+                          DecodedSignal& out,
+                          const DecodeTolerance& tolerance = kDefaultDecodeTolerance);
+
+// 依次尝试已知描述符(NEC、SONY、RC5/RC5X)，全部失败时返回false且protocol为UNKNOWN
+bool decodePulses(const uint16_t* pulses, uint16_t length, DecodedSignal& out,
+                  const DecodeTolerance& tolerance = kDefaultDecodeTolerance);
+
+// 描述符解码器(RC5解码器同时识别RC5X)
+enum DecoderSlot : uint8_t {
+    DECODER_NEC = 0,
+    DECODER_SONY,
+    DECODER_RC5,
+    DECODER_COUNT
+};
+
+const char* decoderSlotName(DecoderSlot slot);
+// 协议对应的解码器，没有描述符的协议返回DECODER_COUNT
+DecoderSlot decoderSlotFor(decode_type_t protocol);
+// 协议的编码描述符(NEC_LIKE按NEC)，没有描述符的协议返回nullptr
+const ProtocolDescriptor* descriptorForProtocol(decode_type_t protocol);
+
+// 按协议筛选的自适应解码：只尝试启用的解码器，按命中次数从多到少排列，
+// 现场最常见的协议第一次尝试就命中。计数达到HIT_DECAY_LIMIT时全部减半，顺序跟随近期的使用情况
+class AdaptiveDecoder {
+public:
+    static const uint8_t ALL = (1 << DECODER_COUNT) - 1;
+    static const uint16_t HIT_DECAY_LIMIT = 1024;
+
+    AdaptiveDecoder();
+
+    void setEnabled(uint8_t mask) { enabled = mask & ALL; }
+    uint8_t getEnabled() const { return enabled; }
+    bool isEnabled(DecoderSlot slot) const { return slot < DECODER_COUNT && (enabled & (1 << slot)); }
+    // 没有描述符的协议只在全部启用时算作启用
+    bool accepts(decode_type_t protocol) const;
+
+    // 按当前顺序尝试启用的解码器，成功时记录命中
+    bool decode(const uint16_t* pulses, uint16_t length, DecodedSignal& out,
+                const DecodeTolerance& tolerance = kDefaultDecodeTolerance);
+    // 由其他途径(IRrecv)解码出的帧也计入命中，使顺序反映全部流量
+    void recordHit(DecoderSlot slot);
+
+    // 第rank次尝试的解码器
+    DecoderSlot slotAt(int rank) const { return (DecoderSlot)order[rank]; }
+    uint16_t getHits(DecoderSlot slot) const { return hits[slot]; }
+
+    // 统计：decode调用的帧数、解码器尝试次数、第一次尝试即命中的帧数、全部失败的帧数
+    uint32_t getFrames() const { return frames; }
+    uint32_t getAttempts() const { return attempts; }
+    uint32_t getFirstTryHits() const { return first_try_hits; }
+    uint32_t getMisses() const { return misses; }
+    void resetStats();
+
+private:
+    uint8_t enabled;
+    uint8_t order[DECODER_COUNT];
+    uint16_t hits[DECODER_COUNT];
+    uint32_t frames;
+    uint32_t attempts;
+    uint32_t first_try_hits;
+    uint32_t misses;
+};
+
+#endif
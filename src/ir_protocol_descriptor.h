@@ -0,0 +1,53 @@
+#ifndef IR_PROTOCOL_DESCRIPTOR_H
+#define IR_PROTOCOL_DESCRIPTOR_H
+
+#include <stdint.h>
+
+// 编码方式
+enum class PulseEncoding : uint8_t {
+    PULSE_DISTANCE,   // 每位 = mark + space，由mark/space长度区分0/1(NEC、Sony等)
+    BIPHASE_RC5       // RC5曼彻斯特编码，含起始位和场位
+};
+
+// 重复帧方式
+enum class RepeatMode : uint8_t {
+    FULL_FRAME,       // 重复发送完整数据帧(Sony、RC5)
+    NEC_REPEAT_CODE   // 发送NEC重复码(头部mark + 短space + 结束mark)
+};
+
+// 协议描述符：所有时间单位为微秒，与IRremoteESP8266的IRsend时序保持一致
+struct ProtocolDescriptor {
+    PulseEncoding encoding;
+    RepeatMode repeatMode;
+    uint16_t hdrMark;          // 引导码mark，0表示无
+    uint16_t hdrSpace;         // 引导码space
+    uint16_t oneMark;          // 数据1的mark(BIPHASE时为半位长度)
+    uint16_t oneSpace;         // 数据1的space
+    uint16_t zeroMark;         // 数据0的mark
+    uint16_t zeroSpace;        // 数据0的space
+    uint16_t footerMark;       // 结束mark，0表示无
+    uint32_t minGap;           // 帧尾最小间隔
+    uint32_t minFrameLength;   // 含间隔的最小帧长，0表示不限
+    uint16_t rptSpace;         // NEC重复码的space
+    bool msbFirst;             // 是否高位先发
+    uint16_t freq;             // 载波频率(kHz)
+    uint8_t duty;              // 载波占空比(%)
+};
+
+// 协议描述符定义(时序取自IRremoteESP8266的ir_NEC/ir_Sony/ir_RC5_RC6)
+constexpr ProtocolDescriptor kNecDescriptor = {
+    PulseEncoding::PULSE_DISTANCE, RepeatMode::NEC_REPEAT_CODE,
+    8960, 4480, 560, 1680, 560, 560, 560, 22400, 108080, 2240, true, 38, 33
+};
+
+constexpr ProtocolDescriptor kSonyDescriptor = {
+    PulseEncoding::PULSE_DISTANCE, RepeatMode::FULL_FRAME,
+    2400, 600, 1200, 600, 600, 600, 0, 10000, 45000, 0, true, 40, 33
+};
+
+constexpr ProtocolDescriptor kRc5Descriptor = {
+    PulseEncoding::BIPHASE_RC5, RepeatMode::FULL_FRAME,
+    0, 0, 889, 889, 889, 889, 0, 88886, 113778, 0, true, 36, 50
+};
+
+#endif
@@ -0,0 +1,324 @@
+#include "ir_protocol_encoder.h"
+
+// ============== RmtItemWriter 实现 ==============
+
+RmtItemWriter::RmtItemWriter(rmt_item32_t* buffer, size_t capacity)
+    : items(buffer), capacity(capacity), count(0), half_pending(false),
+      level(false), duration(0), elapsed(0), overflow(false) {
+}
+
+void RmtItemWriter::pushHalf(bool lvl, uint32_t dur) {
+    if (count >= capacity) {
+        overflow = true;
+        return;
+    }
+
+    if (!half_pending) {
+        items[count].level0 = lvl ? 1 : 0;
+        items[count].duration0 = dur;
+        half_pending = true;
+    } else {
+        items[count].level1 = lvl ? 1 : 0;
+        items[count].duration1 = dur;
+        count++;
+        half_pending = false;
+    }
+}
+
+void RmtItemWriter::flushPending() {
+    // 超过RMT上限的时长拆分为多个同电平的半项
+    while (duration > 0) {
+        uint32_t chunk = duration > MAX_DURATION ? MAX_DURATION : duration;
+        pushHalf(level, chunk);
+        duration -= chunk;
+    }
+}
+
+void RmtItemWriter::mark(uint32_t us) {
+    if (us == 0) return;
+
+    if (duration > 0 && !level) {
+        flushPending();
+    }
+    level = true;
+    duration += us;
+    elapsed += us;
+}
+
+void RmtItemWriter::space(uint32_t us) {
+    if (us == 0) return;
+
+    // RMT空闲电平即为低电平，序列开头的space无需发送
+    if (count == 0 && !half_pending && duration == 0) return;
+
+    if (duration > 0 && level) {
+        flushPending();
+    }
+    level = false;
+    duration += us;
+    elapsed += us;
+}
+
+void RmtItemWriter::startFrame() {
+    elapsed = 0;
+}
+
+uint32_t RmtItemWriter::frameElapsed() const {
+    return elapsed;
+}
+
+size_t RmtItemWriter::finish() {
+    flushPending();
+
+    // 添加结束标记(duration为0)
+    if (half_pending) {
+        items[count].level1 = 0;
+        items[count].duration1 = 0;
+        count++;
+        half_pending = false;
+    } else if (count < capacity) {
+        items[count].val = 0;
+        count++;
+    } else {
+        overflow = true;
+    }
+
+    return overflow ? 0 : count;
+}
+
+bool RmtItemWriter::hasOverflow() const {
+    return overflow;
+}
+
+// ============== 协议编码 ==============
+
+// 帧尾间隔：满足最小间隔，同时补足最小帧长
+static void writeFrameGap(const ProtocolDescriptor& desc, RmtItemWriter& writer) {
+    uint32_t gap = desc.minGap;
+    uint32_t elapsed = writer.frameElapsed();
+    if (desc.minFrameLength > elapsed && desc.minFrameLength - elapsed > gap) {
+        gap = desc.minFrameLength - elapsed;
+    }
+    writer.space(gap);
+}
+
+static void encodePulseDistance(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits,
+                                RmtItemWriter& writer) {
+    writer.startFrame();
+
+    if (desc.hdrMark) writer.mark(desc.hdrMark);
+    if (desc.hdrSpace) writer.space(desc.hdrSpace);
+
+    for (uint16_t i = 0; i < bits; i++) {
+        uint16_t bitIndex = desc.msbFirst ? (bits - 1 - i) : i;
+        if ((value >> bitIndex) & 1) {
+            writer.mark(desc.oneMark);
+            writer.space(desc.oneSpace);
+        } else {
+            writer.mark(desc.zeroMark);
+            writer.space(desc.zeroSpace);
+        }
+    }
+
+    if (desc.footerMark) writer.mark(desc.footerMark);
+    writeFrameGap(desc, writer);
+}
+
+// RC5：1 = space+mark，0 = mark+space；13位及以上时最高位作为RC5X场位(取反)
+static void encodeBiphaseRc5(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits,
+                             RmtItemWriter& writer) {
+    const uint16_t t1 = desc.oneMark;
+    bool fieldBit = true;
+    uint16_t nbits = bits;
+    if (nbits >= 13) {
+        fieldBit = !((value >> (nbits - 1)) & 1);
+        nbits--;
+    }
+
+    writer.startFrame();
+
+    // 第一个起始位(始终为1)
+    writer.space(t1);
+    writer.mark(t1);
+
+    // 场位/第二个起始位
+    if (fieldBit) {
+        writer.space(t1);
+        writer.mark(t1);
+    } else {
+        writer.mark(t1);
+        writer.space(t1);
+    }
+
+    for (uint16_t i = 0; i < nbits; i++) {
+        if ((value >> (nbits - 1 - i)) & 1) {
+            writer.space(t1);
+            writer.mark(t1);
+        } else {
+            writer.mark(t1);
+            writer.space(t1);
+        }
+    }
+
+    writeFrameGap(desc, writer);
+}
+
+static void encodeNecRepeat(const ProtocolDescriptor& desc, RmtItemWriter& writer) {
+    writer.startFrame();
+    writer.mark(desc.hdrMark);
+    writer.space(desc.rptSpace);
+    writer.mark(desc.footerMark);
+    writeFrameGap(desc, writer);
+}
+
+void encodeFrame(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, RmtItemWriter& writer) {
+    switch (desc.encoding) {
+        case PulseEncoding::BIPHASE_RC5:
+            encodeBiphaseRc5(desc, value, bits, writer);
+            break;
+        case PulseEncoding::PULSE_DISTANCE:
+        default:
+            encodePulseDistance(desc, value, bits, writer);
+            break;
+    }
+}
+
+void encodeRepeatFrame(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, RmtItemWriter& writer) {
+    if (desc.repeatMode == RepeatMode::NEC_REPEAT_CODE) {
+        encodeNecRepeat(desc, writer);
+    } else {
+        encodeFrame(desc, value, bits, writer);
+    }
+}
+
+void encodeRawFrame(const uint16_t* pulses, uint16_t length, uint32_t periodUs, RmtItemWriter& writer) {
+    writer.startFrame();
+    for (uint16_t i = 0; i < length; i++) {
+        if (i % 2 == 0) {
+            writer.mark(pulses[i]);
+        } else {
+            writer.space(pulses[i]);
+        }
+    }
+    if (periodUs > writer.frameElapsed()) {
+        writer.space(periodUs - writer.frameElapsed());
+    }
+}
+
+size_t encodeProtocol(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, uint16_t repeat,
+                      rmt_item32_t* buffer, size_t capacity) {
+    if (!buffer || capacity == 0 || bits == 0 || bits > 64) return 0;
+
+    RmtItemWriter writer(buffer, capacity);
+    encodeFrame(desc, value, bits, writer);
+
+    for (uint16_t r = 0; r < repeat; r++) {
+        encodeRepeatFrame(desc, value, bits, writer);
+    }
+
+    return writer.finish();
+}
+
+size_t convertRawPulses(const uint16_t* rawData, uint16_t length, rmt_item32_t* items, size_t capacity) {
+    if (!rawData || !items || length == 0 || capacity < (size_t)(length / 2 + 2)) {
+        return 0;
+    }
+
+    // 配对处理：高电平+低电平
+    size_t count = 0;
+    for (int i = 0; i + 1 < length; i += 2) {
+        uint32_t high_time = rawData[i];
+        uint32_t low_time = rawData[i + 1];
+
+        // RMT限制：每个duration最大32767 ticks
+        if (high_time > RmtItemWriter::MAX_DURATION) high_time = RmtItemWriter::MAX_DURATION;
+        if (low_time > RmtItemWriter::MAX_DURATION) low_time = RmtItemWriter::MAX_DURATION;
+
+        // duration为0会被RMT当作结束标记
+        // 毛刺已在捕获时由PulseFilter合并，这里按原值发射，不再拉伸短脉冲
+        if (high_time == 0) high_time = 1;
+        if (low_time == 0) low_time = 1;
+
+        items[count].level0 = 1;
+        items[count].duration0 = high_time;
+        items[count].level1 = 0;
+        items[count].duration1 = low_time;
+        count++;
+    }
+
+    // 奇数个元素时最后一个mark单独成项
+    if (length % 2 == 1) {
+        uint32_t final_time = rawData[length - 1];
+        if (final_time > RmtItemWriter::MAX_DURATION) final_time = RmtItemWriter::MAX_DURATION;
+        if (final_time == 0) final_time = 1;
+
+        items[count].level0 = 1;
+        items[count].duration0 = final_time;
+        items[count].level1 = 0;
+        items[count].duration1 = 0;  // 结束标记
+        count++;
+    }
+
+    // 1ms低电平确保信号结束
+    items[count].level0 = 0;
+    items[count].duration0 = 1000;
+    items[count].level1 = 0;
+    items[count].duration1 = 0;
+    count++;
+
+    return count;
+}
+
+size_t itemsToPulses(const rmt_item32_t* items, size_t count, uint16_t* pulses, size_t capacity) {
+    if (!items || !pulses || capacity == 0) return 0;
+
+    size_t length = 0;
+    bool level = false;
+    uint32_t duration = 0;
+    for (size_t i = 0; i < count * 2; i++) {
+        const rmt_item32_t& item = items[i / 2];
+        uint32_t dur = i % 2 == 0 ? item.duration0 : item.duration1;
+        bool lvl = (i % 2 == 0 ? item.level0 : item.level1) != 0;
+        if (dur == 0) break;   // 结束标记
+
+        if (lvl == level) {
+            duration += dur;
+            continue;
+        }
+        // 电平切换：写出上一段(跳过帧首的space)
+        if (duration > 0 && (level || length > 0)) {
+            if (length >= capacity) return 0;
+            pulses[length++] = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+        }
+        level = lvl;
+        duration = dur;
+    }
+
+    // 最后一段为mark时写出，space即帧尾间隔
+    if (level && duration > 0) {
+        if (length >= capacity) return 0;
+        pulses[length++] = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+    }
+    return length;
+}
+
+uint32_t encodeFramePulses(const ProtocolDescriptor& desc, bool repeatFrame, uint64_t value, uint16_t bits,
+                           uint16_t* pulses, uint16_t capacity, uint16_t& length) {
+    // 最长的一帧(64位)所需数据项，不占用调用方的栈
+    static const size_t ITEMS = (64 + 2) * 2 + 8;
+    static rmt_item32_t items[ITEMS];
+
+    length = 0;
+    RmtItemWriter writer(items, ITEMS);
+    if (repeatFrame) {
+        encodeRepeatFrame(desc, value, bits, writer);
+    } else {
+        encodeFrame(desc, value, bits, writer);
+    }
+    uint32_t periodUs = writer.frameElapsed();
+    size_t count = writer.finish();
+    if (count == 0) return 0;
+
+    length = (uint16_t)itemsToPulses(items, count, pulses, capacity);
+    return length > 0 ? periodUs : 0;
+}
@@ -0,0 +1,111 @@
+#ifndef IR_PROTOCOL_ENCODER_H
+#define IR_PROTOCOL_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ir_protocol_descriptor.h"
+
+#ifdef ARDUINO
+#include <driver/rmt.h>
+#else
+// 主机端(pio test -e native)没有ESP-IDF，使用与driver/rmt.h布局相同的数据项定义
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+#endif
+
+// RMT数据项写入器：自动合并相同电平、拆分超长时长，忽略帧首的space
+class RmtItemWriter {
+public:
+    static const uint32_t MAX_DURATION = 32767;   // RMT单个duration上限(ticks)
+
+private:
+    rmt_item32_t* items;
+    size_t capacity;
+    size_t count;
+    bool half_pending;         // 当前数据项是否只填了前半部分
+    bool level;                // 待写入的电平
+    uint32_t duration;         // 待写入的时长(同电平累加)
+    uint32_t elapsed;          // 当前帧已用时间
+    bool overflow;
+
+    void pushHalf(bool lvl, uint32_t dur);
+    void flushPending();
+
+public:
+    RmtItemWriter(rmt_item32_t* buffer, size_t capacity);
+
+    void mark(uint32_t us);
+    void space(uint32_t us);
+
+    // 开始新的一帧(用于最小帧长计算)
+    void startFrame();
+    uint32_t frameElapsed() const;
+
+    // 写入剩余数据并添加结束标记，返回数据项数量(溢出时返回0)
+    size_t finish();
+    bool hasOverflow() const;
+};
+
+// 按描述符编码一帧数据(不含重复)
+void encodeFrame(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, RmtItemWriter& writer);
+
+// 按描述符编码一个重复帧(NEC重复码或完整数据帧)
+void encodeRepeatFrame(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, RmtItemWriter& writer);
+
+// 写入一帧原始脉冲(微秒，mark开头)，并以space补足到periodUs(帧首到帧首)
+void encodeRawFrame(const uint16_t* pulses, uint16_t length, uint32_t periodUs, RmtItemWriter& writer);
+
+// 编码完整发射序列(主帧 + repeat次重复)，返回RMT数据项数量，缓冲区不足时返回0
+size_t encodeProtocol(const ProtocolDescriptor& desc, uint64_t value, uint16_t bits, uint16_t repeat,
+                      rmt_item32_t* buffer, size_t capacity);
+
+// 最长原始信号(256个脉冲)逐对转换所需的数据项(含结束项)
+static const size_t RAW_PULSE_ITEMS = 256 / 2 + 2;
+
+// 原始脉冲(微秒，mark/space交替)逐对转换为RMT数据项(1tick = 1us)，不合并、不拆分，capacity至少为length / 2 + 2
+// 返回写入的项数(含结束项)，容量不足时返回0
+size_t convertRawPulses(const uint16_t* rawData, uint16_t length, rmt_item32_t* items, size_t capacity);
+
+// RMT数据项还原为原始脉冲(微秒，mark开头，合并同电平，去掉帧尾间隔)，用于把编码结果存为原始脉冲
+// 返回脉冲数，容量不足时返回0
+size_t itemsToPulses(const rmt_item32_t* items, size_t count, uint16_t* pulses, size_t capacity);
+
+// 按描述符编码一帧(repeatFrame时为重复帧)为原始脉冲，返回帧首到帧首的时长(微秒)，失败返回0
+// 使用内部静态缓冲，只在任务上下文中调用
+uint32_t encodeFramePulses(const ProtocolDescriptor& desc, bool repeatFrame, uint64_t value, uint16_t bits,
+                           uint16_t* pulses, uint16_t capacity, uint16_t& length);
+
+// 编译期绑定描述符的编码器
+template <const ProtocolDescriptor& D>
+struct ProtocolEncoder {
+    static constexpr const ProtocolDescriptor& descriptor = D;
+
+    // 单帧所需的最大数据项数(每位最多2个半项 + 引导/结束/间隔)
+    static constexpr size_t maxItemsPerFrame(uint16_t bits) {
+        return (D.encoding == PulseEncoding::BIPHASE_RC5 ? (bits + 2) * 2 : bits + 1) + 4 +
+               (D.minFrameLength > D.minGap ? D.minFrameLength : D.minGap) / RmtItemWriter::MAX_DURATION;
+    }
+
+    static constexpr size_t maxItems(uint16_t bits, uint16_t repeat) {
+        return maxItemsPerFrame(bits) * (repeat + 1) + 1;
+    }
+
+    static size_t encode(uint64_t value, uint16_t bits, uint16_t repeat, rmt_item32_t* buffer, size_t capacity) {
+        return encodeProtocol(D, value, bits, repeat, buffer, capacity);
+    }
+};
+
+typedef ProtocolEncoder<kNecDescriptor> NecEncoder;
+typedef ProtocolEncoder<kSonyDescriptor> SonyEncoder;
+typedef ProtocolEncoder<kRc5Descriptor> Rc5Encoder;
+
+#endif
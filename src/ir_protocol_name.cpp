@@ -0,0 +1,21 @@
+#include "ir_protocol_name.h"
+#include <IRutils.h>
+#include <string.h>
+
+static const int PROTOCOL_NAME_MAX = 24;
+static const int PROTOCOL_SLOTS = kLastDecodeType + 2;   // UNKNOWN(-1)占第0项
+
+static char names[PROTOCOL_SLOTS][PROTOCOL_NAME_MAX];
+
+const char* protocolName(decode_type_t protocol) {
+    int slot = (int)protocol + 1;
+    if (slot < 0 || slot >= PROTOCOL_SLOTS) slot = 0;
+
+    char* name = names[slot];
+    if (name[0] == '\0') {
+        String text = typeToString((decode_type_t)(slot - 1), false);
+        strncpy(name, text.c_str(), PROTOCOL_NAME_MAX - 1);
+        name[PROTOCOL_NAME_MAX - 1] = '\0';
+    }
+    return name;
+}
@@ -0,0 +1,10 @@
+#ifndef IR_PROTOCOL_NAME_H
+#define IR_PROTOCOL_NAME_H
+
+#include <IRremoteESP8266.h>
+
+// 协议名缓存：typeToString每次都在堆上构造新的String，
+// 这里每个协议只在第一次查询时转换一次，之后直接返回缓存的字符串
+const char* protocolName(decode_type_t protocol);
+
+#endif
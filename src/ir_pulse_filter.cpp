@@ -0,0 +1,202 @@
+#include "ir_pulse_filter.h"
+#include <string.h>
+
+// 单个电平的聚类表
+struct PulseClusterTable {
+    uint32_t sum[PulseFilter::MAX_CLUSTERS];
+    uint16_t count[PulseFilter::MAX_CLUSTERS];
+    uint8_t size;
+};
+
+static uint16_t saturatingAdd(uint32_t a, uint32_t b) {
+    uint32_t total = a + b;
+    return total > 0xFFFF ? 0xFFFF : (uint16_t)total;
+}
+
+static uint32_t snapTolerance(uint32_t center, uint8_t percent) {
+    uint32_t tolerance = center * percent / 100;
+    return tolerance < PulseFilter::MIN_SNAP_US ? PulseFilter::MIN_SNAP_US : tolerance;
+}
+
+// 在容差内找最接近的聚类，未找到返回-1
+static int nearestCluster(const PulseClusterTable& table, uint16_t pulse, uint8_t percent) {
+    int best = -1;
+    uint32_t bestDistance = 0;
+    for (int c = 0; c < table.size; c++) {
+        uint32_t center = table.sum[c] / table.count[c];
+        uint32_t distance = pulse > center ? pulse - center : center - pulse;
+        if (distance <= snapTolerance(center, percent) && (best < 0 || distance < bestDistance)) {
+            best = c;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+// 合并中心相互落在容差内的聚类(单遍聚类中均值漂移会把同一时长拆成两组)
+static void mergeClusters(PulseClusterTable& table, uint8_t percent) {
+    for (int a = 0; a < table.size; a++) {
+        for (int b = a + 1; b < table.size; b++) {
+            uint32_t centerA = table.sum[a] / table.count[a];
+            uint32_t centerB = table.sum[b] / table.count[b];
+            uint32_t larger = centerA > centerB ? centerA : centerB;
+            uint32_t distance = centerA > centerB ? centerA - centerB : centerB - centerA;
+            if (distance > snapTolerance(larger, percent)) continue;
+
+            table.sum[a] += table.sum[b];
+            table.count[a] += table.count[b];
+            table.size--;
+            table.sum[b] = table.sum[table.size];
+            table.count[b] = table.count[table.size];
+            b = a;   // a的中心已变化，重新比较
+        }
+    }
+}
+
+// 第1步：合并毛刺，返回输出长度
+static uint16_t mergeGlitches(const uint16_t* input, uint16_t length, uint16_t* output,
+                              uint16_t glitchUs, uint16_t& glitches) {
+    uint16_t n = 0;
+    bool droppedTail = false;
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t pulse = input[i];
+        if (pulse >= glitchUs) {
+            output[n++] = pulse;
+            continue;
+        }
+
+        glitches++;
+        if (n == 0) {
+            // 开头的毛刺mark与其后的space都属于空闲期，一并丢弃以保持mark开头
+            i++;
+        } else if (i + 1 < length) {
+            // 中间的毛刺：前一脉冲 + 毛刺 + 后一脉冲 合并为一个脉冲，保持mark/space交替
+            output[n - 1] = saturatingAdd(output[n - 1], (uint32_t)pulse + input[i + 1]);
+            i++;
+        } else {
+            droppedTail = true;
+        }
+    }
+
+    // 末尾毛刺被丢弃后，帧不应以space结束
+    if (droppedTail && n > 0 && n % 2 == 0) n--;
+    return n;
+}
+
+PulseFilterResult filterPulses(const uint16_t* input, uint16_t length, uint16_t* output,
+                               const PulseFilterConfig& config) {
+    PulseFilterResult result;
+    memset(&result, 0, sizeof(result));
+    result.inputLength = length;
+
+    if (!input || !output) {
+        result.verdict = FILTER_TOO_SHORT;
+        return result;
+    }
+
+    if (!config.enabled) {
+        if (output != input) memcpy(output, input, length * sizeof(uint16_t));
+        result.outputLength = length;
+        result.verdict = FILTER_OK;
+        return result;
+    }
+
+    uint16_t n = mergeGlitches(input, length, output, config.glitchUs, result.glitches);
+    result.outputLength = n;
+
+    if (n < config.minPulses) {
+        result.verdict = FILTER_TOO_SHORT;
+        return result;
+    }
+    if ((uint32_t)result.glitches * 100 > (uint32_t)length * config.maxGlitchPercent) {
+        result.verdict = FILTER_TOO_NOISY;
+        return result;
+    }
+
+    // 第2步：mark(偶数位置)与space(奇数位置)分别单遍聚类
+    PulseClusterTable tables[2];
+    memset(tables, 0, sizeof(tables));
+    // 关闭吸附时仍按默认容差聚类，用于判断时长是否过于分散
+    uint8_t percent = config.snapPercent > 0 ? config.snapPercent : kDefaultPulseFilterConfig.snapPercent;
+
+    for (uint16_t i = 0; i < n; i++) {
+        PulseClusterTable& table = tables[i % 2];
+        int c = nearestCluster(table, output[i], percent);
+        if (c < 0 && table.size >= PulseFilter::MAX_CLUSTERS) {
+            mergeClusters(table, percent);
+            c = nearestCluster(table, output[i], percent);
+        }
+        if (c < 0) {
+            if (table.size >= PulseFilter::MAX_CLUSTERS) continue;   // 第3步计为无法归类
+            c = table.size++;
+        }
+        table.sum[c] += output[i];
+        table.count[c]++;
+    }
+    mergeClusters(tables[0], percent);
+    mergeClusters(tables[1], percent);
+    result.markClusters = tables[0].size;
+    result.spaceClusters = tables[1].size;
+
+    // 第3步：按最终的聚类中心吸附，离所有中心都超出容差的脉冲保持原值并计为无法归类
+    for (uint16_t i = 0; i < n; i++) {
+        const PulseClusterTable& table = tables[i % 2];
+        int c = nearestCluster(table, output[i], percent);
+        if (c < 0) {
+            result.irregular++;
+            continue;
+        }
+        if (config.snapPercent == 0) continue;
+
+        uint16_t center = (uint16_t)((table.sum[c] + table.count[c] / 2) / table.count[c]);
+        if (center != output[i]) {
+            output[i] = center;
+            result.snapped++;
+        }
+    }
+
+    if ((uint32_t)result.irregular * 100 > (uint32_t)n * config.maxIrregularPercent) {
+        result.verdict = FILTER_IRREGULAR;
+        return result;
+    }
+
+    result.verdict = FILTER_OK;
+    return result;
+}
+
+// ============== PulseFilter 实现 ==============
+
+PulseFilter::PulseFilter(const PulseFilterConfig& config) : config(config) {
+    resetStats();
+}
+
+PulseFilterResult PulseFilter::process(const uint16_t* input, uint16_t length, uint16_t* output) {
+    PulseFilterResult result = filterPulses(input, length, output, config);
+
+    stats.frames++;
+    stats.pulsesIn += result.inputLength;
+    stats.glitches += result.glitches;
+    if (result.verdict == FILTER_OK) {
+        stats.accepted++;
+        stats.snapped += result.snapped;
+        stats.pulsesOut += result.outputLength;
+    } else {
+        stats.rejected[result.verdict]++;
+    }
+    return result;
+}
+
+void PulseFilter::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+const char* PulseFilter::verdictName(PulseFilterVerdict verdict) {
+    switch (verdict) {
+        case FILTER_OK: return "ok";
+        case FILTER_TOO_SHORT: return "too short";
+        case FILTER_TOO_NOISY: return "too noisy";
+        case FILTER_IRREGULAR: return "irregular";
+        default: return "?";
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef IR_PULSE_FILTER_H
+#define IR_PULSE_FILTER_H
+
+#include <stdint.h>
+
+// 脉冲过滤配置
+struct PulseFilterConfig {
+    bool enabled;
+    uint16_t glitchUs;            // 短于此值的脉冲视为毛刺，与前后脉冲合并
+    uint8_t snapPercent;          // 与聚类中心相差不超过此比例的脉冲吸附到中心，0表示不吸附
+    uint16_t minPulses;           // 有效帧的最少脉冲数
+    uint8_t maxGlitchPercent;     // 毛刺占输入脉冲的比例上限
+    uint8_t maxIrregularPercent;  // 无法归入任何聚类的脉冲比例上限
+};
+
+const PulseFilterConfig kDefaultPulseFilterConfig = {true, 100, 15, 6, 25, 10};
+
+// 过滤结论
+enum PulseFilterVerdict {
+    FILTER_OK = 0,
+    FILTER_TOO_SHORT,             // 合并后脉冲过少(如NEC重复码、单个干扰脉冲)
+    FILTER_TOO_NOISY,             // 毛刺过多
+    FILTER_IRREGULAR,             // 时长过于分散，不像编码信号
+    FILTER_VERDICT_COUNT
+};
+
+// 单帧过滤结果
+struct PulseFilterResult {
+    PulseFilterVerdict verdict;
+    uint16_t inputLength;
+    uint16_t outputLength;
+    uint16_t glitches;            // 合并掉的毛刺数
+    uint8_t markClusters;         // mark时长聚类数
+    uint8_t spaceClusters;        // space时长聚类数
+    uint16_t snapped;             // 被吸附到聚类中心(数值发生变化)的脉冲数
+    uint16_t irregular;           // 聚类表已满、无法归类的脉冲数
+};
+
+// 累计统计
+struct PulseFilterStats {
+    uint32_t frames;
+    uint32_t accepted;
+    uint32_t rejected[FILTER_VERDICT_COUNT];
+    uint32_t glitches;
+    uint32_t snapped;
+    uint32_t pulsesIn;
+    uint32_t pulsesOut;
+};
+
+// 捕获预处理：在信号入库前清理原始脉冲(微秒，mark开头，mark/space交替)
+//   1. 合并毛刺：短于glitchUs的脉冲连同其后的脉冲并入前一个脉冲，开头的毛刺直接丢弃
+//   2. 量化：mark与space分别做单遍聚类，再把每个脉冲吸附到所属聚类的平均值
+//   3. 拒绝过短、毛刺过多或时长过于分散的帧
+// 每个脉冲只与固定数量的聚类比较，总耗时与脉冲数成线性关系
+class PulseFilter {
+public:
+    static const int MAX_CLUSTERS = 8;            // mark、space各自的聚类上限
+    static const uint16_t MIN_SNAP_US = 40;       // 吸附容差的下限
+
+private:
+    PulseFilterConfig config;
+    PulseFilterStats stats;
+
+public:
+    explicit PulseFilter(const PulseFilterConfig& config = kDefaultPulseFilterConfig);
+
+    // 过滤input写入output(可与input为同一缓冲区)，output容量不小于length
+    // 拒绝时output内容无意义；关闭过滤时原样复制且总是接受
+    PulseFilterResult process(const uint16_t* input, uint16_t length, uint16_t* output);
+
+    const PulseFilterConfig& getConfig() const { return config; }
+    void setConfig(const PulseFilterConfig& newConfig) { config = newConfig; }
+
+    const PulseFilterStats& getStats() const { return stats; }
+    void resetStats();
+
+    static const char* verdictName(PulseFilterVerdict verdict);
+};
+
+// 不记录统计的过滤函数，供基准测试和主机验证使用
+PulseFilterResult filterPulses(const uint16_t* input, uint16_t length, uint16_t* output,
+                               const PulseFilterConfig& config);
+
+#endif
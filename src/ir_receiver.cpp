@@ -1,15 +1,37 @@
 #include "ir_receiver.h"
+#include <new>
 
 IRReceiver::IRReceiver(uint8_t pin) {
     receive_pin = pin;
-    irrecv = new IRrecv(pin);
     is_learning = false;
-    last_receive_time = 0;
+    has_frame = false;
+    last_frame_time = 0;
+    last_protocol = UNKNOWN;
+    last_value = 0;
+    last_bits = 0;
+    frame_kind = FRAME_NEW;
+    last_kind = FRAME_NEW;
+    repeat_period = 0;
+    hold_count = 0;
+    capture_ring = nullptr;
+    filtered_frames = 0;
+    auto_tune = true;
+    last_capture_us = 0;
+    last_capture_ms = 0;
+    last_rebuild_ms = 0;
+    rebuild_count = 0;
+    rebuild_allocations = 0;
+    // IRrecv的超时上限由kRawTick决定
+    CaptureTunerConfig config = kDefaultCaptureTuner;
+    if (config.maxTimeoutMs > kMaxTimeoutMs) config.maxTimeoutMs = kMaxTimeoutMs;
+    capture_tuner.setConfig(config);
+    irrecv = new (irrecv_storage) IRrecv(pin, CAPTURE_BUFFER_SIZE, kTimeoutMs);
+    capture_tuner.reset(kTimeoutMs);
 }
 
 IRReceiver::~IRReceiver() {
     if (irrecv) {
-        delete irrecv;
+        irrecv->~IRrecv();
     }
 }
 
@@ -26,23 +48,37 @@ bool IRReceiver::begin() {
 
 bool IRReceiver::isAvailable() {
     if (!irrecv) return false;
-    return irrecv->decode(&results);
+    // 帧只解码一次，直到decode()取走为止
+    if (!has_frame) {
+        // 按住按键期间不重建，避免丢掉正在接收的重复帧；重建会重新分配捕获缓冲，限制频率
+        unsigned long nowMs = millis();
+        if (auto_tune && capture_tuner.pending() && nowMs - last_capture_ms > HOLD_GAP_MS &&
+            (rebuild_count == 0 || nowMs - last_rebuild_ms >= REBUILD_MIN_INTERVAL_MS)) {
+            rebuildCapture();
+        }
+        uint32_t start = LatencyStats::now();
+        has_frame = irrecv->decode(&results);
+        // 只统计真正解码出帧的调用，空轮询不计入；协议筛选计入解码时间
+        if (has_frame) {
+            filterProtocol();
+            LatencyStats::record(STAGE_RX_DECODE, start);
+            recordCapture();
+            observeCapture();
+        }
+    }
+    return has_frame;
 }
 
 bool IRReceiver::decode() {
     if (!isAvailable()) return false;
+    has_frame = false;
+    ScopedLatency latency(STAGE_RX_REPORT);
     
-    // 检查是否是重复信号
-    unsigned long now = millis();
-    if (now - last_receive_time < 200) {
-        irrecv->resume();
-        return false;
-    }
+    // 不再按固定200ms丢帧，而是识别按住按键产生的重复帧
+    classifyFrame();
     
-    last_receive_time = now;
-    
-    // 使用IRremoteESP8266的高级功能进行协议分析
-    if (is_learning) {
+    // 使用IRremoteESP8266的高级功能进行协议分析(重复帧不重复打印)
+    if (is_learning && frame_kind == FRAME_NEW) {
         Serial.println("[IR_RX] 接收到红外信号:");
         printAdvancedResult();
     }
@@ -53,7 +89,7 @@ bool IRReceiver::decode() {
 
 // 新增：高级结果显示，利用IRremoteESP8266的完整功能
 void IRReceiver::printAdvancedResult() {
-    Serial.printf("  协议: %s", typeToString(results.decode_type, false).c_str());
+    Serial.printf("  协议: %s", protocolName(results.decode_type));
     
     // 显示协议特定信息
     switch (results.decode_type) {
@@ -85,7 +121,7 @@ void IRReceiver::printAdvancedResult() {
     }
     Serial.println();
     
-    Serial.printf("  数值: 0x%08X\n", (uint32_t)results.value);
+    printValue();
     Serial.printf("  位数: %d\n", results.bits);
     Serial.printf("  原始长度: %d\n", results.rawlen);
     
@@ -99,8 +135,7 @@ void IRReceiver::printAdvancedResult() {
     }
     
     // 显示协议置信度
-    String protocolStr = typeToString(results.decode_type, false);
-    if (protocolStr != "UNKNOWN") {
+    if (results.decode_type != UNKNOWN) {
         Serial.println("  ✅ 协议识别成功");
     } else {
         Serial.println("  ❓ 未知协议，使用原始数据");
@@ -135,10 +170,32 @@ bool IRReceiver::isLearning() {
     return is_learning;
 }
 
-uint32_t IRReceiver::getValue() {
+uint64_t IRReceiver::getValue() {
+    if (hasACState(results.decode_type)) return stateFingerprint(results.state, getStateLength());
     return results.value;
 }
 
+uint16_t IRReceiver::getStateLength() {
+    if (!hasACState(results.decode_type)) return 0;
+    uint16_t length = results.bits / 8;
+    return length > kStateSizeMax ? kStateSizeMax : length;
+}
+
+const uint8_t* IRReceiver::getState() {
+    return results.state;
+}
+
+void IRReceiver::printValue() {
+    uint16_t length = getStateLength();
+    if (length == 0) {
+        Serial.printf("  数值: 0x%08llX\n", (unsigned long long)results.value);
+        return;
+    }
+    Serial.printf("  状态: %d字节 ", length);
+    for (uint16_t i = 0; i < length; i++) Serial.printf("%02X", results.state[i]);
+    Serial.println();
+}
+
 uint16_t IRReceiver::getBits() {
     return results.bits;
 }
@@ -147,8 +204,8 @@ decode_type_t IRReceiver::getProtocol() {
     return results.decode_type;
 }
 
-String IRReceiver::getProtocolName() {
-    return typeToString(results.decode_type, false);
+const char* IRReceiver::getProtocolName() {
+    return protocolName(results.decode_type);
 }
 
 uint16_t* IRReceiver::getRawData() {
@@ -159,9 +216,199 @@ uint16_t IRReceiver::getRawLength() {
     return results.rawlen;
 }
 
+uint16_t IRReceiver::getRawPulses(uint16_t* out, uint16_t maxLength) {
+    if (!out || results.rawlen < 2) return 0;
+    
+    uint16_t length = results.rawlen - 1;
+    if (length > maxLength) length = maxLength;
+    
+    for (uint16_t i = 0; i < length; i++) {
+        uint32_t us = (uint32_t)results.rawbuf[i + 1] * kRawTick;
+        out[i] = us > 65535 ? 65535 : (uint16_t)us;
+    }
+    return length;
+}
+
+void IRReceiver::classifyFrame() {
+    unsigned long now = millis();
+    unsigned long interval = now - last_frame_time;
+    bool holding = last_frame_time != 0 && interval < HOLD_GAP_MS;
+    
+    last_kind = frame_kind;
+    if (results.repeat) {
+        frame_kind = FRAME_REPEAT_CODE;
+    } else if (holding && results.decode_type == last_protocol && getValue() == last_value &&
+               results.bits == last_bits) {
+        frame_kind = FRAME_REPEAT;
+    } else {
+        frame_kind = FRAME_NEW;
+        holding = false;
+    }
+    
+    if (frame_kind != FRAME_REPEAT_CODE) {
+        last_protocol = results.decode_type;
+        last_value = getValue();
+        last_bits = results.bits;
+    }
+    
+    // 只有相同长度的帧之间的间隔才等于帧周期：
+    // 重复码之间、完整重复帧与前一个数据帧之间
+    repeat_period = 0;
+    if (holding && frame_kind != FRAME_NEW) {
+        hold_count++;
+        bool sameLength = (frame_kind == FRAME_REPEAT_CODE) ? (last_kind == FRAME_REPEAT_CODE)
+                                                             : (last_kind != FRAME_REPEAT_CODE);
+        if (sameLength) {
+            repeat_period = interval > 0xFFFF ? 0xFFFF : (uint16_t)interval;
+        }
+    } else {
+        hold_count = 0;
+    }
+    last_frame_time = now;
+}
+
+FrameKind IRReceiver::getFrameKind() {
+    return frame_kind;
+}
+
+bool IRReceiver::isRepeat() {
+    return frame_kind != FRAME_NEW;
+}
+
+uint16_t IRReceiver::getRepeatPeriod() {
+    return repeat_period;
+}
+
+uint16_t IRReceiver::getHoldCount() {
+    return hold_count;
+}
+
+void IRReceiver::setCaptureRing(CaptureRing* ring) {
+    capture_ring = ring;
+}
+
+void IRReceiver::filterProtocol() {
+    if (results.decode_type != UNKNOWN) {
+        if (protocol_decoder.accepts(results.decode_type)) {
+            protocol_decoder.recordHit(decoderSlotFor(results.decode_type));
+        } else {
+            // 数据仍是该协议的值，与原始脉冲不对应，改为按原始数据处理
+            results.decode_type = UNKNOWN;
+            results.repeat = false;
+            filtered_frames++;
+        }
+        return;
+    }
+    
+    // IRrecv已尝试过同样的协议，只有站点构建才需要再按描述符解码
+    if (IR_LIBRARY_DECODERS || protocol_decoder.getEnabled() == 0) return;
+    if (results.rawlen < 2 || results.rawlen - 1 > DECODE_MAX_PULSES) return;
+    
+    uint16_t pulses[DECODE_MAX_PULSES];
+    uint16_t length = getRawPulses(pulses, DECODE_MAX_PULSES);
+    DecodedSignal decoded;
+    if (!protocol_decoder.decode(pulses, length, decoded)) return;
+    
+    results.decode_type = decoded.protocol;
+    results.value = decoded.value;
+    results.bits = decoded.bits;
+    results.repeat = decoded.repeat;
+}
+
+void IRReceiver::setEnabledProtocols(uint8_t mask) {
+    protocol_decoder.setEnabled(mask);
+}
+
+uint8_t IRReceiver::getEnabledProtocols() {
+    return protocol_decoder.getEnabled();
+}
+
+const AdaptiveDecoder& IRReceiver::getProtocolDecoder() {
+    return protocol_decoder;
+}
+
+uint32_t IRReceiver::getFilteredFrames() {
+    return filtered_frames;
+}
+
+void IRReceiver::resetDecodeStats() {
+    protocol_decoder.resetStats();
+    filtered_frames = 0;
+}
+
+void IRReceiver::observeCapture() {
+    CaptureObservation frame = {0, 0, 0, 0, results.overflow, results.decode_type != UNKNOWN};
+    if (results.rawlen >= 2) frame.pulses = results.rawlen - 1;
+    // rawbuf[1]为第一个mark，偶数下标为space
+    for (uint16_t i = 1; i < results.rawlen; i++) {
+        uint32_t us = (uint32_t)results.rawbuf[i] * kRawTick;
+        frame.durationUs += us;
+        if (i % 2 == 0 && us > frame.longestSpaceUs) frame.longestSpaceUs = us;
+    }
+    
+    // 两段的发现时间都晚于各自结束一个超时加检查延迟，相减后只差检查延迟
+    uint32_t now = micros();
+    if (last_capture_us != 0 && now - last_capture_us > frame.durationUs) {
+        frame.gapUs = now - last_capture_us - frame.durationUs;
+    }
+    last_capture_us = now;
+    last_capture_ms = millis();
+    capture_tuner.observe(frame);
+}
+
+void IRReceiver::rebuildCapture() {
+    uint8_t timeoutMs = capture_tuner.targetTimeoutMs();
+    uint32_t allocations = heapAllocationCount();
+    
+    // IRrecv没有设置超时的接口，只能重新构造；旧的捕获缓冲随IRrecv释放，results不再指向它
+    irrecv->~IRrecv();
+    results.rawlen = 0;
+    irrecv = new (irrecv_storage) IRrecv(receive_pin, CAPTURE_BUFFER_SIZE, timeoutMs);
+    pinMode(receive_pin, INPUT_PULLUP);
+    irrecv->enableIRIn();
+    
+    rebuild_allocations += heapAllocationCount() - allocations;
+    rebuild_count++;
+    last_rebuild_ms = millis();
+    capture_tuner.apply();
+    Serial.printf("[IR_RX] 帧结束超时调整为 %d ms\n", timeoutMs);
+}
+
+void IRReceiver::setAutoTune(bool enabled) {
+    auto_tune = enabled;
+}
+
+bool IRReceiver::isAutoTune() {
+    return auto_tune;
+}
+
+void IRReceiver::startCaptureSession() {
+    capture_tuner.reset(capture_tuner.getTimeoutMs());
+    last_capture_us = 0;
+}
+
+const CaptureTuner& IRReceiver::getCaptureTuner() {
+    return capture_tuner;
+}
+
+void IRReceiver::recordCapture() {
+    if (!capture_ring) return;
+    
+    // 以IRrecv的解码结果作为期望值，型号在导出时填写
+    CorpusFrame* frame = capture_ring->next();
+    frame->timestampMs = millis();
+    frame->model[0] = '\0';
+    frame->carrierFreq = 0;
+    frame->dutyCycle = 0;
+    frame->protocol = results.decode_type;
+    frame->value = getValue();
+    frame->bits = results.bits;
+    frame->length = getRawPulses(frame->pulses, CorpusFrame::MAX_PULSES);
+}
+
 void IRReceiver::printResult() {
-    Serial.printf("  协议: %s\n", typeToString(results.decode_type, false).c_str());
-    Serial.printf("  数值: 0x%08X\n", (uint32_t)results.value);
+    Serial.printf("  协议: %s\n", protocolName(results.decode_type));
+    printValue();
     Serial.printf("  位数: %d\n", results.bits);
     Serial.printf("  原始长度: %d\n", results.rawlen);
     
@@ -174,15 +421,16 @@ void IRReceiver::printResult() {
     Serial.println();
 }
 
-String IRReceiver::getResultString() {
-    String result = "";
-    result += "Protocol: " + typeToString(results.decode_type, false);
-    result += ", Value: 0x" + String((uint32_t)results.value, HEX);
-    result += ", Bits: " + String(results.bits);
-    return result;
+size_t IRReceiver::getResultString(char* buffer, size_t size) {
+    if (!buffer || size == 0) return 0;
+    int n = snprintf(buffer, size, "Protocol: %s, Value: 0x%llX, Bits: %u",
+                     protocolName(results.decode_type), (unsigned long long)getValue(), results.bits);
+    if (n < 0) return 0;
+    return (size_t)n < size ? n : size - 1;
 }
 
 void IRReceiver::reset() {
+    has_frame = false;
     if (irrecv) {
         irrecv->resume();
     }
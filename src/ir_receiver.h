@@ -5,39 +5,133 @@
 #include <IRremoteESP8266.h>
 #include <IRrecv.h>
 #include <IRutils.h>
+#include "ir_latency.h"
+#include "ir_corpus.h"
+#include "ir_protocol_name.h"
+#include "ir_protocol_decoder.h"
+#include "ir_capture_tuner.h"
+#include "ir_heap.h"
+
+// 站点构建(platformio.ini的esp32dev_site)不编译IRrecv的协议解码器，IRrecv只负责捕获和哈希，
+// 站点协议由AdaptiveDecoder按启用集合和命中顺序解码
+#if DECODE_NEC || DECODE_SONY || DECODE_RC5
+#define IR_LIBRARY_DECODERS 1
+#else
+#define IR_LIBRARY_DECODERS 0
+#endif
+
+// 帧类型：区分新按键与按住按键时的重复帧
+enum FrameKind {
+    FRAME_NEW = 0,                // 新的按键
+    FRAME_REPEAT_CODE,            // NEC式重复码(不含数据)
+    FRAME_REPEAT                  // 与上一帧相同的完整数据帧(Sony、RC5等)
+};
 
 // 红外接收器类
 class IRReceiver {
+public:
+    static const unsigned long HOLD_GAP_MS = 250;   // 相邻帧间隔小于此值视为同一次按住
+    static const unsigned long REBUILD_MIN_INTERVAL_MS = 5000;   // 两次重建IRrecv的最小间隔
+    
 private:
+    // IRrecv构造在对象内部的存储上，捕获缓冲由IRrecv按CAPTURE_BUFFER_SIZE项分配。
+    // IRrecv只能在构造时设置超时，调整超时只能重建IRrecv，会释放并重新分配捕获缓冲：
+    // 重建至少间隔REBUILD_MIN_INTERVAL_MS，期间的堆分配单独计数，soak等分配统计据此扣除
+    alignas(IRrecv) uint8_t irrecv_storage[sizeof(IRrecv)];
     IRrecv* irrecv;
+    unsigned long last_rebuild_ms;
+    uint32_t rebuild_count;
+    uint32_t rebuild_allocations;    // 重建IRrecv期间的堆分配次数(需要分配计数，见ir_heap.h)
     decode_results results;
     uint8_t receive_pin;
     bool is_learning;
-    unsigned long last_receive_time;
+    bool has_frame;              // 已解码但尚未被decode()取走的帧
+    unsigned long last_frame_time;   // 上一帧的解码时间
+    decode_type_t last_protocol;     // 上一个数据帧(非重复码)
+    uint64_t last_value;
+    uint16_t last_bits;
+    FrameKind frame_kind;
+    FrameKind last_kind;
+    uint16_t repeat_period;          // 本帧与上一帧的间隔(ms)，无法作为帧周期时为0
+    uint16_t hold_count;             // 本次按住已收到的重复帧数
+    CaptureRing* capture_ring;   // 可选：记录每一帧原始捕获
+    AdaptiveDecoder protocol_decoder;
+    uint32_t filtered_frames;        // IRrecv解码为未启用协议而改为UNKNOWN的帧数
+    
+    static const uint16_t DECODE_MAX_PULSES = 128;   // 描述符协议的帧都不超过此长度
+    CaptureTuner capture_tuner;
+    bool auto_tune;
+    uint32_t last_capture_us;        // 上一段捕获被发现的时间，用于估计段间间隔
+    unsigned long last_capture_ms;
+    
+    void filterProtocol();       // 按启用的协议筛选或解码IRrecv的结果
+    void observeCapture();       // 把本段捕获的摘要交给capture_tuner
+    void rebuildCapture();       // 按capture_tuner的目标超时重新构造IRrecv
+    void recordCapture();
+    void classifyFrame();
+    void printValue();           // 打印数值，有状态协议打印状态字节
     
 public:
     IRReceiver(uint8_t pin);
     ~IRReceiver();
     
     bool begin();
-    bool isAvailable();
+    bool isAvailable();          // 是否有完整帧(不会取走该帧，可重复调用)
     bool decode();
     void startLearning();
     void stopLearning();
     bool isLearning();
     
     // 获取接收到的信号数据
-    uint32_t getValue();
+    // 有状态协议(空调等，数据在状态字节中)返回状态字节的64位指纹，与数值协议一样可用于比较
+    uint64_t getValue();
     uint16_t getBits();
     decode_type_t getProtocol();
-    String getProtocolName();
+    const char* getProtocolName();
     uint16_t* getRawData();
     uint16_t getRawLength();
     
+    // 有状态协议的状态字节数(位数/8)，其他协议返回0
+    uint16_t getStateLength();
+    const uint8_t* getState();
+    
+    // 获取以微秒为单位的脉冲序列(去掉rawbuf[0]的帧前间隔)，返回脉冲数
+    uint16_t getRawPulses(uint16_t* out, uint16_t maxLength);
+    
+    // 最近一次decode()取走的帧的类型：每一帧都会返回，由调用方决定是否忽略重复帧
+    FrameKind getFrameKind();
+    bool isRepeat();
+    
+    // 与上一帧同类帧的间隔(ms，帧首到帧首)，用于学习按住时的重复周期；无效时为0
+    uint16_t getRepeatPeriod();
+    uint16_t getHoldCount();
+    
+    // 设置捕获环(nullptr关闭)，接收到的每一帧都会在解码前写入
+    void setCaptureRing(CaptureRing* ring);
+    
+    // 启用的协议(AdaptiveDecoder的解码器位掩码)，未启用的协议按UNKNOWN处理，保留原始数据
+    // 全部启用时没有描述符的协议(空调等)照常接收
+    void setEnabledProtocols(uint8_t mask);
+    uint8_t getEnabledProtocols();
+    const AdaptiveDecoder& getProtocolDecoder();
+    uint32_t getFilteredFrames();
+    void resetDecodeStats();
+    
+    // 帧结束超时按会话自适应(默认开启)，调整在帧间空闲超过HOLD_GAP_MS时进行，
+    // 且与上一次调整至少间隔REBUILD_MIN_INTERVAL_MS
+    void setAutoTune(bool enabled);
+    bool isAutoTune();
+    // 开始新的会话(例如开始学习另一个遥控器)，从当前参数重新观察
+    void startCaptureSession();
+    const CaptureTuner& getCaptureTuner();
+    uint32_t getRebuildCount() const { return rebuild_count; }
+    uint32_t getRebuildAllocations() const { return rebuild_allocations; }
+    
     // 打印信号信息
     void printResult();
     void printAdvancedResult(); // 新增：高级结果显示
-    String getResultString();
+    // 一行结果摘要写入buffer，返回写入的字符数
+    size_t getResultString(char* buffer, size_t size);
     
     void reset();
 };
@@ -0,0 +1,96 @@
+#include "ir_retry_policy.h"
+#include <string.h>
+
+AdaptiveRetryPolicy::AdaptiveRetryPolicy() {
+    resetAll();
+}
+
+RetryStats* AdaptiveRetryPolicy::find(int id) {
+    int index = id - 1;  // 与IRStorage一致，ID从1开始
+    if (index < 0 || index >= MAX_TRACKED) {
+        return nullptr;
+    }
+    return &stats[index];
+}
+
+RetryPlan AdaptiveRetryPolicy::plan(int id, bool knownProtocol) {
+    RetryPlan result = {3, (uint8_t)(knownProtocol ? MAX_REPEAT : 0), 150};
+
+    RetryStats* s = find(id);
+    if (!s) return result;
+
+    // 选择满足目标总成功率的最少尝试次数：1 - (1-p)^n >= TARGET_RATE
+    uint32_t miss = 1000 - s->successRate;
+    uint32_t cumulativeMiss = miss;
+    uint8_t attempts = 1;
+    while (cumulativeMiss > 1000U - TARGET_RATE && attempts < MAX_ATTEMPTS) {
+        cumulativeMiss = cumulativeMiss * miss / 1000;
+        attempts++;
+    }
+    result.maxAttempts = attempts;
+    result.repeat = knownProtocol ? s->repeat : 0;
+
+    // 回波等待时间取观测延迟的两倍，无历史时使用默认值
+    if (s->echoLatencyMs > 0) {
+        uint16_t timeout = s->echoLatencyMs * 2 + 20;
+        if (timeout < MIN_ECHO_TIMEOUT) timeout = MIN_ECHO_TIMEOUT;
+        if (timeout > MAX_ECHO_TIMEOUT) timeout = MAX_ECHO_TIMEOUT;
+        result.echoTimeoutMs = timeout;
+    }
+
+    return result;
+}
+
+void AdaptiveRetryPolicy::recordAttempt(int id, bool confirmed, uint16_t latencyMs) {
+    RetryStats* s = find(id);
+    if (!s) return;
+
+    s->attempts++;
+
+    // EWMA，alpha = 1/4
+    int32_t target = confirmed ? 1000 : 0;
+    s->successRate = (uint16_t)(s->successRate + (target - (int32_t)s->successRate) / 4);
+
+    if (confirmed) {
+        s->echoLatencyMs = (s->echoLatencyMs == 0) ? latencyMs
+                                                   : (uint16_t)((s->echoLatencyMs * 3 + latencyMs) / 4);
+    }
+}
+
+void AdaptiveRetryPolicy::recordSend(int id, bool confirmed) {
+    RetryStats* s = find(id);
+    if (!s) return;
+
+    s->sends++;
+    if (confirmed) s->confirmed++;
+
+    // 带回差的重复次数调整，避免在两个值之间来回振荡
+    if (s->successRate >= 900 && s->repeat > 0) {
+        s->repeat--;
+    } else if (s->successRate < 600 && s->repeat < MAX_REPEAT) {
+        s->repeat++;
+    }
+}
+
+void AdaptiveRetryPolicy::reset(int id) {
+    RetryStats* s = find(id);
+    if (!s) return;
+
+    memset(s, 0, sizeof(RetryStats));
+    s->successRate = INITIAL_RATE;
+    s->repeat = 1;
+}
+
+void AdaptiveRetryPolicy::resetAll() {
+    for (int i = 1; i <= MAX_TRACKED; i++) {
+        reset(i);
+    }
+}
+
+const RetryStats* AdaptiveRetryPolicy::getStats(int id) const {
+    int index = id - 1;
+    if (index < 0 || index >= MAX_TRACKED) {
+        return nullptr;
+    }
+    return &stats[index];
+}
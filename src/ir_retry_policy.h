@@ -0,0 +1,57 @@
+#ifndef IR_RETRY_POLICY_H
+#define IR_RETRY_POLICY_H
+
+#include <stdint.h>
+
+// 单个信号的闭环发射统计
+struct RetryStats {
+    uint16_t sends;            // 发射命令次数
+    uint16_t confirmed;        // 收到回波确认的次数
+    uint16_t attempts;         // 累计发射尝试次数
+    uint16_t successRate;      // 单次尝试确认率(EWMA，千分比)
+    uint16_t echoLatencyMs;    // 回波延迟(EWMA)
+    uint8_t repeat;            // 当前使用的协议重复次数
+};
+
+// 一次发射的计划
+struct RetryPlan {
+    uint8_t maxAttempts;       // 最多尝试次数
+    uint8_t repeat;            // 每次尝试的协议重复次数
+    uint16_t echoTimeoutMs;    // 每次尝试等待回波的时间
+};
+
+// 自适应重试策略：根据回波确认的历史统计调整重试次数和重复次数
+class AdaptiveRetryPolicy {
+public:
+    static const int MAX_TRACKED = 20;             // 与IRStorage的最大信号数一致
+    static const uint8_t MAX_ATTEMPTS = 4;
+    static const uint8_t MAX_REPEAT = 2;
+    static const uint16_t TARGET_RATE = 950;       // 目标总成功率(千分比)
+    static const uint16_t INITIAL_RATE = 500;      // 无历史时假定的单次确认率
+    static const uint16_t MIN_ECHO_TIMEOUT = 60;
+    static const uint16_t MAX_ECHO_TIMEOUT = 300;
+
+private:
+    RetryStats stats[MAX_TRACKED];
+
+    RetryStats* find(int id);
+
+public:
+    AdaptiveRetryPolicy();
+
+    // 为信号生成发射计划，knownProtocol为false时(UNKNOWN原始数据)不使用协议重复
+    RetryPlan plan(int id, bool knownProtocol);
+
+    // 记录一次尝试的结果，confirmed时latencyMs为发射开始到收到回波的时间
+    void recordAttempt(int id, bool confirmed, uint16_t latencyMs);
+
+    // 记录一次发射命令的最终结果
+    void recordSend(int id, bool confirmed);
+
+    void reset(int id);
+    void resetAll();
+
+    const RetryStats* getStats(int id) const;
+};
+
+#endif
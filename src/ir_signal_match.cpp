@@ -0,0 +1,81 @@
+#include "ir_signal_match.h"
+
+uint8_t rawPulsesSimilarity(const uint16_t* a, uint16_t aLength,
+                            const uint16_t* b, uint16_t bLength,
+                            const PulseMatchConfig& config) {
+    if (!a || !b || aLength == 0 || bLength == 0) return 0;
+
+    uint16_t diff = aLength > bLength ? aLength - bLength : bLength - aLength;
+    if (diff > config.maxLengthDiff) return 0;
+
+    uint16_t length = aLength < bLength ? aLength : bLength;
+    uint16_t matched = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t expected = a[i];
+        uint16_t actual = b[i];
+        uint32_t tolerance = (uint32_t)expected * config.tolerancePct / 100;
+        if (tolerance < config.minTolerance) tolerance = config.minTolerance;
+
+        uint16_t delta = expected > actual ? expected - actual : actual - expected;
+        if (delta <= tolerance) matched++;
+    }
+
+    // 缺失的脉冲按不匹配计
+    uint16_t total = aLength > bLength ? aLength : bLength;
+    return (uint8_t)((uint32_t)matched * 100 / total);
+}
+
+bool rawPulsesMatch(const uint16_t* a, uint16_t aLength,
+                    const uint16_t* b, uint16_t bLength,
+                    const PulseMatchConfig& config) {
+    return rawPulsesSimilarity(a, aLength, b, bLength, config) >= config.minSimilarity;
+}
+
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+// 量化分档(单位的十分之一)：相邻档位约1.4倍，长脉冲的抖动也不容易跨档；更长的脉冲(帧间隔等)归入最后一档
+static const uint16_t PULSE_STEPS[] = {15, 25, 35, 50, 70, 95, 135, 190, 270};
+static const int PULSE_STEP_COUNT = sizeof(PULSE_STEPS) / sizeof(PULSE_STEPS[0]);
+
+static uint32_t fnv(uint32_t hash, uint8_t byte) {
+    return (hash ^ byte) * FNV_PRIME;
+}
+
+uint32_t codeFingerprint(int protocol, uint64_t value, uint16_t bits) {
+    uint32_t hash = fnv(FNV_OFFSET, 'C');
+    hash = fnv(hash, (uint8_t)protocol);
+    hash = fnv(hash, (uint8_t)(protocol >> 8));
+    hash = fnv(hash, (uint8_t)bits);
+    hash = fnv(hash, (uint8_t)(bits >> 8));
+    for (int i = 0; i < 8; i++) hash = fnv(hash, (uint8_t)(value >> (i * 8)));
+    return hash;
+}
+
+uint32_t pulseFingerprint(const uint16_t* pulses, uint16_t length) {
+    if (length % 2 == 0 && length > 0) length--;
+    uint32_t hash = fnv(FNV_OFFSET, 'P');
+    if (!pulses || length == 0) return hash;
+
+    // 单位：最短脉冲1.5倍以内的脉冲均值，比最短脉冲本身稳定
+    uint16_t shortest = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        if (pulses[i] > 0 && pulses[i] < shortest) shortest = pulses[i];
+    }
+    uint32_t sum = 0, count = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        if (pulses[i] > 0 && (uint32_t)pulses[i] * 2 <= (uint32_t)shortest * 3) {
+            sum += pulses[i];
+            count++;
+        }
+    }
+    uint32_t unit = count > 0 ? sum / count : 1;
+    if (unit == 0) unit = 1;
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint32_t tenths = (uint32_t)pulses[i] * 10 / unit;
+        uint8_t step = 0;
+        while (step < PULSE_STEP_COUNT && tenths >= PULSE_STEPS[step]) step++;
+        hash = fnv(hash, step);
+    }
+    return hash;
+}
@@ -0,0 +1,33 @@
+#ifndef IR_SIGNAL_MATCH_H
+#define IR_SIGNAL_MATCH_H
+
+#include <stdint.h>
+
+// 原始脉冲匹配参数
+struct PulseMatchConfig {
+    uint8_t tolerancePct;      // 相对容差(%)
+    uint16_t minTolerance;     // 最小绝对容差(与脉冲相同单位)，避免短脉冲被过严判断
+    uint8_t maxLengthDiff;     // 允许的脉冲数差异(结尾间隔可能丢失)
+    uint8_t minSimilarity;     // 判定为匹配的最低相似度(%)
+};
+
+const PulseMatchConfig kDefaultPulseMatch = {25, 100, 2, 95};
+
+// 计算两段脉冲序列的相似度(容差内一致的脉冲所占百分比)，长度差异过大时返回0
+uint8_t rawPulsesSimilarity(const uint16_t* a, uint16_t aLength,
+                            const uint16_t* b, uint16_t bLength,
+                            const PulseMatchConfig& config = kDefaultPulseMatch);
+
+// 两段脉冲序列是否匹配
+bool rawPulsesMatch(const uint16_t* a, uint16_t aLength,
+                    const uint16_t* b, uint16_t bLength,
+                    const PulseMatchConfig& config = kDefaultPulseMatch);
+
+// 信号指纹：同一按键多次学习得到相同的指纹，用于插入时查重和整库去重
+// 已解码的信号按协议/位数/值计算；原始脉冲以短脉冲均值为单位按约1.4倍一档量化再计算，
+// 一般的抖动不改变量化结果，结尾间隔(偶数个脉冲时的最后一个space)不计入
+// 指纹相同只是候选，还需按值或rawPulsesMatch确认
+uint32_t codeFingerprint(int protocol, uint64_t value, uint16_t bits);
+uint32_t pulseFingerprint(const uint16_t* pulses, uint16_t length);
+
+#endif
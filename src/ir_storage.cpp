@@ -1,68 +1,532 @@
 #include "ir_storage.h"
 #include <IRutils.h>
+#include "ir_protocol_name.h"
+#include "ir_protocol_encoder.h"
+#include "ir_signal_match.h"
+#include <algorithm>
+#include <string.h>
+#include <mutex>
 
-IRStorage::IRStorage() {
+const char* duplicatePolicyName(DuplicatePolicy policy) {
+    switch (policy) {
+        case DUPLICATE_KEEP: return "keep";
+        case DUPLICATE_REJECT: return "reject";
+        case DUPLICATE_MERGE: return "merge";
+        default: return "?";
+    }
+}
+
+const char* addStatusName(AddStatus status) {
+    switch (status) {
+        case ADD_STORED: return "stored";
+        case ADD_MERGED: return "merged";
+        case ADD_REJECTED: return "rejected";
+        case ADD_FULL: return "full";
+        default: return "?";
+    }
+}
+
+// 默认存储后端
+static EEPROMBackend eepromBackend;
+
+// 写者锁：编码缓冲和scratch_signal是静态的，所有实例共用一把锁；可重入(flush等在写操作内部调用)
+static std::recursive_mutex writer_lock;
+typedef std::lock_guard<std::recursive_mutex> WriterGuard;
+
+// 存储格式：魔数(1) 记录数(1) 模式表长度(2) 共享模式表，之后是变长记录(小端)，名称和脉冲只保存实际长度
+//   标志(1) 槽位(1) 协议(2) 值(8) 位数(2) 载波(2) 占空比(1) 重复周期(2) 时间戳(4)
+//   名称长度(1) 脉冲数(2) 重复帧脉冲数(1) 状态字节数(1)
+//   [描述符(30)] 名称 [原始脉冲 | 片段下标] [重复帧脉冲] [状态字节]
+// 参数化记录只保存描述符，原始脉冲和重复帧在加载时按描述符重新生成；有状态协议只保存状态字节
+// 共享记录用模式表的片段下标代替原始脉冲和重复帧(每4个脉冲对1字节)，脉冲数仍写在记录头
+// 旧格式(LEGACY_MAGIC)没有模式表长度和模式表，记录全部为原始脉冲
+static const uint8_t RECORD_PARAMETRIC = 0x01;
+static const uint8_t RECORD_PATTERN = 0x02;
+static const size_t RECORD_HEADER_SIZE = 28;
+static const size_t RECORD_DESCRIPTOR_SIZE = 30;
+static const size_t IMAGE_HEADER_SIZE = 4;
+static const size_t MAX_RECORD_SIZE = RECORD_HEADER_SIZE + RECORD_DESCRIPTOR_SIZE + 31 +
+                                      (256 + MAX_REPEAT_PULSES) * sizeof(uint16_t) + kStateSizeMax;
+// 同一缓冲也用于读写模式表
+static uint8_t record_buffer[MAX_RECORD_SIZE > PatternTable::MAX_SERIALIZED ? MAX_RECORD_SIZE
+                                                                            : PatternTable::MAX_SERIALIZED];
+static IRSignal scratch_signal;   // setParametric改写失败时不破坏原记录
+
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+    p = put16(p, (uint16_t)v);
+    return put16(p, (uint16_t)(v >> 16));
+}
+
+static uint8_t* put64(uint8_t* p, uint64_t v) {
+    p = put32(p, (uint32_t)v);
+    return put32(p, (uint32_t)(v >> 32));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// refCount为信号引用的共享片段数，0表示按原始脉冲保存
+static size_t recordSize(const IRSignal& s, uint8_t refCount) {
+    size_t size = RECORD_HEADER_SIZE + strnlen(s.name, 31) + s.stateLength;
+    if (s.parametric) return size + RECORD_DESCRIPTOR_SIZE;
+    if (refCount > 0) return size + refCount;
+    return size + (s.rawLength + s.repeatLength) * sizeof(uint16_t);
+}
+
+static size_t encodeRecord(const IRSignal& s, int slot, const uint8_t* refs, uint8_t refCount, uint8_t* out) {
+    uint8_t nameLen = (uint8_t)strnlen(s.name, 31);
+    uint8_t* p = out;
+    *p++ = s.parametric ? RECORD_PARAMETRIC : (refCount > 0 ? RECORD_PATTERN : 0);
+    *p++ = (uint8_t)slot;
+    p = put16(p, (uint16_t)s.protocol);
+    p = put64(p, s.value);
+    p = put16(p, s.bits);
+    p = put16(p, s.carrierFreq);
+    *p++ = s.dutyCycle;
+    p = put16(p, s.repeatPeriod);
+    p = put32(p, (uint32_t)s.timestamp);
+    *p++ = nameLen;
+    p = put16(p, s.parametric ? 0 : s.rawLength);
+    *p++ = s.parametric ? 0 : (uint8_t)s.repeatLength;
+    *p++ = (uint8_t)s.stateLength;
+
+    if (s.parametric) {
+        const ProtocolDescriptor& d = s.descriptor;
+        *p++ = (uint8_t)d.encoding;
+        *p++ = (uint8_t)d.repeatMode;
+        p = put16(p, d.hdrMark);
+        p = put16(p, d.hdrSpace);
+        p = put16(p, d.oneMark);
+        p = put16(p, d.oneSpace);
+        p = put16(p, d.zeroMark);
+        p = put16(p, d.zeroSpace);
+        p = put16(p, d.footerMark);
+        p = put32(p, d.minGap);
+        p = put32(p, d.minFrameLength);
+        p = put16(p, d.rptSpace);
+        *p++ = d.msbFirst ? 1 : 0;
+        p = put16(p, d.freq);
+        *p++ = d.duty;
+    }
+
+    memcpy(p, s.name, nameLen);
+    p += nameLen;
+    if (!s.parametric && refCount > 0) {
+        memcpy(p, refs, refCount);
+        p += refCount;
+    } else if (!s.parametric) {
+        for (uint16_t i = 0; i < s.rawLength; i++) p = put16(p, s.rawData[i]);
+        for (uint16_t i = 0; i < s.repeatLength; i++) p = put16(p, s.repeatData[i]);
+    }
+    memcpy(p, s.state, s.stateLength);
+    p += s.stateLength;
+    return p - out;
+}
+
+// 共享记录引用的片段数：原始脉冲和重复帧分别切分
+static uint8_t patternRefCount(uint16_t rawLength, uint16_t repeatLength) {
+    return (uint8_t)(PatternTable::segmentsFor(rawLength) + PatternTable::segmentsFor(repeatLength));
+}
+
+// 记录头之后的长度，头部字段不合法时返回0
+static size_t recordBodySize(const uint8_t* header) {
+    bool parametric = header[0] & RECORD_PARAMETRIC;
+    uint8_t nameLen = header[23];
+    uint16_t rawLength = get16(header + 24);
+    uint8_t repeatLength = header[26];
+    uint8_t stateLength = header[27];
+    if (nameLen > 31 || rawLength > 256 || repeatLength > MAX_REPEAT_PULSES || stateLength > kStateSizeMax) return 0;
+    if (parametric) return RECORD_DESCRIPTOR_SIZE + nameLen + stateLength;
+    if (header[0] & RECORD_PATTERN) return nameLen + patternRefCount(rawLength, repeatLength) + stateLength;
+    return nameLen + (rawLength + repeatLength) * sizeof(uint16_t) + stateLength;
+}
+
+// 已解码的信号按值查重，UNKNOWN按量化后的原始脉冲
+static uint32_t fingerprintOf(decode_type_t protocol, uint64_t value, uint16_t bits,
+                              const uint16_t* rawData, uint16_t rawLength) {
+    if (protocol == UNKNOWN) return pulseFingerprint(rawData, rawLength);
+    return codeFingerprint((int)protocol, value, bits);
+}
+
+// 按描述符生成原始脉冲和重复帧
+static bool regeneratePulses(IRSignal& s) {
+    s.repeatLength = 0;
+    if (!encodeFramePulses(s.descriptor, false, s.value, s.bits, s.rawData, 256, s.rawLength)) return false;
+    if (s.descriptor.repeatMode == RepeatMode::NEC_REPEAT_CODE) {
+        return encodeFramePulses(s.descriptor, true, s.value, s.bits, s.repeatData,
+                                 MAX_REPEAT_PULSES, s.repeatLength) != 0;
+    }
+    return true;
+}
+
+// 共享记录的片段下标写入refs并按模式表展开，refCount为0表示不是共享记录
+static bool decodeRecord(const uint8_t* in, IRSignal& s, const PatternTable& patterns,
+                         uint8_t* refs, uint8_t& refCount) {
+    const uint8_t* p = in;
+    uint8_t flags = *p++;
+    s.parametric = (flags & RECORD_PARAMETRIC) != 0;
+    refCount = 0;
+    p++;   // 槽位
+    s.protocol = (decode_type_t)(int16_t)get16(p); p += 2;
+    s.value = get64(p); p += 8;
+    s.bits = get16(p); p += 2;
+    s.carrierFreq = get16(p); p += 2;
+    s.dutyCycle = *p++;
+    s.repeatPeriod = get16(p); p += 2;
+    s.timestamp = get32(p); p += 4;
+    uint8_t nameLen = *p++;
+    s.rawLength = get16(p); p += 2;
+    s.repeatLength = *p++;
+    s.stateLength = *p++;
+
+    if (s.parametric) {
+        ProtocolDescriptor& d = s.descriptor;
+        d.encoding = (PulseEncoding)*p++;
+        d.repeatMode = (RepeatMode)*p++;
+        d.hdrMark = get16(p); p += 2;
+        d.hdrSpace = get16(p); p += 2;
+        d.oneMark = get16(p); p += 2;
+        d.oneSpace = get16(p); p += 2;
+        d.zeroMark = get16(p); p += 2;
+        d.zeroSpace = get16(p); p += 2;
+        d.footerMark = get16(p); p += 2;
+        d.minGap = get32(p); p += 4;
+        d.minFrameLength = get32(p); p += 4;
+        d.rptSpace = get16(p); p += 2;
+        d.msbFirst = *p++ != 0;
+        d.freq = get16(p); p += 2;
+        d.duty = *p++;
+    }
+
+    memcpy(s.name, p, nameLen);
+    s.name[nameLen] = '\0';
+    p += nameLen;
+    if (!s.parametric && (flags & RECORD_PATTERN)) {
+        uint8_t rawSegments = (uint8_t)PatternTable::segmentsFor(s.rawLength);
+        refCount = patternRefCount(s.rawLength, s.repeatLength);
+        memcpy(refs, p, refCount);
+        p += refCount;
+        if (!patterns.expand(refs, rawSegments, s.rawLength, s.rawData) ||
+            !patterns.expand(refs + rawSegments, refCount - rawSegments, s.repeatLength, s.repeatData)) {
+            return false;
+        }
+    } else if (!s.parametric) {
+        for (uint16_t i = 0; i < s.rawLength; i++, p += 2) s.rawData[i] = get16(p);
+        for (uint16_t i = 0; i < s.repeatLength; i++, p += 2) s.repeatData[i] = get16(p);
+    }
+    memcpy(s.state, p, s.stateLength);
+    return !s.parametric || regeneratePulses(s);
+}
+
+IRStorage::IRStorage(StorageBackend* backend)
+    : feature_index(feature_entries, MAX_SIGNALS), lsh_index(lsh_heads, LSH_BUCKETS, lsh_slots, MAX_SIGNALS) {
+    this->backend = backend ? backend : &eepromBackend;
+    quiet = false;
+    batch_depth = 0;
+    batch_dirty = false;
+    debounce_ms = 0;
+    max_delay_ms = 0;
+    dirty = false;
+    first_change_ms = 0;
+    last_change_ms = 0;
+    pending_changes = 0;
+    memset(&commit_stats, 0, sizeof(commit_stats));
     signal_count = 0;
+    next_revision = 1;
+    duplicate_policy = DUPLICATE_KEEP;
+    last_add_status = ADD_STORED;
+    last_duplicate_id = -1;
+    for (int b = 0; b < FINGERPRINT_BUCKETS; b++) fingerprint_head[b] = -1;
+    snapshot_retries.store(0, std::memory_order_relaxed);
     // 初始化信号数组
     for (int i = 0; i < MAX_SIGNALS; i++) {
         signals[i].isValid = false;
+        revisions[i] = 0;
+        sequences[i].store(0, std::memory_order_relaxed);
+        pattern_refs[i].count = 0;
+        fingerprints[i] = 0;
+        fingerprint_next[i] = -1;
+    }
+}
+
+void IRStorage::beginWrite(int index) {
+    uint32_t seq = sequences[index].load(std::memory_order_relaxed);
+    if (seq & 1) return;
+    sequences[index].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void IRStorage::endWrite(int index) {
+    revisions[index] = signals[index].isValid ? next_revision++ : 0;
+    if (next_revision == 0) next_revision = 1;
+    uint32_t seq = sequences[index].load(std::memory_order_relaxed);
+    if (seq & 1) sequences[index].store(seq + 1, std::memory_order_release);
+}
+
+// seqlock读者的乐观复制：可能与写者并发，结果由之后的序号检查决定是否丢弃。
+// 逐字以relaxed原子读取，不会被编译器改写为memcpy；ThreadSanitizer构建中不检查这里的读取，
+// 序号本身的同步和读路径上的其他访问仍由它检查
+#if defined(__SANITIZE_THREAD__)
+__attribute__((no_sanitize_thread))
+#endif
+static void seqlockCopy(void* dst, const void* src, size_t size) {
+    static_assert(alignof(IRSignal) % sizeof(uint32_t) == 0, "IRSignal按字复制");
+    uint32_t* d = static_cast<uint32_t*>(dst);
+    const uint32_t* s = static_cast<const uint32_t*>(src);
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        d[i] = __atomic_load_n(&s[i], __ATOMIC_RELAXED);
+    }
+}
+
+bool IRStorage::snapshot(int id, IRSignal& out, uint32_t* revision) const {
+    int index = id - 1;
+    if (index < 0 || index >= MAX_SIGNALS) return false;
+    
+    uint32_t rev;
+    for (;;) {
+        uint32_t before = sequences[index].load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            seqlockCopy(&out, &signals[index], sizeof(IRSignal));
+            seqlockCopy(&rev, &revisions[index], sizeof(rev));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequences[index].load(std::memory_order_relaxed) == before) break;
+        }
+        snapshot_retries.fetch_add(1, std::memory_order_relaxed);
     }
+    
+    if (revision) *revision = out.isValid ? rev : 0;
+    return out.isValid;
 }
 
 bool IRStorage::begin() {
-    if (!EEPROM.begin(EEPROM_SIZE)) {
+    WriterGuard guard(writer_lock);
+    if (!backend->begin(EEPROM_SIZE)) {
         Serial.println("[Storage] EEPROM初始化失败!");
         return false;
     }
     
     loadFromEEPROM();
-    Serial.printf("[Storage] 存储器初始化完成，已加载%d个信号\n", signal_count);
+    if (!quiet) Serial.printf("[Storage] 存储器初始化完成，已加载%d个信号\n", signal_count);
+    return true;
+}
+
+void IRStorage::setQuiet(bool enable) {
+    quiet = enable;
+}
+
+void IRStorage::beginBatch() {
+    WriterGuard guard(writer_lock);
+    // 先提交批量写入之前的修改，abortBatch重新加载时才不会丢失
+    if (batch_depth == 0) flush();
+    batch_depth++;
+}
+
+void IRStorage::endBatch() {
+    WriterGuard guard(writer_lock);
+    if (batch_depth == 0) return;
+    if (--batch_depth == 0 && batch_dirty) {
+        batch_dirty = false;
+        persist();
+    }
+}
+
+void IRStorage::abortBatch() {
+    WriterGuard guard(writer_lock);
+    batch_depth = 0;
+    if (batch_dirty) {
+        batch_dirty = false;
+        // 存储中没有有效数据时loadFromEEPROM不会触及信号数组
+        for (int i = 0; i < MAX_SIGNALS; i++) {
+            beginWrite(i);
+            signals[i].isValid = false;
+        }
+        loadFromEEPROM();
+    }
+}
+
+void IRStorage::persist() {
+    if (batch_depth > 0) {
+        batch_dirty = true;
+        return;
+    }
+    commit_stats.changes++;
+    if (debounce_ms == 0) {
+        saveToEEPROM();
+        return;
+    }
+    
+    unsigned long now = millis();
+    if (!dirty) first_change_ms = now;
+    last_change_ms = now;
+    dirty = true;
+    pending_changes++;
+}
+
+void IRStorage::setWriteBehind(uint32_t debounceMs, uint32_t maxDelayMs) {
+    WriterGuard guard(writer_lock);
+    debounce_ms = debounceMs;
+    max_delay_ms = maxDelayMs > debounceMs ? maxDelayMs : debounceMs;
+    if (debounce_ms == 0) flush();
+}
+
+bool IRStorage::service(bool idle) {
+    WriterGuard guard(writer_lock);
+    if (!dirty || batch_depth > 0) return false;
+    unsigned long now = millis();
+    bool settled = idle && now - last_change_ms >= debounce_ms;
+    bool overdue = now - first_change_ms >= max_delay_ms;
+    if (!settled && !overdue) return false;
+    return flush();
+}
+
+bool IRStorage::flush() {
+    WriterGuard guard(writer_lock);
+    if (!dirty || batch_depth > 0) return false;
+    saveToEEPROM();
     return true;
 }
 
+unsigned long IRStorage::getDirtyAgeMs() const {
+    return dirty ? millis() - first_change_ms : 0;
+}
+
+void IRStorage::resetCommitStats() {
+    memset(&commit_stats, 0, sizeof(commit_stats));
+}
+
 void IRStorage::loadFromEEPROM() {
+    patterns.clear();
+    for (int i = 0; i < MAX_SIGNALS; i++) pattern_refs[i].count = 0;
+    for (int b = 0; b < FINGERPRINT_BUCKETS; b++) fingerprint_head[b] = -1;
+    feature_index.clear();
+    lsh_index.clear();
+    
     // 检查魔数
-    if (EEPROM.read(0) != MAGIC_NUMBER) {
-        Serial.println("[Storage] EEPROM数据无效，初始化为空");
+    uint8_t magic = backend->read(0);
+    if (magic != MAGIC_NUMBER && magic != LEGACY_MAGIC) {
+        if (!quiet) Serial.println("[Storage] EEPROM数据无效，初始化为空");
         signal_count = 0;
+        for (int i = 0; i < MAX_SIGNALS; i++) endWrite(i);
         return;
     }
     
     // 读取信号数量
-    signal_count = EEPROM.read(1);
-    if (signal_count > MAX_SIGNALS) {
-        signal_count = 0;
-        return;
+    int count = backend->read(1);
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        beginWrite(i);
+        signals[i].isValid = false;
     }
+    signal_count = 0;
+    if (count > MAX_SIGNALS) count = 0;
     
-    // 读取信号数据
+    // 共享模式表，表损坏时所有记录都无法还原
     int addr = 2;
-    for (int i = 0; i < signal_count; i++) {
-        EEPROM.get(addr, signals[i]);
-        addr += sizeof(IRSignal);
+    if (magic == MAGIC_NUMBER) {
+        uint16_t tableLen = (uint16_t)(backend->read(2) | (backend->read(3) << 8));
+        addr = IMAGE_HEADER_SIZE + tableLen;
+        if (tableLen > sizeof(record_buffer) || !backend->readBytes(IMAGE_HEADER_SIZE, record_buffer, tableLen) ||
+            patterns.deserialize(record_buffer, tableLen) != tableLen) {
+            count = 0;
+            if (!quiet) Serial.println("[Storage] ⚠️ 共享模式表损坏，信号未加载");
+        }
+    }
+    
+    // 逐条读取变长记录，遇到损坏的记录即停止
+    for (int i = 0; i < count; i++) {
+        if (!backend->readBytes(addr, record_buffer, RECORD_HEADER_SIZE)) break;
+        int slot = record_buffer[1];
+        size_t body = recordBodySize(record_buffer);
+        if (slot >= MAX_SIGNALS || signals[slot].isValid || body == 0) break;
+        if (!backend->readBytes(addr + RECORD_HEADER_SIZE, record_buffer + RECORD_HEADER_SIZE, body)) break;
+        PatternRefs& refs = pattern_refs[slot];
+        if (!decodeRecord(record_buffer, signals[slot], patterns, refs.refs, refs.count)) {
+            refs.count = 0;
+            break;
+        }
+        if (!patterns.retain(refs.refs, refs.count)) {
+            refs.count = 0;
+            break;
+        }
+        signals[slot].isValid = true;
+        indexFingerprint(slot);
+        indexFeatures(slot);
+        signal_count++;
+        addr += RECORD_HEADER_SIZE + body;
+    }
+    if (signal_count < count && !quiet) {
+        Serial.printf("[Storage] ⚠️ 第%d条记录损坏，之后的信号未加载\n", signal_count + 1);
     }
     
-    Serial.printf("[Storage] 从EEPROM加载了%d个信号\n", signal_count);
+    // 旧格式或表满时保存的原始脉冲记录，下次保存时尽量改为共享
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        if (signals[i].isValid && pattern_refs[i].count == 0) acquirePatterns(i);
+    }
+    for (int i = 0; i < MAX_SIGNALS; i++) endWrite(i);
+    
+    if (!quiet) Serial.printf("[Storage] 从EEPROM加载了%d个信号\n", signal_count);
 }
 
 void IRStorage::saveToEEPROM() {
-    // 写入魔数
-    EEPROM.write(0, MAGIC_NUMBER);
+    ScopedLatency latency(STAGE_STORAGE_SAVE);
+    unsigned long startUs = micros();
     
-    // 写入信号数量
-    EEPROM.write(1, signal_count);
+    // 写入魔数和共享模式表
+    backend->write(0, MAGIC_NUMBER);
+    size_t tableLen = patterns.serialize(record_buffer);
+    backend->write(2, (uint8_t)tableLen);
+    backend->write(3, (uint8_t)(tableLen >> 8));
+    backend->writeBytes(IMAGE_HEADER_SIZE, record_buffer, tableLen);
     
-    // 写入信号数据
-    int addr = 2;
-    for (int i = 0; i < signal_count; i++) {
-        if (signals[i].isValid) {
-            EEPROM.put(addr, signals[i]);
-            addr += sizeof(IRSignal);
+    // 写入信号数据。新增、合并、改名和参数化都已保证映像不超过容量，这里超出或写入失败时停止，
+    // 记录数只计入完整写入的记录
+    int addr = IMAGE_HEADER_SIZE + tableLen;
+    int written = 0;
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        if (!signals[i].isValid) continue;
+        size_t size = encodeRecord(signals[i], i, pattern_refs[i].refs, pattern_refs[i].count, record_buffer);
+        if (addr + size > backend->size() || !backend->writeBytes(addr, record_buffer, size)) {
+            if (!quiet) Serial.printf("[Storage] ⚠️ 信号ID %d 起超出存储容量，未能持久化\n", i + 1);
+            break;
         }
+        addr += size;
+        written++;
     }
     
-    EEPROM.commit();
-    Serial.printf("[Storage] 已保存%d个信号到EEPROM\n", signal_count);
+    // 写入信号数量
+    backend->write(1, written);
+    
+    backend->commit();
+    
+    uint32_t elapsedUs = micros() - startUs;
+    commit_stats.commits++;
+    commit_stats.lastUs = elapsedUs;
+    if (elapsedUs > commit_stats.maxUs) commit_stats.maxUs = elapsedUs;
+    commit_stats.totalUs += elapsedUs;
+    if (!quiet) {
+        if (pending_changes > 1) {
+            Serial.printf("[Storage] 已保存%d个信号到EEPROM (%d字节，合并%u次修改，%lu us)\n",
+                          written, addr, pending_changes, (unsigned long)elapsedUs);
+        } else {
+            Serial.printf("[Storage] 已保存%d个信号到EEPROM (%d字节，%lu us)\n", written, addr, (unsigned long)elapsedUs);
+        }
+    }
+    dirty = false;
+    pending_changes = 0;
 }
 
 int IRStorage::findEmptySlot() {
@@ -74,21 +538,279 @@ int IRStorage::findEmptySlot() {
     return -1;  // 没有空闲槽位
 }
 
-int IRStorage::addSignal(decode_type_t protocol, uint32_t value, uint16_t bits, 
-                        uint16_t* rawData, uint16_t rawLength, const char* name) {
+void IRStorage::acquirePatterns(int index) {
+    IRSignal& s = signals[index];
+    PatternRefs& refs = pattern_refs[index];
+    refs.count = 0;
+    if (s.parametric || s.stateLength > 0 || s.rawLength == 0) return;
+    
+    uint8_t rawSegments = 0;
+    uint8_t repeatSegments = 0;
+    if (!patterns.acquire(s.rawData, s.rawLength, refs.refs, MAX_PATTERN_REFS, rawSegments)) return;
+    if (s.repeatLength > 0 &&
+        !patterns.acquire(s.repeatData, s.repeatLength, refs.refs + rawSegments,
+                          MAX_PATTERN_REFS - rawSegments, repeatSegments)) {
+        patterns.release(refs.refs, rawSegments);
+        return;
+    }
+    refs.count = rawSegments + repeatSegments;
+}
+
+void IRStorage::releasePatterns(int index) {
+    PatternRefs& refs = pattern_refs[index];
+    patterns.release(refs.refs, refs.count);
+    refs.count = 0;
+}
+
+void IRStorage::indexFingerprint(int index) {
+    const IRSignal& s = signals[index];
+    fingerprints[index] = fingerprintOf(s.protocol, s.value, s.bits, s.rawData, s.rawLength);
+    int bucket = fingerprints[index] % FINGERPRINT_BUCKETS;
+    fingerprint_next[index] = fingerprint_head[bucket];
+    fingerprint_head[bucket] = (int8_t)index;
+}
+
+void IRStorage::unindexFingerprint(int index) {
+    int8_t* link = &fingerprint_head[fingerprints[index] % FINGERPRINT_BUCKETS];
+    while (*link >= 0) {
+        if (*link == index) {
+            *link = fingerprint_next[index];
+            break;
+        }
+        link = &fingerprint_next[*link];
+    }
+    fingerprint_next[index] = -1;
+}
+
+void IRStorage::indexFeatures(int index) {
+    const IRSignal& s = signals[index];
+    computeFeatures(s.rawData, s.rawLength, features[index]);
+    unindexFeatures(index);
+    if (s.rawLength == 0) return;
+    
+    feature_index.insert(index, features[index]);
+    uint8_t levels[256];
+    uint16_t length = levelPulses(s.rawData, s.rawLength, levels, sizeof(levels));
+    lsh_index.insert(index, levels, length);
+}
+
+void IRStorage::unindexFeatures(int index) {
+    feature_index.remove(index);
+    lsh_index.remove(index);
+}
+
+bool IRStorage::sameContent(int index, decode_type_t protocol, uint64_t value, uint16_t bits,
+                            const uint16_t* rawData, uint16_t rawLength,
+                            const uint8_t* state, uint16_t stateLength) const {
+    const IRSignal& s = signals[index];
+    if (s.protocol != protocol) return false;
+    if (protocol == UNKNOWN) return rawPulsesMatch(s.rawData, s.rawLength, rawData, rawLength);
+    if (s.value != value || s.bits != bits || s.stateLength != stateLength) return false;
+    return stateLength == 0 || memcmp(s.state, state, stateLength) == 0;
+}
+
+// 重复的学习结果可能带有已有信号缺少的信息：载波和按住重复
+void IRStorage::mergeInto(int index, uint16_t carrierFreq, uint8_t dutyCycle,
+                          const uint16_t* repeatData, uint16_t repeatLength, uint16_t repeatPeriod) {
+    IRSignal& s = signals[index];
+    beginWrite(index);
+    if (s.carrierFreq == 0 && carrierFreq > 0) {
+        s.carrierFreq = carrierFreq;
+        s.dutyCycle = dutyCycle;
+    }
+    if (s.repeatPeriod == 0 && repeatPeriod > 0) {
+        s.repeatPeriod = repeatPeriod;
+        // 参数化记录的重复帧由描述符生成，有状态协议不保存脉冲
+        if (!s.parametric && s.stateLength == 0 && repeatData && repeatLength > 0) {
+            s.repeatLength = std::min(repeatLength, MAX_REPEAT_PULSES);
+            memcpy(s.repeatData, repeatData, s.repeatLength * sizeof(uint16_t));
+            releasePatterns(index);
+            acquirePatterns(index);
+            // 映像放不下时只补充重复周期，不保存重复帧
+            if (imageSize() > backend->size()) {
+                releasePatterns(index);
+                s.repeatLength = 0;
+                acquirePatterns(index);
+            }
+        }
+    }
+    s.timestamp = millis();
+    endWrite(index);
+}
+
+int IRStorage::findDuplicate(decode_type_t protocol, uint64_t value, uint16_t bits,
+                             const uint16_t* rawData, uint16_t rawLength,
+                             const uint8_t* state, uint16_t stateLength) const {
+    uint32_t fingerprint = fingerprintOf(protocol, value, bits, rawData, rawLength);
+    for (int i = fingerprint_head[fingerprint % FINGERPRINT_BUCKETS]; i >= 0; i = fingerprint_next[i]) {
+        if (fingerprints[i] != fingerprint) continue;
+        if (sameContent(i, protocol, value, bits, rawData, rawLength, state, stateLength)) return i + 1;
+    }
+    return -1;
+}
+
+int IRStorage::findDuplicates(DuplicatePair* out, int capacity) const {
+    // (指纹, 槽位)排序后同指纹的信号相邻，只在同指纹的一段内比较内容
+    uint64_t keys[MAX_SIGNALS];
+    int n = 0;
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        if (signals[i].isValid) keys[n++] = (uint64_t)fingerprints[i] << 32 | (uint32_t)i;
+    }
+    std::sort(keys, keys + n);
+    
+    int found = 0;
+    bool duplicate[MAX_SIGNALS] = {false};
+    for (int start = 0; start < n; ) {
+        int end = start + 1;
+        while (end < n && keys[end] >> 32 == keys[start] >> 32) end++;
+        for (int j = start + 1; j < end; j++) {
+            const IRSignal& s = signals[(uint32_t)keys[j]];
+            for (int k = start; k < j; k++) {
+                int keep = (uint32_t)keys[k];
+                if (duplicate[keep]) continue;
+                if (!sameContent(keep, s.protocol, s.value, s.bits, s.rawData, s.rawLength, s.state, s.stateLength)) {
+                    continue;
+                }
+                duplicate[(uint32_t)keys[j]] = true;
+                if (found < capacity) out[found] = {keep + 1, (int)(uint32_t)keys[j] + 1};
+                found++;
+                break;
+            }
+        }
+        start = end;
+    }
+    return found < capacity ? found : capacity;
+}
+
+bool IRStorage::mergeDuplicate(int keepId, int duplicateId) {
+    WriterGuard guard(writer_lock);
+    if (keepId == duplicateId || !isValidId(keepId) || !isValidId(duplicateId)) return false;
+    const IRSignal& dup = signals[duplicateId - 1];
+    mergeInto(keepId - 1, dup.carrierFreq, dup.dutyCycle, dup.repeatData, dup.repeatLength, dup.repeatPeriod);
+    return deleteSignal(duplicateId);
+}
+
+int IRStorage::matchPulses(const uint16_t* pulses, uint16_t length, uint8_t* similarity, int* compared) const {
+    SignalFeatures query;
+    computeFeatures(pulses, length, query);
+    int32_t candidates[MAX_SIGNALS];
+    int best = -1;
+    uint8_t bestSimilarity = 0;
+    int total = 0;
+    
+    // 先按形状精确查找，没有达到相似度时再宽松查找
+    for (int pass = 0; pass < 2 && bestSimilarity < kDefaultPulseMatch.minSimilarity; pass++) {
+        int count = feature_index.candidates(query, candidates, MAX_SIGNALS, pass == 1);
+        total += count;
+        for (int i = 0; i < count; i++) {
+            const IRSignal& s = signals[candidates[i]];
+            uint8_t score = rawPulsesSimilarity(s.rawData, s.rawLength, pulses, length);
+            if (score > bestSimilarity) {
+                bestSimilarity = score;
+                best = candidates[i];
+            }
+        }
+    }
+    if (similarity) *similarity = bestSimilarity;
+    if (compared) *compared = total;
+    return bestSimilarity >= kDefaultPulseMatch.minSimilarity ? best + 1 : -1;
+}
+
+int IRStorage::nearestSignal(const uint16_t* pulses, uint16_t length, uint8_t* confidence, int* compared) const {
+    uint8_t levels[256];
+    uint16_t levelCount = levelPulses(pulses, length, levels, sizeof(levels));
+    int32_t candidates[MAX_SIGNALS];
+    int count = lsh_index.candidates(levels, levelCount, candidates, nullptr, MAX_SIGNALS);
+    
+    int best = -1;
+    uint8_t bestSimilarity = 0;
+    uint8_t runnerUp = 0;
+    for (int i = 0; i < count; i++) {
+        const IRSignal& s = signals[candidates[i]];
+        uint8_t score = rawPulsesSimilarity(s.rawData, s.rawLength, pulses, length);
+        if (score > bestSimilarity) {
+            runnerUp = bestSimilarity;
+            bestSimilarity = score;
+            best = candidates[i];
+        } else if (score > runnerUp) {
+            runnerUp = score;
+        }
+    }
+    if (confidence) *confidence = LshIndex::confidence(bestSimilarity, runnerUp);
+    if (compared) *compared = count;
+    return best >= 0 ? best + 1 : -1;
+}
+
+const SignalFeatures* IRStorage::getFeatures(int id) const {
+    int index = id - 1;
+    if (index < 0 || index >= MAX_SIGNALS || !signals[index].isValid) return nullptr;
+    return &features[index];
+}
+
+uint32_t IRStorage::getFingerprint(int id) const {
+    int index = id - 1;
+    if (index < 0 || index >= MAX_SIGNALS || !signals[index].isValid) return 0;
+    return fingerprints[index];
+}
+
+int IRStorage::addSignal(decode_type_t protocol, uint64_t value, uint16_t bits, 
+                        uint16_t* rawData, uint16_t rawLength, const char* name,
+                        uint16_t carrierFreq, uint8_t dutyCycle,
+                        const uint16_t* repeatData, uint16_t repeatLength,
+                        uint16_t repeatPeriod,
+                        const uint8_t* state, uint16_t stateLength) {
+    WriterGuard guard(writer_lock);
+    last_duplicate_id = -1;
+    if (rawLength > 256) rawLength = 256;
+    if (duplicate_policy != DUPLICATE_KEEP) {
+        int existing = findDuplicate(protocol, value, bits, rawData, rawLength, state, stateLength);
+        if (existing > 0) {
+            last_duplicate_id = existing;
+            if (duplicate_policy == DUPLICATE_REJECT) {
+                last_add_status = ADD_REJECTED;
+                if (!quiet) Serial.printf("[Storage] 与信号ID %d 重复，未保存\n", existing);
+                return -1;
+            }
+            mergeInto(existing - 1, carrierFreq, dutyCycle, repeatData, repeatLength, repeatPeriod);
+            persist();
+            last_add_status = ADD_MERGED;
+            if (!quiet) Serial.printf("[Storage] 与信号ID %d 重复，已合并: %s\n", existing, signals[existing - 1].name);
+            return existing;
+        }
+    }
+    
     int slot = findEmptySlot();
     if (slot == -1) {
+        last_add_status = ADD_FULL;
         Serial.println("[Storage] 存储空间已满!");
         return -1;
     }
     
     // 填充信号数据
+    beginWrite(slot);
     signals[slot].isValid = true;
+    signals[slot].parametric = false;
     signals[slot].protocol = protocol;
     signals[slot].value = value;
     signals[slot].bits = bits;
-    signals[slot].rawLength = min(rawLength, (uint16_t)256);
+    signals[slot].rawLength = rawLength;
+    signals[slot].carrierFreq = carrierFreq;
+    signals[slot].dutyCycle = dutyCycle;
     signals[slot].timestamp = millis();
+    signals[slot].repeatPeriod = repeatPeriod;
+    signals[slot].repeatLength = repeatData ? std::min(repeatLength, MAX_REPEAT_PULSES) : 0;
+    if (signals[slot].repeatLength > 0) {
+        memcpy(signals[slot].repeatData, repeatData, signals[slot].repeatLength * sizeof(uint16_t));
+    }
+    
+    // 有状态协议由状态字节生成波形，原始脉冲不再需要
+    signals[slot].stateLength = state ? std::min(stateLength, kStateSizeMax) : 0;
+    if (signals[slot].stateLength > 0) {
+        memcpy(signals[slot].state, state, signals[slot].stateLength);
+        signals[slot].rawLength = 0;
+        signals[slot].repeatLength = 0;
+        rawLength = 0;
+    }
     
     // 复制原始数据
     if (rawData && rawLength > 0) {
@@ -103,34 +825,64 @@ int IRStorage::addSignal(decode_type_t protocol, uint32_t value, uint16_t bits,
         snprintf(signals[slot].name, 32, "Signal_%d", slot + 1);
     }
     
+    acquirePatterns(slot);
+    // 映像放不下时不插入：saveToEEPROM只能截断，已返回成功的信号会在重启后丢失
+    size_t needed = imageSize();
+    if (needed > backend->size()) {
+        releasePatterns(slot);
+        signals[slot].isValid = false;
+        endWrite(slot);
+        last_add_status = ADD_FULL;
+        Serial.printf("[Storage] 存储容量不足: 需要%u字节，容量%u字节\n", (unsigned)needed,
+                      (unsigned)backend->size());
+        return -1;
+    }
+    indexFingerprint(slot);
+    indexFeatures(slot);
+    endWrite(slot);
     signal_count++;
-    saveToEEPROM();
+    last_add_status = ADD_STORED;
+    persist();
     
-    Serial.printf("[Storage] 信号已保存到槽位%d: %s\n", slot + 1, signals[slot].name);
+    if (!quiet) Serial.printf("[Storage] 信号已保存到槽位%d: %s\n", slot + 1, signals[slot].name);
     return slot + 1;  // 返回1开始的ID
 }
 
 bool IRStorage::deleteSignal(int id) {
+    WriterGuard guard(writer_lock);
     int index = id - 1;  // 转换为0开始的索引
     if (!isValidId(id)) {
         return false;
     }
     
+    beginWrite(index);
     signals[index].isValid = false;
+    releasePatterns(index);
+    unindexFingerprint(index);
+    unindexFeatures(index);
+    endWrite(index);
     signal_count--;
-    saveToEEPROM();
+    persist();
     
-    Serial.printf("[Storage] 已删除信号ID: %d\n", id);
+    if (!quiet) Serial.printf("[Storage] 已删除信号ID: %d\n", id);
     return true;
 }
 
 void IRStorage::clearAll() {
+    WriterGuard guard(writer_lock);
     for (int i = 0; i < MAX_SIGNALS; i++) {
+        beginWrite(i);
         signals[i].isValid = false;
+        pattern_refs[i].count = 0;
+        endWrite(i);
     }
+    patterns.clear();
+    for (int b = 0; b < FINGERPRINT_BUCKETS; b++) fingerprint_head[b] = -1;
+    feature_index.clear();
+    lsh_index.clear();
     signal_count = 0;
-    saveToEEPROM();
-    Serial.println("[Storage] 已清空所有信号");
+    persist();
+    if (!quiet) Serial.println("[Storage] 已清空所有信号");
 }
 
 IRSignal* IRStorage::getSignal(int id) {
@@ -150,6 +902,12 @@ bool IRStorage::isValidId(int id) {
     return (index >= 0 && index < MAX_SIGNALS && signals[index].isValid);
 }
 
+uint32_t IRStorage::getRevision(int id) const {
+    int index = id - 1;
+    if (index < 0 || index >= MAX_SIGNALS || !signals[index].isValid) return 0;
+    return revisions[index];
+}
+
 void IRStorage::listAllSignals() {
     Serial.printf("[Storage] 已存储信号列表 (%d/%d):\n", signal_count, MAX_SIGNALS);
     Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
@@ -160,16 +918,24 @@ void IRStorage::listAllSignals() {
     }
     
     for (int i = 0; i < MAX_SIGNALS; i++) {
-        if (signals[i].isValid) {
-            Serial.printf("  ID:%2d | %-15s | %s | 0x%08X | %2d位\n", 
+        if (!signals[i].isValid) continue;
+        if (signals[i].stateLength > 0) {
+            Serial.printf("  ID:%2d | %-15s | %s | 状态%d字节 | %2d位\n",
+                         i + 1, signals[i].name, protocolName(signals[i].protocol),
+                         signals[i].stateLength, signals[i].bits);
+        } else {
+            Serial.printf("  ID:%2d | %-15s | %s | 0x%08llX | %2d位\n", 
                          i + 1, 
                          signals[i].name,
-                         typeToString(signals[i].protocol, false).c_str(),
-                         (uint32_t)signals[i].value,
+                         protocolName(signals[i].protocol),
+                         (unsigned long long)signals[i].value,
                          signals[i].bits);
         }
     }
     Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
+    Serial.printf("  共享模式表: %d个脉冲对, %d个片段, %u字节, %d个信号引用\n",
+                  patterns.pairCount(), patterns.segmentCount(), (unsigned)patterns.serializedSize(),
+                  getSharedSignals());
 }
 
 void IRStorage::printSignalInfo(int id) {
@@ -181,10 +947,40 @@ void IRStorage::printSignalInfo(int id) {
     
     Serial.printf("[Storage] 信号ID %d 详细信息:\n", id);
     Serial.printf("  名称: %s\n", signal->name);
-    Serial.printf("  协议: %s\n", typeToString(signal->protocol, false).c_str());
-    Serial.printf("  数值: 0x%08X\n", (uint32_t)signal->value);
+    Serial.printf("  协议: %s\n", protocolName(signal->protocol));
+    if (signal->stateLength > 0) {
+        Serial.printf("  状态: %d字节 ", signal->stateLength);
+        for (int i = 0; i < signal->stateLength; i++) Serial.printf("%02X", signal->state[i]);
+        Serial.println();
+    } else {
+        Serial.printf("  数值: 0x%08llX\n", (unsigned long long)signal->value);
+    }
     Serial.printf("  位数: %d\n", signal->bits);
     Serial.printf("  原始长度: %d\n", signal->rawLength);
+    const PatternRefs& refs = pattern_refs[id - 1];
+    unsigned size = (unsigned)recordSize(*signal, refs.count);
+    if (signal->parametric) {
+        Serial.printf("  存储: 参数化记录 %u 字节(原始脉冲按描述符生成)\n", size);
+    } else if (signal->stateLength > 0) {
+        Serial.printf("  存储: 状态记录 %u 字节(波形由IRsend按状态生成)\n", size);
+    } else if (refs.count > 0) {
+        Serial.printf("  存储: 共享记录 %u 字节(引用%d个共享片段，原始脉冲需%u字节)\n", size, refs.count,
+                      (unsigned)((signal->rawLength + signal->repeatLength) * sizeof(uint16_t)));
+    }
+    if (signal->carrierFreq > 0) {
+        Serial.printf("  载波: %dkHz, 占空比: %d%%\n", signal->carrierFreq, signal->dutyCycle);
+    } else {
+        Serial.println("  载波: 未测量");
+    }
+    if (signal->repeatPeriod > 0) {
+        if (signal->repeatLength > 0) {
+            Serial.printf("  按住重复: 重复帧%d个脉冲, 周期%dms\n", signal->repeatLength, signal->repeatPeriod);
+        } else {
+            Serial.printf("  按住重复: 重复主帧, 周期%dms\n", signal->repeatPeriod);
+        }
+    } else {
+        Serial.println("  按住重复: 未学习");
+    }
     Serial.printf("  学习时间: %lu\n", signal->timestamp);
 }
 
@@ -206,16 +1002,64 @@ void IRStorage::printRawData(int id) {
 }
 
 bool IRStorage::setSignalName(int id, const char* name) {
+    WriterGuard guard(writer_lock);
     IRSignal* signal = getSignal(id);
     if (!signal || !name) {
         return false;
     }
     
+    // 名称变长后映像放不下时拒绝，不改变已保存的名称
+    size_t oldLength = strnlen(signal->name, 31);
+    size_t newLength = strnlen(name, 31);
+    if (newLength > oldLength && imageSize() + (newLength - oldLength) > backend->size()) {
+        if (!quiet) Serial.printf("[Storage] 存储容量不足，信号ID %d 名称未更新\n", id);
+        return false;
+    }
+    
+    beginWrite(id - 1);
     strncpy(signal->name, name, 31);
     signal->name[31] = '\0';
-    saveToEEPROM();
+    endWrite(id - 1);
+    persist();
     
-    Serial.printf("[Storage] 信号ID %d 名称已更新为: %s\n", id, name);
+    if (!quiet) Serial.printf("[Storage] 信号ID %d 名称已更新为: %s\n", id, name);
+    return true;
+}
+
+bool IRStorage::setParametric(int id, decode_type_t protocol, const ProtocolDescriptor& descriptor,
+                              uint64_t value, uint16_t bits) {
+    WriterGuard guard(writer_lock);
+    IRSignal* signal = getSignal(id);
+    if (!signal) {
+        return false;
+    }
+    
+    scratch_signal = *signal;
+    scratch_signal.parametric = true;
+    scratch_signal.stateLength = 0;
+    scratch_signal.descriptor = descriptor;
+    scratch_signal.protocol = protocol;
+    scratch_signal.value = value;
+    scratch_signal.bits = bits;
+    scratch_signal.carrierFreq = descriptor.freq;
+    scratch_signal.dutyCycle = descriptor.duty;
+    if (!regeneratePulses(scratch_signal)) {
+        return false;
+    }
+    // 不计释放的共享片段，保守估计改写后的映像大小
+    size_t needed = imageSize() - recordSize(*signal, pattern_refs[id - 1].count) + recordSize(scratch_signal, 0);
+    if (needed > backend->size()) {
+        return false;
+    }
+    
+    beginWrite(id - 1);
+    unindexFingerprint(id - 1);
+    *signal = scratch_signal;
+    releasePatterns(id - 1);
+    indexFingerprint(id - 1);
+    indexFeatures(id - 1);
+    endWrite(id - 1);
+    persist();
     return true;
 }
 
@@ -228,5 +1072,26 @@ int IRStorage::getFreeSlots() {
 }
 
 size_t IRStorage::getUsedMemory() {
-    return sizeof(IRSignal) * signal_count + 2;  // +2 for magic and count
+    return imageSize();
+}
+
+size_t IRStorage::imageSize() const {
+    size_t used = IMAGE_HEADER_SIZE + patterns.serializedSize();  // 魔数、记录数和共享模式表
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        if (signals[i].isValid) used += recordSize(signals[i], pattern_refs[i].count);
+    }
+    return used;
+}
+
+size_t IRStorage::getRecordSize(int id) {
+    IRSignal* signal = getSignal(id);
+    return signal ? recordSize(*signal, pattern_refs[id - 1].count) : 0;
+}
+
+int IRStorage::getSharedSignals() const {
+    int n = 0;
+    for (int i = 0; i < MAX_SIGNALS; i++) {
+        if (signals[i].isValid && pattern_refs[i].count > 0) n++;
+    }
+    return n;
 }
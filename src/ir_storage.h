@@ -1,51 +1,222 @@
 #ifndef IR_STORAGE_H
 #define IR_STORAGE_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
-#include <EEPROM.h>
+#else
+#include "ir_host.h"
+#endif
+#include <atomic>
 #include <IRremoteESP8266.h>
+#include "ir_latency.h"
+#include "ir_storage_backend.h"
+#include "ir_protocol_descriptor.h"
+#include "ir_pattern_table.h"
+#include "ir_feature_index.h"
+#include "ir_lsh_index.h"
+#include "ir_signal_match.h"
+
+static const uint16_t MAX_REPEAT_PULSES = 32;    // 重复帧最大脉冲数
 
 // 红外信号数据结构
 struct IRSignal {
     bool isValid;                  // 信号是否有效
     decode_type_t protocol;        // 协议类型
-    uint32_t value;               // 信号值
+    uint64_t value;               // 信号值(有状态协议为状态字节的指纹，见IRReceiver::getValue)
     uint16_t bits;                // 位数
     uint16_t rawLength;           // 原始数据长度
-    uint16_t rawData[256];        // 原始数据(最大256个数据点)
+    uint16_t rawData[256];        // 原始脉冲(微秒，mark/space交替，最大256个数据点)
+    uint16_t carrierFreq;         // 学习时测得的载波频率(kHz)，0表示未测量
+    uint8_t dutyCycle;            // 学习时测得的载波占空比(%)，0表示未测量
+    uint16_t repeatPeriod;        // 按住按键时的帧周期(ms，帧首到帧首)，0表示未学习到
+    uint16_t repeatLength;        // 重复帧长度，0且repeatPeriod>0表示重复发送主帧
+    uint16_t repeatData[MAX_REPEAT_PULSES];      // 重复帧原始脉冲(如NEC重复码)
     char name[32];                // 信号名称
     unsigned long timestamp;       // 学习时间戳
+    bool parametric;              // 参数化记录：原始脉冲和重复帧由descriptor生成，存储中只保存描述符
+    ProtocolDescriptor descriptor;
+    uint16_t stateLength;         // 有状态协议(空调等)的状态字节数，0表示按value发射
+    uint8_t state[kStateSizeMax]; // 状态字节，发射时由IRsend::send(协议, 状态, 字节数)生成波形，不保存原始脉冲
+};
+
+// 闪存提交统计
+struct StorageCommitStats {
+    uint32_t changes;             // 增删改次数
+    uint32_t commits;             // 实际提交(擦写)次数，延迟写入时多次修改合并为一次
+    uint32_t lastUs;              // 最近一次提交耗时
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+// 新增信号与已有信号重复(指纹相同且内容一致)时的处理
+enum DuplicatePolicy {
+    DUPLICATE_KEEP,               // 照常新增
+    DUPLICATE_REJECT,             // 不新增，addSignal返回-1
+    DUPLICATE_MERGE               // 合并到已有信号(补充载波和按住重复信息)，addSignal返回其ID
+};
+
+// 最近一次addSignal的结果
+enum AddStatus {
+    ADD_STORED,
+    ADD_MERGED,
+    ADD_REJECTED,
+    ADD_FULL
+};
+
+const char* duplicatePolicyName(DuplicatePolicy policy);
+const char* addStatusName(AddStatus status);
+
+// 整库去重找到的一对重复信号，保留ID较小的一个
+struct DuplicatePair {
+    int keepId;
+    int duplicateId;
 };
 
 // 红外信号存储管理类
+// 并发：写操作(增删改、批量写入、提交)由一把写者锁串行化；发射、匹配等读路径用snapshot无锁复制，
+// 每个槽位有一个序号(seqlock)，写入期间为奇数，读者复制前后序号不一致时重试，不会等待闪存提交
 class IRStorage {
 private:
     static const int MAX_SIGNALS = 20;      // 最大存储信号数量
     static const int EEPROM_SIZE = 4096;    // EEPROM大小
-    static const int MAGIC_NUMBER = 0xAB;   // 魔数，用于验证数据有效性
+    static const int MAGIC_NUMBER = 0xB1;   // 魔数，用于验证数据有效性(结构变化时递增)
+    static const int LEGACY_MAGIC = 0xB0;   // 没有共享模式表的旧格式，仍可加载
+    // 每个信号最多引用的片段数：原始脉冲和重复帧分别切分
+    static const int MAX_PATTERN_REFS = (256 / 2 + MAX_REPEAT_PULSES / 2) / PatternTable::SEGMENT_PAIRS;
+    
+    // 信号在共享模式表中的片段下标，count为0表示按原始脉冲保存(表已满或不适用)
+    struct PatternRefs {
+        uint8_t count;
+        uint8_t refs[MAX_PATTERN_REFS];
+    };
     
     IRSignal signals[MAX_SIGNALS];
     int signal_count;
+    StorageBackend* backend;      // 持久化存储，默认使用EEPROM
+    bool quiet;                   // 静默模式：不输出加载/保存日志(基准测试用)
+    int batch_depth;              // 批量写入嵌套层数，大于0时推迟保存
+    bool batch_dirty;             // 批量写入期间是否有修改
+    uint32_t revisions[MAX_SIGNALS];   // 每个槽位的内容修订号，0表示空
+    uint32_t next_revision;
+    std::atomic<uint32_t> sequences[MAX_SIGNALS];   // 槽位序号，奇数表示正在写入
+    mutable std::atomic<uint32_t> snapshot_retries;
+    uint32_t debounce_ms;         // 延迟写入：最后一次修改后空闲这么久才提交，0表示立即保存
+    uint32_t max_delay_ms;        // 延迟写入：首次修改后最多推迟这么久，忙碌时也提交
+    bool dirty;                   // 有未提交到闪存的修改
+    unsigned long first_change_ms;
+    unsigned long last_change_ms;
+    uint32_t pending_changes;     // 未提交的修改次数
+    StorageCommitStats commit_stats;
+    PatternTable patterns;        // 整库共享的脉冲模式，只由写者访问，读者看到的仍是展开后的rawData
+    PatternRefs pattern_refs[MAX_SIGNALS];
+    // 指纹索引：按指纹分桶的槽位链表，插入和查重只看同一个桶
+    static const int FINGERPRINT_BUCKETS = 32;
+    uint32_t fingerprints[MAX_SIGNALS];
+    int8_t fingerprint_head[FINGERPRINT_BUCKETS];
+    int8_t fingerprint_next[MAX_SIGNALS];
+    // 特征索引：插入时计算特征向量，匹配接收帧时只对少量候选逐脉冲比较
+    SignalFeatures features[MAX_SIGNALS];
+    FeatureIndex::Entry feature_entries[MAX_SIGNALS];
+    FeatureIndex feature_index;
+    // LSH索引：没有信号达到匹配相似度时，按量化脉冲找出最接近的信号
+    static const int LSH_BUCKETS = 16;
+    int32_t lsh_heads[LSH_DEFAULT_TABLES * LSH_BUCKETS];
+    LshIndex::Slot lsh_slots[MAX_SIGNALS * LSH_DEFAULT_TABLES];
+    LshIndex lsh_index;
+    DuplicatePolicy duplicate_policy;
+    AddStatus last_add_status;
+    int last_duplicate_id;
     
+    void beginWrite(int index);   // 修改槽位前调用，序号变为奇数(已在写入中时不变)
+    void endWrite(int index);     // 修改完成：分配新的修订号，序号恢复为偶数
     void loadFromEEPROM();
     void saveToEEPROM();
+    void persist();               // 批量写入期间只做标记，延迟写入时只记录修改时间，否则立即保存
     int findEmptySlot();
+    size_t imageSize() const;     // 按当前内容序列化后的存储映像大小(与saveToEEPROM写入的一致)
+    void acquirePatterns(int index);   // 写入新脉冲后引用共享片段，失败时按原始脉冲保存
+    void releasePatterns(int index);
+    void indexFingerprint(int index);   // 按当前内容计算指纹并加入索引
+    void unindexFingerprint(int index);
+    void indexFeatures(int index);      // 按当前原始脉冲计算特征，加入特征索引和LSH索引
+    void unindexFeatures(int index);
+    bool sameContent(int index, decode_type_t protocol, uint64_t value, uint16_t bits,
+                     const uint16_t* rawData, uint16_t rawLength,
+                     const uint8_t* state, uint16_t stateLength) const;
+    void mergeInto(int index, uint16_t carrierFreq, uint8_t dutyCycle,
+                   const uint16_t* repeatData, uint16_t repeatLength, uint16_t repeatPeriod);
     
 public:
-    IRStorage();
+    IRStorage(StorageBackend* backend = nullptr);
     
     bool begin();
+    void setQuiet(bool enable);
+    
+    // 批量写入：beginBatch与endBatch之间的增删改只在endBatch时保存一次
+    void beginBatch();
+    void endBatch();
+    // 放弃批量写入期间的全部修改，从存储重新加载
+    void abortBatch();
+    
+    // 延迟写入：增删改只修改内存并标记，由service在空闲时或超过最长推迟时间后提交，
+    // 连续多次修改合并为一次擦写。debounceMs为0时恢复为每次修改立即保存
+    void setWriteBehind(uint32_t debounceMs, uint32_t maxDelayMs);
+    // 周期调用：idle表示设备空闲(不在学习、发射或导入)，返回是否进行了提交
+    bool service(bool idle);
+    // 立即提交未保存的修改(sync命令、关机前)，批量写入期间不提交，返回是否进行了提交
+    bool flush();
+    bool isDirty() const { return dirty; }
+    uint32_t getPendingChanges() const { return pending_changes; }
+    unsigned long getDirtyAgeMs() const;   // 最早一次未提交修改至今的时间，没有时为0
+    const StorageCommitStats& getCommitStats() const { return commit_stats; }
+    void resetCommitStats();
     
     // 信号管理
-    int addSignal(decode_type_t protocol, uint32_t value, uint16_t bits, 
-                  uint16_t* rawData, uint16_t rawLength, const char* name = nullptr);
+    // state非空时为有状态协议，只保存状态字节，忽略原始脉冲和重复帧
+    int addSignal(decode_type_t protocol, uint64_t value, uint16_t bits, 
+                  uint16_t* rawData, uint16_t rawLength, const char* name = nullptr,
+                  uint16_t carrierFreq = 0, uint8_t dutyCycle = 0,
+                  const uint16_t* repeatData = nullptr, uint16_t repeatLength = 0,
+                  uint16_t repeatPeriod = 0,
+                  const uint8_t* state = nullptr, uint16_t stateLength = 0);
     bool deleteSignal(int id);
     void clearAll();
     
+    // 查重：默认照常新增，学习等场景设置为拒绝或合并
+    void setDuplicatePolicy(DuplicatePolicy policy) { duplicate_policy = policy; }
+    DuplicatePolicy getDuplicatePolicy() const { return duplicate_policy; }
+    AddStatus getLastAddStatus() const { return last_add_status; }
+    int getLastDuplicateId() const { return last_duplicate_id; }   // 最近一次被拒绝或合并时的已有信号ID
+    // 查找与给定内容重复的已有信号，只检查指纹相同的槽位，没有时返回-1
+    int findDuplicate(decode_type_t protocol, uint64_t value, uint16_t bits,
+                      const uint16_t* rawData, uint16_t rawLength,
+                      const uint8_t* state = nullptr, uint16_t stateLength = 0) const;
+    // 整库去重：按指纹排序后只比较相邻的同指纹信号，返回找到的重复对数(最多capacity个)
+    int findDuplicates(DuplicatePair* out, int capacity) const;
+    // 把duplicateId合并到keepId后删除duplicateId
+    bool mergeDuplicate(int keepId, int duplicateId);
+    uint32_t getFingerprint(int id) const;   // 无效ID返回0
+    
+    // 按原始脉冲在库中查找最相似的信号：先用特征索引筛选候选，再逐脉冲比较
+    // 返回达到kDefaultPulseMatch相似度的信号ID，没有时返回-1；只能在执行写操作的任务中使用
+    int matchPulses(const uint16_t* pulses, uint16_t length, uint8_t* similarity = nullptr,
+                    int* compared = nullptr) const;
+    // 查找最接近的信号(不要求达到匹配相似度)：LSH索引筛出候选后逐脉冲比较
+    // confidence输出0~100的置信度(见LshIndex::confidence)，没有候选时返回-1；只能在执行写操作的任务中使用
+    int nearestSignal(const uint16_t* pulses, uint16_t length, uint8_t* confidence = nullptr,
+                      int* compared = nullptr) const;
+    const SignalFeatures* getFeatures(int id) const;   // 无效ID返回nullptr
+    
     // 信号查询
+    // getSignal直接指向存储内部，只能在执行写操作的任务(主循环)中使用
     IRSignal* getSignal(int id);
+    // 无锁复制信号快照，可在任意任务中调用；revision输出与快照一致的修订号。无效ID返回false
+    bool snapshot(int id, IRSignal& out, uint32_t* revision = nullptr) const;
+    uint32_t getSnapshotRetries() const { return snapshot_retries.load(std::memory_order_relaxed); }
     int getSignalCount();
     bool isValidId(int id);
+    // 信号内容修订号：增删改、清空和重新加载后都会变化，无效ID返回0
+    uint32_t getRevision(int id) const;
     
     // 信号操作
     void listAllSignals();
@@ -55,10 +226,22 @@ public:
     // 设置信号名称
     bool setSignalName(int id, const char* name);
     
+    // 改写为参数化记录：按描述符重新生成原始脉冲和重复帧，存储中只保存描述符和值
+    bool setParametric(int id, decode_type_t protocol, const ProtocolDescriptor& descriptor,
+                       uint64_t value, uint16_t bits);
+    
     // 统计信息
+    int getCapacity() const { return MAX_SIGNALS; }
     int getUsedSlots();
     int getFreeSlots();
     size_t getUsedMemory();
+    size_t getRecordSize(int id);   // 信号在存储中占用的字节数，无效ID返回0
+    int getPatternPairs() const { return patterns.pairCount(); }
+    int getPatternSegments() const { return patterns.segmentCount(); }
+    size_t getPatternTableSize() const { return patterns.serializedSize(); }
+    int getSharedSignals() const;   // 按共享片段保存的信号数
+    
+    friend class BenchSuite;
 };
 
 #endif
@@ -0,0 +1,144 @@
+#include "ir_storage_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============== EEPROMBackend 实现 ==============
+
+#ifdef ARDUINO
+#include <EEPROM.h>
+
+EEPROMBackend::EEPROMBackend() : capacity(0) {
+}
+
+bool EEPROMBackend::begin(size_t size) {
+    if (!EEPROM.begin(size)) {
+        return false;
+    }
+    capacity = size;
+    return true;
+}
+
+size_t EEPROMBackend::size() const {
+    return capacity;
+}
+
+uint8_t EEPROMBackend::read(int addr) {
+    return EEPROM.read(addr);
+}
+
+void EEPROMBackend::write(int addr, uint8_t value) {
+    EEPROM.write(addr, value);
+}
+
+bool EEPROMBackend::readBytes(int addr, void* data, size_t length) {
+    if (addr < 0 || (size_t)addr + length > capacity) return false;
+    return EEPROM.readBytes(addr, data, length) == length;
+}
+
+bool EEPROMBackend::writeBytes(int addr, const void* data, size_t length) {
+    if (addr < 0 || (size_t)addr + length > capacity) return false;
+    return EEPROM.writeBytes(addr, data, length) == length;
+}
+
+bool EEPROMBackend::commit() {
+    return EEPROM.commit();
+}
+#else
+// 主机端(native)没有EEPROM：以进程内的RamStorageBackend代替，内容不跨进程保留
+static RamStorageBackend hostEeprom;
+
+EEPROMBackend::EEPROMBackend() : capacity(0) {
+}
+
+bool EEPROMBackend::begin(size_t size) {
+    if (!hostEeprom.begin(size)) {
+        return false;
+    }
+    capacity = size;
+    return true;
+}
+
+size_t EEPROMBackend::size() const {
+    return capacity;
+}
+
+uint8_t EEPROMBackend::read(int addr) {
+    return hostEeprom.read(addr);
+}
+
+void EEPROMBackend::write(int addr, uint8_t value) {
+    hostEeprom.write(addr, value);
+}
+
+bool EEPROMBackend::readBytes(int addr, void* data, size_t length) {
+    if (addr < 0 || (size_t)addr + length > capacity) return false;
+    return hostEeprom.readBytes(addr, data, length);
+}
+
+bool EEPROMBackend::writeBytes(int addr, const void* data, size_t length) {
+    if (addr < 0 || (size_t)addr + length > capacity) return false;
+    return hostEeprom.writeBytes(addr, data, length);
+}
+
+bool EEPROMBackend::commit() {
+    return hostEeprom.commit();
+}
+#endif
+
+// ============== RamStorageBackend 实现 ==============
+
+RamStorageBackend::RamStorageBackend()
+    : buffer(nullptr), capacity(0), bytes_written(0), commit_count(0) {
+}
+
+RamStorageBackend::~RamStorageBackend() {
+    free(buffer);
+}
+
+bool RamStorageBackend::begin(size_t size) {
+    if (buffer && capacity == size) return true;
+
+    free(buffer);
+    buffer = (uint8_t*)malloc(size);
+    if (!buffer) {
+        capacity = 0;
+        return false;
+    }
+    // 与擦除后的闪存一致，初始全为0xFF
+    memset(buffer, 0xFF, size);
+    capacity = size;
+    return true;
+}
+
+size_t RamStorageBackend::size() const {
+    return capacity;
+}
+
+uint8_t RamStorageBackend::read(int addr) {
+    if (!buffer || addr < 0 || (size_t)addr >= capacity) return 0;
+    return buffer[addr];
+}
+
+void RamStorageBackend::write(int addr, uint8_t value) {
+    if (!buffer || addr < 0 || (size_t)addr >= capacity) return;
+    buffer[addr] = value;
+    bytes_written++;
+}
+
+bool RamStorageBackend::readBytes(int addr, void* data, size_t length) {
+    if (!buffer || addr < 0 || (size_t)addr + length > capacity) return false;
+    memcpy(data, buffer + addr, length);
+    return true;
+}
+
+bool RamStorageBackend::writeBytes(int addr, const void* data, size_t length) {
+    if (!buffer || addr < 0 || (size_t)addr + length > capacity) return false;
+    memcpy(buffer + addr, data, length);
+    bytes_written += length;
+    return true;
+}
+
+bool RamStorageBackend::commit() {
+    commit_count++;
+    return buffer != nullptr;
+}
@@ -0,0 +1,66 @@
+#ifndef IR_STORAGE_BACKEND_H
+#define IR_STORAGE_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 字节寻址的持久化存储接口，IRStorage通过它读写，便于替换为模拟存储
+class StorageBackend {
+public:
+    virtual ~StorageBackend() {}
+
+    virtual bool begin(size_t size) = 0;
+    virtual size_t size() const = 0;
+
+    virtual uint8_t read(int addr) = 0;
+    virtual void write(int addr, uint8_t value) = 0;
+
+    // 越界时不读写并返回false
+    virtual bool readBytes(int addr, void* data, size_t length) = 0;
+    virtual bool writeBytes(int addr, const void* data, size_t length) = 0;
+
+    virtual bool commit() = 0;
+};
+
+// 基于Arduino EEPROM(闪存模拟)的存储，主机端构建以进程内存代替
+class EEPROMBackend : public StorageBackend {
+private:
+    size_t capacity;
+
+public:
+    EEPROMBackend();
+
+    bool begin(size_t size) override;
+    size_t size() const override;
+    uint8_t read(int addr) override;
+    void write(int addr, uint8_t value) override;
+    bool readBytes(int addr, void* data, size_t length) override;
+    bool writeBytes(int addr, const void* data, size_t length) override;
+    bool commit() override;
+};
+
+// 纯内存存储，模拟闪存：记录写入字节数和提交次数，用于基准测试
+class RamStorageBackend : public StorageBackend {
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    uint32_t bytes_written;
+    uint32_t commit_count;
+
+public:
+    RamStorageBackend();
+    ~RamStorageBackend();
+
+    bool begin(size_t size) override;
+    size_t size() const override;
+    uint8_t read(int addr) override;
+    void write(int addr, uint8_t value) override;
+    bool readBytes(int addr, void* data, size_t length) override;
+    bool writeBytes(int addr, const void* data, size_t length) override;
+    bool commit() override;
+
+    uint32_t getBytesWritten() const { return bytes_written; }
+    uint32_t getCommitCount() const { return commit_count; }
+};
+
+#endif
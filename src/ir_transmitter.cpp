@@ -1,8 +1,11 @@
 #include "ir_transmitter.h"
+#include "ir_protocol_decoder.h"
+#include <new>
 
 // ============== RMTTransmitter 实现 ==============
 
-RMTTransmitter::RMTTransmitter(uint8_t pin, rmt_channel_t ch) : pin(pin), channel(ch), initialized(false) {
+RMTTransmitter::RMTTransmitter(uint8_t pin, rmt_channel_t ch)
+    : pin(pin), channel(ch), initialized(false), looping(false), current_freq(38), current_duty(33), verbose(false) {
 }
 
 RMTTransmitter::~RMTTransmitter() {
@@ -11,11 +14,6 @@ RMTTransmitter::~RMTTransmitter() {
     }
 }
 
-uint32_t RMTTransmitter::usToTicks(uint32_t us) {
-    // ESP32 RMT时钟分频器设置为80 (80MHz / 80 = 1MHz, 1tick = 1us)
-    return us;
-}
-
 bool RMTTransmitter::begin() {
     if (initialized) return true;
     
@@ -49,118 +47,141 @@ bool RMTTransmitter::begin() {
         return false;
     }
     
+    current_freq = 38;
+    current_duty = 33;
     initialized = true;
     Serial.printf("[RMT] 初始化成功，通道: %d, 引脚: GPIO%d\n", channel, pin);
     return true;
 }
 
-bool RMTTransmitter::sendRawData(uint16_t* rawData, uint16_t length, uint16_t freq) {
-    if (!initialized || !rawData || length == 0) {
+bool RMTTransmitter::configureCarrier(uint16_t freq, uint8_t duty) {
+    if (freq == current_freq && duty == current_duty) {
+        return true;
+    }
+    
+    rmt_config_t config = {
+        .rmt_mode = RMT_MODE_TX,
+        .channel = channel,
+        .gpio_num = (gpio_num_t)pin,
+        .clk_div = 80,
+        .mem_block_num = 2,
+        .flags = 0,
+        .tx_config = {
+            .carrier_freq_hz = static_cast<uint32_t>(freq) * 1000U,
+            .carrier_level = RMT_CARRIER_LEVEL_HIGH,
+            .idle_level = RMT_IDLE_LEVEL_LOW,
+            .carrier_duty_percent = duty,
+            .carrier_en = true,
+            .loop_en = false,
+            .idle_output_en = true
+        }
+    };
+    
+    esp_err_t ret = rmt_config(&config);
+    if (ret != ESP_OK) {
+        Serial.printf("[RMT] 载波配置失败: %s\n", esp_err_to_name(ret));
+        return false;
+    }
+    
+    current_freq = freq;
+    current_duty = duty;
+    return true;
+}
+
+void RMTTransmitter::attachPin() {
+    rmt_set_gpio(channel, RMT_MODE_TX, (gpio_num_t)pin, false);
+}
+
+bool RMTTransmitter::sendItems(const rmt_item32_t* items, size_t count, uint16_t freq, uint8_t duty) {
+    if (!initialized || !items || count == 0) {
         return false;
     }
+    if (looping) {
+        Serial.println("[RMT] ⚠️ 循环发射进行中，忽略本次发射");
+        return false;
+    }
+    
+    // 根据序列总时长计算等待超时，额外留出100ms余量
+    uint32_t totalUs = 0;
+    for (size_t i = 0; i < count; i++) {
+        totalUs += items[i].duration0 + items[i].duration1;
+    }
+    TickType_t timeout = (totalUs / 1000 + 100) / portTICK_PERIOD_MS;
     
-    Serial.printf("[RMT] 🚀 准备发射，原始长度: %d, 频率: %dkHz\n", length, freq);
+    configureCarrier(freq, duty);
+    attachPin();
     
-    // 动态分配RMT数据项，避免栈溢出
-    rmt_item32_t* rmt_items = (rmt_item32_t*)malloc(sizeof(rmt_item32_t) * (length / 2 + 2));
-    if (!rmt_items) {
-        Serial.println("[RMT] ❌ 内存分配失败");
+    uint32_t start = LatencyStats::now();
+    esp_err_t ret = rmt_write_items(channel, items, count, false);
+    LatencyStats::record(STAGE_RMT_WRITE, start);
+    if (ret != ESP_OK) {
+        Serial.printf("[RMT] ❌ 发射失败: %s\n", esp_err_to_name(ret));
         return false;
     }
     
-    size_t rmt_size = 0;
+    start = LatencyStats::now();
+    ret = rmt_wait_tx_done(channel, timeout);
+    LatencyStats::record(STAGE_RMT_WAIT, start);
+    if (ret != ESP_OK) {
+        Serial.printf("[RMT] ⚠️ 发射等待超时: %s\n", esp_err_to_name(ret));
+        return false;
+    }
     
-    // 转换原始数据为RMT格式 (配对处理：高电平+低电平)
-    for (int i = 0; i < length - 1; i += 2) {
-        if (rmt_size >= (length / 2 + 1)) break;
-        
-        uint32_t high_time = usToTicks(rawData[i]);
-        uint32_t low_time = usToTicks(rawData[i + 1]);
-        
-        // RMT限制：每个duration最大32767 ticks
-        if (high_time > 32767) high_time = 32767;
-        if (low_time > 32767) low_time = 32767;
-        
-        // 确保最小时间值，避免过短的脉冲
-        if (high_time == 0) high_time = 1;
-        if (low_time == 0) low_time = 1;
-        
-        // ✨ 改进：VS1838B兼容性调整
-        // VS1838B对时序比较敏感，适当延长短脉冲
-        if (high_time < 50) high_time = (uint32_t)(high_time * 1.2);  
-        if (low_time < 50) low_time = (uint32_t)(low_time * 1.2);
-        
-        // 对于非常短的脉冲，设置最小值
-        if (high_time < 10) high_time = 10;
-        if (low_time < 10) low_time = 10;
-        
-        rmt_items[rmt_size].level0 = 1;
-        rmt_items[rmt_size].duration0 = high_time;
-        rmt_items[rmt_size].level1 = 0;
-        rmt_items[rmt_size].duration1 = low_time;
-        rmt_size++;
-    }
-    
-    // 如果有奇数个元素，处理最后一个
-    if (length % 2 == 1) {
-        uint32_t final_time = usToTicks(rawData[length - 1]);
-        if (final_time > 32767) final_time = 32767;
-        if (final_time == 0) final_time = 1;
-        
-        rmt_items[rmt_size].level0 = 1;
-        rmt_items[rmt_size].duration0 = final_time;
-        rmt_items[rmt_size].level1 = 0;
-        rmt_items[rmt_size].duration1 = 0;  // 结束标记
-        rmt_size++;
-    }
-    
-    // ✨ 新增：添加强化结束信号
-    rmt_items[rmt_size].level0 = 0;
-    rmt_items[rmt_size].duration0 = 1000;  // 1ms低电平确保信号结束
-    rmt_items[rmt_size].level1 = 0;
-    rmt_items[rmt_size].duration1 = 0;
-    rmt_size++;
-    
-    Serial.printf("[RMT] 📊 转换完成: %d项RMT数据\n", rmt_size);
-    
-    // 设置载波频率
-    if (freq != 38) {
-        rmt_config_t config = {
-            .rmt_mode = RMT_MODE_TX,
-            .channel = channel,
-            .gpio_num = (gpio_num_t)pin,
-            .clk_div = 80,
-            .mem_block_num = 2,
-            .flags = 0,
-            .tx_config = {
-                .carrier_freq_hz = static_cast<uint32_t>(freq) * 1000U,
-                .carrier_level = RMT_CARRIER_LEVEL_HIGH,
-                .idle_level = RMT_IDLE_LEVEL_LOW,
-                .carrier_duty_percent = 33,
-                .carrier_en = true,
-                .loop_en = false,
-                .idle_output_en = true
-            }
-        };
-        rmt_config(&config);
+    return true;
+}
+
+size_t RMTTransmitter::convertRawData(const uint16_t* rawData, uint16_t length,
+                                     rmt_item32_t* items, size_t capacity) {
+    return convertRawPulses(rawData, length, items, capacity);
+}
+
+bool RMTTransmitter::sendRawData(uint16_t* rawData, uint16_t length, uint16_t freq, uint8_t duty) {
+    if (!initialized || !rawData || length == 0) {
+        return false;
+    }
+    if (looping) {
+        Serial.println("[RMT] ⚠️ 循环发射进行中，忽略本次发射");
+        return false;
     }
     
-    Serial.printf("[RMT] 发射信号，数据长度: %d -> %d项, 频率: %dkHz\n", length, rmt_size, freq);
+    if (verbose) Serial.printf("[RMT] 🚀 准备发射，原始长度: %d, 频率: %dkHz, 占空比: %d%%\n", length, freq, duty);
+    
+    // 使用固定的转换缓冲(对象成员)，避免栈溢出，也不在每次发射时分配堆内存
+    rmt_item32_t* rmt_items = raw_items;
+    uint32_t convertStart = LatencyStats::now();
+    size_t rmt_size = convertRawData(rawData, length, rmt_items, MAX_RAW_ITEMS);
+    LatencyStats::record(STAGE_RMT_CONVERT, convertStart);
+    if (rmt_size == 0) {
+        Serial.printf("[RMT] ❌ 原始长度%d超出转换缓冲(%d项)\n", length, MAX_RAW_ITEMS);
+        return false;
+    }
+    
+    if (verbose) Serial.printf("[RMT] 📊 转换完成: %d项RMT数据\n", rmt_size);
+    
+    // 设置载波频率和占空比
+    configureCarrier(freq, duty);
+    attachPin();
+    
+    if (verbose) Serial.printf("[RMT] 发射信号，数据长度: %d -> %d项, 频率: %dkHz\n", length, rmt_size, freq);
     
     // ✨ 新增：多重发射增强稳定性
     bool success = false;
     for (int attempt = 1; attempt <= 2; attempt++) {
-        Serial.printf("[RMT] 📡 第 %d/2 次发射尝试\n", attempt);
+        if (verbose) Serial.printf("[RMT] 📡 第 %d/2 次发射尝试\n", attempt);
         
-        // 发射数据
-        esp_err_t ret = rmt_write_items(channel, rmt_items, rmt_size, true);
+        // 发射数据(不在写入时阻塞，写入和等待分别计时)
+        uint32_t start = LatencyStats::now();
+        esp_err_t ret = rmt_write_items(channel, rmt_items, rmt_size, false);
+        LatencyStats::record(STAGE_RMT_WRITE, start);
         
         if (ret == ESP_OK) {
             // 等待发射完成
+            start = LatencyStats::now();
             ret = rmt_wait_tx_done(channel, 1000 / portTICK_PERIOD_MS);  // 1秒超时
+            LatencyStats::record(STAGE_RMT_WAIT, start);
             
             if (ret == ESP_OK) {
-                Serial.printf("[RMT] ✅ 第 %d 次发射成功\n", attempt);
+                if (verbose) Serial.printf("[RMT] ✅ 第 %d 次发射成功\n", attempt);
                 success = true;
                 break;
             } else {
@@ -176,10 +197,8 @@ bool RMTTransmitter::sendRawData(uint16_t* rawData, uint16_t length, uint16_t fr
         }
     }
     
-    free(rmt_items);
-    
     if (success) {
-        Serial.println("[RMT] ✅ 发射完成");
+        if (verbose) Serial.println("[RMT] ✅ 发射完成");
         return true;
     } else {
         Serial.println("[RMT] ❌ 所有发射尝试均失败");
@@ -187,6 +206,39 @@ bool RMTTransmitter::sendRawData(uint16_t* rawData, uint16_t length, uint16_t fr
     }
 }
 
+bool RMTTransmitter::startLoop(const rmt_item32_t* items, size_t count, uint16_t freq, uint8_t duty) {
+    if (!initialized || !items || count == 0 || looping) {
+        return false;
+    }
+    if (count > MAX_LOOP_ITEMS) {
+        Serial.printf("[RMT] ❌ 循环序列%d项超出通道RAM(%d项)\n", count, MAX_LOOP_ITEMS);
+        return false;
+    }
+    
+    configureCarrier(freq, duty);
+    attachPin();
+    
+    rmt_set_tx_loop_mode(channel, true);
+    esp_err_t ret = rmt_write_items(channel, items, count, false);
+    if (ret != ESP_OK) {
+        rmt_set_tx_loop_mode(channel, false);
+        Serial.printf("[RMT] ❌ 循环发射启动失败: %s\n", esp_err_to_name(ret));
+        return false;
+    }
+    looping = true;
+    return true;
+}
+
+void RMTTransmitter::stopLoop() {
+    if (!looping) return;
+    rmt_set_tx_loop_mode(channel, false);
+    looping = false;
+}
+
+bool RMTTransmitter::isLooping() const {
+    return looping;
+}
+
 void RMTTransmitter::end() {
     if (initialized) {
         rmt_driver_uninstall(channel);
@@ -195,22 +247,78 @@ void RMTTransmitter::end() {
     }
 }
 
+// ============== RmtItemCache 实现 ==============
+
+RmtItemCache::RmtItemCache() : hits(0), builds(0) {
+    clear();
+}
+
+const rmt_item32_t* RmtItemCache::prepare(int id, uint32_t revision, const uint16_t* rawData,
+                                          uint16_t rawLength, size_t& count) {
+    count = 0;
+    if (id < 1 || id > MAX_ENTRIES || revision == 0 || !rawData || rawLength == 0) {
+        return nullptr;
+    }
+    
+    Entry& entry = entries[id - 1];
+    if (entry.revision != revision) {
+        uint32_t start = LatencyStats::now();
+        size_t converted = RMTTransmitter::convertRawData(rawData, rawLength, entry.items,
+                                                          RMTTransmitter::MAX_RAW_ITEMS);
+        LatencyStats::record(STAGE_RMT_CONVERT, start);
+        if (converted == 0) {
+            entry.revision = 0;
+            return nullptr;
+        }
+        entry.revision = revision;
+        entry.count = (uint16_t)converted;
+        builds++;
+    } else {
+        hits++;
+    }
+    
+    count = entry.count;
+    return entry.items;
+}
+
+void RmtItemCache::invalidate(int id) {
+    if (id >= 1 && id <= MAX_ENTRIES) {
+        entries[id - 1].revision = 0;
+    }
+}
+
+void RmtItemCache::clear() {
+    for (int i = 0; i < MAX_ENTRIES; i++) {
+        entries[i].revision = 0;
+        entries[i].count = 0;
+    }
+}
+
+int RmtItemCache::preparedCount() const {
+    int count = 0;
+    for (int i = 0; i < MAX_ENTRIES; i++) {
+        if (entries[i].revision != 0) count++;
+    }
+    return count;
+}
+
 // ============== IRTransmitter 实现 ==============
 
 IRTransmitter::IRTransmitter(uint8_t pin) {
     send_pin = pin;
-    irsend = new IRsend(pin);
-    rmt_transmitter = new RMTTransmitter(pin, RMT_CHANNEL_0);
+    irsend = new (irsend_storage) IRsend(pin);
+    rmt_transmitter = new (rmt_storage) RMTTransmitter(pin, RMT_CHANNEL_0);
     is_sending = false;
     use_rmt_for_raw = true;  // 默认启用RMT用于原始数据发射
+    verbose = false;
 }
 
 IRTransmitter::~IRTransmitter() {
     if (irsend) {
-        delete irsend;
+        irsend->~IRsend();
     }
     if (rmt_transmitter) {
-        delete rmt_transmitter;
+        rmt_transmitter->~RMTTransmitter();
     }
 }
 
@@ -238,60 +346,81 @@ bool IRTransmitter::begin() {
     return true;
 }
 
-bool IRTransmitter::sendNEC(uint32_t data, uint16_t bits, uint16_t repeat) {
+bool IRTransmitter::sendNEC(uint32_t data, uint16_t bits, uint16_t repeat,
+                            uint16_t carrierFreq, uint8_t dutyCycle) {
     if (!irsend) return false;
     
     is_sending = true;
-    Serial.printf("[IR_TX] 发射NEC信号: 0x%08X, %d位", data, bits);
-    if (repeat > 0) Serial.printf(", 重复%d次", repeat);
-    Serial.println();
+    if (verbose) {
+        Serial.printf("[IR_TX] 发射NEC信号: 0x%08X, %d位", data, bits);
+        if (repeat > 0) Serial.printf(", 重复%d次", repeat);
+        Serial.println();
+    }
     
-    irsend->sendNEC(data, bits, repeat);
+    // 优先使用RMT硬件编码发射，发射期间CPU不被占用
+    if (!sendEncoded(kNecDescriptor, data, bits, repeat, carrierFreq, dutyCycle)) {
+        irsend->begin();
+        irsend->sendNEC(data, bits, repeat);
+    }
     
     is_sending = false;
     return true;
 }
 
-bool IRTransmitter::sendSony(uint32_t data, uint16_t bits, uint16_t repeat) {
+bool IRTransmitter::sendSony(uint32_t data, uint16_t bits, uint16_t repeat,
+                            uint16_t carrierFreq, uint8_t dutyCycle) {
     if (!irsend) return false;
     
     is_sending = true;
-    Serial.printf("[IR_TX] 发射Sony信号: 0x%08X, %d位", data, bits);
-    if (repeat > 0) Serial.printf(", 重复%d次", repeat);
-    Serial.println();
+    if (verbose) {
+        Serial.printf("[IR_TX] 发射Sony信号: 0x%08X, %d位", data, bits);
+        if (repeat > 0) Serial.printf(", 重复%d次", repeat);
+        Serial.println();
+    }
     
-    irsend->sendSony(data, bits, repeat);
+    // 优先使用RMT硬件编码发射，发射期间CPU不被占用
+    if (!sendEncoded(kSonyDescriptor, data, bits, repeat, carrierFreq, dutyCycle)) {
+        irsend->begin();
+        irsend->sendSony(data, bits, repeat);
+    }
     
     is_sending = false;
     return true;
 }
 
-bool IRTransmitter::sendRC5(uint32_t data, uint16_t bits, uint16_t repeat) {
+bool IRTransmitter::sendRC5(uint32_t data, uint16_t bits, uint16_t repeat,
+                            uint16_t carrierFreq, uint8_t dutyCycle) {
     if (!irsend) return false;
     
     is_sending = true;
-    Serial.printf("[IR_TX] 发射RC5信号: 0x%08X, %d位", data, bits);
-    if (repeat > 0) Serial.printf(", 重复%d次", repeat);
-    Serial.println();
+    if (verbose) {
+        Serial.printf("[IR_TX] 发射RC5信号: 0x%08X, %d位", data, bits);
+        if (repeat > 0) Serial.printf(", 重复%d次", repeat);
+        Serial.println();
+    }
     
-    irsend->sendRC5(data, bits, repeat);
+    // 优先使用RMT硬件编码发射，发射期间CPU不被占用
+    if (!sendEncoded(kRc5Descriptor, data, bits, repeat, carrierFreq, dutyCycle)) {
+        irsend->begin();
+        irsend->sendRC5(data, bits, repeat);
+    }
     
     is_sending = false;
     return true;
 }
 
-bool IRTransmitter::sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq) {
+bool IRTransmitter::sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq, uint8_t duty) {
     if (!rawData) return false;
     
     is_sending = true;
-    Serial.printf("[IR_TX] 发射原始数据，长度: %d, 频率: %dkHz\n", length, freq);
+    if (verbose) Serial.printf("[IR_TX] 发射原始数据，长度: %d, 频率: %dkHz\n", length, freq);
     
     bool success = false;
     
     // 优先使用RMT硬件发射器发射原始数据（更稳定）
     if (use_rmt_for_raw && rmt_transmitter) {
-        Serial.println("[IR_TX] 📡 使用RMT硬件发射器");
-        success = rmt_transmitter->sendRawData(rawData, length, freq);
+        if (verbose) Serial.println("[IR_TX] 📡 使用RMT硬件发射器");
+        success = rmt_transmitter->sendRawData(rawData, length, freq, duty);
         
         if (!success) {
             Serial.println("[IR_TX] ⚠️ RMT发射失败，切换到软件发射");
@@ -300,7 +429,8 @@ bool IRTransmitter::sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq) {
     
     // 如果RMT发射失败或未启用，使用IRremoteESP8266软件发射
     if (!success && irsend) {
-        Serial.println("[IR_TX] 📡 使用软件发射器");
+        if (verbose) Serial.println("[IR_TX] 📡 使用软件发射器");
+        irsend->begin();
         irsend->sendRaw(rawData, length, freq);
         success = true;
     }
@@ -309,27 +439,34 @@ bool IRTransmitter::sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq) {
     return success;
 }
 
-bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t bits, uint16_t repeat) {
+bool IRTransmitter::sendSignal(decode_type_t protocol, uint64_t data, uint16_t bits, uint16_t repeat) {
+    return sendProtocol(protocol, data, bits, repeat, 0, 0);
+}
+
+bool IRTransmitter::sendProtocol(decode_type_t protocol, uint64_t data, uint16_t bits, uint16_t repeat,
+                                 uint16_t carrierFreq, uint8_t dutyCycle) {
     // 首先尝试使用已知协议
     switch (protocol) {
         case NEC:
         case NEC_LIKE:
-            Serial.printf("[IR_TX] 使用NEC协议发射: 0x%08X, %d位\n", data, bits);
-            return sendNEC(data, bits, repeat);
+            if (verbose) Serial.printf("[IR_TX] 使用NEC协议发射: 0x%08X, %d位\n", (uint32_t)data, bits);
+            return sendNEC((uint32_t)data, bits, repeat, carrierFreq, dutyCycle);
             
         case SONY:
-            Serial.printf("[IR_TX] 使用SONY协议发射: 0x%08X, %d位\n", data, bits);
-            return sendSony(data, bits, repeat);
+            if (verbose) Serial.printf("[IR_TX] 使用SONY协议发射: 0x%08X, %d位\n", (uint32_t)data, bits);
+            return sendSony((uint32_t)data, bits, repeat, carrierFreq, dutyCycle);
             
         case RC5:
         case RC5X:
-            Serial.printf("[IR_TX] 使用RC5协议发射: 0x%08X, %d位\n", data, bits);
-            return sendRC5(data, bits, repeat);
+            if (verbose) Serial.printf("[IR_TX] 使用RC5协议发射: 0x%08X, %d位\n", (uint32_t)data, bits);
+            return sendRC5((uint32_t)data, bits, repeat, carrierFreq, dutyCycle);
             
         default:
             // 对于未知协议，尝试使用IRremoteESP8266的通用发射功能
-            Serial.printf("[IR_TX] 尝试使用通用方法发射协议: %s, 数据: 0x%08X, %d位\n", 
-                         typeToString(protocol, false).c_str(), data, bits);
+            if (verbose) {
+                Serial.printf("[IR_TX] 尝试使用通用方法发射协议: %s, 数据: 0x%llX, %d位\n",
+                             protocolName(protocol), (unsigned long long)data, bits);
+            }
             
             // 使用IRremoteESP8266库的send()方法，它支持更多协议
             if (irsend) {
@@ -338,11 +475,11 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
                 is_sending = false;
                 
                 if (success) {
-                    Serial.println("[IR_TX] ✅ 通用方法发射成功");
+                    if (verbose) Serial.println("[IR_TX] ✅ 通用方法发射成功");
                     return true;
                 } else {
                     Serial.printf("[IR_TX] ⚠️ 通用方法失败，协议 %s 可能不被支持\n", 
-                                 typeToString(protocol, false).c_str());
+                                 protocolName(protocol));
                     return false;
                 }
             }
@@ -351,29 +488,40 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
 }
 
 // 带原始数据的发射函数 - 针对UNKNOWN协议优化
-bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                               uint16_t* rawData, uint16_t rawLength, uint16_t repeat) {
+bool IRTransmitter::sendSignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                               uint16_t* rawData, uint16_t rawLength, uint16_t repeat,
+                               uint16_t carrierFreq, uint8_t dutyCycle) {
+    ScopedLatency latency(STAGE_TX_SIGNAL);
+    
+    // 优先使用学习时测得的载波参数，未测量时按协议推测
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : defaultFrequency(protocol);
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : 33;
     
     // 对于UNKNOWN协议，优先使用原始数据发射
     if (protocol == UNKNOWN && rawData && rawLength > 0) {
-        Serial.printf("[IR_TX] 🎯 检测到UNKNOWN协议\n");
-        Serial.printf("[IR_TX] 📋 信号信息: 值=0x%08X, 位数=%d, 原始长度=%d\n", data, bits, rawLength);
+        if (verbose) {
+            Serial.printf("[IR_TX] 🎯 检测到UNKNOWN协议\n");
+            Serial.printf("[IR_TX] 📋 信号信息: 值=0x%08llX, 位数=%d, 原始长度=%d\n",
+                         (unsigned long long)data, bits, rawLength);
+            Serial.printf("[IR_TX] 📶 载波: %dkHz, 占空比: %d%%%s\n", frequency, duty,
+                         carrierFreq > 0 ? " (学习时测得)" : " (默认值)");
+        }
         
         is_sending = true;
         bool success = false;
         
         // 根据RMT状态选择发射方式
         if (use_rmt_for_raw && rmt_transmitter) {
-            Serial.println("[IR_TX] 📡 使用RMT硬件发射器");
+            if (verbose) Serial.println("[IR_TX] 📡 使用RMT硬件发射器");
             
             for (int attempt = 0; attempt <= repeat; attempt++) {
-                Serial.printf("[IR_TX] 🔄 RMT发射第 %d/%d 次\n", attempt + 1, repeat + 1);
+                if (verbose) Serial.printf("[IR_TX] 🔄 RMT发射第 %d/%d 次\n", attempt + 1, repeat + 1);
                 
                 delay(10);  // 发射前短暂延时
-                success = rmt_transmitter->sendRawData(rawData, rawLength, 38);
+                success = rmt_transmitter->sendRawData(rawData, rawLength, frequency, duty);
                 
                 if (success) {
-                    Serial.printf("[IR_TX] ✅ 第 %d 次RMT发射成功\n", attempt + 1);
+                    if (verbose) Serial.printf("[IR_TX] ✅ 第 %d 次RMT发射成功\n", attempt + 1);
                     break;
                 } else {
                     Serial.printf("[IR_TX] ❌ 第 %d 次RMT发射失败\n", attempt + 1);
@@ -382,17 +530,17 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
                 if (attempt < repeat) delay(100);
             }
         } else {
-            Serial.println("[IR_TX] 📡 使用软件发射器");
+            if (verbose) Serial.println("[IR_TX] 📡 使用软件发射器");
             
             for (int attempt = 0; attempt <= repeat; attempt++) {
-                Serial.printf("[IR_TX] 🔄 软件发射第 %d/%d 次\n", attempt + 1, repeat + 1);
+                if (verbose) Serial.printf("[IR_TX] 🔄 软件发射第 %d/%d 次\n", attempt + 1, repeat + 1);
                 
                 delay(10);  // 发射前短暂延时
                 
                 if (irsend) {
-                    irsend->sendRaw(rawData, rawLength, 38);
+                    irsend->sendRaw(rawData, rawLength, frequency);
                     success = true;
-                    Serial.printf("[IR_TX] ✅ 第 %d 次软件发射完成\n", attempt + 1);
+                    if (verbose) Serial.printf("[IR_TX] ✅ 第 %d 次软件发射完成\n", attempt + 1);
                 } else {
                     Serial.printf("[IR_TX] ❌ 第 %d 次软件发射失败，IRsend未初始化\n", attempt + 1);
                 }
@@ -403,17 +551,17 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
         
         is_sending = false;
         
-        if (success) {
-            Serial.println("[IR_TX] ✅ UNKNOWN协议发射完成");
-        } else {
+        if (!success) {
             Serial.println("[IR_TX] ❌ UNKNOWN协议发射失败");
+        } else if (verbose) {
+            Serial.println("[IR_TX] ✅ UNKNOWN协议发射完成");
         }
         
         return success;
     }
     
-    // 对于已知协议，首先尝试协议特定方法
-    bool protocolSuccess = sendSignal(protocol, data, bits, repeat);
+    // 对于已知协议，首先尝试协议特定方法(RMT编码发射使用学习时测得的载波)
+    bool protocolSuccess = sendProtocol(protocol, data, bits, repeat, carrierFreq, dutyCycle);
     
     if (protocolSuccess) {
         return true;
@@ -423,30 +571,13 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
     if (rawData && rawLength > 0) {
         Serial.printf("[IR_TX] 协议方法失败，使用原始数据发射，长度: %d\n", rawLength);
         
-        // 对于无法识别的协议，使用38kHz载波频率
-        uint16_t frequency = 38;
-        
-        // 根据协议调整频率
-        switch (protocol) {
-            case SONY:
-                frequency = 40;
-                break;
-            case RC5:
-            case RC6:
-                frequency = 36;
-                break;
-            default:
-                frequency = 38;
-                break;
-        }
-        
         is_sending = true;
-        Serial.printf("[IR_TX] 使用原始数据发射，频率: %dkHz\n", frequency);
+        if (verbose) Serial.printf("[IR_TX] 使用原始数据发射，频率: %dkHz\n", frequency);
         
         bool success = false;
         for (int attempt = 0; attempt <= repeat; attempt++) {
             delay(10);
-            success = sendRaw(rawData, rawLength, frequency);
+            success = sendRaw(rawData, rawLength, frequency, duty);
             if (attempt < repeat) {
                 delay(100);
             }
@@ -456,7 +587,7 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
         is_sending = false;
         
         if (success) {
-            Serial.println("[IR_TX] ✅ 原始数据发射完成");
+            if (verbose) Serial.println("[IR_TX] ✅ 原始数据发射完成");
             return true;
         }
     }
@@ -465,12 +596,50 @@ bool IRTransmitter::sendSignal(decode_type_t protocol, uint32_t data, uint16_t b
     return false;
 }
 
+bool IRTransmitter::sendState(decode_type_t protocol, const uint8_t* state, uint16_t length, uint16_t repeat) {
+    if (!irsend || !state || length == 0) return false;
+    ScopedLatency latency(STAGE_TX_SIGNAL);
+    
+    is_sending = true;
+    if (verbose) {
+        Serial.printf("[IR_TX] 发射%s状态: %d字节", protocolName(protocol), length);
+        if (repeat > 0) Serial.printf(", 重复%d次", repeat);
+        Serial.println();
+    }
+    
+    // 状态协议的send没有重复参数，逐次发射
+    irsend->begin();
+    bool success = true;
+    for (int i = 0; i <= repeat && success; i++) {
+        success = irsend->send(protocol, state, length);
+    }
+    is_sending = false;
+    
+    if (!success) {
+        Serial.printf("[IR_TX] ⚠️ 协议 %s 的状态发射不被支持\n", protocolName(protocol));
+    }
+    return success;
+}
+
+bool IRTransmitter::sendSignal(const IRSignal& signal, uint16_t repeat) {
+    if (signal.stateLength > 0) {
+        return sendState(signal.protocol, signal.state, signal.stateLength, repeat);
+    }
+    return sendSignal(signal.protocol, signal.value, signal.bits,
+                      const_cast<uint16_t*>(signal.rawData), signal.rawLength, repeat,
+                      signal.carrierFreq, signal.dutyCycle);
+}
+
 // 新增：持续验证模式 - 每0.5秒发送一次，持续10秒，同时监控接收
-bool IRTransmitter::continuousVerifySignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                                          uint16_t* rawData, uint16_t rawLength) {
+bool IRTransmitter::continuousVerifySignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                                          uint16_t* rawData, uint16_t rawLength,
+                                          uint16_t carrierFreq, uint8_t dutyCycle) {
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : defaultFrequency(protocol);
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : 33;
+    
     Serial.println("🔄 ========== 持续验证模式 ==========");
-    Serial.printf("📋 信号信息: 协议=%s, 值=0x%08X, 位数=%d\n", 
-                 typeToString(protocol, false).c_str(), data, bits);
+    Serial.printf("📋 信号信息: 协议=%s, 值=0x%08llX, 位数=%d, 载波=%dkHz\n", 
+                 protocolName(protocol), (unsigned long long)data, bits, frequency);
     Serial.println("⏱️ 测试时长: 10秒，发射间隔: 0.5秒");
     Serial.println("📡 同时监控接收器实时反应...");
     Serial.println("====================================");
@@ -503,13 +672,13 @@ bool IRTransmitter::continuousVerifySignal(decode_type_t protocol, uint32_t data
             if (protocol == UNKNOWN && rawData && rawLength > 0) {
                 // UNKNOWN协议优先使用RMT硬件发射
                 if (use_rmt_for_raw && rmt_transmitter) {
-                    sendSuccess = rmt_transmitter->sendRawData(rawData, rawLength, 38);
+                    sendSuccess = rmt_transmitter->sendRawData(rawData, rawLength, frequency, duty);
                 } else {
-                    sendSuccess = sendRaw(rawData, rawLength, 38);
+                    sendSuccess = sendRaw(rawData, rawLength, frequency, duty);
                 }
             } else {
                 // 已知协议使用标准方法
-                sendSuccess = sendSignal(protocol, data, bits, rawData, rawLength, 0);
+                sendSuccess = sendSignal(protocol, data, bits, rawData, rawLength, 0, carrierFreq, dutyCycle);
             }
             
             if (sendSuccess) {
@@ -551,11 +720,15 @@ bool IRTransmitter::continuousVerifySignal(decode_type_t protocol, uint32_t data
 }
 
 // 新增：信号验证测试 - 更新版本
-bool IRTransmitter::verifySignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                                 uint16_t* rawData, uint16_t rawLength, uint16_t testCount) {
+bool IRTransmitter::verifySignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                                 uint16_t* rawData, uint16_t rawLength, uint16_t testCount,
+                                 uint16_t carrierFreq, uint8_t dutyCycle) {
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : defaultFrequency(protocol);
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : 33;
+    
     Serial.printf("[IR_TX] 🧪 开始信号验证测试，将发射 %d 次\n", testCount);
-    Serial.printf("[IR_TX] 📋 信号信息: 协议=%s, 值=0x%08X, 位数=%d\n", 
-                 typeToString(protocol, false).c_str(), data, bits);
+    Serial.printf("[IR_TX] 📋 信号信息: 协议=%s, 值=0x%08llX, 位数=%d, 载波=%dkHz\n", 
+                 protocolName(protocol), (unsigned long long)data, bits, frequency);
     Serial.println("[IR_TX] 💡 请观察接收器是否能稳定接收到相同信号");
     Serial.println("================================");
     
@@ -570,12 +743,12 @@ bool IRTransmitter::verifySignal(decode_type_t protocol, uint32_t data, uint16_t
         if (protocol == UNKNOWN && rawData && rawLength > 0) {
             // UNKNOWN协议使用RMT硬件发射
             if (use_rmt_for_raw && rmt_transmitter) {
-                success = rmt_transmitter->sendRawData(rawData, rawLength, 38);
+                success = rmt_transmitter->sendRawData(rawData, rawLength, frequency, duty);
             } else {
-                success = sendRaw(rawData, rawLength, 38);
+                success = sendRaw(rawData, rawLength, frequency, duty);
             }
         } else {
-            success = sendSignal(protocol, data, bits, rawData, rawLength, 1);
+            success = sendSignal(protocol, data, bits, rawData, rawLength, 1, carrierFreq, dutyCycle);
         }
         
         if (success) {
@@ -656,10 +829,195 @@ void IRTransmitter::testGPIO4() {
     }
 }
 
+bool IRTransmitter::sendEncoded(const ProtocolDescriptor& desc, uint64_t data, uint16_t bits, uint16_t repeat,
+                                uint16_t carrierFreq, uint8_t dutyCycle) {
+    if (!use_rmt_for_raw || !rmt_transmitter) {
+        return false;
+    }
+    
+    uint32_t start = LatencyStats::now();
+    size_t count = encodeProtocol(desc, data, bits, repeat, encode_buffer, ENCODE_BUFFER_ITEMS);
+    LatencyStats::record(STAGE_RMT_CONVERT, start);
+    if (count == 0) {
+        Serial.println("[IR_TX] ⚠️ 协议编码失败(缓冲区不足)，使用软件发射");
+        return false;
+    }
+    
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : desc.freq;
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : desc.duty;
+    if (verbose) Serial.printf("[IR_TX] 📡 RMT硬件编码发射: %d项, %dkHz\n", count, frequency);
+    if (!rmt_transmitter->sendItems(encode_buffer, count, frequency, duty)) {
+        Serial.println("[IR_TX] ⚠️ RMT编码发射失败，使用软件发射");
+        return false;
+    }
+    return true;
+}
+
+bool IRTransmitter::sendWithDescriptor(const ProtocolDescriptor& desc, uint64_t data, uint16_t bits, uint16_t repeat) {
+    ScopedLatency latency(STAGE_TX_SIGNAL);
+    
+    is_sending = true;
+    if (verbose) {
+        Serial.printf("[IR_TX] 发射参数化信号: 0x%08llX, %d位", (unsigned long long)data, bits);
+        if (repeat > 0) Serial.printf(", 重复%d次", repeat);
+        Serial.println();
+    }
+    
+    bool success = sendEncoded(desc, data, bits, repeat);
+    is_sending = false;
+    return success;
+}
+
+bool IRTransmitter::sendPrepared(decode_type_t protocol, const rmt_item32_t* items, size_t count,
+                                 uint16_t carrierFreq, uint8_t dutyCycle) {
+    if (!use_rmt_for_raw || !rmt_transmitter || !items || count == 0) {
+        return false;
+    }
+    ScopedLatency latency(STAGE_TX_SIGNAL);
+    
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : defaultFrequency(protocol);
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : 33;
+    
+    if (verbose) Serial.printf("[IR_TX] 📡 发射预构建的RMT数据: %d项, %dkHz\n", count, frequency);
+    is_sending = true;
+    bool success = rmt_transmitter->sendItems(items, count, frequency, duty);
+    is_sending = false;
+    return success;
+}
+
+const ProtocolDescriptor* IRTransmitter::descriptorFor(decode_type_t protocol) {
+    return descriptorForProtocol(protocol);
+}
+
+bool IRTransmitter::encodeHoldFrame(RmtItemWriter& writer, const ProtocolDescriptor* desc, bool repeatFrame,
+                                    uint64_t data, uint16_t bits, const uint16_t* pulses, uint16_t length,
+                                    uint32_t periodUs) {
+    if (pulses && length > 0) {
+        encodeRawFrame(pulses, length, periodUs, writer);
+        return true;
+    }
+    if (!desc) return false;
+    
+    if (repeatFrame) {
+        encodeRepeatFrame(*desc, data, bits, writer);
+    } else {
+        encodeFrame(*desc, data, bits, writer);
+    }
+    // 描述符已补足协议最小帧长，学习到的周期更长时继续补足
+    if (periodUs > writer.frameElapsed()) {
+        writer.space(periodUs - writer.frameElapsed());
+    }
+    return true;
+}
+
+bool IRTransmitter::startHold(decode_type_t protocol, uint64_t data, uint16_t bits,
+                              const uint16_t* rawData, uint16_t rawLength,
+                              const uint16_t* repeatData, uint16_t repeatLength, uint16_t repeatPeriod,
+                              uint16_t carrierFreq, uint8_t dutyCycle) {
+    if (!use_rmt_for_raw || !rmt_transmitter) {
+        Serial.println("[IR_TX] ❌ 按住发射需要RMT硬件发射器");
+        return false;
+    }
+    if (rmt_transmitter->isLooping()) {
+        Serial.println("[IR_TX] ⚠️ 按住发射已在进行中");
+        return false;
+    }
+    
+    // 已知协议优先按描述符编码，UNKNOWN使用原始脉冲
+    const ProtocolDescriptor* desc = descriptorFor(protocol);
+    const uint16_t* mainPulses = desc ? nullptr : rawData;
+    uint16_t mainLength = desc ? 0 : rawLength;
+    if (!desc && (!rawData || rawLength == 0)) {
+        Serial.println("[IR_TX] ❌ 没有可发射的主帧");
+        return false;
+    }
+    
+    uint32_t periodUs = (uint32_t)repeatPeriod * 1000;
+    if (periodUs == 0) {
+        if (!desc) {
+            Serial.println("[IR_TX] ❌ 未学习到按住重复周期，且协议没有默认重复方式");
+            return false;
+        }
+        periodUs = desc->minFrameLength;
+    }
+    
+    uint16_t frequency = carrierFreq > 0 ? carrierFreq : defaultFrequency(protocol);
+    uint8_t duty = dutyCycle > 0 ? dutyCycle : 33;
+    
+    // 主帧(补足到周期)照常发射，完成后紧接着开始循环
+    RmtItemWriter mainWriter(encode_buffer, ENCODE_BUFFER_ITEMS);
+    encodeHoldFrame(mainWriter, desc, false, data, bits, mainPulses, mainLength, periodUs);
+    size_t mainCount = mainWriter.finish();
+    
+    // 重复帧：学习到的重复码 > 重复主帧 > 协议默认重复方式
+    const uint16_t* loopPulses = nullptr;
+    uint16_t loopLength = 0;
+    if (repeatData && repeatLength > 0) {
+        loopPulses = repeatData;
+        loopLength = repeatLength;
+    } else if (repeatPeriod > 0) {
+        loopPulses = mainPulses;
+        loopLength = mainLength;
+    }
+    bool repeatCode = loopLength == 0 && repeatPeriod == 0;
+    
+    rmt_item32_t* loopItems = encode_buffer + mainCount;
+    size_t loopCapacity = ENCODE_BUFFER_ITEMS - mainCount;
+    if (loopCapacity > RMTTransmitter::MAX_LOOP_ITEMS) loopCapacity = RMTTransmitter::MAX_LOOP_ITEMS;
+    RmtItemWriter loopWriter(loopItems, loopCapacity);
+    encodeHoldFrame(loopWriter, desc, repeatCode, data, bits, loopPulses, loopLength, periodUs);
+    size_t loopCount = loopWriter.finish();
+    
+    if (mainCount == 0 || loopCount == 0) {
+        Serial.println("[IR_TX] ❌ 按住发射序列编码失败(超出RMT缓冲区)");
+        return false;
+    }
+    
+    Serial.printf("[IR_TX] 🔁 按住发射: 主帧%d项, 重复帧%d项, 周期%lums, %dkHz\n",
+                 mainCount, loopCount, (unsigned long)(periodUs / 1000), frequency);
+    
+    is_sending = true;
+    if (!rmt_transmitter->sendItems(encode_buffer, mainCount, frequency, duty) ||
+        !rmt_transmitter->startLoop(loopItems, loopCount, frequency, duty)) {
+        is_sending = false;
+        return false;
+    }
+    return true;
+}
+
+void IRTransmitter::stopHold() {
+    if (!rmt_transmitter || !rmt_transmitter->isLooping()) return;
+    rmt_transmitter->stopLoop();
+    is_sending = false;
+    Serial.println("[IR_TX] ✅ 按住发射结束");
+}
+
+bool IRTransmitter::isHolding() const {
+    return rmt_transmitter && rmt_transmitter->isLooping();
+}
+
+uint16_t IRTransmitter::defaultFrequency(decode_type_t protocol) {
+    // 对于无法识别的协议，使用38kHz载波频率
+    switch (protocol) {
+        case SONY:
+            return 40;
+        case RC5:
+        case RC6:
+            return 36;
+        default:
+            return 38;
+    }
+}
+
 bool IRTransmitter::isSending() {
     return is_sending;
 }
 
+void IRTransmitter::setVerbose(bool enable) {
+    verbose = enable;
+    if (rmt_transmitter) rmt_transmitter->setVerbose(enable);
+}
+
 void IRTransmitter::setFrequency(uint16_t freq) {
     Serial.printf("[IR_TX] 设置载波频率: %dkHz\n", freq);
     // IRsend库会自动处理频率设置
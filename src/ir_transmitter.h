@@ -8,34 +8,122 @@
 #include <driver/rmt.h>
 #include <soc/rmt_reg.h>
 #include <esp32-hal-rmt.h>
+#include "ir_protocol_encoder.h"
+#include "ir_latency.h"
+#include "ir_protocol_name.h"
+#include "ir_storage.h"
 
 // RMT硬件发射器类 - 专门用于UNKNOWN协议的稳定发射
 class RMTTransmitter {
+public:
+    static const size_t MAX_LOOP_ITEMS = 128;   // 循环发射的序列必须完整放入通道RAM(2个内存块)
+    static const size_t MAX_RAW_ITEMS = RAW_PULSE_ITEMS;   // 最长原始信号(256个脉冲)所需的数据项
+    
 private:
     rmt_channel_t channel;
     uint8_t pin;
     bool initialized;
+    bool looping;            // 循环模式发射中
+    uint16_t current_freq;   // 当前配置的载波频率(kHz)
+    uint8_t current_duty;    // 当前配置的载波占空比(%)
+    bool verbose;            // 输出每次发射的过程日志(默认关闭，见IRTransmitter::setVerbose)
+    rmt_item32_t raw_items[MAX_RAW_ITEMS];   // sendRawData的转换缓冲，发射时不再分配堆内存
     
-    // 将微秒时间转换为RMT ticks
-    uint32_t usToTicks(uint32_t us);
+    // 配置载波参数(仅在与当前配置不同时重新配置)
+    bool configureCarrier(uint16_t freq, uint8_t duty);
+    
+    // 将RMT输出重新连接到引脚(IRsend软件发射会占用同一引脚)
+    void attachPin();
     
 public:
     RMTTransmitter(uint8_t pin, rmt_channel_t ch = RMT_CHANNEL_0);
     ~RMTTransmitter();
     
+    void setVerbose(bool enable) { verbose = enable; }
+    
     bool begin();
-    bool sendRawData(uint16_t* rawData, uint16_t length, uint16_t freq = 38);
+    
+    // 原始脉冲(微秒，mark/space交替)转换为RMT数据项，capacity至少为length / 2 + 2
+    // 返回写入的项数(含结束项)，容量不足时返回0
+    static size_t convertRawData(const uint16_t* rawData, uint16_t length,
+                                 rmt_item32_t* items, size_t capacity);
+    
+    bool sendRawData(uint16_t* rawData, uint16_t length, uint16_t freq = 38, uint8_t duty = 33);
+    
+    // 发射已编码好的RMT数据项，等待期间任务阻塞在信号量上，不占用CPU
+    bool sendItems(const rmt_item32_t* items, size_t count, uint16_t freq, uint8_t duty);
+    
+    // 循环模式：硬件在结束标记处回到序列开头反复发射，期间不需要CPU参与
+    bool startLoop(const rmt_item32_t* items, size_t count, uint16_t freq, uint8_t duty);
+    // 关闭循环模式，当前这一轮发射完后停止(随后触发发射完成回调)
+    void stopLoop();
+    bool isLooping() const;
+    
     void end();
 };
 
+// 预构建的RMT数据项：原始脉冲在导入或首次发射时转换一次，之后发射直接交给RMT
+// 按信号ID(1开始)缓存，由存储给出的修订号判断是否过期
+class RmtItemCache {
+public:
+    static const int MAX_ENTRIES = 20;   // 与IRStorage容量一致
+
+private:
+    struct Entry {
+        uint32_t revision;                // 0表示空
+        uint16_t count;
+        rmt_item32_t items[RMTTransmitter::MAX_RAW_ITEMS];
+    };
+    Entry entries[MAX_ENTRIES];
+    uint32_t hits;
+    uint32_t builds;
+
+public:
+    RmtItemCache();
+    
+    // 返回信号对应的数据项，修订号不一致时重新转换；无法转换时返回nullptr
+    const rmt_item32_t* prepare(int id, uint32_t revision, const uint16_t* rawData, uint16_t rawLength,
+                                size_t& count);
+    void invalidate(int id);
+    void clear();
+    
+    int preparedCount() const;
+    uint32_t getHits() const { return hits; }
+    uint32_t getBuilds() const { return builds; }
+};
+
 // 红外发射器类
 class IRTransmitter {
 private:
+    static const size_t ENCODE_BUFFER_ITEMS = 256;   // 协议编码缓冲区大小
+    
+    // IRsend和RMTTransmitter构造在对象内部的存储上，不占用堆
+    alignas(IRsend) uint8_t irsend_storage[sizeof(IRsend)];
+    alignas(RMTTransmitter) uint8_t rmt_storage[sizeof(RMTTransmitter)];
     IRsend* irsend;
     RMTTransmitter* rmt_transmitter;
     uint8_t send_pin;
     bool is_sending;
     bool use_rmt_for_raw;
+    bool verbose;            // 输出每次发射的过程日志
+    rmt_item32_t encode_buffer[ENCODE_BUFFER_ITEMS];
+    
+    // 使用编译期协议描述符直接生成RMT数据项发射，失败时返回false由调用方回退到IRsend
+    // carrierFreq/dutyCycle为0时使用描述符的载波参数
+    bool sendEncoded(const ProtocolDescriptor& desc, uint64_t data, uint16_t bits, uint16_t repeat,
+                     uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    
+    // 按协议发射(不含原始数据)，两个sendSignal重载共用
+    bool sendProtocol(decode_type_t protocol, uint64_t data, uint16_t bits, uint16_t repeat,
+                      uint16_t carrierFreq, uint8_t dutyCycle);
+    
+    // 根据协议推测载波频率(未测量载波时使用)
+    uint16_t defaultFrequency(decode_type_t protocol);
+    
+    // 写入按住发射的一帧：有原始脉冲时使用原始脉冲，否则按描述符编码，并补足到周期
+    bool encodeHoldFrame(RmtItemWriter& writer, const ProtocolDescriptor* desc, bool repeatFrame,
+                         uint64_t data, uint16_t bits, const uint16_t* pulses, uint16_t length,
+                         uint32_t periodUs);
     
 public:
     IRTransmitter(uint8_t pin);
@@ -44,27 +132,62 @@ public:
     bool begin();
     
     // 发射标准协议信号
-    bool sendNEC(uint32_t data, uint16_t bits = 32, uint16_t repeat = 0);
-    bool sendSony(uint32_t data, uint16_t bits = 12, uint16_t repeat = 0);
-    bool sendRC5(uint32_t data, uint16_t bits = 12, uint16_t repeat = 0);
+    // carrierFreq/dutyCycle为学习时测得的载波参数，0表示使用协议标准值；
+    // 只有RMT编码发射能使用测得的载波，回退到IRsend时按协议标准载波发射
+    bool sendNEC(uint32_t data, uint16_t bits = 32, uint16_t repeat = 0,
+                 uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    bool sendSony(uint32_t data, uint16_t bits = 12, uint16_t repeat = 0,
+                  uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    bool sendRC5(uint32_t data, uint16_t bits = 12, uint16_t repeat = 0,
+                 uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
     
     // 发射原始数据
-    bool sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq = 38);
+    bool sendRaw(uint16_t* rawData, uint16_t length, uint16_t freq = 38, uint8_t duty = 33);
     
     // 通用发射函数
-    bool sendSignal(decode_type_t protocol, uint32_t data, uint16_t bits, uint16_t repeat = 0);
+    bool sendSignal(decode_type_t protocol, uint64_t data, uint16_t bits, uint16_t repeat = 0);
     
     // 带原始数据的发射函数（用于UNKNOWN协议）
-    bool sendSignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                   uint16_t* rawData, uint16_t rawLength, uint16_t repeat = 0);
+    // carrierFreq/dutyCycle为学习时测得的载波参数，0表示按协议推测；已知协议同样按测得的载波编码发射
+    bool sendSignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                   uint16_t* rawData, uint16_t rawLength, uint16_t repeat = 0,
+                   uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    
+    // 发射有状态协议(空调等)：由IRsend::send(协议, 状态, 字节数)按协议时序生成波形
+    bool sendState(decode_type_t protocol, const uint8_t* state, uint16_t length, uint16_t repeat = 0);
+    
+    // 发射存储的信号：有状态字节时按状态发射，否则同上
+    bool sendSignal(const IRSignal& signal, uint16_t repeat = 0);
+    
+    // 按描述符发射参数化记录(analyze改写后的未知协议)，未启用RMT时返回false由调用方用原始脉冲发射
+    bool sendWithDescriptor(const ProtocolDescriptor& desc, uint64_t data, uint16_t bits, uint16_t repeat = 0);
+    
+    // 发射预构建的RMT数据项(见RmtItemCache)，未启用RMT时返回false由调用方回退
+    bool sendPrepared(decode_type_t protocol, const rmt_item32_t* items, size_t count,
+                      uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    
+    // 有编码描述符的协议返回描述符，否则返回nullptr
+    static const ProtocolDescriptor* descriptorFor(decode_type_t protocol);
+    
+    // 按住按键发射：先发主帧，再由RMT循环模式按周期发射重复帧，直到stopHold()
+    // repeatData为空且repeatPeriod>0时重复发送主帧；repeatPeriod为0时按协议的重复方式和帧长
+    bool startHold(decode_type_t protocol, uint64_t data, uint16_t bits,
+                   const uint16_t* rawData, uint16_t rawLength,
+                   const uint16_t* repeatData, uint16_t repeatLength, uint16_t repeatPeriod,
+                   uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
+    void stopHold();
+    bool isHolding() const;
     
     // 信号验证测试（连续发射用于稳定性测试）
-    bool verifySignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                     uint16_t* rawData, uint16_t rawLength, uint16_t testCount = 5);
+    // carrierFreq/dutyCycle同sendSignal，0表示按协议推测
+    bool verifySignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                     uint16_t* rawData, uint16_t rawLength, uint16_t testCount = 5,
+                     uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
     
     // 新增：持续验证模式（每0.5秒发送一次，持续10秒）
-    bool continuousVerifySignal(decode_type_t protocol, uint32_t data, uint16_t bits, 
-                               uint16_t* rawData, uint16_t rawLength);
+    bool continuousVerifySignal(decode_type_t protocol, uint64_t data, uint16_t bits, 
+                               uint16_t* rawData, uint16_t rawLength,
+                               uint16_t carrierFreq = 0, uint8_t dutyCycle = 0);
     
     // RMT硬件发射器控制
     bool enableRMT(bool enable = true);
@@ -77,6 +200,11 @@ public:
     // 状态查询
     bool isSending();
     
+    // 发射过程日志：默认关闭，发射路径上只输出错误。
+    // Print::printf格式化64字节以上的行时会分配堆内存，逐次发射的日志会破坏发射路径不分配内存的保证
+    void setVerbose(bool enable);
+    bool isVerbose() const { return verbose; }
+    
     // 设置载波频率
     void setFrequency(uint16_t freq);
 };
@@ -2,19 +2,69 @@
 #include "ir_receiver.h"
 #include "ir_transmitter.h"
 #include "ir_storage.h"
+#include "ir_carrier.h"
+#include "ir_retry_policy.h"
+#include "ir_signal_match.h"
+#include "ir_event_loop.h"
+#include "ir_latency.h"
+#include "ir_learning.h"
+#include "ir_command.h"
+#include "ir_corpus.h"
+#include "ir_pulse_filter.h"
+#include "ir_heap.h"
+#include "ir_bundle.h"
+#include "ir_code_import.h"
+#include "ir_analyzer.h"
+#include "ir_protocol_decoder.h"
+#include <driver/rmt.h>
+#include <driver/pcnt.h>
+#include <esp_system.h>
 
 // 引脚定义
 #define IR_RECEIVER_PIN 2    // VS1838B数据引脚
 #define IR_TRANSMITTER_PIN 4 // IR333C-A控制引脚（通过三极管）
 #define STATUS_LED_PIN 5     // 状态指示LED（使用GPIO5）
+#define IR_CARRIER_PIN 34    // 载波检测光电管（可选，未解调的原始输入）
+
+// 事件循环配置
+#define INPUT_POLL_INTERVAL 5      // 载波检测/串口兜底轮询周期(ms)
+#define RX_FRAME_CHECK 2           // 帧捕获进行中检查IRrecv是否已结束的间隔(ms)
+#define RX_WAKE_PCNT_UNIT PCNT_UNIT_0   // 接收引脚边沿唤醒使用的脉冲计数单元
+#define COMMAND_IDLE_TIMEOUT 100   // 无换行符时，串口空闲多久视为命令结束(ms)
+#define REPEAT_INTERVAL 300        // repeat命令的发射间隔(ms)
+#define BUNDLE_IDLE_TIMEOUT 3000   // 导入信号库包时，串口空闲多久视为中断(ms)
+#define SERIAL_RX_BUFFER 1024      // 串口接收缓冲，导入信号库包时避免溢出
+#define COMMAND_BUFFER_SIZE 1536   // 串口命令缓冲，一行可容纳128对的Pronto码
+#define STORAGE_DEBOUNCE 1500      // 延迟写入：最后一次修改后空闲多久提交到闪存(ms)
+#define STORAGE_MAX_DELAY 10000    // 延迟写入：忙碌时最多推迟多久(ms)
+#define STORAGE_SERVICE_INTERVAL 250   // 延迟写入检查周期(ms)
 
 // 对象实例
 IRReceiver irReceiver(IR_RECEIVER_PIN);
 IRTransmitter irTransmitter(IR_TRANSMITTER_PIN);
 IRStorage irStorage;
+RmtItemCache rmtCache;       // 原始脉冲信号预构建的RMT数据项
+CarrierDetector carrierDetector(IR_CARRIER_PIN);
+AdaptiveRetryPolicy retryPolicy;
+CaptureRing captureRing;
+PulseFilter pulseFilter;
+HeapSnapshot bootHeap;       // 初始化完成时的堆状态，stats以此为参照
+IRSignal txSignal;           // 发射和回波匹配使用的信号快照，期间存储被修改也不影响
+
+// 事件循环：以任务通知等待，串口/接收/发射完成事件可提前唤醒
+uint32_t clockMicros();
+void waitForEvent(uint32_t maxWaitUs);
+void wakeEventLoop();
+void writeStatusLed(bool level);
+EventLoop eventLoop(clockMicros, waitForEvent, wakeEventLoop);
+LedPattern statusLed(&eventLoop, writeStatusLed);
+TaskHandle_t loopTaskHandle = nullptr;
+bool rxWakeup = false;       // 接收引脚边沿唤醒可用，否则按INPUT_POLL_INTERVAL轮询接收器
+int rxCheckTimer = -1;
+int16_t rxCheckEdges = 0;    // 上一次检查时的边沿计数
 
 // 函数声明
-void processCommand(String command);
+void processCommand(const char* line);
 void handleLearning();
 void finalizeLearning(); // 新增：完成学习分析
 void showHelp();
@@ -36,6 +86,64 @@ void ledStartupFlash(); // 新增：启动LED闪烁
 void testGPIO2(); // 新增：测试GPIO2引脚状态
 void diagnosePullupResistor(); // 新增：诊断上拉电阻问题
 void toggleRMT(); // 新增：切换RMT硬件发射器状态
+void sendSignalClosedLoop(int id); // 新增：以接收器回波确认的闭环发射
+void closedLoopAttempt(); // 新增：闭环发射的一次尝试，发射后启动回波等待定时器
+void onClosedLoopEcho(); // 新增：闭环发射等待期间收到的帧
+void onClosedLoopTimeout(void* ctx); // 新增：回波等待超时
+void finishClosedLoop(); // 新增：结束闭环发射并更新重试策略
+bool echoMatches(IRSignal* signal); // 新增：判断接收到的信号是否为发射回波
+void toggleLoopback(); // 新增：切换闭环发射模式
+void showLoopbackStats(); // 新增：显示闭环发射统计
+void onSerialData(void* ctx); // 新增：串口数据事件
+void onCommandIdle(void* ctx); // 新增：串口空闲超时，提交无换行的命令
+void dispatchCommandLine(); // 新增：执行缓冲区中的命令
+void onIrFrame(void* ctx); // 新增：红外帧事件
+void onTxDone(void* ctx); // 新增：RMT发射完成事件
+void pollInputs(void* ctx); // 新增：周期检查载波检测器和串口(边沿唤醒不可用时也检查接收器)
+bool beginRxWakeup(); // 新增：接收引脚的第一个边沿唤醒事件循环
+void onRxCheck(void* ctx); // 新增：帧捕获进行中的检查
+void scheduleRxCheck(uint32_t delayMs); // 新增：安排下一次帧结束检查
+void onLearningTimeout(void* ctx); // 新增：学习超时
+void repeatStep(void* ctx); // 新增：repeat命令的单次发射
+void finishRepeat(); // 新增：结束repeat任务
+void showEventStats(); // 新增：显示事件延迟统计
+void showLatencyStats(); // 新增：显示热路径各阶段延迟直方图
+void dumpCaptures(const char* model); // 新增：以语料格式导出最近的捕获
+void replayCaptures(int times, int speedPct); // 新增：回放捕获并统计解码准确率和吞吐
+void waitMicros(uint32_t us); // 新增：回放等待
+void captureLearningRaw(int candidate); // 新增：过滤学习帧的原始脉冲并计入候选波形
+void showFilterStatus(); // 新增：显示脉冲过滤配置与统计
+void showDecoderStatus(); // 新增：显示启用的协议、解码顺序、每帧解码时间和固件大小
+void setDecoders(const char* names); // 新增：设置启用的协议
+void showCaptureStatus(); // 新增：显示自适应的帧结束超时、捕获缓冲、溢出率和按键到解码延迟
+void captureLearningRepeat(); // 新增：记录学习时按住按键产生的重复帧和周期
+void holdSignal(int id, int durationMs); // 新增：按住按键发射
+void onHoldEnd(void* ctx); // 新增：按住发射到时
+void finishHold(); // 新增：结束按住发射
+void startBatchLearning(const char* prefix); // 新增：批量学习整个遥控器
+void handleBatchLearning(); // 新增：批量学习时处理一帧
+void finishBatchLearning(); // 新增：结束批量学习并一次性入库
+uint16_t captureRepeatCode(uint16_t* pulses); // 新增：过滤当前重复码帧，返回脉冲数(0表示无效)
+void runSoak(int id, int count); // 新增：连续发射并检查堆上是否残留分配
+void exportBundle(); // 新增：以二进制包导出整个信号库
+void startBundleImport(bool replace); // 新增：从串口接收二进制包导入信号库
+void feedBundleImport(); // 新增：把串口数据送入包读取器
+void onBundleImportIdle(void* ctx); // 新增：导入时串口空闲超时
+void finishBundleImport(BundleStatus status); // 新增：导入结束，成功则一次性提交
+bool onBundleEntry(const BundleEntry& entry, void* ctx); // 新增：包中的一个信号写入存储
+int storeBundleEntry(const BundleEntry& entry); // 新增：把一个中间表示的信号写入存储
+void importCodeCommand(const char* text); // 新增：导入单个Pronto码或协议码
+void startCodeImport(); // 新增：逐行批量导入红外码
+void handleCodeLine(const char* line); // 新增：处理批量导入中的一行
+void finishCodeImport(bool commit); // 新增：结束批量导入，end时一次性保存
+int prepareStoredSignals(); // 新增：为原始脉冲发射的信号预构建RMT数据项
+void analyzeSignals(bool apply); // 新增：分析UNKNOWN信号的脉冲结构，apply时改写为参数化记录
+void serviceStorage(void* ctx); // 新增：空闲时提交延迟写入的修改
+void syncStorage(); // 新增：立即提交未保存的修改
+void renameSignal(int id, const char* name); // 新增：重命名信号
+void runStorageStress(uint32_t durationMs); // 新增：读写并发压力测试，检查快照是否完整
+void dedupeSignals(bool apply); // 新增：按指纹查找整库重复信号，apply时合并
+void matchReceivedFrame(); // 新增：识别模式下在信号库中查找收到的帧
 
 // 程序状态
 enum SystemState {
@@ -46,43 +154,133 @@ enum SystemState {
 
 // 学习模式配置
 struct LearningConfig {
-  static const int MAX_SAMPLES = 20;      // 最大采样次数
   static const int MIN_SAMPLES = 5;       // 最少采样次数
-  static const unsigned long TIMEOUT = 30000;  // 30秒超时
-  static const unsigned long SAMPLE_INTERVAL = 200; // 采样间隔200ms
-};
-
-// 信号样本结构
-struct SignalSample {
-  uint32_t value;
-  uint16_t bits;
-  decode_type_t protocol;
-  unsigned long timestamp;
-  bool isValid;
+  static const int TARGET_SAMPLES = 20;   // 达到此样本数且置信度足够时自动结束(样本数本身不设上限)
+  static const int TARGET_CONFIDENCE = 90; // 自动结束所需的保守置信度(%)
+  static const unsigned long TIMEOUT = 30000;  // 30秒没有新样本则结束
 };
 
 SystemState currentState = IDLE;
+bool closedLoopMode = false;  // 闭环发射模式：用板载接收器确认发射结果
+bool matchMode = false;       // 识别模式：空闲时收到的帧在信号库中查找
 
-// 学习相关变量
-SignalSample learningSamples[LearningConfig::MAX_SAMPLES];
-int sampleCount = 0;
+// 学习相关变量：流式学习器内存固定，样本数不限
+StreamingLearner learner;
 unsigned long learningStartTime = 0;
 unsigned long lastSampleTime = 0;
+int learningTimer = -1;
+
+// 学习期间观察到的按住重复信息(属于最近一个新按键)
+struct HoldCapture {
+  decode_type_t protocol;
+  uint64_t value;
+  uint16_t bits;
+  uint16_t repeats;                          // 收到的重复帧数
+  uint16_t repeatData[MAX_REPEAT_PULSES];    // NEC式重复码
+  uint16_t repeatLength;                     // 0表示重复帧为完整数据帧
+  uint32_t periodSum;                        // 测得的帧周期累计(ms)
+  uint16_t periodCount;
+};
+HoldCapture learningHold;
+
+// 批量学习：与单键学习共用LEARNING状态和超时定时器
+BatchSession batchSession;
+bool batchLearning = false;
+char batchPrefix[16] = "key";
+
+// 按住发射定时器
+int holdTimer = -1;
+
+// 串口命令缓冲(非阻塞逐字节接收)
+char commandBuffer[COMMAND_BUFFER_SIZE];
+size_t commandLength = 0;
+int commandIdleTimer = -1;
+
+// repeat命令的定时发射任务
+struct RepeatJob {
+  int id;
+  int total;
+  int done;
+  int timerId;
+};
+RepeatJob repeatJob = {0, 0, 0, -1};
+
+// 闭环发射任务：每次尝试后由事件循环定时器等待回波，等待期间不阻塞串口和其他事件
+struct ClosedLoopJob {
+  int id;
+  RetryPlan plan;
+  int attempt;
+  unsigned long sendStart;   // 本次尝试开始发射的时间(ms)，回波延迟从这里算起
+  bool confirmed;
+  bool active;
+  int timerId;               // 回波等待定时器
+};
+ClosedLoopJob closedLoopJob = {0, {0, 0, 0}, 0, 0, false, false, -1};
+
+// 信号库包导入：期间串口按二进制接收，不解析命令
+struct BundleImport {
+  bool active;
+  bool replace;              // 导入前清空现有信号
+  unsigned long startUs;     // 收到第一个字节的时间，0表示尚未收到
+  int accepted;
+  int timerId;
+};
+BundleImport bundleImport = {false, false, 0, 0, -1};
+BundleReader bundleReader(onBundleEntry);
+
+// 红外码批量导入：期间每行为 "<名称> <红外码>"，end提交，cancel放弃
+struct CodeImport {
+  bool active;
+  int accepted;
+  int failed;                // 解析失败的行
+  int dropped;               // 解析成功但存储已满的行
+  uint32_t convertUs;        // 解析+转换累计耗时
+  uint32_t prepareUs;        // RMT预构建累计耗时
+};
+CodeImport codeImport = {false, 0, 0, 0, 0, 0};
 
 void setup() {
+  Serial.setRxBufferSize(SERIAL_RX_BUFFER);
   Serial.begin(115200);
   Serial.println("ESP32 红外学习与控制系统");
   Serial.println("============================");
   
   // 初始化状态LED并进行启动闪烁
   pinMode(STATUS_LED_PIN, OUTPUT);
-  digitalWrite(STATUS_LED_PIN, LOW);
+  statusLed.set(false);
   
   // 初始化模块
   irReceiver.begin();
+  irReceiver.setCaptureRing(&captureRing);
   irTransmitter.begin();
   irStorage.begin();
+  irStorage.setWriteBehind(STORAGE_DEBOUNCE, STORAGE_MAX_DELAY);
+  // 重复学习同一按键时合并到已有信号，不占用新槽位
+  irStorage.setDuplicatePolicy(DUPLICATE_MERGE);
+  // esp_restart()等正常关机路径上提交未保存的修改
+  esp_register_shutdown_handler([]() { irStorage.flush(); });
+  prepareStoredSignals();
+  
+  // 载波检测为可选功能，初始化失败不影响学习
+  if (!carrierDetector.begin()) {
+    Serial.println("⚠️ 载波检测器不可用，学习时将不测量载波频率");
+  }
+  
+  // 注册事件源：串口接收回调、RMT发射完成中断、接收引脚边沿中断、载波和串口兜底轮询定时器
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  eventLoop.onEvent(EVENT_UART, onSerialData);
+  eventLoop.onEvent(EVENT_IR_RX, onIrFrame);
+  eventLoop.onEvent(EVENT_TX_DONE, onTxDone);
+  Serial.onReceive([]() { eventLoop.post(EVENT_UART); });
+  rmt_register_tx_end_callback([](rmt_channel_t channel, void* arg) { eventLoop.post(EVENT_TX_DONE); }, nullptr);
+  rxWakeup = beginRxWakeup();
+  if (!rxWakeup) {
+    Serial.println("⚠️ 接收引脚边沿唤醒不可用，改为定时轮询接收器");
+  }
+  eventLoop.startTimer(INPUT_POLL_INTERVAL, pollInputs, nullptr, INPUT_POLL_INTERVAL);
+  eventLoop.startTimer(STORAGE_SERVICE_INTERVAL, serviceStorage, nullptr, STORAGE_SERVICE_INTERVAL);
   
+  bootHeap = takeHeapSnapshot();
   Serial.println("系统初始化完成");
   
   // 启动闪烁提示
@@ -93,85 +291,1129 @@ void setup() {
 }
 
 void loop() {
-  // 检查串口命令 (使用简单可靠的readString方法)
+  // 处理事件和到期定时器，空闲时睡眠到下一个截止时间
+  eventLoop.runOnce();
+}
+
+// ============== 事件循环 ==============
+
+uint32_t clockMicros() {
+  return micros();
+}
+
+void waitForEvent(uint32_t maxWaitUs) {
+  // 任务通知按tick等待，向上取整避免提前醒来空转
+  TickType_t ticks = pdMS_TO_TICKS((maxWaitUs + 999) / 1000);
+  ulTaskNotifyTake(pdTRUE, ticks);
+}
+
+void wakeEventLoop() {
+  if (!loopTaskHandle) return;
+  if (xPortInIsrContext()) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  } else {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
+void writeStatusLed(bool level) {
+  digitalWrite(STATUS_LED_PIN, level ? HIGH : LOW);
+}
+
+void pollInputs(void* ctx) {
+  if (currentState == LEARNING) {
+    carrierDetector.poll();
+  }
+  if (!rxWakeup && irReceiver.isAvailable()) {
+    eventLoop.post(EVENT_IR_RX);
+  }
+  // 串口回调只在FIFO超时或满时触发，这里兜底
   if (Serial.available()) {
-    String command = Serial.readString();
-    command.trim();
-    if (command.length() > 0) {
-      processCommand(command);
-      Serial.print("> ");
+    eventLoop.post(EVENT_UART);
+  }
+}
+
+// ============== 接收唤醒 ==============
+// IRrecv没有帧完成回调。脉冲计数器经GPIO矩阵与IRrecv共用接收引脚，计数从0到1(帧的第一个下降沿)时
+// 中断投递EVENT_IR_RX；帧还在捕获中时按帧结束超时安排检查，帧处理或判定为噪声后清零计数，
+// 空闲时接收器不产生任何唤醒
+
+static void IRAM_ATTR onRxEdge(void* arg) {
+  eventLoop.post(EVENT_IR_RX);
+}
+
+bool beginRxWakeup() {
+  pcnt_config_t config = {
+    .pulse_gpio_num = IR_RECEIVER_PIN,
+    .ctrl_gpio_num = PCNT_PIN_NOT_USED,
+    .lctrl_mode = PCNT_MODE_KEEP,
+    .hctrl_mode = PCNT_MODE_KEEP,
+    .pos_mode = PCNT_COUNT_DIS,
+    .neg_mode = PCNT_COUNT_INC,      // VS1838B输出低电平有效，每个标记以下降沿开始
+    .counter_h_lim = INT16_MAX,
+    .counter_l_lim = 0,
+    .unit = RX_WAKE_PCNT_UNIT,
+    .channel = PCNT_CHANNEL_0,
+  };
+  if (pcnt_unit_config(&config) != ESP_OK) return false;
+  pcnt_set_event_value(RX_WAKE_PCNT_UNIT, PCNT_EVT_THRES_0, 1);
+  pcnt_event_enable(RX_WAKE_PCNT_UNIT, PCNT_EVT_THRES_0);
+  if (pcnt_isr_service_install(0) != ESP_OK) return false;
+  if (pcnt_isr_handler_add(RX_WAKE_PCNT_UNIT, onRxEdge, nullptr) != ESP_OK) return false;
+  pcnt_counter_clear(RX_WAKE_PCNT_UNIT);
+  pcnt_counter_resume(RX_WAKE_PCNT_UNIT);
+  return true;
+}
+
+int16_t readRxEdges() {
+  int16_t edges = 0;
+  pcnt_get_counter_value(RX_WAKE_PCNT_UNIT, &edges);
+  return edges;
+}
+
+void scheduleRxCheck(uint32_t delayMs) {
+  rxCheckEdges = readRxEdges();
+  eventLoop.cancelTimer(rxCheckTimer);
+  rxCheckTimer = eventLoop.startTimer(delayMs, onRxCheck);
+}
+
+void onRxCheck(void* ctx) {
+  rxCheckTimer = -1;
+  if (irReceiver.isAvailable()) {
+    eventLoop.post(EVENT_IR_RX);
+  } else if (readRxEdges() != rxCheckEdges) {
+    // 仍有新的边沿，帧还没结束
+    scheduleRxCheck(RX_FRAME_CHECK);
+  } else {
+    // 没有新边沿也没有完整帧(噪声，或IRrecv持有上一帧时到达的边沿)：等待下一帧的第一个边沿
+    pcnt_counter_clear(RX_WAKE_PCNT_UNIT);
+  }
+}
+
+void onSerialData(void* ctx) {
+  if (bundleImport.active) {
+    feedBundleImport();
+    return;
+  }
+  
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      dispatchCommandLine();
+      continue;
+    }
+    if (commandLength < sizeof(commandBuffer) - 1) {
+      commandBuffer[commandLength++] = c;
     }
   }
   
-  // 根据当前状态执行相应操作
-  switch (currentState) {
-    case LEARNING:
-      handleLearning();
-      break;
-    case TRANSMITTING:
-      // 发射状态在命令处理中完成
-      currentState = IDLE;
-      break;
-    case IDLE:
-    default:
-      // 空闲状态，等待命令
-      break;
+  // 兼容不发送换行符的串口工具：空闲一段时间后提交命令
+  if (commandLength > 0) {
+    eventLoop.cancelTimer(commandIdleTimer);
+    commandIdleTimer = eventLoop.startTimer(COMMAND_IDLE_TIMEOUT, onCommandIdle);
+  }
+}
+
+void onCommandIdle(void* ctx) {
+  commandIdleTimer = -1;
+  dispatchCommandLine();
+}
+
+void dispatchCommandLine() {
+  eventLoop.cancelTimer(commandIdleTimer);
+  commandIdleTimer = -1;
+  
+  commandBuffer[commandLength] = '\0';
+  commandLength = 0;
+  
+  // 直接在接收缓冲上解析，不构造String
+  const char* line = commandBuffer;
+  while (isspace((unsigned char)*line)) line++;
+  if (*line && codeImport.active) {
+    // 批量导入时逐行处理，不回显提示符
+    handleCodeLine(line);
+  } else if (*line) {
+    processCommand(line);
+    Serial.print("> ");
+  }
+}
+
+void onIrFrame(void* ctx) {
+  if (rxWakeup) {
+    if (!irReceiver.isAvailable()) {
+      // 第一个边沿的唤醒：帧结束超时之后IRrecv才交出整帧
+      if (rxCheckTimer < 0) scheduleRxCheck(irReceiver.getCaptureTuner().getTimeoutMs() + RX_FRAME_CHECK);
+      return;
+    }
+    // 帧被取走(resume)之前IRrecv不再捕获，此后的边沿属于下一帧
+    eventLoop.cancelTimer(rxCheckTimer);
+    rxCheckTimer = -1;
+    pcnt_counter_clear(RX_WAKE_PCNT_UNIT);
+  }
+  
+  if (currentState == LEARNING) {
+    handleLearning();
+  } else if (closedLoopJob.active) {
+    onClosedLoopEcho();
+  } else if (matchMode && currentState == IDLE) {
+    matchReceivedFrame();
+  } else {
+    // 空闲时丢弃，避免开始学习时读到旧帧
+    irReceiver.reset();
+  }
+}
+
+void onTxDone(void* ctx) {
+  // 发射状态在命令处理中完成，repeat任务和按住发射自行结束
+  if (currentState == TRANSMITTING && repeatJob.timerId < 0 && !irTransmitter.isHolding() &&
+      !closedLoopJob.active) {
+    currentState = IDLE;
+  }
+}
+
+void showLatencyStats() {
+  Serial.printf("\n⏱️ 热路径阶段延迟(周期计数器，%u MHz)：\n", LatencyStats::cyclesPerUs());
+  Serial.println("阶段         | 次数     | p50(us)  | p99(us)  | max(us)");
+  Serial.println("-------------|----------|----------|----------|----------");
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    LatencyStage stage = (LatencyStage)i;
+    const LatencyHistogram& hist = LatencyStats::get(stage);
+    Serial.printf("%-12s | %8u | %8u | %8u | %8u\n",
+                  LatencyStats::stageName(stage), hist.count(),
+                  LatencyStats::toMicros(hist.percentile(500)),
+                  LatencyStats::toMicros(hist.percentile(990)),
+                  LatencyStats::toMicros(hist.max()));
+  }
+  Serial.println("💡 p50/p99为对数桶上界，误差不超过25%");
+  
+  HeapSnapshot heap = takeHeapSnapshot();
+  Serial.println("\n🧮 堆内存：");
+  Serial.printf("  空闲: %u 字节 (初始化完成时 %u，变化 %+d)\n",
+                heap.freeBytes, bootHeap.freeBytes, heapFreeDelta(bootHeap, heap));
+  Serial.printf("  水位线(最低空闲): %u 字节\n", heap.minFreeBytes);
+  Serial.printf("  最大连续空闲块: %u 字节\n", heap.largestBlock);
+  Serial.printf("  已分配块: %u (初始化完成时 %u，变化 %+d)\n",
+                heap.allocatedBlocks, bootHeap.allocatedBlocks, heapBlockDelta(bootHeap, heap));
+  
+  Serial.printf("\n📡 RMT预构建: %d 个信号，命中 %u 次，转换 %u 次\n",
+                rmtCache.preparedCount(), rmtCache.getHits(), rmtCache.getBuilds());
+  
+  const StorageCommitStats& commits = irStorage.getCommitStats();
+  Serial.printf("\n💾 闪存提交: 修改 %u 次，提交 %u 次", commits.changes, commits.commits);
+  if (commits.commits > 0) {
+    Serial.printf("，耗时 平均 %u us / 最大 %u us / 最近 %u us",
+                  (uint32_t)(commits.totalUs / commits.commits), commits.maxUs, commits.lastUs);
+  }
+  Serial.println();
+  if (irStorage.isDirty()) {
+    Serial.printf("  未保存: %u 次修改，已推迟 %lu ms\n",
+                  irStorage.getPendingChanges(), irStorage.getDirtyAgeMs());
+  }
+  Serial.println();
+}
+
+// ============== 延迟写入 ==============
+
+void serviceStorage(void* ctx) {
+  bool idle = currentState == IDLE && !bundleImport.active && !codeImport.active &&
+              !eventLoop.isTimerActive(repeatJob.timerId) && !eventLoop.isTimerActive(holdTimer);
+  irStorage.service(idle);
+}
+
+void syncStorage() {
+  if (!irStorage.isDirty()) {
+    Serial.println("💾 没有未保存的修改");
+    return;
+  }
+  uint32_t pending = irStorage.getPendingChanges();
+  if (!irStorage.flush()) {
+    Serial.println("⚠️ 批量写入进行中，结束后再提交");
+    return;
+  }
+  Serial.printf("💾 已提交 %u 次修改，耗时 %u us\n", pending, irStorage.getCommitStats().lastUs);
+}
+
+// 包的第index个信号对应存储中的第index+1个槽位，空槽位跳过
+static bool bundleSource(int index, BundleEntry& out, void* ctx) {
+  IRSignal* signal = irStorage.getSignal(index + 1);
+  if (!signal || !signal->isValid) return false;
+  
+  out.protocol = (int16_t)signal->protocol;
+  out.bits = signal->bits;
+  out.value = signal->value;
+  out.carrierFreq = signal->carrierFreq;
+  out.dutyCycle = signal->dutyCycle;
+  out.repeatPeriod = signal->repeatPeriod;
+  out.rawLength = min(signal->rawLength, (uint16_t)BundleEntry::MAX_PULSES);
+  out.repeatLength = min(signal->repeatLength, (uint16_t)BundleEntry::MAX_REPEAT);
+  memcpy(out.rawData, signal->rawData, out.rawLength * sizeof(uint16_t));
+  memcpy(out.repeatData, signal->repeatData, out.repeatLength * sizeof(uint16_t));
+  out.stateLength = (uint8_t)min(signal->stateLength, (uint16_t)BundleEntry::MAX_STATE);
+  memcpy(out.state, signal->state, out.stateLength);
+  strncpy(out.name, signal->name, BundleEntry::MAX_NAME - 1);
+  return true;
+}
+
+static void bundleSerialSink(const uint8_t* data, size_t length, void* ctx) {
+  Serial.write(data, length);
+}
+
+void exportBundle() {
+  int capacity = irStorage.getCapacity();
+  int count = irStorage.getSignalCount();
+  if (count == 0) {
+    Serial.println("暂无信号可导出");
+    return;
+  }
+  
+  // BUNDLE_BEGIN与BUNDLE_END之间为原始二进制，主机端工具按长度截取
+  size_t size = bundleSize(capacity, bundleSource, nullptr);
+  Serial.printf("BUNDLE_BEGIN %u\n", (unsigned)size);
+  size_t written = writeBundle(capacity, bundleSource, bundleSerialSink, nullptr);
+  Serial.println();
+  Serial.println("BUNDLE_END");
+  
+  size_t stored = irStorage.getUsedMemory();
+  Serial.printf("📦 导出 %d 个信号，%u 字节 (存储格式 %u 字节，%u%%)\n",
+               count, (unsigned)written, (unsigned)stored, (unsigned)(written * 100 / stored));
+}
+
+void startBundleImport(bool replace) {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  bundleReader.reset();
+  bundleImport.active = true;
+  bundleImport.replace = replace;
+  bundleImport.startUs = 0;
+  bundleImport.accepted = 0;
+  
+  // 所有修改在整包校验通过后一次写入；失败时从存储重新加载
+  irStorage.setQuiet(true);
+  irStorage.beginBatch();
+  if (replace) irStorage.clearAll();
+  
+  Serial.printf("📥 等待信号库包(二进制，%s现有信号)，%d 秒无数据自动取消...\n",
+               replace ? "替换" : "追加到", BUNDLE_IDLE_TIMEOUT / 1000);
+  eventLoop.cancelTimer(bundleImport.timerId);
+  bundleImport.timerId = eventLoop.startTimer(BUNDLE_IDLE_TIMEOUT, onBundleImportIdle);
+}
+
+int storeBundleEntry(const BundleEntry& entry) {
+  return irStorage.addSignal((decode_type_t)entry.protocol, entry.value, entry.bits,
+                             const_cast<uint16_t*>(entry.rawData), entry.rawLength,
+                             entry.name[0] ? entry.name : nullptr,
+                             entry.carrierFreq, entry.dutyCycle,
+                             entry.repeatLength > 0 ? entry.repeatData : nullptr, entry.repeatLength,
+                             entry.repeatPeriod,
+                             entry.stateLength > 0 ? entry.state : nullptr, entry.stateLength);
+}
+
+bool onBundleEntry(const BundleEntry& entry, void* ctx) {
+  int id = storeBundleEntry(entry);
+  if (id < 0) return false;
+  bundleImport.accepted++;
+  return true;
+}
+
+void feedBundleImport() {
+  uint8_t chunk[64];
+  BundleStatus status = BUNDLE_IN_PROGRESS;
+  while (status == BUNDLE_IN_PROGRESS && Serial.available()) {
+    size_t length = 0;
+    while (length < sizeof(chunk) && Serial.available()) {
+      chunk[length++] = (uint8_t)Serial.read();
+    }
+    if (bundleImport.startUs == 0) bundleImport.startUs = micros();
+    status = bundleReader.feed(chunk, length);
+  }
+  
+  if (status != BUNDLE_IN_PROGRESS) {
+    finishBundleImport(status);
+    return;
+  }
+  eventLoop.cancelTimer(bundleImport.timerId);
+  bundleImport.timerId = eventLoop.startTimer(BUNDLE_IDLE_TIMEOUT, onBundleImportIdle);
+}
+
+void onBundleImportIdle(void* ctx) {
+  bundleImport.timerId = -1;
+  if (!bundleImport.active) return;
+  Serial.printf("⏰ 导入超时，已收到 %u/%u 字节\n", bundleReader.bytesReceived(), bundleReader.totalLength());
+  finishBundleImport(BUNDLE_IN_PROGRESS);
+  Serial.print("> ");
+}
+
+void finishBundleImport(BundleStatus status) {
+  unsigned long receiveUs = bundleImport.startUs ? micros() - bundleImport.startUs : 0;
+  bundleImport.active = false;
+  eventLoop.cancelTimer(bundleImport.timerId);
+  bundleImport.timerId = -1;
+  
+  if (status != BUNDLE_OK) {
+    irStorage.abortBatch();
+    irStorage.setQuiet(false);
+    if (status != BUNDLE_IN_PROGRESS) {
+      Serial.printf("\n❌ 导入失败: %s (第 %d/%d 个信号)，信号库保持不变\n", bundleStatusName(status),
+                   bundleReader.entriesDecoded() + 1, bundleReader.entryCount());
+    } else {
+      Serial.println("❌ 导入已取消，信号库保持不变");
+    }
+    return;
+  }
+  
+  uint32_t commitStart = micros();
+  irStorage.endBatch();
+  uint32_t commitUs = micros() - commitStart;
+  irStorage.setQuiet(false);
+  // 替换导入后同一ID对应的是另一个信号，旧的闭环统计不再适用
+  if (bundleImport.replace) retryPolicy.resetAll();
+  prepareStoredSignals();
+  
+  uint32_t bytes = bundleReader.bytesReceived();
+  Serial.printf("\n✅ 导入 %d 个信号 (%u 字节)\n", bundleImport.accepted, bytes);
+  if (receiveUs > 0) {
+    Serial.printf("⏱️ 接收+解码 %lu ms，%.1f KB/s；写入存储 %u ms\n",
+                 receiveUs / 1000, bytes * 1000000.0 / 1024 / receiveUs, commitUs / 1000);
+  }
+}
+
+// 为原始脉冲发射(UNKNOWN协议)的信号预构建RMT数据项，返回是否已就绪
+static bool prepareSignal(int id) {
+  uint32_t revision = 0;
+  if (!irStorage.snapshot(id, txSignal, &revision)) return false;
+  if (txSignal.protocol != UNKNOWN || txSignal.parametric || txSignal.rawLength == 0) return false;
+  
+  size_t count = 0;
+  return rmtCache.prepare(id, revision, txSignal.rawData, txSignal.rawLength, count) != nullptr;
+}
+
+int prepareStoredSignals() {
+  int prepared = 0;
+  for (int id = 1; id <= irStorage.getCapacity(); id++) {
+    if (prepareSignal(id)) prepared++;
+  }
+  return prepared;
+}
+
+// 解析 "<名称> <红外码>" 并写入存储。成功返回信号ID，解析失败返回-1(已输出原因)，存储已满返回-2
+// lineNo为批量导入中的行号，0表示单条命令
+static int importCodeLine(const char* text, int lineNo, uint32_t& convertUs) {
+  // 中间表示约600字节，不放在栈上
+  static BundleEntry entry;
+  
+  while (isspace((unsigned char)*text)) text++;
+  const char* nameEnd = text;
+  while (*nameEnd && !isspace((unsigned char)*nameEnd)) nameEnd++;
+  size_t nameLength = nameEnd - text;
+  if (nameLength >= BundleEntry::MAX_NAME) nameLength = BundleEntry::MAX_NAME - 1;
+  
+  memset(entry.name, 0, sizeof(entry.name));
+  memcpy(entry.name, text, nameLength);
+  
+  ProntoStatus prontoStatus = PRONTO_OK;
+  uint32_t start = micros();
+  CodeImportStatus status = importCode(nameEnd, entry, &prontoStatus);
+  convertUs = micros() - start;
+  
+  if (status != CODE_OK) {
+    if (lineNo > 0) Serial.printf("❌ 第 %d 行 (%s): ", lineNo, entry.name);
+    else Serial.print("❌ ");
+    if (status == CODE_PRONTO) {
+      Serial.printf("Pronto码无效: %s\n", prontoStatusName(prontoStatus));
+    } else {
+      Serial.printf("红外码无效: %s\n", codeImportStatusName(status));
+    }
+    return -1;
+  }
+  
+  if (irStorage.getFreeSlots() == 0) return -2;
+  return storeBundleEntry(entry);
+}
+
+void importCodeCommand(const char* text) {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  uint32_t convertUs = 0;
+  int id = importCodeLine(text, 0, convertUs);
+  if (id == -2) {
+    Serial.println("❌ 存储空间已满，请先删除信号");
+    return;
+  }
+  if (id < 0) {
+    Serial.println("💡 格式: code <名称> <Pronto码|协议:值[:位数]>，如 code tv_power NEC:0x20DF10EF:32");
+    return;
+  }
+  
+  IRSignal* signal = irStorage.getSignal(id);
+  Serial.printf("✅ 已导入信号 ID %d: %s\n", id, signal->name);
+  Serial.printf("📋 协议: %s, 值: 0x%08llX, 位数: %d, 脉冲: %d, 载波: %dkHz, 重复周期: %dms\n",
+               protocolName(signal->protocol), (unsigned long long)signal->value, signal->bits, signal->rawLength,
+               signal->carrierFreq, signal->repeatPeriod);
+  Serial.printf("⏱️ 解析+转换 %lu us%s\n", (unsigned long)convertUs,
+               prepareSignal(id) ? "，已预构建RMT数据项" : "");
+}
+
+void startCodeImport() {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  codeImport.active = true;
+  codeImport.accepted = 0;
+  codeImport.failed = 0;
+  codeImport.dropped = 0;
+  codeImport.convertUs = 0;
+  codeImport.prepareUs = 0;
+  
+  // 全部行在end时一次写入存储
+  irStorage.setQuiet(true);
+  irStorage.beginBatch();
+  
+  Serial.printf("📥 逐行输入红外码 '<名称> <Pronto码|协议:值[:位数]>'，#开头为注释 (剩余 %d 个槽位)\n",
+               irStorage.getFreeSlots());
+  Serial.println("   输入 'end' 一次性保存，'cancel' 放弃");
+}
+
+void handleCodeLine(const char* line) {
+  if (*line == '#') return;
+  
+  ParsedCommand parsed;
+  parseCommand(line, parsed);
+  if (parsed.equals("end") || parsed.equals("cancel")) {
+    finishCodeImport(parsed.equals("end"));
+    Serial.print("> ");
+    return;
+  }
+  
+  int lineNo = codeImport.accepted + codeImport.failed + codeImport.dropped + 1;
+  uint32_t convertUs = 0;
+  int id = importCodeLine(line, lineNo, convertUs);
+  if (id == -1) {
+    codeImport.failed++;
+    return;
+  }
+  codeImport.convertUs += convertUs;
+  if (id < 0) {
+    codeImport.dropped++;
+    return;
+  }
+  
+  codeImport.accepted++;
+  uint32_t start = micros();
+  prepareSignal(id);
+  codeImport.prepareUs += micros() - start;
+}
+
+void finishCodeImport(bool commit) {
+  codeImport.active = false;
+  
+  if (!commit) {
+    irStorage.abortBatch();
+    irStorage.setQuiet(false);
+    Serial.println("❌ 已放弃本次导入，信号库保持不变");
+    return;
+  }
+  
+  uint32_t commitStart = micros();
+  irStorage.endBatch();
+  uint32_t commitUs = micros() - commitStart;
+  irStorage.setQuiet(false);
+  
+  Serial.printf("\n✅ 导入 %d 个信号，解析失败 %d 行", codeImport.accepted, codeImport.failed);
+  if (codeImport.dropped > 0) Serial.printf("，存储已满未保存 %d 行", codeImport.dropped);
+  Serial.println();
+  
+  int converted = codeImport.accepted + codeImport.dropped;
+  if (converted > 0) {
+    Serial.printf("⏱️ 解析+转换 平均 %lu us/个 (%lu 个/秒)",
+                 (unsigned long)(codeImport.convertUs / converted),
+                 codeImport.convertUs > 0 ? (unsigned long)((uint64_t)converted * 1000000 / codeImport.convertUs) : 0UL);
+    if (codeImport.accepted > 0) {
+      Serial.printf("，RMT预构建 平均 %lu us/个", (unsigned long)(codeImport.prepareUs / codeImport.accepted));
+    }
+    Serial.printf("，写入存储 %u ms\n", commitUs / 1000);
+  }
+}
+
+void analyzeSignals(bool apply) {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  // 中间表示约600字节，不放在栈上
+  static BundleEntry entry;
+  int candidates = 0, upgraded = 0;
+  size_t bytesBefore = irStorage.getUsedMemory();
+  uint32_t analyzeUs = 0;
+  
+  Serial.printf("\n🔬 分析UNKNOWN信号的脉冲结构%s\n", apply ? "并改写为参数化记录" : " (预览，analyze apply 执行改写)");
+  if (apply) irStorage.beginBatch();
+  
+  for (int id = 1; id <= irStorage.getCapacity(); id++) {
+    IRSignal* signal = irStorage.getSignal(id);
+    if (!signal || signal->protocol != UNKNOWN || signal->parametric || signal->rawLength == 0) continue;
+    candidates++;
+    bundleSource(id - 1, entry, nullptr);
+    size_t before = irStorage.getRecordSize(id);
+    
+    // 先按已知协议解码，不行再推断时序
+    uint32_t start = micros();
+    DecodedSignal decoded;
+    PulseAnalysis analysis;
+    AnalyzeStatus status = ANALYZE_NO_STRUCTURE;
+    bool known = decodePulses(entry.rawData, entry.rawLength, decoded) && !decoded.repeat;
+    if (!known) status = analyzeEntry(entry, analysis);
+    analyzeUs += micros() - start;
+    
+    if (known) {
+      Serial.printf("  ID:%2d %-15s → %s 0x%08llX %d位\n", id, signal->name,
+                   protocolName(decoded.protocol), (unsigned long long)decoded.value, decoded.bits);
+    } else if (status == ANALYZE_OK) {
+      const ProtocolDescriptor& d = analysis.desc;
+      Serial.printf("  ID:%2d %-15s → %s 引导%u/%u 1=%u/%u 0=%u/%u 结束%u, 0x%08llX %d位, 偏差%d%%\n",
+                   id, signal->name, pulseCodeKindName(analysis.kind), d.hdrMark, d.hdrSpace,
+                   d.oneMark, d.oneSpace, d.zeroMark, d.zeroSpace, d.footerMark,
+                   (unsigned long long)analysis.value, analysis.bits, analysis.maxErrorPct);
+    } else {
+      Serial.printf("  ID:%2d %-15s ✗ %s\n", id, signal->name, analyzeStatusName(status));
+      continue;
+    }
+    if (!apply) continue;
+    
+    bool ok;
+    if (known) {
+      ok = irStorage.setParametric(id, decoded.protocol, *IRTransmitter::descriptorFor(decoded.protocol),
+                                   decoded.value, decoded.bits);
+    } else {
+      ok = irStorage.setParametric(id, UNKNOWN, analysis.desc, analysis.value, analysis.bits);
+    }
+    if (ok) {
+      upgraded++;
+      Serial.printf("        %u → %u 字节\n", (unsigned)before, (unsigned)irStorage.getRecordSize(id));
+    }
+  }
+  
+  if (apply) irStorage.endBatch();
+  
+  Serial.printf("📊 UNKNOWN信号 %d 个", candidates);
+  if (apply) {
+    Serial.printf("，改写 %d 个，存储 %u → %u 字节", upgraded,
+                 (unsigned)bytesBefore, (unsigned)irStorage.getUsedMemory());
+  }
+  if (candidates > 0) Serial.printf("，分析平均 %lu us/个", (unsigned long)(analyzeUs / candidates));
+  Serial.println();
+}
+
+void dedupeSignals(bool apply) {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  DuplicatePair pairs[20];
+  uint32_t start = micros();
+  int found = irStorage.findDuplicates(pairs, 20);
+  uint32_t elapsedUs = micros() - start;
+  size_t bytesBefore = irStorage.getUsedMemory();
+  
+  Serial.printf("\n🔁 查找重复信号%s\n", apply ? "并合并" : " (预览，dedupe apply 执行合并)");
+  for (int i = 0; i < found; i++) {
+    IRSignal* keep = irStorage.getSignal(pairs[i].keepId);
+    IRSignal* dup = irStorage.getSignal(pairs[i].duplicateId);
+    Serial.printf("  ID:%2d %-15s = ID:%2d %-15s (%s, 指纹 %08lX)\n", pairs[i].duplicateId, dup->name,
+                 pairs[i].keepId, keep->name, protocolName(keep->protocol),
+                 (unsigned long)irStorage.getFingerprint(pairs[i].keepId));
+  }
+  
+  int merged = 0;
+  if (apply && found > 0) {
+    irStorage.beginBatch();
+    for (int i = 0; i < found; i++) {
+      if (!irStorage.mergeDuplicate(pairs[i].keepId, pairs[i].duplicateId)) continue;
+      // 保留的信号可能补上了载波和重复帧，删除的槽位会被新信号复用，两者的闭环统计都重新开始
+      retryPolicy.reset(pairs[i].keepId);
+      retryPolicy.reset(pairs[i].duplicateId);
+      merged++;
+    }
+    irStorage.endBatch();
   }
   
-  delay(10);
+  Serial.printf("📊 %d 个信号中有 %d 个重复", irStorage.getSignalCount() + merged, found);
+  if (apply) {
+    Serial.printf("，合并 %d 个，存储 %u → %u 字节", merged,
+                 (unsigned)bytesBefore, (unsigned)irStorage.getUsedMemory());
+  }
+  Serial.printf("，查找用时 %lu us\n", (unsigned long)elapsedUs);
+}
+
+void runSoak(int id, int count) {
+  IRSignal* signal = &txSignal;
+  if (!irStorage.snapshot(id, txSignal)) {
+    Serial.printf("❌ 错误: 信号 ID %d 不存在\n", id);
+    return;
+  }
+  
+  Serial.printf("\n🧪 浸泡测试: 信号 ID %d 连续发射 %d 次，期间不响应其他命令...\n", id, count);
+  SystemState previousState = currentState;
+  currentState = TRANSMITTING;
+  
+  // 测量期间关闭发射过程日志，统计的是发射路径本身
+  bool verbose = irTransmitter.isVerbose();
+  irTransmitter.setVerbose(false);
+  bool counting = heapAllocationCounting();
+  
+  // 先发射一次，把协议名缓存、驱动内部缓冲等一次性分配排除在统计之外
+  uint16_t repeat = signal->protocol == UNKNOWN ? 0 : 2;
+  irTransmitter.sendSignal(*signal, repeat);
+  
+  // 每次发射后取走接收器捕获到的回波：接收路径(解码、分类、捕获环、超时自适应)也在统计之内
+  HeapSnapshot before = takeHeapSnapshot();
+  uint32_t rebuilds = irReceiver.getRebuildCount();
+  uint32_t rebuildAllocations = irReceiver.getRebuildAllocations();
+  int failures = 0;
+  int echoes = 0;
+  for (int i = 0; i < count; i++) {
+    if (!irTransmitter.sendSignal(*signal, repeat)) {
+      failures++;
+    }
+    while (irReceiver.decode()) echoes++;
+  }
+  HeapSnapshot after = takeHeapSnapshot();
+  irTransmitter.setVerbose(verbose);
+  currentState = previousState == TRANSMITTING ? IDLE : previousState;
+  rebuilds = irReceiver.getRebuildCount() - rebuilds;
+  rebuildAllocations = irReceiver.getRebuildAllocations() - rebuildAllocations;
+  
+  int32_t blocks = heapBlockDelta(before, after);
+  int32_t bytes = heapFreeDelta(before, after);
+  // 调整帧结束超时时重建IRrecv会重新分配捕获缓冲，有频率限制，单独列出不计入
+  uint32_t allocations = heapAllocationDelta(before, after) - rebuildAllocations;
+  Serial.println("\n🧪 浸泡测试结果：");
+  Serial.printf("  发射: %d 次，失败 %d 次，接收回波 %d 帧\n", count, failures, echoes);
+  if (counting) {
+    Serial.printf("  堆分配次数: %u (每次发射 %.2f，含其他任务)\n", allocations, (float)allocations / count);
+    if (rebuilds > 0) {
+      Serial.printf("  另有接收器重建 %u 次，分配 %u 次(不计入)\n", rebuilds, rebuildAllocations);
+    }
+  } else {
+    Serial.println("  堆分配次数: 未统计(生产构建；用 pio run -e esp32dev_diag 构建的诊断固件统计)");
+  }
+  Serial.printf("  已分配块变化: %+d (每次 %.2f)\n", blocks, (float)blocks / count);
+  Serial.printf("  空闲字节变化: %+d\n", bytes);
+  Serial.printf("  最大连续空闲块: %u -> %u 字节\n", before.largestBlock, after.largestBlock);
+  Serial.printf("  水位线: %u 字节\n", after.minFreeBytes);
+  if (counting ? allocations == 0 : (blocks == 0 && bytes == 0)) {
+    Serial.printf("  ✅ 发射路径%s\n", counting ? "没有任何堆分配" : "没有残留堆分配(未统计临时分配)");
+  } else if (counting) {
+    Serial.println("  ⚠️ 发射期间发生了堆分配(含释放掉的临时缓冲)");
+  } else {
+    Serial.println("  ⚠️ 发射前后堆状态不一致，发射路径可能存在堆分配");
+  }
+}
+
+// ============== 存储并发压力测试 ==============
+
+// 写者在另一个核心上反复删除重建信号1、重命名信号2，读者在主循环中不断取快照检查：
+//   信号1  名称为 "s<值>"，第i个脉冲为 值+i
+//   信号2  名称由同一个字符重复构成
+// 快照被写入撕裂时上述关系不成立。使用独立的内存存储，不影响已保存的信号
+struct StorageStress {
+  IRStorage* storage;
+  volatile bool running;
+  volatile bool finished;
+  uint32_t writes;
+  uint32_t writeUs;
+};
+
+static const uint16_t STRESS_PULSES = 64;
+
+static void storageStressWriter(void* arg) {
+  StorageStress* stress = (StorageStress*)arg;
+  uint16_t raw[STRESS_PULSES];
+  char name[32];
+  uint32_t k = 0;
+  
+  while (stress->running) {
+    k++;
+    uint32_t start = micros();
+    if (k % 2) {
+      for (uint16_t i = 0; i < STRESS_PULSES; i++) raw[i] = (uint16_t)(k + i);
+      snprintf(name, sizeof(name), "s%u", k);
+      stress->storage->deleteSignal(1);
+      stress->storage->addSignal(UNKNOWN, k, 0, raw, STRESS_PULSES, name);
+    } else {
+      memset(name, 'a' + k % 26, 31);
+      name[31] = '\0';
+      stress->storage->setSignalName(2, name);
+    }
+    stress->writeUs += micros() - start;
+    stress->writes++;
+    // 让出CPU给同核心的空闲任务，避免触发任务看门狗
+    if (k % 64 == 0) vTaskDelay(1);
+  }
+  stress->finished = true;
+  vTaskDelete(nullptr);
+}
+
+static bool stressSnapshotIntact(int id, const IRSignal& signal) {
+  if (id == 2) {
+    for (int i = 1; i < 31; i++) {
+      if (signal.name[i] != signal.name[0]) return false;
+    }
+    return signal.name[31] == '\0';
+  }
+  char expected[32];
+  snprintf(expected, sizeof(expected), "s%u", (uint32_t)signal.value);
+  if (strcmp(signal.name, expected) != 0 || signal.rawLength != STRESS_PULSES) return false;
+  for (uint16_t i = 0; i < STRESS_PULSES; i++) {
+    if (signal.rawData[i] != (uint16_t)(signal.value + i)) return false;
+  }
+  return true;
 }
 
-void processCommand(String command) {
-  command.trim();
-  command.toLowerCase();
+void runStorageStress(uint32_t durationMs) {
+  if (currentState != IDLE) {
+    Serial.println("⚠️ 请先输入 'stop' 结束当前操作");
+    return;
+  }
+  
+  RamStorageBackend* backend = new RamStorageBackend();
+  StorageStress* stress = new StorageStress();
+  stress->storage = new IRStorage(backend);
+  stress->storage->setQuiet(true);
+  stress->storage->begin();
+  uint16_t raw[STRESS_PULSES];
+  for (uint16_t i = 0; i < STRESS_PULSES; i++) raw[i] = i;
+  stress->storage->addSignal(UNKNOWN, 0, 0, raw, STRESS_PULSES, "s0");
+  stress->storage->addSignal(UNKNOWN, 0, 0, raw, STRESS_PULSES, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  
+  // 主循环运行在核心1，写者放到核心0，两边真正并行
+  Serial.printf("\n🧪 存储并发压力测试 %u ms：写者(核心0)删除重建/重命名并提交，读者(主循环)取快照校验...\n",
+               durationMs);
+  stress->running = true;
+  TaskHandle_t writer = nullptr;
+  if (xTaskCreatePinnedToCore(storageStressWriter, "stress_writer", 4096, stress, 1, &writer, 0) != pdPASS) {
+    Serial.println("❌ 无法创建写者任务");
+    delete stress->storage;
+    delete stress;
+    delete backend;
+    return;
+  }
   
-  if (command == "help") {
+  static IRSignal snapshot;
+  uint32_t reads = 0, missing = 0, torn = 0, maxReadUs = 0;
+  uint32_t retriesBefore = stress->storage->getSnapshotRetries();
+  unsigned long start = millis();
+  while (millis() - start < durationMs) {
+    for (int id = 1; id <= 2; id++) {
+      uint32_t t0 = micros();
+      bool valid = stress->storage->snapshot(id, snapshot);
+      uint32_t us = micros() - t0;
+      if (us > maxReadUs) maxReadUs = us;
+      reads++;
+      if (!valid) {
+        missing++;                 // 信号1删除与重建之间
+      } else if (!stressSnapshotIntact(id, snapshot)) {
+        torn++;
+      }
+    }
+  }
+  
+  stress->running = false;
+  while (!stress->finished) vTaskDelay(1);
+  
+  uint32_t writes = stress->writes;
+  Serial.println("\n🧪 压力测试结果：");
+  Serial.printf("  读者: 快照 %u 次，不完整 %u 次，信号不存在 %u 次，重试 %u 次，单次最长 %u us\n",
+                reads, torn, missing, stress->storage->getSnapshotRetries() - retriesBefore, maxReadUs);
+  Serial.printf("  写者: 修改 %u 次(每次立即提交)，平均 %u us，闪存提交 %u 次\n",
+                writes, writes > 0 ? stress->writeUs / writes : 0, backend->getCommitCount());
+  if (torn == 0) {
+    Serial.println("  ✅ 所有快照完整，读者没有看到写入中的记录");
+  } else {
+    Serial.println("  ❌ 出现不完整的快照");
+  }
+  
+  delete stress->storage;
+  delete stress;
+  delete backend;
+}
+
+void showFilterStatus() {
+  const PulseFilterConfig& config = pulseFilter.getConfig();
+  const PulseFilterStats& stats = pulseFilter.getStats();
+  
+  Serial.printf("\n🧹 脉冲过滤: %s\n", config.enabled ? "开启" : "关闭");
+  Serial.printf("  毛刺阈值: %u us, 吸附容差: %u%%, 最少脉冲: %u\n",
+                config.glitchUs, config.snapPercent, config.minPulses);
+  Serial.printf("  拒绝条件: 毛刺 > %u%%, 无法归类 > %u%%\n",
+                config.maxGlitchPercent, config.maxIrregularPercent);
+  Serial.printf("  已处理 %u 帧，通过 %u，拒绝: 过短 %u / 毛刺过多 %u / 时长分散 %u\n",
+                stats.frames, stats.accepted, stats.rejected[FILTER_TOO_SHORT],
+                stats.rejected[FILTER_TOO_NOISY], stats.rejected[FILTER_IRREGULAR]);
+  Serial.printf("  合并毛刺 %u 个，吸附脉冲 %u 个", stats.glitches, stats.snapped);
+  if (stats.accepted > 0) {
+    Serial.printf("，通过帧的脉冲数 %u -> %u", stats.pulsesIn, stats.pulsesOut);
+  }
+  Serial.println();
+  Serial.println("💡 过滤在学习采样时进行，只影响之后入库的信号");
+  Serial.println();
+}
+
+void showDecoderStatus() {
+  const AdaptiveDecoder& decoder = irReceiver.getProtocolDecoder();
+  uint8_t enabled = decoder.getEnabled();
+  
+  Serial.printf("\n🔎 协议解码: %s\n", IR_LIBRARY_DECODERS ? "IRrecv全部协议解码器" : "站点构建(IRrecv只捕获，按描述符解码)");
+  Serial.print("  启用: ");
+  if (enabled == AdaptiveDecoder::ALL) {
+    Serial.print(IR_LIBRARY_DECODERS ? "全部协议" : "NEC SONY RC5");
+  } else if (enabled == 0) {
+    Serial.print("无(全部按原始数据处理)");
+  } else {
+    for (int i = 0; i < DECODER_COUNT; i++) {
+      if (enabled & (1 << i)) Serial.printf("%s ", decoderSlotName((DecoderSlot)i));
+    }
+  }
+  Serial.println();
+  
+  Serial.print("  顺序(命中): ");
+  for (int rank = 0; rank < DECODER_COUNT; rank++) {
+    DecoderSlot slot = decoder.slotAt(rank);
+    if (!decoder.isEnabled(slot)) continue;
+    Serial.printf("%s(%u) ", decoderSlotName(slot), decoder.getHits(slot));
+  }
+  Serial.println();
+  
+  if (decoder.getFrames() > 0) {
+    Serial.printf("  描述符解码 %u 帧，尝试 %u 次(平均 %.2f)，第一次命中 %u 帧，未识别 %u 帧\n",
+                  decoder.getFrames(), decoder.getAttempts(),
+                  (float)decoder.getAttempts() / decoder.getFrames(),
+                  decoder.getFirstTryHits(), decoder.getMisses());
+  }
+  if (irReceiver.getFilteredFrames() > 0) {
+    Serial.printf("  未启用协议改为UNKNOWN: %u 帧\n", irReceiver.getFilteredFrames());
+  }
+  
+  const LatencyHistogram& hist = LatencyStats::get(STAGE_RX_DECODE);
+  Serial.printf("  每帧解码: %u 帧，p50 %u us / p99 %u us / max %u us\n", hist.count(),
+                LatencyStats::toMicros(hist.percentile(500)),
+                LatencyStats::toMicros(hist.percentile(990)),
+                LatencyStats::toMicros(hist.max()));
+  Serial.printf("  固件大小: %u 字节 (剩余空间 %u 字节)\n", ESP.getSketchSize(), ESP.getFreeSketchSpace());
+  Serial.println("💡 分别烧录esp32dev和esp32dev_site环境，decoders reset后接收同样的帧即可比较前后的解码时间和固件大小");
+  Serial.println();
+}
+
+void showCaptureStatus() {
+  const CaptureTuner& tuner = irReceiver.getCaptureTuner();
+  const CaptureTunerConfig& config = tuner.getConfig();
+  const CaptureTunerStats& stats = tuner.getStats();
+  
+  Serial.printf("\n📥 捕获参数自适应: %s\n", irReceiver.isAutoTune() ? "开启" : "关闭");
+  Serial.printf("  帧结束超时: %u ms (目标 %u，范围 %u-%u)\n", tuner.getTimeoutMs(), tuner.targetTimeoutMs(),
+                config.minTimeoutMs, config.maxTimeoutMs);
+  Serial.printf("  捕获缓冲: %u 项 (%u 字节，固定)\n", CAPTURE_BUFFER_SIZE, CAPTURE_BUFFER_SIZE * 2);
+  Serial.printf("  重建IRrecv: %u 次 (至少间隔 %lu 秒)，期间堆分配 %u 次\n", irReceiver.getRebuildCount(),
+                IRReceiver::REBUILD_MIN_INTERVAL_MS / 1000, irReceiver.getRebuildAllocations());
+  Serial.printf("  本会话 %u 帧，溢出 %u (%u.%u%%)，判定截断 %u，已调整 %u 次\n", stats.frames, stats.overflows,
+                tuner.overflowPermille() / 10, tuner.overflowPermille() % 10, stats.splits, stats.retunes);
+  
+  const LatencyHistogram& latency = tuner.getLatency();
+  if (latency.count() > 0) {
+    Serial.printf("  按键到解码(帧长+超时): p50 %u us / p99 %u us / max %u us，另加帧结束检查 %d ms以内\n",
+                  latency.percentile(500), latency.percentile(990), latency.max(),
+                  rxWakeup ? RX_FRAME_CHECK : INPUT_POLL_INTERVAL);
+  }
+  Serial.println("💡 学习开始时自动开始新会话；主机端 tunereplay 用语料比较固定参数与自适应的效果");
+  Serial.println();
+}
+
+void setDecoders(const char* names) {
+  uint8_t mask = 0;
+  char buffer[48];
+  strncpy(buffer, names, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+  
+  for (char* name = strtok(buffer, " "); name; name = strtok(nullptr, " ")) {
+    if (strcasecmp(name, "all") == 0) {
+      mask = AdaptiveDecoder::ALL;
+      continue;
+    }
+    int slot = 0;
+    while (slot < DECODER_COUNT && strcasecmp(name, decoderSlotName((DecoderSlot)slot)) != 0) slot++;
+    if (slot == DECODER_COUNT) {
+      Serial.printf("错误: 未知协议 %s，可选 all|nec|sony|rc5\n", name);
+      return;
+    }
+    mask |= 1 << slot;
+  }
+  if (mask == 0) {
+    Serial.println("错误: decoders命令格式为 'decoders <all|nec sony rc5>'");
+    return;
+  }
+  
+  irReceiver.setEnabledProtocols(mask);
+  showDecoderStatus();
+}
+
+void dumpCaptures(const char* model) {
+  int count = captureRing.size();
+  if (count == 0) {
+    Serial.println("暂无捕获的信号，请先对准接收器按遥控器");
+    return;
+  }
+  
+  char* line = (char*)malloc(CORPUS_MAX_LINE);
+  CorpusFrame* frame = (CorpusFrame*)malloc(sizeof(CorpusFrame));
+  if (!line || !frame) {
+    Serial.println("❌ 内存不足，无法导出");
+    free(line);
+    free(frame);
+    return;
+  }
+  
+  // 头部和注释行以#开头，其余每行一帧，可直接保存为语料文件
+  Serial.println(CORPUS_HEADER);
+  Serial.printf("# captures=%d total=%u\n", count, captureRing.totalCaptured());
+  for (int i = 0; i < count; i++) {
+    *frame = *captureRing.at(i);
+    if (model && model[0]) {
+      strncpy(frame->model, model, CorpusFrame::MAX_MODEL - 1);
+      frame->model[CorpusFrame::MAX_MODEL - 1] = '\0';
+    }
+    if (formatCorpusFrame(*frame, line, CORPUS_MAX_LINE) > 0) {
+      Serial.println(line);
+    }
+  }
+  Serial.println("# end");
+  
+  free(line);
+  free(frame);
+}
+
+void waitMicros(uint32_t us) {
+  if (us >= 2000) {
+    vTaskDelay(pdMS_TO_TICKS(us / 1000));
+  } else {
+    delayMicroseconds(us);
+  }
+}
+
+void replayCaptures(int times, int speedPct) {
+  int count = captureRing.size();
+  if (count == 0) {
+    Serial.println("暂无捕获的信号可回放");
+    return;
+  }
+  
+  char* line = (char*)malloc(CORPUS_MAX_LINE);
+  CorpusFrame* frame = (CorpusFrame*)malloc(sizeof(CorpusFrame));
+  CorpusReplay* replay = new CorpusReplay(replayDecodePulses, nullptr, clockMicros, waitMicros);
+  if (!line || !frame || !replay) {
+    Serial.println("❌ 内存不足，无法回放");
+    free(line);
+    free(frame);
+    delete replay;
+    return;
+  }
+  
+  if (speedPct > 0) {
+    Serial.printf("▶️ 回放 %d 帧 x %d 遍，速度: %d%%\n", count, times, speedPct);
+  } else {
+    Serial.printf("▶️ 回放 %d 帧 x %d 遍，速度: 最快\n", count, times);
+  }
+  
+  // 多遍回放时按捕获跨度平移时间戳，保持帧间隔
+  uint32_t span = captureRing.at(count - 1)->timestampMs - captureRing.at(0)->timestampMs + 1000;
+  replay->begin(speedPct);
+  for (int pass = 0; pass < times; pass++) {
+    for (int i = 0; i < count; i++) {
+      // 经过语料文本格式往返，与从文件回放的路径一致
+      if (formatCorpusFrame(*captureRing.at(i), line, CORPUS_MAX_LINE) == 0 ||
+          !parseCorpusFrame(line, *frame)) {
+        continue;
+      }
+      frame->timestampMs += pass * span;
+      replay->feed(*frame);
+    }
+  }
+  replay->end();
+  
+  const ReplayStats& stats = replay->getStats();
+  Serial.println("\n📊 回放结果：");
+  Serial.printf("  帧数: %u (已标注 %u)\n", stats.frames, stats.labeled);
+  Serial.printf("  解码: %u，正确: %u，不一致: %u，未解码: %u\n",
+                stats.decoded, stats.correct, stats.mismatched, stats.missed);
+  if (stats.labeled > 0) {
+    Serial.printf("  解码准确率: %.1f%%\n", stats.correct * 100.0 / stats.labeled);
+  }
+  Serial.printf("  学习会话: %u，选出正确信号: %u\n", stats.sessions, stats.sessionsCorrect);
+  Serial.printf("  耗时: %u ms，吞吐: %u 帧/秒\n", stats.elapsedUs / 1000, replay->framesPerSecond());
+  Serial.println("💡 期望值来自IRrecv，回放使用内置的NEC/SONY/RC5描述符解码器");
+  Serial.println();
+  
+  free(line);
+  free(frame);
+  delete replay;
+}
+
+void showEventStats() {
+  static const char* names[EVENT_TYPE_COUNT] = {"UART", "IR_RX", "TX_DONE"};
+  
+  Serial.println("\n⏱️ 事件延迟统计(投递到处理)：");
+  Serial.println("事件     | 次数     | 平均(us) | 最大(us) | 最近(us)");
+  Serial.println("---------|----------|----------|----------|----------");
+  for (int i = 0; i < EVENT_TYPE_COUNT; i++) {
+    const EventLatencyStats& stats = eventLoop.getLatency((EventType)i);
+    uint32_t avg = stats.count > 0 ? (uint32_t)(stats.totalUs / stats.count) : 0;
+    Serial.printf("%-8s | %8u | %8u | %8u | %8u\n",
+                  names[i], stats.count, avg, stats.maxUs, stats.lastUs);
+  }
+  Serial.println();
+}
+
+void processCommand(const char* line) {
+  ScopedLatency latency(STAGE_COMMAND);
+  
+  // 整行转小写后与数字参数一起解析到固定缓冲，括号等装饰字符在解析时忽略
+  ParsedCommand parsed;
+  if (!parseCommand(line, parsed)) return;
+  
+  if (parsed.equals("help")) {
     showHelp();
-  } else if (command == "learn") {
+  } else if (parsed.equals("learn")) {
     startLearning();
-  } else if (command == "stop") {
+  } else if (parsed.equals("learn batch") || parsed.startsWith("learn batch ")) {
+    const char* prefix = parsed.tail(2);
+    startBatchLearning(*prefix ? prefix : "key");
+  } else if (parsed.equals("stop")) {
     stopCurrentOperation();
-  } else if (command == "list") {
+  } else if (parsed.equals("list")) {
     listStoredSignals();
-  } else if (command == "clear") {
+  } else if (parsed.equals("clear")) {
     clearAllSignals();
-  } else if (command.startsWith("send ")) {
-    String idStr = command.substring(5);
-    idStr.trim();
-    // 清理尖括号和其他非数字字符
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.replace("(", "");
-    idStr.replace(")", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("send") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       sendSignal(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command.startsWith("repeat ")) {
-    int spaceIndex = command.indexOf(' ', 7);
-    if (spaceIndex > 0) {
-      String idStr = command.substring(7, spaceIndex);
-      String timesStr = command.substring(spaceIndex + 1);
-      idStr.trim();
-      timesStr.trim();
-      // 清理尖括号
-      idStr.replace("<", "");
-      idStr.replace(">", "");
-      idStr.replace("[", "");
-      idStr.replace("]", "");
-      timesStr.replace("<", "");
-      timesStr.replace(">", "");
-      timesStr.replace("[", "");
-      timesStr.replace("]", "");
-      idStr.trim();
-      timesStr.trim();
-      int id = idStr.toInt();
-      int times = timesStr.toInt();
+  } else if (parsed.is("repeat") && parsed.argc >= 1) {
+    if (parsed.argc >= 2) {
+      int id = parsed.arg(0);
+      int times = parsed.arg(1);
       if (id > 0 && times > 0) {
         repeatSignal(id, times);
       } else {
@@ -180,106 +1422,210 @@ void processCommand(String command) {
     } else {
       Serial.println("错误: repeat命令格式为 'repeat <id> <times>'");
     }
-  } else if (command.startsWith("delete ")) {
-    String idStr = command.substring(7);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("hold") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
+    int ms = parsed.arg(1, 1000);
+    if (id > 0 && ms > 0 && ms <= 60000) {
+      holdSignal(id, ms);
+    } else {
+      Serial.println("错误: hold命令格式为 'hold <id> <ms>'，ms范围 1-60000");
+    }
+  } else if (parsed.is("delete") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       deleteSignal(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command.startsWith("info ")) {
-    String idStr = command.substring(5);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("info") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       showSignalInfo(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command.startsWith("detail ")) {
-    String idStr = command.substring(7);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("detail") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       showDetailedSignalInfo(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command.startsWith("raw ")) {
-    String idStr = command.substring(4);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("raw") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       showRawData(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command == "test") {
+  } else if (parsed.equals("test")) {
     testTransmitter();
-  } else if (command.startsWith("verify ")) {
-    String idStr = command.substring(7);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("verify") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       verifySignal(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command.startsWith("continuous ")) {
-    String idStr = command.substring(11);
-    idStr.trim();
-    // 清理尖括号
-    idStr.replace("<", "");
-    idStr.replace(">", "");
-    idStr.replace("[", "");
-    idStr.replace("]", "");
-    idStr.trim();
-    int id = idStr.toInt();
+  } else if (parsed.is("continuous") && parsed.argc >= 1) {
+    int id = parsed.arg(0);
     if (id > 0) {
       continuousVerifySignal(id);
     } else {
       Serial.println("错误: 无效的信号ID，请输入正整数");
     }
-  } else if (command == "gpio") {
+  } else if (parsed.equals("gpio")) {
     testGPIO2();
-  } else if (command == "testgpio4") {
+  } else if (parsed.equals("testgpio4")) {
     irTransmitter.testGPIO4();
-  } else if (command == "diag") {
+  } else if (parsed.equals("diag")) {
     diagnosePullupResistor();
-  } else if (command == "rmt") {
+  } else if (parsed.equals("rmt")) {
     toggleRMT();
+  } else if (parsed.equals("loopback")) {
+    toggleLoopback();
+  } else if (parsed.equals("match")) {
+    matchMode = !matchMode;
+    irReceiver.reset();
+    Serial.printf("✅ 识别模式已%s\n", matchMode ? "启用：按下遥控器按键，显示匹配的信号ID" : "禁用");
+  } else if (parsed.equals("loopback stats")) {
+    showLoopbackStats();
+  } else if (parsed.equals("stats")) {
+    showLatencyStats();
+  } else if (parsed.equals("sync")) {
+    syncStorage();
+  } else if (parsed.is("rename")) {
+    int id = parsed.arg(0);
+    if (parsed.argc >= 2 && id > 0) {
+      // 名称从原始输入中取，保留大小写
+      const char* name = line;
+      for (int word = 0; word < 2; word++) {
+        while (isspace((unsigned char)*name)) name++;
+        while (*name && !isspace((unsigned char)*name)) name++;
+      }
+      while (isspace((unsigned char)*name)) name++;
+      renameSignal(id, name);
+    } else {
+      Serial.println("错误: rename命令格式为 'rename <id> <名称>'");
+    }
+  } else if (parsed.is("code")) {
+    if (parsed.argc >= 2) {
+      // 名称和红外码从原始输入中取，保留大小写
+      const char* text = line;
+      while (isspace((unsigned char)*text)) text++;
+      while (*text && !isspace((unsigned char)*text)) text++;
+      importCodeCommand(text);
+    } else {
+      Serial.println("错误: code命令格式为 'code <名称> <Pronto码|协议:值[:位数]>'");
+    }
+  } else if (parsed.equals("codes")) {
+    startCodeImport();
+  } else if (parsed.equals("analyze") || parsed.equals("analyze apply")) {
+    analyzeSignals(parsed.equals("analyze apply"));
+  } else if (parsed.equals("dedupe") || parsed.equals("dedupe apply")) {
+    dedupeSignals(parsed.equals("dedupe apply"));
+  } else if (parsed.startsWith("dedupe policy")) {
+    // dedupe policy <keep|reject|merge>
+    const char* name = parsed.tail(2);
+    if (strcmp(name, "keep") == 0) irStorage.setDuplicatePolicy(DUPLICATE_KEEP);
+    else if (strcmp(name, "reject") == 0) irStorage.setDuplicatePolicy(DUPLICATE_REJECT);
+    else if (strcmp(name, "merge") == 0) irStorage.setDuplicatePolicy(DUPLICATE_MERGE);
+    else if (name[0]) Serial.println("错误: dedupe policy 取值为 keep|reject|merge");
+    Serial.printf("🔁 新增重复信号时: %s\n", duplicatePolicyName(irStorage.getDuplicatePolicy()));
+  } else if (parsed.equals("export")) {
+    exportBundle();
+  } else if (parsed.equals("import") || parsed.equals("import append")) {
+    startBundleImport(parsed.equals("import"));
+  } else if (parsed.is("soak")) {
+    // soak [次数] [id]
+    int times = parsed.arg(0, 20);
+    int id = parsed.arg(1, 1);
+    if (times > 0 && times <= 10000 && id > 0) {
+      runSoak(id, times);
+    } else {
+      Serial.println("错误: soak命令格式为 'soak [次数1-10000] [id]'");
+    }
+  } else if (parsed.is("stress")) {
+    // stress [毫秒]
+    int ms = parsed.arg(0, 2000);
+    if (ms >= 100 && ms <= 60000) {
+      runStorageStress(ms);
+    } else {
+      Serial.println("错误: stress命令格式为 'stress [毫秒100-60000]'");
+    }
+  } else if (parsed.equals("stats reset")) {
+    LatencyStats::resetAll();
+    irStorage.resetCommitStats();
+    Serial.println("阶段延迟和闪存提交统计已清零");
+  } else if (parsed.equals("dump clear")) {
+    captureRing.clear();
+    Serial.println("捕获缓存已清空");
+  } else if (parsed.is("dump")) {
+    // dump [型号]：型号写入每一帧的元数据
+    dumpCaptures(parsed.tail(1));
+  } else if (parsed.is("replay")) {
+    int times = parsed.arg(0, 1);
+    int speed = parsed.arg(1, 0);
+    if (times > 0 && times <= 1000 && speed >= 0) {
+      replayCaptures(times, speed);
+    } else {
+      Serial.println("错误: replay命令格式为 'replay [次数1-1000] [速度%，0为最快]'");
+    }
+  } else if (parsed.equals("filter")) {
+    showFilterStatus();
+  } else if (parsed.equals("filter on") || parsed.equals("filter off")) {
+    PulseFilterConfig config = pulseFilter.getConfig();
+    config.enabled = (parsed.equals("filter on"));
+    pulseFilter.setConfig(config);
+    Serial.printf("脉冲过滤已%s\n", config.enabled ? "开启" : "关闭");
+  } else if (parsed.startsWith("filter glitch") && parsed.argc >= 2) {
+    int us = parsed.arg(1);
+    if (us >= 0 && us <= 1000) {
+      PulseFilterConfig config = pulseFilter.getConfig();
+      config.glitchUs = us;
+      pulseFilter.setConfig(config);
+      Serial.printf("毛刺阈值: %d us\n", us);
+    } else {
+      Serial.println("错误: 毛刺阈值范围为 0-1000 us");
+    }
+  } else if (parsed.startsWith("filter snap") && parsed.argc >= 2) {
+    int pct = parsed.arg(1);
+    if (pct >= 0 && pct <= 50) {
+      PulseFilterConfig config = pulseFilter.getConfig();
+      config.snapPercent = pct;
+      pulseFilter.setConfig(config);
+      Serial.printf("吸附容差: %d%%%s\n", pct, pct == 0 ? " (不吸附)" : "");
+    } else {
+      Serial.println("错误: 吸附容差范围为 0-50%");
+    }
+  } else if (parsed.equals("filter reset")) {
+    pulseFilter.resetStats();
+    Serial.println("脉冲过滤统计已清零");
+  } else if (parsed.equals("txlog on") || parsed.equals("txlog off")) {
+    irTransmitter.setVerbose(parsed.equals("txlog on"));
+    Serial.printf("发射过程日志已%s\n", irTransmitter.isVerbose() ? "开启" : "关闭");
+  } else if (parsed.equals("decoders")) {
+    showDecoderStatus();
+  } else if (parsed.equals("decoders reset")) {
+    irReceiver.resetDecodeStats();
+    LatencyStats::resetAll();
+    Serial.println("解码器命中和阶段延迟统计已清零");
+  } else if (parsed.is("decoders")) {
+    // decoders <all|nec sony rc5 ...>
+    setDecoders(parsed.tail(1));
+  } else if (parsed.equals("capture")) {
+    showCaptureStatus();
+  } else if (parsed.equals("capture reset")) {
+    irReceiver.startCaptureSession();
+    Serial.println("捕获会话已重新开始，从当前超时和缓冲重新观察");
+  } else if (parsed.equals("capture auto on") || parsed.equals("capture auto off")) {
+    irReceiver.setAutoTune(parsed.equals("capture auto on"));
+    Serial.printf("捕获参数自适应已%s\n", irReceiver.isAutoTune() ? "开启" : "关闭");
+  } else if (parsed.equals("events")) {
+    showEventStats();
+  } else if (parsed.equals("events reset")) {
+    eventLoop.resetLatency();
+    Serial.println("事件延迟统计已清零");
   } else {
     Serial.println("未知命令，输入 'help' 查看可用命令");
   }
@@ -292,6 +1638,7 @@ void showHelp() {
   Serial.println("🔧 基础命令：");
   Serial.println("  help         - 显示此帮助信息");
   Serial.println("  learn        - 进入学习模式");
+  Serial.println("  learn batch [前缀] - 🆕 批量学习整个遥控器：每个按键按一次，结束时一次性入库");
   Serial.println("  stop         - 停止当前操作");
   Serial.println("  list         - 列出已学习的信号");
   Serial.println("  clear        - 清除所有已学习信号");
@@ -304,7 +1651,9 @@ void showHelp() {
     Serial.println("  test         - 测试发射器功能");
   }
   Serial.println("  repeat <id> <times> - 重复发射信号");
+  Serial.println("  hold <id> <ms> - 🆕 模拟按住按键：主帧后按学习到的周期发射重复帧");
   Serial.println("  delete <id>  - 删除指定ID的信号");
+  Serial.println("  rename <id> <名称> - 🆕 重命名信号");
   Serial.println("\n🔍 验证命令：");
   Serial.println("  verify <id>  - 🆕 标准验证(发射5次，间隔2秒)");
   Serial.println("  continuous <id> - 🎯 持续验证(每0.5秒发射，持续10秒)");
@@ -316,6 +1665,29 @@ void showHelp() {
   Serial.println("  testgpio4    - 🆕 测试GPIO4红外发射引脚输出");
   Serial.println("  diag         - 🆕 诊断上拉电阻问题");
   Serial.println("  rmt          - 🆕 切换RMT硬件发射器状态");
+  Serial.println("  loopback     - 🆕 切换闭环发射(接收器确认回波后停止重试)");
+  Serial.println("  loopback stats - 🆕 显示闭环发射的每信号统计");
+  Serial.println("  match        - 🆕 切换识别模式：收到的帧按特征索引在信号库中查找匹配的信号，未匹配时显示最接近的信号和置信度");
+  Serial.println("  events       - 🆕 显示事件延迟统计(events reset 清零)");
+  Serial.println("  stats        - 🆕 显示各阶段延迟p50/p99/max、堆内存水位和闪存提交统计(stats reset 清零)");
+  Serial.println("  sync         - 🆕 立即把未保存的修改提交到闪存(平时空闲1.5秒后自动提交)");
+  Serial.println("  export       - 🆕 以二进制包导出整个信号库(BUNDLE_BEGIN/BUNDLE_END之间)");
+  Serial.println("  import [append] - 🆕 从串口接收信号库包，校验通过后一次性写入(默认替换现有信号)");
+  Serial.println("  code <名称> <码> - 🆕 直接导入Pronto码或 协议:值[:位数]，无需学习");
+  Serial.println("  codes        - 🆕 逐行批量导入红外码，end一次性保存(cancel放弃)");
+  Serial.println("  analyze [apply] - 🆕 推断UNKNOWN信号的编码结构，apply改写为参数化记录(存储只保留描述符)");
+  Serial.println("  dedupe [apply] - 🆕 按指纹查找重复信号，apply合并到ID较小的一个并删除其余");
+  Serial.println("  dedupe policy <keep|reject|merge> - 🆕 学习或导入重复信号时照常新增/拒绝/合并(默认merge)");
+  Serial.println("  soak [n] [id] - 🆕 连续发射n次，统计期间的堆分配确认发射路径不分配内存(分配次数需诊断构建)");
+  Serial.println("  txlog on|off - 🆕 开关每次发射的过程日志(默认关闭，只输出错误)");
+  Serial.println("  stress [ms]  - 🆕 存储读写并发压力测试：另一核心不断修改，主循环取快照校验完整性");
+  Serial.println("  dump [model] - 🆕 以语料格式导出最近捕获的原始帧(dump clear 清空)");
+  Serial.println("  replay [n] [speed%] - 🆕 回放捕获帧n遍，统计解码准确率和帧率");
+  Serial.println("  filter       - 🆕 显示脉冲过滤配置与统计(filter on|off|reset)");
+  Serial.println("  filter glitch <us> / filter snap <pct> - 🆕 设置毛刺阈值/吸附容差");
+  Serial.println("  decoders     - 🆕 显示启用的协议、按命中排序的解码顺序、每帧解码时间和固件大小(decoders reset 清零)");
+  Serial.println("  decoders <all|nec sony rc5> - 🆕 只接收指定协议，其他协议按UNKNOWN原始数据处理");
+  Serial.println("  capture      - 🆕 显示自适应的帧结束超时和捕获缓冲、溢出率和按键到解码延迟(capture reset 新会话，capture auto on|off)");
   
   if (isLearning) {
     Serial.println("\n🎯 学习模式提示：");
@@ -324,212 +1696,533 @@ void showHelp() {
     Serial.println("  🔄 学习模式下发射不会退出学习状态");
   }
   
-  Serial.println("\n🚀 新功能亮点：");
-  Serial.println("  🎯 RMT硬件发射器 - 为UNKNOWN协议提供更稳定的发射");
-  Serial.println("  🔄 持续验证模式 - 实时观察信号稳定性");
-  Serial.println("  📊 智能协议选择 - 自动选择最佳发射方式");
+  Serial.println("\n🚀 新功能亮点：");
+  Serial.println("  🎯 RMT硬件发射器 - 为UNKNOWN协议提供更稳定的发射");
+  Serial.println("  🔄 持续验证模式 - 实时观察信号稳定性");
+  Serial.println("  📊 智能协议选择 - 自动选择最佳发射方式");
+  
+  Serial.println();
+}
+
+void startLearning() {
+  Serial.println("🎯 进入智能学习模式...");
+  Serial.println("================================");
+  Serial.printf("📊 配置: 至少 %d 个样本，%d 个样本且置信度达到 %d%% 时自动结束\n",
+               LearningConfig::MIN_SAMPLES, LearningConfig::TARGET_SAMPLES, LearningConfig::TARGET_CONFIDENCE);
+  Serial.printf("⏱️ 超时时间: %d 秒无新样本\n", LearningConfig::TIMEOUT / 1000);
+  Serial.println("📡 请将遥控器对准接收器(距离5-10cm)");
+  Serial.println("🔄 请连续按下同一个按键，次数越多波形越准");
+  Serial.println("💡 系统会自动分析并选择最稳定的信号");
+  Serial.println("🛑 输入 'stop' 可随时退出学习模式");
+  Serial.println("================================");
+  
+  // 重置学习状态
+  learner.reset();
+  learningStartTime = millis();
+  lastSampleTime = 0;
+  memset(&learningHold, 0, sizeof(learningHold));
+  
+  // 同时通过光电管测量遥控器的真实载波
+  carrierDetector.start();
+  
+  // 丢弃进入学习前残留的帧，新的遥控器开始新的捕获会话
+  irReceiver.reset();
+  irReceiver.startCaptureSession();
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = eventLoop.startTimer(LearningConfig::TIMEOUT, onLearningTimeout);
+  
+  currentState = LEARNING;
+  statusLed.set(true); // 点亮LED表示学习模式
+}
+
+void onLearningTimeout(void* ctx) {
+  learningTimer = -1;
+  if (currentState != LEARNING) return;
+  
+  if (batchLearning) {
+    Serial.println("⏰ 批量学习空闲超时，正在入库...");
+    finishBatchLearning();
+    Serial.print("> ");
+    return;
+  }
+  
+  Serial.println("⏰ 学习超时，正在分析已收集的数据...");
+  if (learner.totalSamples() >= LearningConfig::MIN_SAMPLES) {
+    finalizeLearning();
+  } else {
+    Serial.printf("❌ 样本不足（%u < %d），学习失败\n", learner.totalSamples(), LearningConfig::MIN_SAMPLES);
+    stopCurrentOperation();
+  }
+  Serial.print("> ");
+}
+
+void handleLearning() {
+  unsigned long currentTime = millis();
+  
+  carrierDetector.poll();
+  
+  if (batchLearning) {
+    handleBatchLearning();
+    return;
+  }
+  
+  // 超时由learningTimer处理
+  if (irReceiver.decode()) {
+    // 按住按键产生的重复帧不作为样本，只记录重复帧和周期
+    if (irReceiver.isRepeat()) {
+      captureLearningRepeat();
+      return;
+    }
+    
+    // 获取接收到的信号数据
+    uint64_t value = irReceiver.getValue();
+    uint16_t bits = irReceiver.getBits();
+    decode_type_t protocol = irReceiver.getProtocol();
+    
+    // 验证信号有效性
+    if (value == 0 || bits == 0) {
+      Serial.println("⚠️ 无效信号，请重试");
+      return;
+    }
+    
+    // 添加样本(不保存样本本身，只更新候选计数和波形统计；有状态协议的状态字节随新候选保存)
+    int candidate = learner.addSample(protocol, value, bits, irReceiver.getState(), irReceiver.getStateLength());
+    lastSampleTime = currentTime;
+    captureLearningRaw(candidate);
+    
+    // 超时从最后一个样本起算，持续按键时学习不会被打断
+    eventLoop.cancelTimer(learningTimer);
+    learningTimer = eventLoop.startTimer(LearningConfig::TIMEOUT, onLearningTimeout);
+    
+    // 换了按键时，之前记录的按住信息作废
+    if (protocol != learningHold.protocol || value != learningHold.value || bits != learningHold.bits) {
+      memset(&learningHold, 0, sizeof(learningHold));
+      learningHold.protocol = protocol;
+      learningHold.value = value;
+      learningHold.bits = bits;
+    }
+    
+    uint32_t samples = learner.totalSamples();
+    const LearnCandidate& best = learner.candidate(learner.bestCandidate());
+    Serial.printf("✅ 样本 %u: 协议=%s, 值=0x%08llX, 位数=%d | 领先 0x%08llX 置信度 %d%% (保守 %d%%)\n",
+                 samples, protocolName(protocol), (unsigned long long)value, bits,
+                 (unsigned long long)best.value, learner.confidencePercent(), learner.guaranteedPercent());
+    
+    // 信号接收成功时LED快闪一次
+    static const uint16_t ackBlink[] = {50};
+    statusLed.play(false, ackBlink, 1, true);
+    
+    // 达到最小样本数后提示可以结束
+    if (samples == LearningConfig::MIN_SAMPLES) {
+      Serial.println("💡 已达到最小样本数，可输入 'stop' 结束学习");
+    }
+    
+    // 样本足够且结论稳定时自动结束，否则继续吸收样本
+    if (samples >= LearningConfig::TARGET_SAMPLES) {
+      if (learner.guaranteedPercent() >= LearningConfig::TARGET_CONFIDENCE) {
+        Serial.println("📊 置信度已达标，正在分析数据...");
+        finalizeLearning();
+      } else if (samples == LearningConfig::TARGET_SAMPLES) {
+        Serial.println("💡 干扰较多，置信度未达标，可继续按键或输入 'stop' 结束");
+      }
+    }
+  }
+}
+
+// 过滤当前帧的原始脉冲，通过时计入候选的波形统计(在采样时完成，入库时不再处理)
+void captureLearningRaw(int candidate) {
+  uint16_t pulses[StreamingLearner::MAX_PULSES];
+  uint16_t length = irReceiver.getRawPulses(pulses, StreamingLearner::MAX_PULSES);
+  
+  PulseFilterResult result = pulseFilter.process(pulses, length, pulses);
+  if (result.verdict != FILTER_OK) {
+    Serial.printf("⚠️ 原始波形未通过过滤(%s)，仅计入解码结果\n", PulseFilter::verdictName(result.verdict));
+    return;
+  }
+  
+  learner.addWaveform(candidate, pulses, result.outputLength);
+}
+
+void captureLearningRepeat() {
+  // 学习开始前就按住的按键没有对应的新帧
+  if (learner.totalSamples() == 0) return;
+  
+  FrameKind kind = irReceiver.getFrameKind();
+  if (learningHold.repeats == 0) {
+    Serial.printf("🔁 检测到按住重复帧(%s)\n", kind == FRAME_REPEAT_CODE ? "重复码" : "完整帧");
+  }
+  learningHold.repeats++;
+  
+  uint16_t period = irReceiver.getRepeatPeriod();
+  if (period > 0) {
+    learningHold.periodSum += period;
+    learningHold.periodCount++;
+  }
+  
+  if (kind != FRAME_REPEAT_CODE) {
+    learningHold.repeatLength = 0;
+    return;
+  }
   
-  Serial.println();
+  uint16_t pulses[MAX_REPEAT_PULSES * 2];
+  uint16_t length = captureRepeatCode(pulses);
+  if (length > 0) {
+    memcpy(learningHold.repeatData, pulses, length * sizeof(uint16_t));
+    learningHold.repeatLength = length;
+  }
 }
 
-void startLearning() {
-  Serial.println("🎯 进入智能学习模式...");
+// pulses容量不小于MAX_REPEAT_PULSES * 2
+uint16_t captureRepeatCode(uint16_t* pulses) {
+  // 重复码很短，放宽最少脉冲数后同样经过过滤
+  uint16_t length = irReceiver.getRawPulses(pulses, MAX_REPEAT_PULSES * 2);
+  PulseFilterConfig config = pulseFilter.getConfig();
+  config.minPulses = 3;
+  PulseFilterResult result = filterPulses(pulses, length, pulses, config);
+  if (result.verdict != FILTER_OK || result.outputLength > MAX_REPEAT_PULSES) return 0;
+  return result.outputLength;
+}
+
+void startBatchLearning(const char* prefix) {
+  if (currentState == LEARNING) {
+    Serial.println("⚠️ 正在学习中，请先输入 'stop' 结束");
+    return;
+  }
+  
+  // 按键数不超过存储剩余的槽位，开始前告知，避免按完后才发现后面的按键存不下
+  int freeSlots = irStorage.getFreeSlots();
+  if (freeSlots == 0) {
+    Serial.println("❌ 存储已满，请先删除不需要的信号");
+    return;
+  }
+  int maxKeys = freeSlots < BatchSession::MAX_KEYS ? freeSlots : BatchSession::MAX_KEYS;
+  
+  Serial.println("🎯 进入批量学习模式...");
   Serial.println("================================");
-  Serial.printf("📊 配置: 需要采集 %d-%d 个样本\n", LearningConfig::MIN_SAMPLES, LearningConfig::MAX_SAMPLES);
-  Serial.printf("⏱️ 超时时间: %d 秒\n", LearningConfig::TIMEOUT / 1000);
-  Serial.println("📡 请将遥控器对准接收器(距离5-10cm)");
-  Serial.println("🔄 请连续按下同一个按键 5-20 次");
-  Serial.println("💡 系统会自动分析并选择最稳定的信号");
-  Serial.println("🛑 输入 'stop' 可随时退出学习模式");
+  Serial.println("🔄 依次按下遥控器上的每个按键，每个按键按一次即可");
+  Serial.printf("📊 按键间隔超过 %d ms 或编码变化时视为新的按压，最多 %d 个按键 (存储剩余 %d 个槽位)\n",
+               BatchSession::DEFAULT_GAP_MS, maxKeys, freeSlots);
+  Serial.printf("💾 存储已用 %u 字节，波形较长时可能在槽位用完前存满\n", (unsigned)irStorage.getUsedMemory());
+  Serial.printf("⏱️ %d 秒没有新按键或输入 'stop' 时一次性入库\n", LearningConfig::TIMEOUT / 1000);
+  Serial.printf("🏷️ 自动命名: %s_01, %s_02 ...\n", prefix, prefix);
   Serial.println("================================");
   
-  // 重置学习状态
-  sampleCount = 0;
+  strncpy(batchPrefix, prefix, sizeof(batchPrefix) - 1);
+  batchPrefix[sizeof(batchPrefix) - 1] = '\0';
+  batchSession.reset(BatchSession::DEFAULT_GAP_MS, maxKeys);
+  batchLearning = true;
   learningStartTime = millis();
   lastSampleTime = 0;
-  memset(learningSamples, 0, sizeof(learningSamples));
+  
+  carrierDetector.start();
+  irReceiver.reset();
+  irReceiver.startCaptureSession();
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = eventLoop.startTimer(LearningConfig::TIMEOUT, onLearningTimeout);
   
   currentState = LEARNING;
-  digitalWrite(STATUS_LED_PIN, HIGH); // 点亮LED表示学习模式
+  statusLed.set(true);
 }
 
-void handleLearning() {
-  unsigned long currentTime = millis();
+void handleBatchLearning() {
+  if (!irReceiver.decode()) return;
+  
+  unsigned long now = millis();
+  if (irReceiver.isRepeat()) {
+    uint16_t pulses[MAX_REPEAT_PULSES * 2];
+    uint16_t length = irReceiver.getFrameKind() == FRAME_REPEAT_CODE ? captureRepeatCode(pulses) : 0;
+    batchSession.addRepeat(now, irReceiver.getRepeatPeriod(), length > 0 ? pulses : nullptr, length);
+    return;
+  }
   
-  // 检查超时
-  if (currentTime - learningStartTime > LearningConfig::TIMEOUT) {
-    Serial.println("⏰ 学习超时，正在分析已收集的数据...");
-    if (sampleCount >= LearningConfig::MIN_SAMPLES) {
-      finalizeLearning();
-    } else {
-      Serial.printf("❌ 样本不足（%d < %d），学习失败\n", sampleCount, LearningConfig::MIN_SAMPLES);
-      stopCurrentOperation();
-    }
+  uint64_t value = irReceiver.getValue();
+  uint16_t bits = irReceiver.getBits();
+  decode_type_t protocol = irReceiver.getProtocol();
+  if (value == 0 || bits == 0) return;
+  
+  int key = batchSession.addFrame(protocol, value, bits, now, irReceiver.getState(), irReceiver.getStateLength());
+  if (key < 0) {
+    Serial.printf("⚠️ 已达到 %d 个按键上限，忽略新按键\n", batchSession.keyLimit());
     return;
   }
+  lastSampleTime = now;
   
-  if (irReceiver.isAvailable() && irReceiver.decode()) {
-    // 防抖：避免重复采样
-    if (currentTime - lastSampleTime < LearningConfig::SAMPLE_INTERVAL) {
-      return;
+  uint16_t pulses[BatchSession::MAX_PULSES];
+  uint16_t length = irReceiver.getRawPulses(pulses, BatchSession::MAX_PULSES);
+  PulseFilterResult result = pulseFilter.process(pulses, length, pulses);
+  if (result.verdict == FILTER_OK) {
+    batchSession.addWaveform(key, pulses, result.outputLength);
+  }
+  
+  // 空闲超时从最后一个按键起算
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = eventLoop.startTimer(LearningConfig::TIMEOUT, onLearningTimeout);
+  
+  if (!batchSession.isNewPress()) return;
+  const BatchKey& k = batchSession.key(key);
+  if (k.presses == 1) {
+    Serial.printf("🔘 新按键 %s_%02d: %s 0x%08llX (%d位)\n", batchPrefix, key + 1,
+                 protocolName(protocol), (unsigned long long)value, bits);
+  } else {
+    Serial.printf("🔁 %s_%02d 第 %d 次按压\n", batchPrefix, key + 1, k.presses);
+  }
+  static const uint16_t ackBlink[] = {50};
+  statusLed.play(false, ackBlink, 1, true);
+}
+
+void finishBatchLearning() {
+  batchSession.closeSegment();
+  unsigned long elapsed = millis() - learningStartTime;
+  
+  Serial.println("\n🔍 批量学习结果");
+  Serial.println("================================");
+  Serial.printf("📊 %u 帧，%d 个按键，其中 %d 个可入库\n",
+               batchSession.totalFrames(), batchSession.keyCount(), batchSession.acceptedCount());
+  
+  CarrierEstimate carrier = carrierDetector.getEstimate();
+  carrierDetector.stop();
+  if (carrier.valid) {
+    captureRing.annotateCarrier(learningStartTime, carrier.frequency, carrier.dutyCycle);
+    Serial.printf("📶 载波测量: %.1fkHz, 占空比 %d%%\n", carrier.frequencyHz / 1000.0, carrier.dutyCycle);
+  }
+  
+  // 所有按键一次写入存储
+  int saved = 0;
+  irStorage.beginBatch();
+  for (int i = 0; i < batchSession.keyCount(); i++) {
+    const BatchKey& k = batchSession.key(i);
+    if (!batchSession.isAccepted(i)) {
+      Serial.printf("🗑️ 丢弃 %s 0x%08llX: %d 次按压均疑似误码或缺少原始波形\n",
+                   protocolName(k.protocol), (unsigned long long)k.value, k.presses);
+      continue;
     }
     
-    // 获取接收到的信号数据
-    uint32_t value = irReceiver.getValue();
-    uint16_t bits = irReceiver.getBits();
-    decode_type_t protocol = irReceiver.getProtocol();
-    
-    // 验证信号有效性
-    if (value == 0 || bits == 0) {
-      Serial.println("⚠️ 无效信号，请重试");
-      return;
+    char name[32];
+    snprintf(name, sizeof(name), "%s_%02d", batchPrefix, i + 1);
+    uint16_t period = batchSession.repeatPeriod(i);
+    int id = irStorage.addSignal(k.protocol, k.value, k.bits,
+                                 const_cast<uint16_t*>(k.wave), k.waveLength, name,
+                                 carrier.valid ? carrier.frequency : 0,
+                                 carrier.valid ? carrier.dutyCycle : 0,
+                                 k.repeatLength > 0 ? k.repeatData : nullptr, k.repeatLength,
+                                 period, k.stateLength > 0 ? k.state : nullptr, k.stateLength);
+    if (id < 0) {
+      Serial.printf("❌ 存储空间不足，%s 及之后的按键未保存\n", name);
+      break;
     }
-    
-    // 添加样本
-    if (sampleCount < LearningConfig::MAX_SAMPLES) {
-      learningSamples[sampleCount].value = value;
-      learningSamples[sampleCount].bits = bits;
-      learningSamples[sampleCount].protocol = protocol;
-      learningSamples[sampleCount].timestamp = currentTime;
-      learningSamples[sampleCount].isValid = true;
-      
-      sampleCount++;
-      lastSampleTime = currentTime;
-      
-      Serial.printf("✅ 样本 %d/%d: 协议=%s, 值=0x%08X, 位数=%d\n", 
-                   sampleCount, LearningConfig::MAX_SAMPLES,
-                   typeToString(protocol, false).c_str(), value, bits);
-      
-      // 信号接收成功时LED快闪一次
-      digitalWrite(STATUS_LED_PIN, LOW);
-      delay(50);
-      digitalWrite(STATUS_LED_PIN, HIGH);
-      
-      // 达到最小样本数后提示可以结束
-      if (sampleCount == LearningConfig::MIN_SAMPLES) {
-        Serial.println("💡 已达到最小样本数，可输入 'stop' 结束学习");
-      }
-      
-      // 达到最大样本数时自动结束
-      if (sampleCount >= LearningConfig::MAX_SAMPLES) {
-        Serial.println("📊 已达到最大样本数，正在分析数据...");
-        finalizeLearning();
-      }
+    if (irStorage.getLastAddStatus() == ADD_MERGED) {
+      Serial.printf("🔁 %s 与已有信号 ID %d 相同，已合并\n", name, id);
+      continue;
     }
+    saved++;
+    Serial.printf("✅ ID %d %s: %s 0x%08llX (%d位) 按压%d次 波形%d帧%s\n", id, name,
+                 protocolName(k.protocol), (unsigned long long)k.value, k.bits, k.presses, k.waveCount,
+                 period > 0 ? " 含按住周期" : "");
+  }
+  irStorage.endBatch();
+  
+  if (batchSession.droppedFrames() > 0) {
+    Serial.printf("⚠️ 按键表已满，丢弃 %u 帧\n", batchSession.droppedFrames());
   }
+  Serial.printf("⏱️ 共保存 %d 个按键，用时 %lu 秒", saved, elapsed / 1000);
+  if (saved > 0) Serial.printf("，平均每键 %.1f 秒", elapsed / 1000.0 / saved);
+  Serial.println();
+  Serial.println("================================");
+  
+  if (saved > 0) {
+    static const uint16_t successBlink[] = {100, 100, 100, 100, 100, 100};
+    statusLed.play(false, successBlink, 6, false);
+  } else {
+    statusLed.set(false);
+  }
+  
+  currentState = IDLE;
+  batchLearning = false;
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = -1;
+  learningStartTime = 0;
+  lastSampleTime = 0;
 }
 
 // 新增：完成学习并分析数据
 void finalizeLearning() {
-  if (sampleCount < LearningConfig::MIN_SAMPLES) {
-    Serial.printf("❌ 样本不足（%d < %d），学习失败\n", sampleCount, LearningConfig::MIN_SAMPLES);
+  uint32_t samples = learner.totalSamples();
+  if (samples < LearningConfig::MIN_SAMPLES) {
+    Serial.printf("❌ 样本不足（%u < %d），学习失败\n", samples, LearningConfig::MIN_SAMPLES);
     currentState = IDLE;
-    digitalWrite(STATUS_LED_PIN, LOW);
-    sampleCount = 0;
+    statusLed.set(false);
+    carrierDetector.stop();
+    eventLoop.cancelTimer(learningTimer);
+    learningTimer = -1;
+    learner.reset();
     return;
   }
   
   Serial.println("\n🔍 开始信号分析...");
   Serial.println("================================");
   
-  // 使用简化的分析方法，减少栈使用
-  uint32_t bestValue = 0;
-  uint16_t bestBits = 0;
-  decode_type_t bestProtocol = UNKNOWN;
-  int maxCount = 0;
-  int bestIndex = 0;
+  // 候选码按出现次数排序前已由学习器统计好(Space-Saving，计数可能偏大error次)
+  Serial.printf("📊 共 %u 个样本，保留 %d 个候选\n", samples, learner.candidateCount());
+  for (int i = 0; i < learner.candidateCount(); i++) {
+    const LearnCandidate& c = learner.candidate(i);
+    Serial.printf("📊 信号: 0x%08llX (%s, %d位) - 出现 %u 次 (%.1f%%)",
+                 (unsigned long long)c.value, protocolName(c.protocol), c.bits, c.count,
+                 (float)c.count / samples * 100);
+    if (c.error > 0) Serial.printf(" 误差≤%u", c.error);
+    Serial.printf(", 波形 %u 帧\n", c.waveCount);
+  }
   
-  // 为每个样本计算出现次数
-  for (int i = 0; i < sampleCount; i++) {
-    if (!learningSamples[i].isValid) continue;
-    
-    int count = 1;
-    // 计算当前样本在所有样本中的出现次数
-    for (int j = i + 1; j < sampleCount; j++) {
-      if (learningSamples[j].isValid &&
-          learningSamples[j].value == learningSamples[i].value &&
-          learningSamples[j].bits == learningSamples[i].bits &&
-          learningSamples[j].protocol == learningSamples[i].protocol) {
-        count++;
-        learningSamples[j].isValid = false; // 标记为已处理，避免重复计算
-      }
-    }
-    
-    // 如果这个信号出现次数更多，更新最佳选择
-    if (count > maxCount) {
-      maxCount = count;
-      bestValue = learningSamples[i].value;
-      bestBits = learningSamples[i].bits;
-      bestProtocol = learningSamples[i].protocol;
-      bestIndex = i;
-    }
-    
-    float percentage = (float)count / sampleCount * 100;
-    Serial.printf("📊 信号: 0x%08X (%s, %d位) - 出现 %d 次 (%.1f%%)\n", 
-                 learningSamples[i].value, 
-                 typeToString(learningSamples[i].protocol, false).c_str(),
-                 learningSamples[i].bits, count, percentage);
+  int bestIndex = learner.bestCandidate();
+  const LearnCandidate& best = learner.candidate(bestIndex);
+  uint64_t bestValue = best.value;
+  uint16_t bestBits = best.bits;
+  decode_type_t bestProtocol = best.protocol;
+  
+  uint8_t reliability = learner.confidencePercent();
+  Serial.printf("\n🎯 选择最稳定信号: 0x%08llX (可靠性: %d%%, 保守 %d%%)\n",
+               (unsigned long long)bestValue, reliability, learner.guaranteedPercent());
+  
+  // 原始数据 - 最佳候选各帧(已去毛刺并量化)逐位置的平均波形
+  uint16_t rawData[StreamingLearner::MAX_PULSES];
+  uint16_t rawLength = learner.waveform(bestIndex, rawData, StreamingLearner::MAX_PULSES);
+  if (rawLength == 0) {
+    Serial.println("⚠️ 没有通过过滤的原始帧，只保存解码结果");
+  } else {
+    Serial.printf("📈 平均波形: %d 个脉冲，由 %u 帧平均，最大抖动 ±%d us\n",
+                 rawLength, best.waveCount, learner.maxDeviation(bestIndex));
+  }
+  if (learner.rejectedWaveforms() > 0) {
+    Serial.printf("⚠️ %u 帧原始波形长度与候选不一致，未计入平均\n", learner.rejectedWaveforms());
+  }
+  
+  if (bestProtocol == UNKNOWN && rawLength == 0) {
+    Serial.println("❌ UNKNOWN协议必须依靠原始波形发射，学习失败");
+    currentState = IDLE;
+    statusLed.set(false);
+    carrierDetector.stop();
+    eventLoop.cancelTimer(learningTimer);
+    learningTimer = -1;
+    learner.reset();
+    learningStartTime = 0;
+    lastSampleTime = 0;
+    return;
   }
   
-  float reliability = (float)maxCount / sampleCount * 100;
-  Serial.printf("\n🎯 选择最稳定信号: 0x%08X (可靠性: %.1f%%)\n", bestValue, reliability);
+  // 获取学习期间测得的载波参数
+  CarrierEstimate carrier = carrierDetector.getEstimate();
+  carrierDetector.stop();
+  if (carrier.valid) {
+    captureRing.annotateCarrier(learningStartTime, carrier.frequency, carrier.dutyCycle);
+    Serial.printf("📶 载波测量: %.1fkHz, 占空比 %d%% (%d个周期)\n",
+                 carrier.frequencyHz / 1000.0, carrier.dutyCycle, carrier.cycles);
+  } else {
+    Serial.println("📶 未测得载波，发射时将按协议推测载波频率");
+  }
   
-  // 获取原始数据 - 使用最后接收的数据
-  uint16_t* rawData = irReceiver.getRawData();
-  uint16_t rawLength = irReceiver.getRawLength();
+  // 按住重复信息：只采用属于最佳信号的记录
+  const uint16_t* repeatData = nullptr;
+  uint16_t repeatLength = 0;
+  uint16_t repeatPeriod = 0;
+  if (learningHold.repeats > 0 && learningHold.protocol == bestProtocol &&
+      learningHold.value == bestValue && learningHold.bits == bestBits) {
+    if (learningHold.periodCount > 0) {
+      repeatPeriod = (learningHold.periodSum + learningHold.periodCount / 2) / learningHold.periodCount;
+      repeatData = learningHold.repeatLength > 0 ? learningHold.repeatData : nullptr;
+      repeatLength = learningHold.repeatLength;
+      Serial.printf("🔁 按住重复: %s, 周期 %d ms (%d次测量)\n",
+                   repeatLength > 0 ? "重复码" : "重复主帧", repeatPeriod, learningHold.periodCount);
+    } else {
+      Serial.println("🔁 检测到按住重复帧，但按住时间太短，未能测得周期");
+    }
+  }
   
   // 生成信号名称
   char signalName[48];
-  sprintf(signalName, "Signal_%d_R%.0f%%", irStorage.getSignalCount() + 1, reliability);
+  sprintf(signalName, "Signal_%d_R%d%%", irStorage.getSignalCount() + 1, reliability);
   
   // 存储最佳信号
-  int id = irStorage.addSignal(bestProtocol, bestValue, bestBits, rawData, rawLength, signalName);
-  
-  if (id > 0) {
+  int id = irStorage.addSignal(bestProtocol, bestValue, bestBits, rawData, rawLength, signalName,
+                               carrier.valid ? carrier.frequency : 0,
+                               carrier.valid ? carrier.dutyCycle : 0,
+                               repeatData, repeatLength, repeatPeriod,
+                               best.stateLength > 0 ? best.state : nullptr, best.stateLength);
+  
+  if (id > 0 && irStorage.getLastAddStatus() == ADD_MERGED) {
+    Serial.printf("🔁 与已有信号 ID %d (%s) 相同，已合并，未占用新槽位\n", id, irStorage.getSignal(id)->name);
+    static const uint16_t successBlink[] = {100, 100, 100, 100, 100, 100};
+    statusLed.play(false, successBlink, 6, false);
+  } else if (id > 0) {
     Serial.printf("✅ 学习成功！信号已保存为ID: %d\n", id);
-    Serial.printf("📋 信号详情: %s, 值: 0x%08X, 位数: %d\n", 
-                 typeToString(bestProtocol, false).c_str(), bestValue, bestBits);
-    
-    // 成功时LED闪烁3次
-    for (int i = 0; i < 3; i++) {
-      digitalWrite(STATUS_LED_PIN, LOW);
-      delay(100);
-      digitalWrite(STATUS_LED_PIN, HIGH);
-      delay(100);
+    Serial.printf("📋 信号详情: %s, 值: 0x%08llX, 位数: %d\n", 
+                 protocolName(bestProtocol), (unsigned long long)bestValue, bestBits);
+    if (best.stateLength > 0) {
+      Serial.printf("📦 有状态协议: 保存 %d 字节状态，发射时按协议生成波形\n", best.stateLength);
     }
+    
+    // 成功时LED闪烁3次后熄灭
+    static const uint16_t successBlink[] = {100, 100, 100, 100, 100, 100};
+    statusLed.play(false, successBlink, 6, false);
   } else {
     Serial.println("❌ 存储失败！存储空间可能已满");
+    statusLed.set(false);
   }
   
   Serial.println("================================");
   
   // 直接清理状态，避免递归调用
   currentState = IDLE;
-  digitalWrite(STATUS_LED_PIN, LOW);
-  sampleCount = 0;
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = -1;
+  learner.reset();
   learningStartTime = 0;
   lastSampleTime = 0;
   Serial.println("✅ 学习完成");
 }
 
 void stopCurrentOperation() {
+  if (currentState == LEARNING && batchLearning) {
+    finishBatchLearning();
+    return;
+  }
+  
   // 防止在学习分析过程中重复调用
-  if (currentState == LEARNING && sampleCount >= LearningConfig::MIN_SAMPLES) {
-    Serial.printf("🔄 学习中断，但已收集 %d 个样本，正在分析...\n", sampleCount);
+  if (currentState == LEARNING && learner.totalSamples() >= LearningConfig::MIN_SAMPLES) {
+    Serial.printf("🔄 学习中断，但已收集 %u 个样本，正在分析...\n", learner.totalSamples());
     finalizeLearning();
     return;
   }
   
-  if (currentState == LEARNING && sampleCount < LearningConfig::MIN_SAMPLES) {
-    Serial.printf("❌ 学习中断，样本不足（%d < %d）\n", sampleCount, LearningConfig::MIN_SAMPLES);
+  if (currentState == LEARNING && learner.totalSamples() < LearningConfig::MIN_SAMPLES) {
+    Serial.printf("❌ 学习中断，样本不足（%u < %d）\n", learner.totalSamples(), LearningConfig::MIN_SAMPLES);
+  }
+  
+  // 停止按住发射
+  if (irTransmitter.isHolding()) {
+    finishHold();
+  }
+  
+  // 停止等待回波的闭环发射，已完成的尝试计入统计
+  if (closedLoopJob.active) {
+    Serial.printf("🛑 闭环发射已取消(已尝试 %d/%d 次)\n", closedLoopJob.attempt, closedLoopJob.plan.maxAttempts);
+    finishClosedLoop();
+  }
+  
+  // 停止进行中的repeat任务
+  if (repeatJob.timerId >= 0) {
+    Serial.printf("🛑 repeat任务已取消(已发射 %d/%d 次)\n", repeatJob.done, repeatJob.total);
+    eventLoop.cancelTimer(repeatJob.timerId);
+    repeatJob.timerId = -1;
   }
   
   // 清理状态
   currentState = IDLE;
-  digitalWrite(STATUS_LED_PIN, LOW);
+  statusLed.set(false);
+  carrierDetector.stop();
+  eventLoop.cancelTimer(learningTimer);
+  learningTimer = -1;
   
   // 清理学习状态
-  sampleCount = 0;
+  learner.reset();
   learningStartTime = 0;
   lastSampleTime = 0;
   
@@ -548,8 +2241,8 @@ void listStoredSignals() {
     for (int i = 1; i <= count; i++) {
       IRSignal* signal = irStorage.getSignal(i);
       if (signal && signal->isValid) {
-        Serial.printf("%2d | %-11s | 0x%08X | %4d | %s\n", 
-                     i, typeToString(signal->protocol, false).c_str(), signal->value, 
+        Serial.printf("%2d | %-11s | 0x%08llX | %4d | %s\n", 
+                     i, protocolName(signal->protocol), (unsigned long long)signal->value, 
                      signal->bits, signal->name);
       }
     }
@@ -559,15 +2252,28 @@ void listStoredSignals() {
 
 void clearAllSignals() {
   irStorage.clearAll();
+  retryPolicy.resetAll();
   Serial.println("所有信号已清除");
 }
 
 void sendSignal(int id) {
-  IRSignal* signal = irStorage.getSignal(id);
-  if (signal && signal->isValid) {
+  if (closedLoopJob.active) {
+    Serial.println("⚠️ 闭环发射正在等待回波，请稍候或输入 'stop'");
+    return;
+  }
+  
+  uint32_t revision = 0;
+  IRSignal* signal = &txSignal;
+  if (irStorage.snapshot(id, txSignal, &revision)) {
     Serial.printf("📡 发射信号 ID: %d (%s)\n", id, signal->name);
-    Serial.printf("📋 协议: %s, 值: 0x%08X, 位数: %d\n", 
-                 typeToString(signal->protocol, false).c_str(), signal->value, signal->bits);
+    Serial.printf("📋 协议: %s, 值: 0x%08llX, 位数: %d\n", 
+                 protocolName(signal->protocol), (unsigned long long)signal->value, signal->bits);
+    
+    // 闭环模式下由接收器回波决定是否重试(学习模式下接收器被学习占用)
+    if (closedLoopMode && currentState != LEARNING) {
+      sendSignalClosedLoop(id);
+      return;
+    }
     
     // 显示发射方式
     if (signal->protocol == UNKNOWN && irTransmitter.isRMTEnabled()) {
@@ -584,7 +2290,7 @@ void sendSignal(int id) {
       currentState = TRANSMITTING;
     }
     
-    digitalWrite(STATUS_LED_PIN, HIGH);
+    statusLed.set(true);
     
     // 改进的重试机制，针对UNKNOWN协议优化
     bool success = false;
@@ -595,13 +2301,22 @@ void sendSignal(int id) {
       
       // 使用优化的发射参数
       if (signal->protocol == UNKNOWN) {
-        // UNKNOWN协议使用RMT硬件发射，不需要额外重复
-        success = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                          signal->rawData, signal->rawLength, 0);
+        // UNKNOWN协议使用RMT硬件发射，不需要额外重复；参数化记录按描述符编码，其他优先使用预构建的数据项
+        size_t count = 0;
+        if (signal->parametric) {
+          success = irTransmitter.sendWithDescriptor(signal->descriptor, signal->value, signal->bits);
+        } else {
+          const rmt_item32_t* items = irTransmitter.isRMTEnabled() ?
+              rmtCache.prepare(id, revision, signal->rawData, signal->rawLength, count) : nullptr;
+          success = items && irTransmitter.sendPrepared(signal->protocol, items, count,
+                                                        signal->carrierFreq, signal->dutyCycle);
+        }
+        if (!success) {
+          success = irTransmitter.sendSignal(*signal, 0);
+        }
       } else {
         // 已知协议增加重复次数提高稳定性
-        success = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                          signal->rawData, signal->rawLength, 2);
+        success = irTransmitter.sendSignal(*signal, 2);
       }
       
       if (success) {
@@ -620,7 +2335,7 @@ void sendSignal(int id) {
       currentState = LEARNING;
       Serial.println("🎯 继续学习模式，请继续按遥控器测试接收...");
     } else {
-      digitalWrite(STATUS_LED_PIN, LOW);
+      statusLed.set(false);
       currentState = IDLE;
     }
     
@@ -638,33 +2353,133 @@ void sendSignal(int id) {
 }
 
 void repeatSignal(int id, int times) {
-  IRSignal* signal = irStorage.getSignal(id);
-  if (signal && signal->isValid) {
+  if (closedLoopJob.active) {
+    Serial.println("⚠️ 闭环发射正在等待回波，请稍候或输入 'stop'");
+    return;
+  }
+  if (irStorage.isValidId(id)) {
+    if (repeatJob.timerId >= 0) {
+      Serial.println("⚠️ 上一个repeat任务尚未完成，已取消");
+      eventLoop.cancelTimer(repeatJob.timerId);
+    }
+    
     Serial.printf("重复发射信号 ID: %d，次数: %d\n", id, times);
     currentState = TRANSMITTING;
     
-    for (int i = 0; i < times; i++) {
-      digitalWrite(STATUS_LED_PIN, HIGH);
-      bool success = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                             signal->rawData, signal->rawLength, 0);
-      digitalWrite(STATUS_LED_PIN, LOW);
-      
-      if (!success) {
-        Serial.printf("第 %d 次发射失败\n", i + 1);
-        break;
-      }
-      
-      Serial.printf("第 %d 次发射完成\n", i + 1);
-      delay(300); // 增加间隔
-    }
-    Serial.println("重复发射完成");
+    // 首次立即发射，之后由定时器按间隔发射，不阻塞串口和接收
+    repeatJob.id = id;
+    repeatJob.total = times;
+    repeatJob.done = 0;
+    repeatJob.timerId = -1;
+    repeatStep(nullptr);
   } else {
     Serial.printf("错误: 信号 ID %d 不存在\n", id);
   }
 }
 
+void holdSignal(int id, int durationMs) {
+  IRSignal* signal = &txSignal;
+  if (!irStorage.snapshot(id, txSignal)) {
+    Serial.printf("错误: 信号 ID %d 不存在\n", id);
+    return;
+  }
+  if (currentState != IDLE || irTransmitter.isHolding()) {
+    Serial.println("⚠️ 当前有其他操作进行中，请先输入 'stop'");
+    return;
+  }
+  
+  Serial.printf("🔁 按住发射信号 ID: %d，持续 %d ms\n", id, durationMs);
+  unsigned long start = millis();
+  
+  // 主帧发射完成后，重复帧由RMT循环发射，只需一个定时器结束
+  if (!irTransmitter.startHold(signal->protocol, signal->value, signal->bits,
+                               signal->rawData, signal->rawLength,
+                               signal->repeatData, signal->repeatLength, signal->repeatPeriod,
+                               signal->carrierFreq, signal->dutyCycle)) {
+    Serial.println("❌ 按住发射失败");
+    return;
+  }
+  
+  currentState = TRANSMITTING;
+  statusLed.set(true);
+  
+  unsigned long elapsed = millis() - start;
+  holdTimer = eventLoop.startTimer(elapsed < (unsigned long)durationMs ? durationMs - elapsed : 1, onHoldEnd);
+}
+
+void onHoldEnd(void* ctx) {
+  holdTimer = -1;
+  finishHold();
+  Serial.print("> ");
+}
+
+void finishHold() {
+  eventLoop.cancelTimer(holdTimer);
+  holdTimer = -1;
+  irTransmitter.stopHold();
+  statusLed.set(false);
+  currentState = IDLE;
+}
+
+void repeatStep(void* ctx) {
+  repeatJob.timerId = -1;
+  
+  IRSignal* signal = &txSignal;
+  if (!irStorage.snapshot(repeatJob.id, txSignal)) {
+    Serial.printf("错误: 信号 ID %d 已不存在\n", repeatJob.id);
+    finishRepeat();
+    return;
+  }
+  
+  statusLed.set(true);
+  bool success = irTransmitter.sendSignal(*signal, 0);
+  statusLed.set(false);
+  
+  if (!success) {
+    Serial.printf("第 %d 次发射失败\n", repeatJob.done + 1);
+    finishRepeat();
+    return;
+  }
+  
+  repeatJob.done++;
+  Serial.printf("第 %d 次发射完成\n", repeatJob.done);
+  
+  if (repeatJob.done >= repeatJob.total) {
+    finishRepeat();
+    return;
+  }
+  
+  repeatJob.timerId = eventLoop.startTimer(REPEAT_INTERVAL, repeatStep);
+  if (repeatJob.timerId < 0) {
+    Serial.println("❌ 定时器已满，repeat任务中止");
+    finishRepeat();
+  }
+}
+
+void finishRepeat() {
+  Serial.println("重复发射完成");
+  if (currentState == TRANSMITTING) {
+    currentState = IDLE;
+  }
+}
+
+void renameSignal(int id, const char* name) {
+  if (!irStorage.isValidId(id)) {
+    Serial.printf("错误: 信号 ID %d 不存在\n", id);
+    return;
+  }
+  if (*name == '\0') {
+    Serial.println("错误: 名称不能为空");
+    return;
+  }
+  if (!irStorage.setSignalName(id, name)) {
+    Serial.println("❌ 存储容量不足，名称未更新");
+  }
+}
+
 void deleteSignal(int id) {
   if (irStorage.deleteSignal(id)) {
+    retryPolicy.reset(id);
     Serial.printf("信号 ID %d 已删除\n", id);
   } else {
     Serial.printf("错误: 信号 ID %d 不存在\n", id);
@@ -675,10 +2490,25 @@ void showSignalInfo(int id) {
   IRSignal* signal = irStorage.getSignal(id);
   if (signal && signal->isValid) {
     Serial.printf("\n信号 ID %d 详细信息：\n", id);
-    Serial.printf("协议: %s\n", typeToString(signal->protocol, false).c_str());
-    Serial.printf("值: 0x%08X (%u)\n", signal->value, signal->value);
+    Serial.printf("协议: %s\n", protocolName(signal->protocol));
+    if (signal->stateLength > 0) {
+      Serial.printf("状态: %d字节 ", signal->stateLength);
+      for (int i = 0; i < signal->stateLength; i++) Serial.printf("%02X", signal->state[i]);
+      Serial.println();
+    } else {
+      Serial.printf("值: 0x%08llX (%llu)\n", (unsigned long long)signal->value, (unsigned long long)signal->value);
+    }
     Serial.printf("位数: %d\n", signal->bits);
     Serial.printf("原始数据长度: %d\n", signal->rawLength);
+    if (signal->carrierFreq > 0) {
+      Serial.printf("载波: %dkHz, 占空比: %d%%\n", signal->carrierFreq, signal->dutyCycle);
+    } else {
+      Serial.println("载波: 未测量(按协议推测)");
+    }
+    if (signal->repeatPeriod > 0) {
+      Serial.printf("按住重复: %s, 周期 %d ms\n",
+                   signal->repeatLength > 0 ? "重复码" : "重复主帧", signal->repeatPeriod);
+    }
     Serial.printf("名称: %s\n", signal->name);
     Serial.printf("学习时间: %lu\n", signal->timestamp);
   } else {
@@ -691,13 +2521,19 @@ void showRawData(int id) {
   IRSignal* signal = irStorage.getSignal(id);
   if (signal && signal->isValid) {
     Serial.printf("\n信号 ID %d 原始数据：\n", id);
-    Serial.printf("信号值: 0x%08X\n", signal->value);
-    Serial.printf("二进制: ");
-    for (int i = signal->bits - 1; i >= 0; i--) {
-      Serial.print((signal->value >> i) & 1);
-      if (i % 8 == 0 && i > 0) Serial.print(" ");
+    if (signal->stateLength > 0) {
+      Serial.printf("状态字节(%d): ", signal->stateLength);
+      for (int i = 0; i < signal->stateLength; i++) Serial.printf("%02X ", signal->state[i]);
+      Serial.println();
+    } else {
+      Serial.printf("信号值: 0x%08llX\n", (unsigned long long)signal->value);
+      Serial.printf("二进制: ");
+      for (int i = min((int)signal->bits, 64) - 1; i >= 0; i--) {
+        Serial.print((int)((signal->value >> i) & 1));
+        if (i % 8 == 0 && i > 0) Serial.print(" ");
+      }
+      Serial.println();
     }
-    Serial.println();
     
     if (signal->rawLength > 0) {
       Serial.println("原始时序数据:");
@@ -723,11 +2559,11 @@ void testTransmitter() {
     Serial.println("🎯 学习模式下测试，请观察是否能接收到发射的信号...");
   }
   
-  digitalWrite(STATUS_LED_PIN, HIGH);
+  statusLed.set(true);
   bool success = irTransmitter.sendSignal(NEC, 0xFF00FF, 32);
   
   if (!wasLearning) {
-    digitalWrite(STATUS_LED_PIN, LOW);
+    statusLed.set(false);
   }
   
   if (success) {
@@ -754,26 +2590,38 @@ void showDetailedSignalInfo(int id) {
   
   // 基础信息
   Serial.printf("📋 基础信息:\n");
-  Serial.printf("   协议: %s\n", typeToString(signal->protocol, false).c_str());
+  Serial.printf("   协议: %s\n", protocolName(signal->protocol));
   Serial.printf("   信号名称: %s\n", signal->name);
   Serial.printf("   学习时间: %lu\n", signal->timestamp);
   Serial.printf("   数据长度: %d 位\n", signal->bits);
   Serial.printf("   原始数据长度: %d\n", signal->rawLength);
+  if (signal->carrierFreq > 0) {
+    Serial.printf("   载波: %dkHz, 占空比: %d%%\n", signal->carrierFreq, signal->dutyCycle);
+  }
   
   // 十六进制值显示
   Serial.printf("\n💾 数据值:\n");
-  Serial.printf("   HEX: 0x%08X\n", signal->value);
-  Serial.printf("   DEC: %u\n", signal->value);
-  
-  // 二进制显示（按字节分组）
-  Serial.printf("\n🔢 二进制数据 (%d位):\n", signal->bits);
-  Serial.print("   BIN: ");
-  for (int i = signal->bits - 1; i >= 0; i--) {
-    Serial.print((signal->value >> i) & 1);
-    if (i % 8 == 0 && i > 0) Serial.print(" ");
-    if (i % 32 == 0 && i > 0) Serial.print("\n        ");
+  if (signal->stateLength > 0) {
+    Serial.printf("   状态: %d字节\n   ", signal->stateLength);
+    for (int i = 0; i < signal->stateLength; i++) {
+      Serial.printf("%02X ", signal->state[i]);
+      if ((i + 1) % 16 == 0) Serial.print("\n   ");
+    }
+    Serial.println();
+  } else {
+    Serial.printf("   HEX: 0x%08llX\n", (unsigned long long)signal->value);
+    Serial.printf("   DEC: %llu\n", (unsigned long long)signal->value);
+    
+    // 二进制显示（按字节分组）
+    Serial.printf("\n🔢 二进制数据 (%d位):\n", signal->bits);
+    Serial.print("   BIN: ");
+    for (int i = min((int)signal->bits, 64) - 1; i >= 0; i--) {
+      Serial.print((int)((signal->value >> i) & 1));
+      if (i % 8 == 0 && i > 0) Serial.print(" ");
+      if (i % 32 == 0 && i > 0) Serial.print("\n        ");
+    }
+    Serial.println();
   }
-  Serial.println();
   
   // NEC协议专门解析
   if (signal->protocol == NEC && signal->bits == 32) {
@@ -812,19 +2660,22 @@ void showDetailedSignalInfo(int id) {
     }
     Serial.println();
     
-    // 分析时序特征
+    // 分析时序特征：脉冲数、总时长、引导码和直方图为插入时算好的特征向量
     Serial.printf("\n📈 时序特征分析:\n");
+    const SignalFeatures* features = irStorage.getFeatures(id);
     uint16_t minVal = 65535, maxVal = 0;
-    uint32_t totalTime = 0;
     for (int i = 0; i < signal->rawLength; i++) {
       if (signal->rawData[i] < minVal) minVal = signal->rawData[i];
       if (signal->rawData[i] > maxVal) maxVal = signal->rawData[i];
-      totalTime += signal->rawData[i];
     }
     Serial.printf("   最短脉冲: %d μs\n", minVal);
     Serial.printf("   最长脉冲: %d μs\n", maxVal);
-    Serial.printf("   总持续时间: %u μs (%.1f ms)\n", totalTime, totalTime / 1000.0);
-    Serial.printf("   平均脉冲长度: %d μs\n", totalTime / signal->rawLength);
+    Serial.printf("   总持续时间: %u μs (%.1f ms，不含结尾间隔)\n", features->totalUs, features->totalUs / 1000.0);
+    Serial.printf("   平均脉冲长度: %d μs\n", features->totalUs / features->edges);
+    Serial.printf("   引导码: %d/%d μs\n", features->leaderMark, features->leaderSpace);
+    Serial.print("   时长分布:");
+    for (int b = 0; b < FEATURE_BINS; b++) Serial.printf(" %d", features->histogram[b]);
+    Serial.println();
   }
   
   Serial.println(String("=").substring(0, 60));
@@ -833,25 +2684,17 @@ void showDetailedSignalInfo(int id) {
 
 // LED控制函数
 void ledStartupFlash() {
-  // 启动时快速闪烁3次，然后熄灭
+  // 启动时快速闪烁3次，然后熄灭(由事件循环驱动，不阻塞启动)
+  static const uint16_t startupBlink[] = {150, 150, 150, 150, 150, 150};
   Serial.println("🔆 系统启动中...");
-  for (int i = 0; i < 3; i++) {
-    digitalWrite(STATUS_LED_PIN, HIGH);
-    delay(150);
-    digitalWrite(STATUS_LED_PIN, LOW);
-    delay(150);
-  }
+  statusLed.play(true, startupBlink, 6, false);
   Serial.println("✅ 系统就绪");
 }
 
 void ledSignalFlash() {
   // 信号接收时闪烁两下
-  for (int i = 0; i < 2; i++) {
-    digitalWrite(STATUS_LED_PIN, HIGH);
-    delay(100);
-    digitalWrite(STATUS_LED_PIN, LOW);
-    delay(100);
-  }
+  static const uint16_t signalBlink[] = {100, 100, 100, 100};
+  statusLed.play(true, signalBlink, 4, false);
 }
 
 // 新增：GPIO2精确电压测试函数
@@ -901,15 +2744,15 @@ void testGPIO2() {
 
 // 新增：验证信号稳定性 - 改进版本，显示接收结果
 void verifySignal(int id) {
-  IRSignal* signal = irStorage.getSignal(id);
-  if (!signal || !signal->isValid) {
+  IRSignal* signal = &txSignal;
+  if (!irStorage.snapshot(id, txSignal)) {
     Serial.printf("错误: 信号 ID %d 不存在\n", id);
     return;
   }
   
   Serial.printf("🧪 开始验证信号 ID: %d (%s)\n", id, signal->name);
-  Serial.printf("📋 协议: %s, 值: 0x%08X, 位数: %d\n", 
-               typeToString(signal->protocol, false).c_str(), signal->value, signal->bits);
+  Serial.printf("📋 协议: %s, 值: 0x%08llX, 位数: %d\n", 
+               protocolName(signal->protocol), (unsigned long long)signal->value, signal->bits);
   Serial.println("💡 将发射5次信号，每次间隔2秒，同时监控接收结果");
   Serial.println("====================================");
   
@@ -938,12 +2781,10 @@ void verifySignal(int id) {
       } else {
         Serial.println("  📡 使用软件发射器");
       }
-      sendSuccess = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                            signal->rawData, signal->rawLength, 0);
+      sendSuccess = irTransmitter.sendSignal(*signal, 0);
     } else {
       Serial.println("  📡 使用协议发射器");
-      sendSuccess = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                            signal->rawData, signal->rawLength, 1);
+      sendSuccess = irTransmitter.sendSignal(*signal, 1);
     }
     
     if (sendSuccess) {
@@ -961,12 +2802,12 @@ void verifySignal(int id) {
     Serial.printf("  🔍 监控接收器反应 (超时%dms)...\n", RECEIVE_TIMEOUT);
     
     while (millis() - receiveStartTime < RECEIVE_TIMEOUT) {
-      if (irReceiver.isAvailable() && irReceiver.decode()) {
+      if (irReceiver.isAvailable() && irReceiver.decode() && !irReceiver.isRepeat()) {
         receivedSignal = true;
         receiveCount++;
         
         // 获取接收到的信号数据
-        uint32_t receivedValue = irReceiver.getValue();
+        uint64_t receivedValue = irReceiver.getValue();
         uint16_t receivedBits = irReceiver.getBits();
         decode_type_t receivedProtocol = irReceiver.getProtocol();
         
@@ -978,18 +2819,18 @@ void verifySignal(int id) {
         if (protocolMatch && valueMatch && bitsMatch) {
           signalMatches = true;
           receiveMatchCount++;
-          Serial.printf("  ✅ 接收验证: 协议=%s, 值=0x%08X, 位数=%d ✅完全匹配\n", 
-                       typeToString(receivedProtocol, false).c_str(), 
-                       receivedValue, receivedBits);
+          Serial.printf("  ✅ 接收验证: 协议=%s, 值=0x%08llX, 位数=%d ✅完全匹配\n", 
+                       protocolName(receivedProtocol), 
+                       (unsigned long long)receivedValue, receivedBits);
         } else {
-          Serial.printf("  ⚠️ 接收验证: 协议=%s, 值=0x%08X, 位数=%d ❌不匹配\n", 
-                       typeToString(receivedProtocol, false).c_str(), 
-                       receivedValue, receivedBits);
+          Serial.printf("  ⚠️ 接收验证: 协议=%s, 值=0x%08llX, 位数=%d ❌不匹配\n", 
+                       protocolName(receivedProtocol), 
+                       (unsigned long long)receivedValue, receivedBits);
           if (!protocolMatch) Serial.printf("    ❌ 协议差异: 期望%s ≠ 实际%s\n", 
-                                           typeToString(signal->protocol, false).c_str(),
-                                           typeToString(receivedProtocol, false).c_str());
-          if (!valueMatch) Serial.printf("    ❌ 数值差异: 期望0x%08X ≠ 实际0x%08X\n", 
-                                        signal->value, receivedValue);
+                                           protocolName(signal->protocol),
+                                           protocolName(receivedProtocol));
+          if (!valueMatch) Serial.printf("    ❌ 数值差异: 期望0x%08llX ≠ 实际0x%08llX\n", 
+                                        (unsigned long long)signal->value, (unsigned long long)receivedValue);
           if (!bitsMatch) Serial.printf("    ❌ 位数差异: 期望%d ≠ 实际%d\n", 
                                        signal->bits, receivedBits);
         }
@@ -1112,15 +2953,15 @@ void diagnosePullupResistor() {
 
 // 新增：持续验证信号稳定性 - 改进版本，同时监控接收
 void continuousVerifySignal(int id) {
-  IRSignal* signal = irStorage.getSignal(id);
-  if (!signal || !signal->isValid) {
+  IRSignal* signal = &txSignal;
+  if (!irStorage.snapshot(id, txSignal)) {
     Serial.printf("❌ 错误: 信号 ID %d 不存在\n", id);
     return;
   }
   
   Serial.printf("🔄 开始持续验证信号 ID: %d (%s)\n", id, signal->name);
-  Serial.printf("📋 协议: %s, 值: 0x%08X, 位数: %d\n", 
-               typeToString(signal->protocol, false).c_str(), signal->value, signal->bits);
+  Serial.printf("📋 协议: %s, 值: 0x%08llX, 位数: %d\n", 
+               protocolName(signal->protocol), (unsigned long long)signal->value, signal->bits);
   Serial.println("⏱️ 测试时长: 10秒，发射间隔: 0.5秒");
   Serial.println("📡 同时监控VS1838B接收器实时反应...");
   Serial.println("====================================");
@@ -1163,12 +3004,10 @@ void continuousVerifySignal(int id) {
         } else {
           Serial.println("  📡 使用软件发射器");
         }
-        sendSuccess = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                              signal->rawData, signal->rawLength, 0);
+        sendSuccess = irTransmitter.sendSignal(*signal, 0);
       } else {
         Serial.println("  📡 使用协议发射器");
-        sendSuccess = irTransmitter.sendSignal(signal->protocol, signal->value, signal->bits,
-                                              signal->rawData, signal->rawLength, 0);
+        sendSuccess = irTransmitter.sendSignal(*signal, 0);
       }
       
       if (sendSuccess) {
@@ -1188,12 +3027,12 @@ void continuousVerifySignal(int id) {
       Serial.printf("  🔍 监控接收器反应 (超时%dms)...\n", RECEIVE_TIMEOUT);
       
       while (millis() - receiveStartTime < RECEIVE_TIMEOUT) {
-        if (irReceiver.isAvailable() && irReceiver.decode()) {
+        if (irReceiver.isAvailable() && irReceiver.decode() && !irReceiver.isRepeat()) {
           receivedSignal = true;
           receiveCount++;
           
           // 获取接收到的信号数据
-          uint32_t receivedValue = irReceiver.getValue();
+          uint64_t receivedValue = irReceiver.getValue();
           uint16_t receivedBits = irReceiver.getBits();
           decode_type_t receivedProtocol = irReceiver.getProtocol();
           
@@ -1205,18 +3044,18 @@ void continuousVerifySignal(int id) {
           if (protocolMatch && valueMatch && bitsMatch) {
             signalMatches = true;
             receiveMatchCount++;
-            Serial.printf("  ✅ 接收样本 %d: 协议=%s, 值=0x%08X, 位数=%d ✅匹配\n", 
-                         receiveCount, typeToString(receivedProtocol, false).c_str(), 
-                         receivedValue, receivedBits);
+            Serial.printf("  ✅ 接收样本 %d: 协议=%s, 值=0x%08llX, 位数=%d ✅匹配\n", 
+                         receiveCount, protocolName(receivedProtocol), 
+                         (unsigned long long)receivedValue, receivedBits);
           } else {
-            Serial.printf("  ⚠️ 接收样本 %d: 协议=%s, 值=0x%08X, 位数=%d ❌不匹配\n", 
-                         receiveCount, typeToString(receivedProtocol, false).c_str(), 
-                         receivedValue, receivedBits);
+            Serial.printf("  ⚠️ 接收样本 %d: 协议=%s, 值=0x%08llX, 位数=%d ❌不匹配\n", 
+                         receiveCount, protocolName(receivedProtocol), 
+                         (unsigned long long)receivedValue, receivedBits);
             if (!protocolMatch) Serial.printf("    ❌ 协议不匹配: 期望%s, 实际%s\n", 
-                                             typeToString(signal->protocol, false).c_str(),
-                                             typeToString(receivedProtocol, false).c_str());
-            if (!valueMatch) Serial.printf("    ❌ 值不匹配: 期望0x%08X, 实际0x%08X\n", 
-                                          signal->value, receivedValue);
+                                             protocolName(signal->protocol),
+                                             protocolName(receivedProtocol));
+            if (!valueMatch) Serial.printf("    ❌ 值不匹配: 期望0x%08llX, 实际0x%08llX\n", 
+                                          (unsigned long long)signal->value, (unsigned long long)receivedValue);
             if (!bitsMatch) Serial.printf("    ❌ 位数不匹配: 期望%d, 实际%d\n", 
                                          signal->bits, receivedBits);
           }
@@ -1308,7 +3147,7 @@ void toggleRMT() {
   } else {
     // 当前禁用，切换为启用
     if (irTransmitter.enableRMT(true)) {
-      Serial.println("✅ RMT硬件发射器已启用，将用于UNKNOWN协议");
+      Serial.println("✅ RMT硬件发射器已启用，将用于UNKNOWN协议及NEC/SONY/RC5硬件编码");
       Serial.println("� 适用于: 提高UNKNOWN协议信号的发射稳定性");
     } else {
       Serial.println("❌ 启用RMT硬件发射器失败");
@@ -1316,8 +3155,186 @@ void toggleRMT() {
   }
   
   Serial.println("\n🔧 RMT硬件发射器说明:");
-  Serial.println("  ✅ 启用: 使用ESP32硬件RMT模块发射原始数据(更稳定)");
+  Serial.println("  ✅ 启用: 使用ESP32硬件RMT模块发射原始数据和NEC/SONY/RC5(时序精确，不占用CPU)");
   Serial.println("  ❌ 禁用: 使用IRremoteESP8266软件发射(兼容性更好)");
   Serial.println("  🎯 建议: UNKNOWN协议启用RMT，已知协议可禁用");
   Serial.println();
-}
\ No newline at end of file
+}
+
+// 新增：闭环发射 - 每次尝试后等待接收器回波，匹配即停止，并据此调整重试策略
+// 等待由事件循环定时器完成：回波通过EVENT_IR_RX到达onClosedLoopEcho，超时则进行下一次尝试
+void sendSignalClosedLoop(int id) {
+  bool knownProtocol = (txSignal.protocol != UNKNOWN);
+  closedLoopJob.id = id;
+  closedLoopJob.plan = retryPolicy.plan(id, knownProtocol);
+  closedLoopJob.attempt = 0;
+  closedLoopJob.confirmed = false;
+  closedLoopJob.active = true;
+  closedLoopJob.timerId = -1;
+  
+  Serial.printf("🔁 闭环发射: 最多%d次尝试, 协议重复%d次, 回波等待%dms\n",
+               closedLoopJob.plan.maxAttempts, closedLoopJob.plan.repeat, closedLoopJob.plan.echoTimeoutMs);
+  
+  currentState = TRANSMITTING;
+  statusLed.set(true);
+  
+  // 丢弃发射前残留的接收数据
+  irReceiver.reset();
+  closedLoopAttempt();
+}
+
+void closedLoopAttempt() {
+  // 发射失败不等待回波，直接进行下一次尝试
+  while (closedLoopJob.attempt < closedLoopJob.plan.maxAttempts) {
+    closedLoopJob.attempt++;
+    
+    // 每次尝试重新取快照，等待期间其他命令可能使用了txSignal
+    if (!irStorage.snapshot(closedLoopJob.id, txSignal)) {
+      Serial.printf("错误: 信号 ID %d 已不存在\n", closedLoopJob.id);
+      break;
+    }
+    
+    // 回波延迟从发射开始计算，与AdaptiveRetryPolicy::recordAttempt的约定一致
+    closedLoopJob.sendStart = millis();
+    if (!irTransmitter.sendSignal(txSignal, closedLoopJob.plan.repeat)) {
+      Serial.printf("❌ 第 %d 次发射失败\n", closedLoopJob.attempt);
+      retryPolicy.recordAttempt(closedLoopJob.id, false, 0);
+      continue;
+    }
+    
+    closedLoopJob.timerId = eventLoop.startTimer(closedLoopJob.plan.echoTimeoutMs, onClosedLoopTimeout);
+    if (closedLoopJob.timerId >= 0) return;
+    Serial.println("❌ 定时器已满，闭环发射中止");
+    break;
+  }
+  finishClosedLoop();
+}
+
+void onClosedLoopEcho() {
+  if (!irReceiver.decode()) return;
+  if (!irStorage.snapshot(closedLoopJob.id, txSignal) || !echoMatches(&txSignal)) return;
+  
+  eventLoop.cancelTimer(closedLoopJob.timerId);
+  closedLoopJob.timerId = -1;
+  uint16_t latency = (uint16_t)(millis() - closedLoopJob.sendStart);
+  retryPolicy.recordAttempt(closedLoopJob.id, true, latency);
+  closedLoopJob.confirmed = true;
+  Serial.printf("✅ 第 %d 次发射已确认 (回波延迟 %dms)\n", closedLoopJob.attempt, latency);
+  finishClosedLoop();
+  Serial.print("> ");
+}
+
+void onClosedLoopTimeout(void* ctx) {
+  closedLoopJob.timerId = -1;
+  retryPolicy.recordAttempt(closedLoopJob.id, false, 0);
+  Serial.printf("⚠️ 第 %d 次发射未收到匹配回波\n", closedLoopJob.attempt);
+  closedLoopAttempt();
+  if (!closedLoopJob.active) Serial.print("> ");
+}
+
+void finishClosedLoop() {
+  eventLoop.cancelTimer(closedLoopJob.timerId);
+  closedLoopJob.timerId = -1;
+  closedLoopJob.active = false;
+  
+  int id = closedLoopJob.id;
+  retryPolicy.recordSend(id, closedLoopJob.confirmed);
+  
+  statusLed.set(false);
+  currentState = IDLE;
+  
+  const RetryStats* stats = retryPolicy.getStats(id);
+  if (closedLoopJob.confirmed) {
+    Serial.printf("✅ 发射完成，共 %d 次尝试\n", closedLoopJob.attempt);
+  } else {
+    Serial.printf("❌ %d 次尝试均未确认，请检查接收器是否能看到发射管\n", closedLoopJob.attempt);
+  }
+  if (stats) {
+    Serial.printf("📊 累计确认率: %d/%d, 单次确认率: %.1f%%\n",
+                 stats->confirmed, stats->sends, stats->successRate / 10.0);
+  }
+}
+
+// 新增：判断刚解码的信号是否为指定信号的回波
+bool echoMatches(IRSignal* signal) {
+  if (irReceiver.getProtocol() != signal->protocol) {
+    return false;
+  }
+  
+  if (signal->protocol != UNKNOWN) {
+    return irReceiver.getValue() == signal->value && irReceiver.getBits() == signal->bits;
+  }
+  
+  // UNKNOWN协议比较原始脉冲
+  uint16_t pulses[256];
+  uint16_t length = irReceiver.getRawPulses(pulses, 256);
+  return rawPulsesMatch(signal->rawData, signal->rawLength, pulses, length);
+}
+
+// 新增：识别模式下查找收到的帧，特征索引筛出候选后才逐脉冲比较，未匹配时给出LSH找到的最接近信号
+void matchReceivedFrame() {
+  if (!irReceiver.decode() || irReceiver.isRepeat()) return;
+  
+  static uint16_t pulses[256];
+  uint16_t length = irReceiver.getRawPulses(pulses, 256);
+  uint8_t similarity = 0;
+  int compared = 0;
+  uint32_t start = micros();
+  int id = irStorage.matchPulses(pulses, length, &similarity, &compared);
+  uint32_t elapsedUs = micros() - start;
+  
+  if (id > 0) {
+    Serial.printf("🎯 ID %d %s 相似度%d%% (候选%d/%d, %lu us)\n", id, irStorage.getSignal(id)->name,
+                 similarity, compared, irStorage.getSignalCount(), (unsigned long)elapsedUs);
+  } else {
+    Serial.printf("❓ 未匹配: %s %d个脉冲 (候选%d/%d, 最高相似度%d%%, %lu us)\n",
+                 protocolName(irReceiver.getProtocol()), length, compared, irStorage.getSignalCount(),
+                 similarity, (unsigned long)elapsedUs);
+    
+    // 再用LSH索引找最接近的信号，置信度低说明库中有几个同样接近的信号
+    uint8_t confidence = 0;
+    start = micros();
+    int nearest = irStorage.nearestSignal(pulses, length, &confidence, &compared);
+    elapsedUs = micros() - start;
+    if (nearest > 0) {
+      Serial.printf("   最接近: ID %d %s 置信度%d%% (候选%d, %lu us)\n", nearest, irStorage.getSignal(nearest)->name,
+                   confidence, compared, (unsigned long)elapsedUs);
+    }
+  }
+}
+
+// 新增：切换闭环发射模式
+void toggleLoopback() {
+  closedLoopMode = !closedLoopMode;
+  
+  if (closedLoopMode) {
+    Serial.println("✅ 闭环发射已启用");
+    Serial.println("💡 发射后由VS1838B确认回波，确认即停止重试，并按历史成功率自动调整重复次数");
+    Serial.println("💡 请确保接收器能看到发射管的光(可用反射面)");
+  } else {
+    Serial.println("✅ 闭环发射已禁用，恢复固定重试次数");
+  }
+}
+
+// 新增：显示闭环发射统计
+void showLoopbackStats() {
+  Serial.printf("\n🔁 闭环发射统计 (模式: %s)\n", closedLoopMode ? "启用" : "禁用");
+  Serial.println("ID | 发射 | 确认 | 尝试 | 单次确认率 | 回波延迟 | 重复");
+  Serial.println("---|------|------|------|-----------|---------|-----");
+  
+  int shown = 0;
+  for (int id = 1; id <= AdaptiveRetryPolicy::MAX_TRACKED; id++) {
+    const RetryStats* stats = retryPolicy.getStats(id);
+    if (!stats || stats->sends == 0) continue;
+    
+    Serial.printf("%2d | %4d | %4d | %4d | %8.1f%% | %5dms | %3d\n",
+                 id, stats->sends, stats->confirmed, stats->attempts,
+                 stats->successRate / 10.0, stats->echoLatencyMs, stats->repeat);
+    shown++;
+  }
+  
+  if (shown == 0) {
+    Serial.println("暂无闭环发射记录");
+  }
+  Serial.println();
+}
@@ -0,0 +1,1250 @@
+// 主机端信号库包工具(pio run -e native，生成 .pio/build/native/program)
+//   program inspect <包文件>          校验并列出包内容，可直接读取含BUNDLE_BEGIN的串口日志
+//   program create <清单文件> <包文件>  按清单生成包，清单格式与inspect的输出相同
+//   program pronto <Pronto清单> [包文件]  解析Pronto码并测量吞吐，给出包文件时同时生成包
+//   program analyze <包文件>          推断包内UNKNOWN信号的编码结构，统计可改写为参数化记录的比例
+//   program compress <包文件或清单...>  把全部信号放入一张共享模式表，统计脉冲数据的压缩比
+//   program matchbench [信号数] [种子]  生成合成信号库，比较特征索引与逐个比较的查找速度(默认10000个)
+//   program lshbench [捕获数] [种子]   生成合成UNKNOWN捕获库，测量不同LSH参数和噪声下的召回率与查询延迟(默认100000个)
+//   program parbench [捕获数] [工作者数] 逐个比较整个捕获库，测量1、2和N个工作者的查找速度(默认100000个，N为CPU核数)
+//   program tunereplay [语料文件]    按时间戳回放语料(默认合成的多遥控器语料)，比较固定和自适应的帧结束超时
+//   program bench [基线CSV]          以固定种子运行基准套件，输出CSV并与基线比较，输出摘要不一致时返回2
+//                                    基线即本命令的输出，仓库中的基线为src/tools/bench_baseline.csv
+// 清单每行一个信号，#开头为注释：
+//   <名称> <协议编号> <值(十六进制)> <位数> <载波kHz> <占空比%> <重复周期ms> : <脉冲...> [| <重复帧脉冲...>]
+//   [@ <状态字节(十六进制，连续书写)>]
+// Pronto清单每行：<名称> <Pronto码>
+// pio test -e native 把src下的代码链接进每个测试程序，测试自带main，因此不编译本工具
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+#include "../ir_bundle.h"
+#include "../ir_pronto.h"
+#include "../ir_analyzer.h"
+#include "../ir_pattern_table.h"
+#include "../ir_feature_index.h"
+#include "../ir_signal_match.h"
+#include "../ir_lsh_index.h"
+#include "../ir_parallel_match.h"
+#include "../ir_capture_tuner.h"
+#include "../ir_latency.h"
+#include "../ir_bench.h"
+#include "../ir_host.h"
+#include <chrono>
+#include <ctype.h>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+// 串口日志中BUNDLE_BEGIN行之后才是包数据
+static size_t findBundleStart(const std::vector<uint8_t>& data) {
+    static const char marker[] = "BUNDLE_BEGIN ";
+    size_t length = strlen(marker);
+    for (size_t i = 0; i + length <= data.size(); i++) {
+        if (memcmp(&data[i], marker, length) != 0) continue;
+        while (i < data.size() && data[i] != '\n') i++;
+        return i < data.size() ? i + 1 : data.size();
+    }
+    return 0;
+}
+
+static void printPulses(const uint16_t* pulses, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) printf(" %u", pulses[i]);
+}
+
+static bool printEntry(const BundleEntry& entry, void*) {
+    printf("%s %d 0x%llX %u %u %u %u :", entry.name[0] ? entry.name : "-", entry.protocol,
+           (unsigned long long)entry.value, entry.bits, entry.carrierFreq, entry.dutyCycle, entry.repeatPeriod);
+    printPulses(entry.rawData, entry.rawLength);
+    if (entry.repeatLength > 0) {
+        printf(" |");
+        printPulses(entry.repeatData, entry.repeatLength);
+    }
+    if (entry.stateLength > 0) {
+        printf(" @ ");
+        for (uint8_t i = 0; i < entry.stateLength; i++) printf("%02X", entry.state[i]);
+    }
+    printf("\n");
+    return true;
+}
+
+static int inspect(const char* path) {
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    size_t start = findBundleStart(data);
+
+    static BundleReader reader(printEntry);
+    auto begin = std::chrono::steady_clock::now();
+    size_t consumed = 0;
+    BundleStatus status = reader.feed(data.data() + start, data.size() - start, &consumed);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("# bundle v%u: %d signals, %u bytes, status %s\n", BUNDLE_VERSION, reader.entryCount(),
+           reader.bytesReceived(), bundleStatusName(status));
+    if (seconds > 0) printf("# decode %.1f KB/s\n", reader.bytesReceived() / 1024.0 / seconds);
+    return status == BUNDLE_OK ? 0 : 2;
+}
+
+// ============== 按清单生成 ==============
+
+static std::vector<BundleEntry> entries;
+
+static bool parsePulses(char* text, uint16_t* out, uint16_t capacity, uint16_t& length) {
+    length = 0;
+    for (char* token = strtok(text, " \t\r\n"); token; token = strtok(nullptr, " \t\r\n")) {
+        if (length >= capacity) return false;
+        out[length++] = (uint16_t)strtoul(token, nullptr, 10);
+    }
+    return true;
+}
+
+static bool parseState(const char* text, uint8_t* out, uint8_t& length) {
+    length = 0;
+    while (*text == ' ' || *text == '\t') text++;
+    while (isxdigit((unsigned char)text[0]) && isxdigit((unsigned char)text[1])) {
+        if (length >= BundleEntry::MAX_STATE) return false;
+        char hex[3] = {text[0], text[1], '\0'};
+        out[length++] = (uint8_t)strtoul(hex, nullptr, 16);
+        text += 2;
+    }
+    while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') text++;
+    return *text == '\0' && length > 0;
+}
+
+static bool parseLine(char* line, BundleEntry& entry) {
+    memset(&entry, 0, sizeof(entry));
+    char* colon = strchr(line, ':');
+    if (!colon) return false;
+    *colon = '\0';
+
+    int protocol;
+    unsigned long long value;
+    unsigned bits, freq, duty, period;
+    char name[BundleEntry::MAX_NAME];
+    if (sscanf(line, "%31s %d %llx %u %u %u %u", name, &protocol, &value, &bits, &freq, &duty, &period) != 7) {
+        return false;
+    }
+    strncpy(entry.name, strcmp(name, "-") == 0 ? "" : name, BundleEntry::MAX_NAME - 1);
+    entry.protocol = (int16_t)protocol;
+    entry.value = value;
+    entry.bits = (uint16_t)bits;
+    entry.carrierFreq = (uint16_t)freq;
+    entry.dutyCycle = (uint8_t)duty;
+    entry.repeatPeriod = (uint16_t)period;
+
+    char* at = strchr(colon + 1, '@');
+    if (at) {
+        *at = '\0';
+        if (!parseState(at + 1, entry.state, entry.stateLength)) return false;
+    }
+    char* bar = strchr(colon + 1, '|');
+    if (bar) *bar = '\0';
+    if (!parsePulses(colon + 1, entry.rawData, BundleEntry::MAX_PULSES, entry.rawLength)) return false;
+    return !bar || parsePulses(bar + 1, entry.repeatData, BundleEntry::MAX_REPEAT, entry.repeatLength);
+}
+
+static bool listSource(int index, BundleEntry& out, void*) {
+    out = entries[index];
+    return true;
+}
+
+static void fileSink(const uint8_t* data, size_t length, void* ctx) {
+    fwrite(data, 1, length, (FILE*)ctx);
+}
+
+static int create(const char* listPath, const char* outPath) {
+    FILE* list = fopen(listPath, "r");
+    if (!list) {
+        fprintf(stderr, "cannot read %s\n", listPath);
+        return 1;
+    }
+
+    char line[4096];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), list)) {
+        lineNo++;
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+
+        BundleEntry entry;
+        if (!parseLine(p, entry)) {
+            fprintf(stderr, "%s:%d: invalid line\n", listPath, lineNo);
+            fclose(list);
+            return 1;
+        }
+        entries.push_back(entry);
+    }
+    fclose(list);
+
+    if (entries.size() > (size_t)BundleReader::MAX_ENTRIES) {
+        fprintf(stderr, "too many signals (%zu > %d)\n", entries.size(), BundleReader::MAX_ENTRIES);
+        return 1;
+    }
+
+    FILE* out = fopen(outPath, "wb");
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    size_t written = writeBundle((int)entries.size(), listSource, fileSink, out);
+    fclose(out);
+
+    size_t rawBytes = 0;
+    for (const BundleEntry& entry : entries) rawBytes += (entry.rawLength + entry.repeatLength) * 2;
+    printf("%zu signals, %zu bytes (pulses uncompressed %zu bytes)\n", entries.size(), written, rawBytes);
+    return written > 0 ? 0 : 1;
+}
+
+// ============== Pronto导入 ==============
+
+static int pronto(const char* listPath, const char* outPath) {
+    FILE* list = fopen(listPath, "r");
+    if (!list) {
+        fprintf(stderr, "cannot read %s\n", listPath);
+        return 1;
+    }
+
+    // 先读入全部码文本，计时只覆盖解析
+    std::vector<std::string> names;
+    std::vector<std::string> codes;
+    char line[8192];
+    while (fgets(line, sizeof(line), list)) {
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        char* code = p;
+        while (*code && *code != ' ' && *code != '\t') code++;
+        if (*code) *code++ = '\0';
+        names.push_back(p);
+        codes.push_back(code);
+    }
+    fclose(list);
+    if (codes.empty()) {
+        fprintf(stderr, "no codes in %s\n", listPath);
+        return 1;
+    }
+
+    static BundleEntry entry;
+    int failed = 0;
+    size_t pulses = 0;
+    for (size_t i = 0; i < codes.size(); i++) {
+        ProntoStatus status = parsePronto(codes[i].c_str(), entry);
+        if (status != PRONTO_OK) {
+            fprintf(stderr, "%s:%zu (%s): %s\n", listPath, i + 1, names[i].c_str(), prontoStatusName(status));
+            failed++;
+            continue;
+        }
+        pulses += entry.rawLength + entry.repeatLength;
+        if (outPath && entries.size() < (size_t)BundleReader::MAX_ENTRIES) {
+            strncpy(entry.name, names[i].c_str(), BundleEntry::MAX_NAME - 1);
+            entry.name[BundleEntry::MAX_NAME - 1] = '\0';
+            entries.push_back(entry);
+        }
+    }
+
+    // 重复解析整个清单直到至少10万个码，得到稳定的吞吐
+    size_t rounds = 100000 / codes.size() + 1;
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t sink = 0;
+    for (size_t r = 0; r < rounds; r++) {
+        for (const std::string& code : codes) {
+            sink += parsePronto(code.c_str(), entry) + entry.rawLength;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    size_t parsed = rounds * codes.size();
+
+    printf("# %zu codes, %d invalid, %zu pulses\n", codes.size(), failed, pulses);
+    if (seconds > 0) {
+        printf("# parse %.0f codes/s, %.2f us/code (%zu codes, check %u)\n",
+               parsed / seconds, seconds * 1e6 / parsed, parsed, sink);
+    }
+
+    if (!outPath) return failed == 0 ? 0 : 2;
+    if (codes.size() - failed > entries.size()) {
+        fprintf(stderr, "bundle holds the first %zu valid codes\n", entries.size());
+    }
+    FILE* out = fopen(outPath, "wb");
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    size_t written = writeBundle((int)entries.size(), listSource, fileSink, out);
+    fclose(out);
+    printf("%zu signals, %zu bytes\n", entries.size(), written);
+    return written > 0 && failed == 0 ? 0 : 2;
+}
+
+// ============== 结构分析 ==============
+
+// 与设备端参数化记录一致：描述符30字节替代原始脉冲
+static const size_t DESCRIPTOR_BYTES = 30;
+
+struct AnalyzeTotals {
+    int unknown;
+    int upgraded;
+    int byStatus[ANALYZE_BAD_REPEAT + 1];
+    size_t pulseBytes;            // 可改写信号的原始脉冲字节数
+    double seconds;
+};
+
+static bool analyzeBundleEntry(const BundleEntry& entry, void* ctx) {
+    AnalyzeTotals& totals = *(AnalyzeTotals*)ctx;
+    if (entry.protocol != -1 || entry.rawLength == 0) return true;
+    totals.unknown++;
+
+    PulseAnalysis analysis;
+    auto begin = std::chrono::steady_clock::now();
+    AnalyzeStatus status = analyzeEntry(entry, analysis);
+    totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    totals.byStatus[status]++;
+
+    const char* name = entry.name[0] ? entry.name : "-";
+    if (status != ANALYZE_OK) {
+        printf("%s: %s\n", name, analyzeStatusName(status));
+        return true;
+    }
+    const ProtocolDescriptor& d = analysis.desc;
+    printf("%s: %s hdr %u/%u one %u/%u zero %u/%u footer %u repeat %s, 0x%llX %u bits, error %u%%\n",
+           name, pulseCodeKindName(analysis.kind), d.hdrMark, d.hdrSpace, d.oneMark, d.oneSpace,
+           d.zeroMark, d.zeroSpace, d.footerMark,
+           d.repeatMode == RepeatMode::NEC_REPEAT_CODE ? "code" : "frame",
+           (unsigned long long)analysis.value, analysis.bits, analysis.maxErrorPct);
+    totals.upgraded++;
+    totals.pulseBytes += (entry.rawLength + entry.repeatLength) * sizeof(uint16_t);
+    return true;
+}
+
+static int analyze(const char* path) {
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    size_t start = findBundleStart(data);
+
+    static AnalyzeTotals totals;
+    static BundleReader reader(analyzeBundleEntry, &totals);
+    BundleStatus status = reader.feed(data.data() + start, data.size() - start);
+    if (status != BUNDLE_OK) {
+        fprintf(stderr, "%s: %s\n", path, bundleStatusName(status));
+        return 2;
+    }
+
+    printf("# %d signals, %d unknown, %d upgradable\n", reader.entryCount(), totals.unknown, totals.upgraded);
+    for (int s = ANALYZE_TOO_SHORT; s <= ANALYZE_BAD_REPEAT; s++) {
+        if (totals.byStatus[s] > 0) printf("#   %s: %d\n", analyzeStatusName((AnalyzeStatus)s), totals.byStatus[s]);
+    }
+    if (totals.upgraded > 0) {
+        printf("# pulses %zu bytes -> descriptors %zu bytes\n", totals.pulseBytes, totals.upgraded * DESCRIPTOR_BYTES);
+    }
+    if (totals.unknown > 0) printf("# analyze %.2f us/signal\n", totals.seconds * 1e6 / totals.unknown);
+    return 0;
+}
+
+// ============== 共享模式表压缩 ==============
+
+static bool collectEntry(const BundleEntry& entry, void*) {
+    entries.push_back(entry);
+    return true;
+}
+
+// 包文件(含串口日志)或清单，追加到entries
+static bool loadEntries(const char* path) {
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    size_t start = findBundleStart(data);
+    if (data.size() - start >= 4 && memcmp(&data[start], "IRBD", 4) == 0) {
+        static BundleReader reader(collectEntry);
+        reader.reset();
+        BundleStatus status = reader.feed(data.data() + start, data.size() - start);
+        if (status != BUNDLE_OK) {
+            fprintf(stderr, "%s: %s\n", path, bundleStatusName(status));
+            return false;
+        }
+        return true;
+    }
+
+    data.push_back('\0');
+    int lineNo = 0;
+    for (char* line = (char*)data.data(); line && *line; ) {
+        char* next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        lineNo++;
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line != '#' && *line != '\r' && *line != '\0') {
+            BundleEntry entry;
+            if (!parseLine(line, entry)) {
+                fprintf(stderr, "%s:%d: invalid line\n", path, lineNo);
+                return false;
+            }
+            entries.push_back(entry);
+        }
+        line = next;
+    }
+    return true;
+}
+
+// 与设备端共享记录一致：原始脉冲和重复帧分别切分为片段，每个片段下标1字节
+static int compress(int count, char** paths) {
+    for (int i = 0; i < count; i++) {
+        if (!loadEntries(paths[i])) return 1;
+    }
+
+    static PatternTable table;
+    uint8_t refs[PatternTable::MAX_SEGMENTS];
+    size_t pulseBytes = 0;        // 参与共享的信号的原始脉冲
+    size_t refBytes = 0;
+    size_t fallbackBytes = 0;     // 表满后按原始脉冲保存
+    int shared = 0;
+    int fallbacks = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (const BundleEntry& entry : entries) {
+        if (entry.stateLength > 0 || entry.rawLength == 0) continue;
+        size_t bytes = (entry.rawLength + entry.repeatLength) * sizeof(uint16_t);
+        uint8_t raw = 0;
+        uint8_t repeat = 0;
+        if (!table.acquire(entry.rawData, entry.rawLength, refs, sizeof(refs), raw) ||
+            !table.acquire(entry.repeatData, entry.repeatLength, refs + raw, sizeof(refs) - raw, repeat)) {
+            table.release(refs, raw);
+            fallbacks++;
+            fallbackBytes += bytes;
+            continue;
+        }
+        shared++;
+        pulseBytes += bytes;
+        refBytes += raw + repeat;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    size_t tableBytes = table.serializedSize();
+    size_t before = pulseBytes + fallbackBytes;
+    size_t after = refBytes + tableBytes + fallbackBytes;
+    printf("# %zu signals, %d shared, %d fallback (table full)\n", entries.size(), shared, fallbacks);
+    printf("# table %d pairs, %d segments, %zu bytes\n", table.pairCount(), table.segmentCount(), tableBytes);
+    printf("# pulses %zu bytes -> %zu bytes (refs %zu + table %zu + fallback %zu), %.1fx\n",
+           before, after, refBytes, tableBytes, fallbackBytes, after > 0 ? (double)before / after : 0.0);
+    if (!entries.empty()) printf("# intern %.2f us/signal\n", seconds * 1e6 / entries.size());
+    return 0;
+}
+
+// ============== 特征索引匹配基准 ==============
+
+static uint32_t benchRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// 常见编码的时序：引导码、1/0的mark和space、位数
+struct BenchFamily {
+    uint16_t hdrMark, hdrSpace, oneMark, oneSpace, zeroMark, zeroSpace, footerMark;
+    uint8_t bits;
+};
+
+static const BenchFamily BENCH_FAMILIES[] = {
+    {9000, 4500, 560, 1690, 560, 560, 560, 32},     // NEC
+    {4500, 4500, 560, 1690, 560, 560, 560, 32},     // SAMSUNG
+    {2400, 600, 1200, 600, 600, 600, 0, 12},        // SONY 12位
+    {2400, 600, 1200, 600, 600, 600, 0, 20},        // SONY 20位
+    {3400, 1700, 430, 1300, 430, 430, 430, 48},     // 松下
+    {8000, 4000, 500, 1500, 500, 500, 500, 40},     // 其他脉冲间隔编码
+};
+
+static void benchFrame(const BenchFamily& f, uint64_t value, std::vector<uint16_t>& out) {
+    out.clear();
+    out.push_back(f.hdrMark);
+    out.push_back(f.hdrSpace);
+    for (int b = f.bits - 1; b >= 0; b--) {
+        bool one = (value >> b) & 1;
+        out.push_back(one ? f.oneMark : f.zeroMark);
+        out.push_back(one ? f.oneSpace : f.zeroSpace);
+    }
+    if (f.footerMark) out.push_back(f.footerMark);
+    else out.pop_back();
+}
+
+static int matchBench(int signals, uint32_t seed) {
+    const int familyCount = sizeof(BENCH_FAMILIES) / sizeof(BENCH_FAMILIES[0]);
+    uint32_t rng = seed;
+    std::vector<std::vector<uint16_t>> library(signals);
+    std::vector<FeatureIndex::Entry> storage(signals);
+    FeatureIndex index(storage.data(), signals);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < signals; i++) {
+        const BenchFamily& f = BENCH_FAMILIES[benchRandom(rng) % familyCount];
+        uint64_t value = ((uint64_t)benchRandom(rng) << 24) ^ benchRandom(rng);
+        if (f.bits < 64) value &= (1ULL << f.bits) - 1;
+        benchFrame(f, value, library[i]);
+        SignalFeatures features;
+        computeFeatures(library[i].data(), (uint16_t)library[i].size(), features);
+        index.insert(i, features);
+    }
+    double insertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // 查询：库中信号加±6%抖动，一半带结尾间隔
+    const int queries = 2000;
+    std::vector<std::vector<uint16_t>> frames(queries);
+    std::vector<int> expected(queries);
+    for (int q = 0; q < queries; q++) {
+        expected[q] = benchRandom(rng) % signals;
+        frames[q] = library[expected[q]];
+        for (uint16_t& pulse : frames[q]) {
+            int jitter = (int)(benchRandom(rng) % 13) - 6;
+            pulse = (uint16_t)(pulse + pulse * jitter / 100);
+        }
+        if (q & 1) frames[q].push_back(40000);
+    }
+
+    // 逐个比较整个库
+    int linearHits = 0;
+    int linearQueries = queries / 10;
+    begin = std::chrono::steady_clock::now();
+    for (int q = 0; q < linearQueries; q++) {
+        int best = -1;
+        uint8_t bestScore = 0;
+        for (int i = 0; i < signals; i++) {
+            uint8_t score = rawPulsesSimilarity(library[i].data(), (uint16_t)library[i].size(),
+                                                frames[q].data(), (uint16_t)frames[q].size());
+            if (score > bestScore) {
+                bestScore = score;
+                best = i;
+            }
+        }
+        if (best >= 0 && library[best] == library[expected[q]] && bestScore >= kDefaultPulseMatch.minSimilarity) {
+            linearHits++;
+        }
+    }
+    double linearSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // 特征索引筛选后只比较候选
+    static int32_t candidates[4096];
+    int indexHits = 0, broadLookups = 0;
+    long long candidateTotal = 0, scannedTotal = 0;
+    begin = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        SignalFeatures query;
+        computeFeatures(frames[q].data(), (uint16_t)frames[q].size(), query);
+        int best = -1;
+        uint8_t bestScore = 0;
+        // 与设备端一致：精确查找没有达到相似度时再宽松查找
+        for (int pass = 0; pass < 2 && bestScore < kDefaultPulseMatch.minSimilarity; pass++) {
+            int scanned = 0;
+            int count = index.candidates(query, candidates, 4096, pass == 1, &scanned);
+            if (count > 4096) count = 4096;
+            if (pass == 1) broadLookups++;
+            candidateTotal += count;
+            scannedTotal += scanned;
+            for (int c = 0; c < count; c++) {
+                const std::vector<uint16_t>& s = library[candidates[c]];
+                uint8_t score = rawPulsesSimilarity(s.data(), (uint16_t)s.size(),
+                                                    frames[q].data(), (uint16_t)frames[q].size());
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = candidates[c];
+                }
+            }
+        }
+        if (best >= 0 && library[best] == library[expected[q]] && bestScore >= kDefaultPulseMatch.minSimilarity) {
+            indexHits++;
+        }
+    }
+    double indexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("# %d signals, %d families, index built in %.1f ms (%.2f us/insert)\n", signals, familyCount,
+           insertSeconds * 1e3, insertSeconds * 1e6 / signals);
+    printf("# linear: %.0f lookups/s, hit %d/%d\n", linearQueries / linearSeconds, linearHits, linearQueries);
+    printf("# index:  %.0f lookups/s, hit %d/%d, %.1f candidates, %.1f scanned per lookup, %d broad\n",
+           queries / indexSeconds, indexHits, queries, (double)candidateTotal / queries,
+           (double)scannedTotal / queries, broadLookups);
+    printf("# speedup %.0fx\n", (queries / indexSeconds) / (linearQueries / linearSeconds));
+    return indexHits == queries ? 0 : 2;
+}
+
+// ============== LSH最近邻基准 ==============
+
+// 未知编码：随机的引导码、位时序和位数，模拟捕获工具积累的UNKNOWN语料
+static void lshRandomFamily(uint32_t& rng, BenchFamily& f) {
+    uint16_t unit = (uint16_t)(300 + benchRandom(rng) % 500);
+    uint16_t ratio = (uint16_t)(20 + benchRandom(rng) % 20);          // 长短比2.0~3.9
+    f.hdrMark = (uint16_t)(unit * (4 + benchRandom(rng) % 13));
+    f.hdrSpace = (uint16_t)(f.hdrMark / (1 + benchRandom(rng) % 4));
+    if (benchRandom(rng) & 1) {
+        // 脉冲间隔编码
+        f.oneMark = f.zeroMark = unit;
+        f.oneSpace = (uint16_t)(unit * ratio / 10);
+        f.zeroSpace = unit;
+        f.footerMark = unit;
+    } else {
+        // 脉冲宽度编码
+        f.oneMark = (uint16_t)(unit * ratio / 10);
+        f.zeroMark = unit;
+        f.oneSpace = f.zeroSpace = unit;
+        f.footerMark = 0;
+    }
+    f.bits = (uint8_t)(12 + benchRandom(rng) % 37);
+}
+
+// 最近邻：候选中相似度最高者，返回库下标，没有候选时返回-1
+static int lshNearest(const LshIndex& index, const std::vector<std::vector<uint16_t>>& library,
+                      const std::vector<uint16_t>& frame, int32_t* candidates, int capacity,
+                      int& count, uint8_t& confidence) {
+    uint8_t levels[BundleEntry::MAX_PULSES];
+    uint16_t length = levelPulses(frame.data(), (uint16_t)frame.size(), levels, sizeof(levels));
+    count = index.candidates(levels, length, candidates, nullptr, capacity);
+    int best = -1;
+    uint8_t bestScore = 0, runnerUp = 0;
+    for (int c = 0; c < count; c++) {
+        const std::vector<uint16_t>& s = library[candidates[c]];
+        uint8_t score = rawPulsesSimilarity(s.data(), (uint16_t)s.size(), frame.data(), (uint16_t)frame.size());
+        if (score > bestScore) {
+            runnerUp = bestScore;
+            bestScore = score;
+            best = candidates[c];
+        } else if (score > runnerUp) {
+            runnerUp = score;
+        }
+    }
+    confidence = LshIndex::confidence(bestScore, runnerUp);
+    return best;
+}
+
+static int lshBench(int signals, uint32_t seed) {
+    const int familyCount = 256;
+    const int queries = 1000;
+    // 噪声档位：抖动(%) + 超出容差的脉冲比例(%)，最后一档接近匹配阈值(95%脉冲一致)
+    struct Noise {
+        uint8_t jitterPct;
+        uint8_t corruptPct;
+    };
+    static const Noise NOISES[] = {{4, 0}, {12, 0}, {8, 2}, {8, 4}};
+    static const LshConfig CONFIGS[] = {{4, 16}, {8, 16}, {8, 24}, {12, 24}, {16, 24}, {16, 32}, {16, 48}};
+    const int noiseCount = sizeof(NOISES) / sizeof(NOISES[0]);
+
+    uint32_t rng = seed;
+    std::vector<BenchFamily> families(familyCount);
+    for (BenchFamily& f : families) lshRandomFamily(rng, f);
+    std::vector<std::vector<uint16_t>> library(signals);
+    for (int i = 0; i < signals; i++) {
+        const BenchFamily& f = families[benchRandom(rng) % familyCount];
+        uint64_t value = ((uint64_t)benchRandom(rng) << 24) ^ benchRandom(rng);
+        if (f.bits < 64) value &= (1ULL << f.bits) - 1;
+        benchFrame(f, value, library[i]);
+    }
+
+    // 每档噪声一组查询，被破坏的脉冲变为一半或1.6倍，一半查询带结尾间隔
+    std::vector<std::vector<uint16_t>> frames(queries * noiseCount);
+    std::vector<int> expected(queries * noiseCount);
+    for (int j = 0; j < noiseCount; j++) {
+        for (int q = 0; q < queries; q++) {
+            int k = j * queries + q;
+            expected[k] = benchRandom(rng) % signals;
+            frames[k] = library[expected[k]];
+            int span = NOISES[j].jitterPct;
+            for (uint16_t& pulse : frames[k]) {
+                int jitter = (int)(benchRandom(rng) % (span * 2 + 1)) - span;
+                pulse = (uint16_t)(pulse + pulse * jitter / 100);
+            }
+            int corrupt = (int)frames[k].size() * NOISES[j].corruptPct / 100;
+            for (int c = 0; c < corrupt; c++) {
+                uint16_t& pulse = frames[k][benchRandom(rng) % frames[k].size()];
+                pulse = (benchRandom(rng) & 1) ? pulse / 2 : (uint16_t)(pulse * 8 / 5);
+            }
+            if (q & 1) frames[k].push_back(40000);
+        }
+    }
+
+    printf("# %d captures, %d unknown families, %d queries per noise level\n", signals, familyCount, queries);
+
+    // 逐个比较的基线(每档只测部分查询)
+    int linearQueries = signals > 100000 ? 10 : 50;
+    printf("# linear:");
+    for (int j = 0; j < noiseCount; j++) {
+        int hits = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int q = 0; q < linearQueries; q++) {
+            const std::vector<uint16_t>& frame = frames[j * queries + q];
+            int best = -1;
+            uint8_t bestScore = 0;
+            for (int i = 0; i < signals; i++) {
+                uint8_t score = rawPulsesSimilarity(library[i].data(), (uint16_t)library[i].size(),
+                                                    frame.data(), (uint16_t)frame.size());
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = i;
+                }
+            }
+            if (best >= 0 && library[best] == library[expected[j * queries + q]]) hits++;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        printf(" +-%u%%/%u%% recall %.3f %.0f us;", NOISES[j].jitterPct, NOISES[j].corruptPct,
+               (double)hits / linearQueries, seconds * 1e6 / linearQueries);
+    }
+    printf("\n");
+
+    // 召回率/延迟曲线：每组参数一行，每档噪声给出召回率、平均候选数、每次查询耗时和平均置信度
+    printf("# tables samples  build_ms  bytes/entry");
+    for (int j = 0; j < noiseCount; j++) {
+        printf(" | +-%u%%/%u%%: recall  cand     us conf", NOISES[j].jitterPct, NOISES[j].corruptPct);
+    }
+    printf("\n");
+
+    int buckets = 1;
+    while (buckets < signals) buckets <<= 1;
+    std::vector<int32_t> heads;
+    std::vector<LshIndex::Slot> slots;
+    static int32_t candidates[1 << 16];
+    int status = 0;
+    for (const LshConfig& config : CONFIGS) {
+        heads.assign((size_t)buckets * config.tables, 0);
+        slots.assign((size_t)signals * config.tables, LshIndex::Slot());
+        LshIndex index(heads.data(), buckets, slots.data(), signals, config);
+
+        auto begin = std::chrono::steady_clock::now();
+        uint8_t levels[BundleEntry::MAX_PULSES];
+        for (int i = 0; i < signals; i++) {
+            uint16_t length = levelPulses(library[i].data(), (uint16_t)library[i].size(), levels, sizeof(levels));
+            index.insert(i, levels, length);
+        }
+        double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        double bytes = (double)(heads.size() * sizeof(int32_t) + slots.size() * sizeof(LshIndex::Slot)) / signals;
+        printf("  %6u %7u %9.0f %12.1f", config.tables, config.samples, buildSeconds * 1e3, bytes);
+
+        for (int j = 0; j < noiseCount; j++) {
+            int hits = 0;
+            long long candidateTotal = 0, confidenceTotal = 0;
+            begin = std::chrono::steady_clock::now();
+            for (int q = 0; q < queries; q++) {
+                int k = j * queries + q;
+                int count = 0;
+                uint8_t confidence = 0;
+                int best = lshNearest(index, library, frames[k], candidates, 1 << 16, count, confidence);
+                candidateTotal += count;
+                if (best >= 0 && library[best] == library[expected[k]]) {
+                    hits++;
+                    confidenceTotal += confidence;
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            printf(" |            %.3f %5.1f %6.1f %3.0f%%", (double)hits / queries,
+                   (double)candidateTotal / queries, seconds * 1e6 / queries,
+                   hits ? (double)confidenceTotal / hits : 0.0);
+            // 默认参数在只有抖动时应找回几乎全部信号
+            if (config.tables == kDefaultLsh.tables && config.samples == kDefaultLsh.samples &&
+                NOISES[j].corruptPct == 0 && hits * 100 < queries * 99) {
+                status = 2;
+            }
+        }
+        printf("\n");
+    }
+    return status;
+}
+
+// ============== 并行匹配基准 ==============
+
+static const uint16_t* libraryPulses(int32_t id, uint16_t& length, void* ctx) {
+    const std::vector<std::vector<uint16_t>>& library = *(const std::vector<std::vector<uint16_t>>*)ctx;
+    length = (uint16_t)library[id].size();
+    return library[id].data();
+}
+
+static int parallelBench(int signals, int maxWorkers) {
+    const int familyCount = 256;
+    const int queries = signals >= 100000 ? 50 : 200;
+    uint32_t rng = 1;
+    std::vector<BenchFamily> families(familyCount);
+    for (BenchFamily& f : families) lshRandomFamily(rng, f);
+    std::vector<std::vector<uint16_t>> library(signals);
+    for (int i = 0; i < signals; i++) {
+        const BenchFamily& f = families[benchRandom(rng) % familyCount];
+        uint64_t value = ((uint64_t)benchRandom(rng) << 24) ^ benchRandom(rng);
+        if (f.bits < 64) value &= (1ULL << f.bits) - 1;
+        benchFrame(f, value, library[i]);
+    }
+
+    std::vector<std::vector<uint16_t>> frames(queries);
+    std::vector<int> expected(queries);
+    for (int q = 0; q < queries; q++) {
+        expected[q] = benchRandom(rng) % signals;
+        frames[q] = library[expected[q]];
+        for (uint16_t& pulse : frames[q]) {
+            int jitter = (int)(benchRandom(rng) % 17) - 8;
+            pulse = (uint16_t)(pulse + pulse * jitter / 100);
+        }
+    }
+
+    printf("# %d captures, %d queries, full scan (no index), %u hardware threads\n", signals, queries,
+           std::thread::hardware_concurrency());
+    printf("# workers  lookups/s  speedup  hit | early stop: lookups/s  compared/lookup\n");
+
+    int counts[] = {1, 2, maxWorkers};
+    int runs = maxWorkers > 2 ? 3 : 2;
+    double baseline = 0;
+    std::vector<int32_t> reference(queries);
+    int status = 0;
+    for (int r = 0; r < runs; r++) {
+        ThreadPoolMatchWorkers pool(counts[r]);
+        SerialMatchWorkers serial;
+        ParallelMatcher matcher(counts[r] == 1 ? (MatchWorkers*)&serial : &pool);
+
+        // 不提前结束：与单工作者的结果必须一致
+        int hits = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) {
+            ParallelMatchResult result = matcher.match(frames[q].data(), (uint16_t)frames[q].size(), nullptr,
+                                                       signals, libraryPulses, &library);
+            if (r == 0) reference[q] = result.best;
+            else if (result.best != reference[q]) status = 2;
+            if (result.best >= 0 && library[result.best] == library[expected[q]]) hits++;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        double rate = queries / seconds;
+        if (r == 0) baseline = rate;
+
+        // 完全一致即结束
+        long long compared = 0;
+        begin = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) {
+            ParallelMatchResult result = matcher.match(frames[q].data(), (uint16_t)frames[q].size(), nullptr,
+                                                       signals, libraryPulses, &library, 100);
+            compared += result.compared;
+        }
+        double stopSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        printf("  %7d %10.0f %7.2fx %4d | %21.0f %16.0f\n", counts[r], rate, rate / baseline, hits,
+               queries / stopSeconds, (double)compared / queries);
+    }
+    if (status) printf("# MISMATCH: parallel result differs from single worker\n");
+    return status;
+}
+
+// ============== 捕获参数回放 ==============
+
+// 语料帧的时间和脉冲(格式见ir_corpus.h，这里只取时间戳、型号、期望协议和脉冲)
+struct TimedFrame {
+    uint32_t startUs;
+    std::string model;
+    bool labeled;                 // 期望协议不是UNKNOWN
+    std::vector<uint16_t> pulses;
+};
+
+static bool loadCorpusTimings(const char* path, std::vector<TimedFrame>& frames) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    static char line[64 + 256 * 6 + 16];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        char* fields[8];
+        char* p = line;
+        int n = 0;
+        for (; n < 8 && p; n++) {
+            fields[n] = p;
+            char* comma = n < 7 ? strchr(p, ',') : strchr(p, ':');
+            if (comma) *comma = '\0';
+            p = comma ? comma + 1 : nullptr;
+        }
+        if (n < 8 || !p) continue;
+
+        TimedFrame frame;
+        frame.startUs = (uint32_t)strtoul(fields[0], nullptr, 10) * 1000;
+        frame.model = fields[1];
+        frame.labeled = strcmp(fields[4], "UNKNOWN") != 0;
+        uint16_t pulses[256];
+        uint16_t length = 0;
+        if (!parsePulses(p, pulses, 256, length) || length == 0) continue;
+        frame.pulses.assign(pulses, pulses + length);
+        frames.push_back(frame);
+    }
+    fclose(file);
+    return true;
+}
+
+static void pushSection(const BenchFamily& f, int bits, uint32_t& rng, std::vector<uint16_t>& out) {
+    out.push_back(f.hdrMark);
+    out.push_back(f.hdrSpace);
+    for (int b = 0; b < bits; b++) {
+        bool one = benchRandom(rng) & 1;
+        out.push_back(one ? f.oneMark : f.zeroMark);
+        out.push_back(one ? f.oneSpace : f.zeroSpace);
+    }
+    if (f.footerMark) out.push_back(f.footerMark);
+    else out.pop_back();
+}
+
+// 合成语料：每个遥控器一次会话，按键间隔0.6~1.8秒
+//   NEC电视     数据帧 + 0~3个重复码(周期108ms)
+//   SONY功放    每次按键3帧(周期45ms)
+//   空调        3段(8、8、19字节)，段间29ms，共约570个脉冲
+static void syntheticCorpus(std::vector<TimedFrame>& frames) {
+    const BenchFamily nec = {9000, 4500, 560, 1690, 560, 560, 560, 32};
+    const BenchFamily sony = {2400, 600, 1200, 600, 600, 600, 0, 12};
+    const BenchFamily ac = {3650, 1623, 428, 1280, 428, 428, 428, 0};
+    uint32_t rng = 1;
+    uint32_t now = 0;
+    for (int session = 0; session < 3; session++) {
+        for (int press = 0; press < 20; press++) {
+            now += 600000 + benchRandom(rng) % 1200000;
+            TimedFrame frame;
+            frame.labeled = true;
+            if (session == 0) {
+                frame.model = "nec_tv";
+                frame.startUs = now;
+                pushSection(nec, 32, rng, frame.pulses);
+                frames.push_back(frame);
+                int repeats = benchRandom(rng) % 4;
+                for (int r = 1; r <= repeats; r++) {
+                    frame.startUs = now + r * 108000;
+                    frame.pulses = {9000, 2250, 560};
+                    frames.push_back(frame);
+                }
+            } else if (session == 1) {
+                frame.model = "sony_av";
+                frame.pulses.clear();
+                pushSection(sony, 12, rng, frame.pulses);
+                for (int r = 0; r < 3; r++) {
+                    frame.startUs = now + r * 45000;
+                    frames.push_back(frame);
+                }
+            } else {
+                // 空调三段同属一帧，段间的间隔在帧内
+                frame.model = "ac";
+                frame.startUs = now;
+                int bytes[] = {8, 8, 19};
+                for (int part = 0; part < 3; part++) {
+                    if (part > 0) frame.pulses.push_back(29400);
+                    pushSection(ac, bytes[part] * 8, rng, frame.pulses);
+                }
+                frames.push_back(frame);
+            }
+        }
+    }
+}
+
+static const uint16_t kIRrecvDefaultBuffer = 100;   // IRrecv默认的捕获缓冲项数(kRawBuf)
+
+struct TuneResult {
+    uint32_t frames;
+    uint32_t intact;              // 恰好捕获为一段的帧
+    uint32_t split;               // 被超时截成多段的帧
+    uint32_t merged;              // 与相邻帧并入同一段的帧
+    uint32_t captures;
+    uint32_t overflows;
+    uint32_t retunes;
+    LatencyHistogram latency;     // 完整捕获的帧：帧长 + 超时(微秒)
+};
+
+// 模拟IRrecv：超过超时的space结束一段捕获，缓冲(capacity项)满后本段余下的脉冲丢弃。
+// tuner不为nullptr时每段捕获交给它观察，需要调整时与设备一样等到段间空闲超过HOLD_GAP、
+// 且距上一次调整(重建IRrecv)不少于IRReceiver::REBUILD_MIN_INTERVAL_MS再调整
+static void simulateCapture(const std::vector<TimedFrame>& frames, size_t first, size_t last, uint8_t& timeoutMs,
+                            uint16_t capacity, CaptureTuner* tuner, TuneResult& result) {
+    const uint32_t holdGapUs = 250000;
+    const uint32_t rebuildIntervalUs = 5000000;
+    bool rebuilt = false;
+    uint32_t lastRebuildUs = 0;
+
+    // 展开为mark/space交替的时长序列，帧之间的间隔也是space
+    std::vector<uint32_t> durations;
+    std::vector<uint32_t> owners;
+    std::vector<size_t> frameFirst, frameLast;       // 每帧第一个和最后一个mark的下标
+    uint32_t t = frames[first].startUs;
+    for (size_t f = first; f < last; f++) {
+        const std::vector<uint16_t>& pulses = frames[f].pulses;
+        size_t length = pulses.size() % 2 == 0 ? pulses.size() - 1 : pulses.size();
+        if (f > first) {
+            durations.push_back(frames[f].startUs > t ? frames[f].startUs - t : 1);
+            owners.push_back((uint32_t)(f - first));
+            t += durations.back();
+        }
+        frameFirst.push_back(durations.size());
+        for (size_t k = 0; k < length; k++) {
+            durations.push_back(pulses[k]);
+            owners.push_back((uint32_t)(f - first));
+            t += pulses[k];
+        }
+        frameLast.push_back(durations.size() - 1);
+    }
+
+    size_t count = last - first;
+    std::vector<int> pieces(count, 0);               // 每帧被分成的段数
+    std::vector<int> spans(count, 0);                // 每帧所在的段最多包含几帧
+    uint32_t previousEnd = 0;
+    t = frames[first].startUs;
+    size_t k = 0;
+    while (k < durations.size()) {
+        uint32_t gap = k > 0 ? t - previousEnd : 0;
+        if (tuner && tuner->pending() && gap > holdGapUs && (!rebuilt || t - lastRebuildUs >= rebuildIntervalUs)) {
+            tuner->apply();
+            timeoutMs = tuner->getTimeoutMs();
+            rebuilt = true;
+            lastRebuildUs = t;
+        }
+
+        CaptureObservation observation = {0, 0, 0, gap, false, false};
+        uint32_t limitUs = (uint32_t)timeoutMs * 1000;
+        uint32_t start = t;
+        size_t j = k;
+        while (true) {
+            // j是mark，缓冲项数比脉冲数多1
+            if (observation.pulses + 1 < capacity) {
+                observation.pulses++;
+                observation.durationUs = t + durations[j] - start;
+            } else {
+                observation.overflow = true;
+            }
+            t += durations[j];
+            if (j + 1 >= durations.size() || durations[j + 1] > limitUs) break;
+            if (!observation.overflow) {
+                if (observation.pulses + 1 < capacity) {
+                    observation.pulses++;
+                    if (durations[j + 1] > observation.longestSpaceUs) observation.longestSpaceUs = durations[j + 1];
+                } else {
+                    observation.overflow = true;
+                }
+            }
+            t += durations[j + 1];
+            j += 2;
+        }
+
+        uint32_t firstFrame = owners[k];
+        uint32_t lastFrame = owners[j];
+        int framesInCapture = (int)(lastFrame - firstFrame + 1);
+        for (uint32_t f = firstFrame; f <= lastFrame; f++) {
+            pieces[f]++;
+            if (spans[f] < framesInCapture) spans[f] = framesInCapture;
+        }
+        bool whole = framesInCapture == 1 && k == frameFirst[firstFrame] && j == frameLast[firstFrame];
+
+        result.captures++;
+        if (observation.overflow) result.overflows++;
+        observation.decoded = whole && !observation.overflow && frames[first + firstFrame].labeled;
+        if (whole && !observation.overflow) result.latency.record(observation.durationUs + limitUs);
+        if (tuner) tuner->observe(observation);
+
+        // 结束本段的space不属于任何一段
+        previousEnd = t;
+        if (j + 1 < durations.size()) t += durations[j + 1];
+        k = j + 2;
+    }
+
+    for (size_t f = 0; f < count; f++) {
+        result.frames++;
+        if (spans[f] > 1) result.merged++;
+        else if (pieces[f] > 1) result.split++;
+        else result.intact++;
+    }
+    if (tuner) result.retunes += tuner->getStats().retunes;
+}
+
+static void printTuneResult(const char* session, const char* mode, const TuneResult& r, uint8_t timeoutMs,
+                            uint16_t buffer) {
+    printf("%-12s %-9s %6u %6u %5u %6u %8.1f%% %8.1f %8.1f %7u %6u\n", session, mode, r.frames, r.intact, r.split,
+           r.merged, r.captures ? 100.0 * r.overflows / r.captures : 0.0, r.latency.percentile(500) / 1000.0,
+           r.latency.percentile(990) / 1000.0, timeoutMs, buffer);
+}
+
+static void addTuneResult(TuneResult& total, const TuneResult& part) {
+    total.frames += part.frames;
+    total.intact += part.intact;
+    total.split += part.split;
+    total.merged += part.merged;
+    total.captures += part.captures;
+    total.overflows += part.overflows;
+    total.retunes += part.retunes;
+}
+
+static int tuneReplay(const char* path) {
+    std::vector<TimedFrame> frames;
+    if (path) {
+        if (!loadCorpusTimings(path, frames)) {
+            fprintf(stderr, "cannot read %s\n", path);
+            return 1;
+        }
+    } else {
+        syntheticCorpus(frames);
+    }
+    if (frames.empty()) {
+        fprintf(stderr, "no frames\n");
+        return 1;
+    }
+
+    printf("# %zu frames from %s; fixed = IRrecv defaults (%u ms, %u entries), adaptive = CaptureTuner timeout per"
+           " session with the device buffer (%u entries)\n",
+           frames.size(), path ? path : "synthetic corpus", CAPTURE_DEFAULT_TIMEOUT_MS, kIRrecvDefaultBuffer,
+           CAPTURE_BUFFER_SIZE);
+    printf("# latency = frame length + timeout for frames captured whole, excluding the frame-end check interval\n");
+    printf("# session    mode      frames intact split merged overflow  p50(ms)  p99(ms) timeout buffer\n");
+
+    // 型号变化即开始新会话，自适应参数跨会话保留，与设备上开始学习另一个遥控器时一致
+    TuneResult fixedTotal = {}, adaptiveTotal = {};
+    uint8_t adaptiveTimeout = CAPTURE_DEFAULT_TIMEOUT_MS;
+    CaptureTuner tuner;
+    for (size_t begin = 0; begin < frames.size();) {
+        size_t end = begin + 1;
+        while (end < frames.size() && frames[end].model == frames[begin].model) end++;
+
+        TuneResult fixed = {}, adaptive = {};
+        uint8_t fixedTimeout = CAPTURE_DEFAULT_TIMEOUT_MS;
+        simulateCapture(frames, begin, end, fixedTimeout, kIRrecvDefaultBuffer, nullptr, fixed);
+        tuner.reset(adaptiveTimeout);
+        simulateCapture(frames, begin, end, adaptiveTimeout, CAPTURE_BUFFER_SIZE, &tuner, adaptive);
+
+        const char* model = frames[begin].model.empty() ? "-" : frames[begin].model.c_str();
+        printTuneResult(model, "fixed", fixed, fixedTimeout, kIRrecvDefaultBuffer);
+        printTuneResult(model, "adaptive", adaptive, adaptiveTimeout, CAPTURE_BUFFER_SIZE);
+        addTuneResult(fixedTotal, fixed);
+        addTuneResult(adaptiveTotal, adaptive);
+        begin = end;
+    }
+
+    printf("# total: fixed intact %u/%u, overflow %.1f%% | adaptive intact %u/%u, overflow %.1f%%, %u retunes\n",
+           fixedTotal.intact, fixedTotal.frames,
+           fixedTotal.captures ? 100.0 * fixedTotal.overflows / fixedTotal.captures : 0.0, adaptiveTotal.intact,
+           adaptiveTotal.frames, adaptiveTotal.captures ? 100.0 * adaptiveTotal.overflows / adaptiveTotal.captures : 0.0,
+           adaptiveTotal.retunes);
+    return 0;
+}
+
+// ============== 基准套件 ==============
+
+struct BaselineCase {
+    std::string name;
+    BenchBaselineEntry entry;
+};
+
+// 读取bench输出的CSV作为基线：按用例名对应，#seed=行记录生成基线时的种子
+static bool loadBaseline(const char* path, std::vector<BaselineCase>& cases, uint32_t& seed) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned long value;
+        if (sscanf(line, "# seed=%lu", &value) == 1) {
+            seed = (uint32_t)value;
+            continue;
+        }
+        if (line[0] == '#' || strncmp(line, "case,", 5) == 0) continue;
+
+        char name[64];
+        unsigned long iterations, nsPerOp, checksum;
+        if (sscanf(line, "%63[^,],%lu,%lu,%lx", name, &iterations, &nsPerOp, &checksum) != 4) continue;
+        BaselineCase c;
+        c.name = name;
+        c.entry.nsPerOp = (uint32_t)nsPerOp;
+        c.entry.checksum = (uint32_t)checksum;
+        cases.push_back(c);
+    }
+    fclose(file);
+    return true;
+}
+
+static int runBench(const char* baselinePath) {
+    std::vector<BaselineCase> baseline;
+    uint32_t baselineSeed = 0;
+    if (baselinePath && !loadBaseline(baselinePath, baseline, baselineSeed)) {
+        fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+        return 1;
+    }
+
+    // 单次运行只有几十毫秒，受调度影响大：运行BENCH_RUNS次取每个用例的最短耗时
+    // 存储用例会打印存储日志，与CSV混在一起
+    const int BENCH_RUNS = 5;
+    Serial.setQuiet(true);
+    BenchSuite suite(BenchSuite::DEFAULT_SEED);
+    ThreadPoolMatchWorkers pool(2);
+    suite.setMatchWorkers(&pool);
+    BenchResult results[BenchSuite::MAX_CASES];
+    int count = suite.run(results, BenchSuite::MAX_CASES);
+    for (int run = 1; run < BENCH_RUNS; run++) {
+        BenchResult again[BenchSuite::MAX_CASES];
+        suite.run(again, BenchSuite::MAX_CASES);
+        for (int i = 0; i < count; i++) {
+            if (again[i].nsPerOp < results[i].nsPerOp) results[i].nsPerOp = again[i].nsPerOp;
+        }
+    }
+    Serial.setQuiet(false);
+
+    bool sameSeed = baselineSeed == BenchSuite::DEFAULT_SEED;
+    printf("# seed=%u\n", BenchSuite::DEFAULT_SEED);
+    printf("case,iterations,ns_per_op,checksum,baseline_ns,ratio_pct,verdict\n");
+    int regressions = 0;
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        const BenchBaselineEntry* entry = nullptr;
+        for (const BaselineCase& c : baseline) {
+            if (c.name == results[i].name) entry = &c.entry;
+        }
+        uint32_t ratioPct = 0;
+        BenchVerdict verdict = BenchSuite::compare(results[i], entry, sameSeed, ratioPct);
+        if (verdict == BENCH_REGRESSION) regressions++;
+        if (verdict == BENCH_MISMATCH) mismatches++;
+
+        printf("%s,%u,%u,%08x,%u,%u,%s\n", results[i].name, results[i].iterations, results[i].nsPerOp,
+               results[i].checksum, entry ? entry->nsPerOp : 0, ratioPct, BenchSuite::verdictName(verdict));
+    }
+    printf("# cases=%d regressions=%d mismatches=%d\n", count, regressions, mismatches);
+    // 耗时只在同一台机器上可比，退化只在CSV中标出；输出摘要与机器无关，不一致说明行为改变
+    return mismatches > 0 ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "inspect") == 0) return inspect(argv[2]);
+    if (argc == 4 && strcmp(argv[1], "create") == 0) return create(argv[2], argv[3]);
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "pronto") == 0) {
+        return pronto(argv[2], argc == 4 ? argv[3] : nullptr);
+    }
+    if (argc == 3 && strcmp(argv[1], "analyze") == 0) return analyze(argv[2]);
+    if (argc >= 3 && strcmp(argv[1], "compress") == 0) return compress(argc - 2, argv + 2);
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "matchbench") == 0) {
+        int signals = argc >= 3 ? atoi(argv[2]) : 10000;
+        uint32_t seed = argc >= 4 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 1;
+        if (signals > 0) return matchBench(signals, seed);
+    }
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "parbench") == 0) {
+        int signals = argc >= 3 ? atoi(argv[2]) : 100000;
+        int workers = argc >= 4 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+        if (signals > 0) return parallelBench(signals, workers > 0 ? workers : 1);
+    }
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "lshbench") == 0) {
+        int signals = argc >= 3 ? atoi(argv[2]) : 100000;
+        uint32_t seed = argc >= 4 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 1;
+        if (signals > 0) return lshBench(signals, seed);
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "tunereplay") == 0) {
+        return tuneReplay(argc == 3 ? argv[2] : nullptr);
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+        return runBench(argc == 3 ? argv[2] : nullptr);
+    }
+
+    fprintf(stderr, "usage: %s inspect <bundle>\n       %s create <list> <bundle>\n"
+                    "       %s pronto <pronto list> [bundle]\n       %s analyze <bundle>\n"
+                    "       %s compress <bundle|list>...\n       %s matchbench [signals] [seed]\n"
+                    "       %s lshbench [captures] [seed]\n       %s parbench [captures] [workers]\n"
+                    "       %s tunereplay [corpus]\n       %s bench [baseline.csv]\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include <unity.h>
+#include "ir_carrier_estimator.h"
+
+// 载波估计器：合成边沿流(80MHz时间戳，与CarrierDetector的RMT分辨率相同)
+static const uint32_t TICK_HZ = 80000000UL;
+
+static uint32_t rng_state;
+
+static void seedJitter(uint32_t seed) {
+    rng_state = seed;
+}
+
+// 固定种子的线性同余发生器，返回[-range, range]内的抖动
+static int32_t jitter(int32_t range) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    if (range == 0) return 0;
+    return (int32_t)((rng_state >> 16) % (uint32_t)(2 * range + 1)) - range;
+}
+
+// 按NEC风格的mark/space序列输出边沿：每个mark是一段载波突发，每个边沿加抖动
+// 返回下一段的起始时间(ticks)
+static double feedFrame(CarrierEstimator& est, double t, uint32_t freqHz, uint8_t dutyPct,
+                        int32_t jitterTicks, int marks, bool markEndBurst) {
+    double period = (double)TICK_HZ / freqHz;
+    double high = period * dutyPct / 100;
+    int cyclesPerMark = (int)(560e-6 * freqHz);      // 560us的mark
+    for (int m = 0; m < marks; m++) {
+        for (int c = 0; c < cyclesPerMark; c++) {
+            est.addEdge((uint32_t)(t + jitter(jitterTicks)), true);
+            est.addEdge((uint32_t)(t + high + jitter(jitterTicks)), false);
+            t += period;
+        }
+        if (markEndBurst) est.endBurst();
+        t += (m & 1 ? 1690e-6 : 560e-6) * TICK_HZ;    // 数据位之间的space
+    }
+    return t;
+}
+
+static void checkCarrier(uint32_t freqHz, int32_t jitterTicks) {
+    CarrierEstimator est(TICK_HZ);
+    seedJitter(freqHz);
+    feedFrame(est, 1000, freqHz, 33, jitterTicks, 16, true);
+
+    CarrierEstimate result = est.estimate();
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL_UINT16(freqHz / 1000, result.frequency);
+    TEST_ASSERT_UINT32_WITHIN(freqHz / 100, freqHz, result.frequencyHz);
+    TEST_ASSERT_UINT_WITHIN(3, 33, result.dutyCycle);
+    TEST_ASSERT_GREATER_OR_EQUAL(CarrierEstimator::MIN_CYCLES, result.cycles);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// 每个边沿±1%周期的抖动
+void test_carrier_36k(void) { checkCarrier(36000, 22); }
+void test_carrier_38k(void) { checkCarrier(38000, 21); }
+void test_carrier_40k(void) { checkCarrier(40000, 20); }
+void test_carrier_56k(void) { checkCarrier(56000, 14); }
+
+// 更大的抖动(±5%周期)下中位数和±10%窗口仍给出正确的kHz
+void test_carrier_heavy_jitter(void) {
+    const uint32_t freqs[] = {36000, 38000, 40000, 56000};
+    for (uint32_t freq : freqs) {
+        CarrierEstimator est(TICK_HZ);
+        seedJitter(freq + 1);
+        feedFrame(est, 500, freq, 50, (int32_t)(TICK_HZ / freq / 20), 32, true);
+        CarrierEstimate result = est.estimate();
+        TEST_ASSERT_TRUE(result.valid);
+        TEST_ASSERT_UINT_WITHIN(1, freq / 1000, result.frequency);
+        TEST_ASSERT_UINT_WITHIN(5, 50, result.dutyCycle);
+    }
+}
+
+// 不调用endBurst时，mark之间的space与下一个上升沿组成的周期超出载波范围，不参与统计
+void test_carrier_gaps_without_end_burst(void) {
+    CarrierEstimator est(TICK_HZ);
+    seedJitter(7);
+    feedFrame(est, 0, 38000, 33, 21, 16, false);
+    CarrierEstimate result = est.estimate();
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL_UINT16(38, result.frequency);
+}
+
+// 偶发的畸变周期(毛刺拆开的半个周期)不影响结果
+void test_carrier_outliers_rejected(void) {
+    CarrierEstimator est(TICK_HZ);
+    uint32_t period = TICK_HZ / 40000;
+    for (int i = 0; i < 100; i++) {
+        if (i % 10 == 0) {
+            est.addCycle(period / 6, period / 2);
+        } else {
+            est.addCycle(period / 3, period - period / 3);
+        }
+    }
+    CarrierEstimate result = est.estimate();
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL_UINT16(40, result.frequency);
+    TEST_ASSERT_EQUAL_UINT16(90, result.cycles);
+}
+
+// 周期数不足时不给出结论
+void test_carrier_too_few_cycles(void) {
+    CarrierEstimator est(TICK_HZ);
+    uint32_t period = TICK_HZ / 38000;
+    for (int i = 0; i < CarrierEstimator::MIN_CYCLES - 1; i++) {
+        est.addCycle(period / 3, period - period / 3);
+    }
+    TEST_ASSERT_FALSE(est.estimate().valid);
+    est.addCycle(period / 3, period - period / 3);
+    TEST_ASSERT_TRUE(est.estimate().valid);
+    est.reset();
+    TEST_ASSERT_EQUAL_UINT16(0, est.getCycleCount());
+    TEST_ASSERT_FALSE(est.estimate().valid);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_carrier_36k);
+    RUN_TEST(test_carrier_38k);
+    RUN_TEST(test_carrier_40k);
+    RUN_TEST(test_carrier_56k);
+    RUN_TEST(test_carrier_heavy_jitter);
+    RUN_TEST(test_carrier_gaps_without_end_burst);
+    RUN_TEST(test_carrier_outliers_rejected);
+    RUN_TEST(test_carrier_too_few_cycles);
+    return UNITY_END();
+}
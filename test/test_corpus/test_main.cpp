@@ -0,0 +1,223 @@
+#include <unity.h>
+#include <string.h>
+#include "ir_corpus.h"
+#include "ir_protocol_encoder.h"
+
+// 语料格式与回放：帧由描述符编码器生成(加抖动)，写成语料文本后逐行解析回放
+static uint32_t rng_state;
+
+static int32_t jitter(int32_t range) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    if (range == 0) return 0;
+    return (int32_t)((rng_state >> 16) % (uint32_t)(2 * range + 1)) - range;
+}
+
+// 按描述符生成一帧，每个脉冲加±jitterPct%抖动；label为false时不标注期望结果
+static void makeFrame(CorpusFrame& frame, uint32_t timestampMs, const char* model, decode_type_t protocol,
+                      const ProtocolDescriptor& desc, bool repeatFrame, uint64_t value, uint16_t bits,
+                      int32_t jitterPct, bool label) {
+    memset(&frame, 0, sizeof(frame));
+    frame.timestampMs = timestampMs;
+    strncpy(frame.model, model, sizeof(frame.model) - 1);
+    frame.carrierFreq = desc.freq;
+    frame.dutyCycle = desc.duty;
+    TEST_ASSERT_GREATER_THAN(0, encodeFramePulses(desc, repeatFrame, value, bits, frame.pulses,
+                                                  CorpusFrame::MAX_PULSES, frame.length));
+    for (uint16_t i = 0; i < frame.length; i++) {
+        frame.pulses[i] = (uint16_t)(frame.pulses[i] + frame.pulses[i] * jitter(jitterPct) / 100);
+    }
+    frame.protocol = label ? protocol : UNKNOWN;
+    frame.value = label ? value : 0;
+    frame.bits = label ? bits : 0;
+}
+
+// 回放时钟：只在等待时前进
+static uint32_t fake_now_us;
+static uint32_t wait_calls;
+static uint32_t waits_us[8];
+
+static uint32_t fakeClock() {
+    return fake_now_us;
+}
+
+static void fakeWait(uint32_t us) {
+    if (wait_calls < 8) waits_us[wait_calls] = us;
+    wait_calls++;
+    fake_now_us += us;
+}
+
+void setUp(void) {
+    rng_state = 20240601u;
+    fake_now_us = 0;
+    wait_calls = 0;
+    memset(waits_us, 0, sizeof(waits_us));
+}
+
+void tearDown(void) {}
+
+// 格式化后解析回来各字段不变；型号中的分隔符替换为下划线
+void test_format_parse_roundtrip(void) {
+    CorpusFrame frame;
+    makeFrame(frame, 123456, "Living Room,TV:1", NEC, kNecDescriptor, false, 0x20DF10EFULL, 32, 5, true);
+
+    char line[CORPUS_MAX_LINE];
+    size_t length = formatCorpusFrame(frame, line, sizeof(line));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_EQUAL_UINT32(strlen(line), length);
+
+    CorpusFrame parsed;
+    TEST_ASSERT_TRUE(parseCorpusFrame(line, parsed));
+    TEST_ASSERT_EQUAL_UINT32(123456, parsed.timestampMs);
+    TEST_ASSERT_EQUAL_STRING("Living_Room_TV_1", parsed.model);
+    TEST_ASSERT_EQUAL_UINT16(kNecDescriptor.freq, parsed.carrierFreq);
+    TEST_ASSERT_EQUAL_UINT8(kNecDescriptor.duty, parsed.dutyCycle);
+    TEST_ASSERT_EQUAL_INT(NEC, parsed.protocol);
+    TEST_ASSERT_EQUAL_HEX64(0x20DF10EFULL, parsed.value);
+    TEST_ASSERT_EQUAL_UINT16(32, parsed.bits);
+    TEST_ASSERT_EQUAL_UINT16(frame.length, parsed.length);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(frame.pulses, parsed.pulses, frame.length);
+
+    // 缓冲区放不下整行时不输出半行
+    TEST_ASSERT_EQUAL_UINT32(0, formatCorpusFrame(frame, line, 40));
+}
+
+void test_parse_rejects_malformed_lines(void) {
+    CorpusFrame frame;
+    TEST_ASSERT_FALSE(parseCorpusFrame(CORPUS_HEADER, frame));
+    TEST_ASSERT_FALSE(parseCorpusFrame("   ", frame));
+    TEST_ASSERT_FALSE(parseCorpusFrame("100,tv,38,33,NEC,0x1", frame));
+    // 声明的脉冲数与实际不符
+    TEST_ASSERT_FALSE(parseCorpusFrame("100,tv,38,33,NEC,0x1,32,4:9000 4500 560", frame));
+    TEST_ASSERT_FALSE(parseCorpusFrame("100,tv,38,33,NEC,0x1,32,300:9000", frame));
+
+    TEST_ASSERT_TRUE(parseCorpusFrame("100,tv,0,0,UNKNOWN,0x0,0,3:9000 4500 560", frame));
+    TEST_ASSERT_EQUAL_INT(UNKNOWN, frame.protocol);
+    TEST_ASSERT_EQUAL_UINT16(3, frame.length);
+    TEST_ASSERT_EQUAL_UINT16(560, frame.pulses[2]);
+}
+
+// 写成语料文本、逐行解析后回放：统计与各帧的标注一致，每个会话由流式学习器选出期望值
+void test_replay_corpus_text(void) {
+    static CorpusFrame frames[14];
+    int n = 0;
+    for (int i = 0; i < 4; i++) {
+        makeFrame(frames[n++], 1000 + i * 110, "tv", NEC, kNecDescriptor, false, 0x00FF02FDULL, 32, 8, true);
+    }
+    // 未标注的NEC重复码：解码成功但不计入标注统计
+    makeFrame(frames[n++], 1450, "tv", NEC, kNecDescriptor, true, 0x00FF02FDULL, 32, 0, false);
+    for (int i = 0; i < 3; i++) {
+        makeFrame(frames[n++], 3000 + i * 45, "amp", SONY, kSonyDescriptor, false, 0x910, 12, 8, true);
+    }
+    // 引导码被干扰的帧：有标注但无法解码
+    makeFrame(frames[n], 3135, "amp", SONY, kSonyDescriptor, false, 0x910, 12, 0, true);
+    frames[n++].pulses[0] = 1000;
+    for (int i = 0; i < 3; i++) {
+        makeFrame(frames[n++], 5000 + i * 114, "dvd", RC5, kRc5Descriptor, false, 0x175, 12, 8, true);
+    }
+    // 标注与实际波形不同：解码成功但结果不符，该会话学到的也不是期望值
+    makeFrame(frames[n], 7000, "tv", NEC, kNecDescriptor, false, 0x00FF22DDULL, 32, 0, true);
+    frames[n++].value = 0x00FFA857ULL;
+    // 未标注的噪声
+    memset(&frames[n], 0, sizeof(CorpusFrame));
+    frames[n].timestampMs = 7500;
+    strcpy(frames[n].model, "noise");
+    frames[n].protocol = UNKNOWN;
+    frames[n].length = 40;
+    for (int i = 0; i < 40; i++) frames[n].pulses[i] = 300;
+    n++;
+    TEST_ASSERT_EQUAL_INT(14, n);
+
+    static char text[14 * CORPUS_MAX_LINE];
+    size_t used = (size_t)snprintf(text, sizeof(text), "%s\n", CORPUS_HEADER);
+    for (int i = 0; i < n; i++) {
+        size_t length = formatCorpusFrame(frames[i], text + used, sizeof(text) - used - 1);
+        TEST_ASSERT_GREATER_THAN(0, length);
+        used += length;
+        text[used++] = '\n';
+    }
+    text[used] = '\0';
+
+    CorpusReplay replay(replayDecodePulses, nullptr, fakeClock, fakeWait);
+    replay.begin(0);
+    int fed = 0;
+    for (char* line = strtok(text, "\n"); line; line = strtok(nullptr, "\n")) {
+        CorpusFrame frame;
+        if (!parseCorpusFrame(line, frame)) continue;
+        replay.feed(frame);
+        fed++;
+    }
+    replay.end();
+
+    TEST_ASSERT_EQUAL_INT(n, fed);
+    const ReplayStats& stats = replay.getStats();
+    TEST_ASSERT_EQUAL_UINT32(14, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(12, stats.labeled);
+    TEST_ASSERT_EQUAL_UINT32(12, stats.decoded);
+    TEST_ASSERT_EQUAL_UINT32(10, stats.correct);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.mismatched);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.missed);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.sessions);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.sessionsCorrect);
+    // 速度为0时不等待
+    TEST_ASSERT_EQUAL_UINT32(0, wait_calls);
+}
+
+// 按时间戳间隔除以加速倍数等待
+void test_replay_paces_by_timestamp(void) {
+    CorpusFrame frame;
+    makeFrame(frame, 0, "tv", NEC, kNecDescriptor, false, 0x00FF02FDULL, 32, 0, true);
+
+    CorpusReplay replay(replayDecodePulses, nullptr, fakeClock, fakeWait);
+    replay.begin(200);
+    const uint32_t timestamps[] = {1000, 1100, 1500};
+    for (uint32_t ts : timestamps) {
+        frame.timestampMs = ts;
+        replay.feed(frame);
+    }
+    replay.end();
+
+    TEST_ASSERT_EQUAL_UINT32(2, wait_calls);
+    TEST_ASSERT_EQUAL_UINT32(50000, waits_us[0]);
+    TEST_ASSERT_EQUAL_UINT32(200000, waits_us[1]);
+    TEST_ASSERT_EQUAL_UINT32(250000, replay.getStats().elapsedUs);
+    TEST_ASSERT_EQUAL_UINT32(12, replay.framesPerSecond());
+    TEST_ASSERT_EQUAL_UINT32(3, replay.getStats().correct);
+    TEST_ASSERT_EQUAL_UINT32(1, replay.getStats().sessionsCorrect);
+}
+
+// 捕获环保留最近CAPACITY帧，按时间顺序访问；只为指定时间之后未测量载波的帧补充载波
+void test_capture_ring(void) {
+    static CaptureRing ring;
+    ring.clear();
+    for (int i = 0; i < CaptureRing::CAPACITY + 2; i++) {
+        CorpusFrame* frame = ring.next();
+        memset(frame, 0, sizeof(CorpusFrame));
+        frame->timestampMs = i * 100;
+    }
+    TEST_ASSERT_EQUAL_INT(CaptureRing::CAPACITY, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(CaptureRing::CAPACITY + 2, ring.totalCaptured());
+    TEST_ASSERT_EQUAL_UINT32(200, ring.at(0)->timestampMs);
+    TEST_ASSERT_EQUAL_UINT32((CaptureRing::CAPACITY + 1) * 100, ring.at(CaptureRing::CAPACITY - 1)->timestampMs);
+    TEST_ASSERT_NULL(ring.at(CaptureRing::CAPACITY));
+
+    const_cast<CorpusFrame*>(ring.at(5))->carrierFreq = 40;
+    ring.annotateCarrier(500, 38, 33);
+    TEST_ASSERT_EQUAL_UINT16(0, ring.at(2)->carrierFreq);     // 400ms
+    TEST_ASSERT_EQUAL_UINT16(38, ring.at(3)->carrierFreq);    // 500ms
+    TEST_ASSERT_EQUAL_UINT8(33, ring.at(3)->dutyCycle);
+    TEST_ASSERT_EQUAL_UINT16(40, ring.at(5)->carrierFreq);
+
+    ring.clear();
+    TEST_ASSERT_EQUAL_INT(0, ring.size());
+    TEST_ASSERT_NULL(ring.at(0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_format_parse_roundtrip);
+    RUN_TEST(test_parse_rejects_malformed_lines);
+    RUN_TEST(test_replay_corpus_text);
+    RUN_TEST(test_replay_paces_by_timestamp);
+    RUN_TEST(test_capture_ring);
+    return UNITY_END();
+}
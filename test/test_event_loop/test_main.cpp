@@ -0,0 +1,281 @@
+#include <unity.h>
+#include "ir_event_loop.h"
+
+// 事件循环在虚拟时钟上运行：runOnce的等待直接把时间推进到下一个截止时间
+static EventLoop* loop = nullptr;
+static int fired[EventLoop::MAX_TIMERS];
+static uint32_t firedAt[8];
+static int firedCount;
+static int handled[EVENT_TYPE_COUNT];
+
+static void countTimer(void* ctx) {
+    int index = (int)(intptr_t)ctx;
+    fired[index]++;
+    if (firedCount < 8) firedAt[firedCount] = VirtualClock::now();
+    firedCount++;
+}
+
+static void countEvent(void* ctx) {
+    handled[(int)(intptr_t)ctx]++;
+}
+
+void setUp(void) {
+    VirtualClock::set(1000000);
+    delete loop;
+    loop = new EventLoop(VirtualClock::now, VirtualClock::wait, VirtualClock::wake);
+    for (int i = 0; i < EventLoop::MAX_TIMERS; i++) fired[i] = 0;
+    for (int i = 0; i < EVENT_TYPE_COUNT; i++) handled[i] = 0;
+    firedCount = 0;
+}
+
+void tearDown(void) {}
+
+// 每轮先处理到期的定时器，再等待到下一个截止时间；单次定时器只触发一次
+void test_one_shot_timer(void) {
+    int id = loop->startTimer(30, countTimer, (void*)0);
+    TEST_ASSERT_TRUE(loop->isTimerActive(id));
+
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(0, fired[0]);
+    TEST_ASSERT_EQUAL_UINT32(1030000, VirtualClock::now());
+
+    // 触发后没有定时器，最多等待maxWaitMs
+    loop->runOnce(50);
+    TEST_ASSERT_EQUAL_INT(1, fired[0]);
+    TEST_ASSERT_FALSE(loop->isTimerActive(id));
+    TEST_ASSERT_EQUAL_UINT32(1080000, VirtualClock::now());
+
+    loop->runOnce(50);
+    TEST_ASSERT_EQUAL_INT(1, fired[0]);
+}
+
+// 周期定时器按截止时间累加，不随处理延迟漂移；落后超过一个周期时不补发
+void test_periodic_timer(void) {
+    loop->startTimer(10, countTimer, (void*)1, 10);
+    for (int i = 0; i < 4; i++) loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(3, fired[1]);
+    TEST_ASSERT_EQUAL_UINT32(1010000, firedAt[0]);
+    TEST_ASSERT_EQUAL_UINT32(1020000, firedAt[1]);
+    TEST_ASSERT_EQUAL_UINT32(1030000, firedAt[2]);
+    TEST_ASSERT_EQUAL_UINT32(1040000, VirtualClock::now());
+
+    // 处理晚了3ms：下一次仍在原来的周期点
+    VirtualClock::advance(3000);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(4, fired[1]);
+    TEST_ASSERT_EQUAL_UINT32(1043000, firedAt[3]);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(5, fired[1]);
+    TEST_ASSERT_EQUAL_UINT32(1050000, firedAt[4]);
+
+    // 阻塞了35ms：只触发一次，之后从当前时间重新计时
+    VirtualClock::advance(35000);
+    uint32_t resumed = VirtualClock::now();
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(6, fired[1]);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(7, fired[1]);
+    TEST_ASSERT_EQUAL_UINT32(resumed + 10000, firedAt[6]);
+}
+
+static int chainTimer = -1;
+static int cancelTarget = -1;
+
+static void restartSelf(void* ctx) {
+    fired[2]++;
+    if (fired[2] < 3) chainTimer = loop->startTimer(5, restartSelf);
+}
+
+static void cancelOther(void* ctx) {
+    fired[3]++;
+    loop->cancelTimer(cancelTarget);
+}
+
+// 回调中可以启动新的定时器，也可以取消同一轮中尚未触发的定时器
+void test_timers_started_and_cancelled_in_callbacks(void) {
+    chainTimer = loop->startTimer(5, restartSelf);
+    for (int i = 0; i < 10; i++) loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(3, fired[2]);
+    TEST_ASSERT_FALSE(loop->isTimerActive(chainTimer));
+
+    loop->startTimer(20, cancelOther);
+    cancelTarget = loop->startTimer(20, countTimer, (void*)4);
+    VirtualClock::advance(20000);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(1, fired[3]);
+    TEST_ASSERT_EQUAL_INT(0, fired[4]);
+    TEST_ASSERT_FALSE(loop->isTimerActive(cancelTarget));
+
+    // 无效ID的取消和查询是安全的
+    loop->cancelTimer(-1);
+    loop->cancelTimer(EventLoop::MAX_TIMERS);
+    TEST_ASSERT_FALSE(loop->isTimerActive(-1));
+}
+
+// 定时器表满时返回-1，释放后可以重新使用
+void test_timer_table_full(void) {
+    int ids[EventLoop::MAX_TIMERS];
+    for (int i = 0; i < EventLoop::MAX_TIMERS; i++) {
+        ids[i] = loop->startTimer(100, countTimer, (void*)5);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, ids[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, loop->startTimer(100, countTimer, (void*)5));
+    loop->cancelTimer(ids[3]);
+    TEST_ASSERT_EQUAL_INT(ids[3], loop->startTimer(100, countTimer, (void*)5));
+}
+
+// 微秒时钟在约71分钟后回绕，截止时间按有符号差值比较
+void test_clock_wraparound(void) {
+    VirtualClock::set(0xFFFFFFFFu - 4000);
+    loop->startTimer(10, countTimer, (void*)6);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(0, fired[6]);
+    TEST_ASSERT_EQUAL_UINT32(10000 - 4000 - 1, VirtualClock::now());
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(1, fired[6]);
+}
+
+// 同一事件处理前重复投递只处理一次，延迟从第一次投递算起
+void test_pending_bits_coalesce(void) {
+    loop->onEvent(EVENT_IR_RX, countEvent, (void*)EVENT_IR_RX);
+    loop->onEvent(EVENT_UART, countEvent, (void*)EVENT_UART);
+
+    loop->post(EVENT_IR_RX);
+    VirtualClock::advance(300);
+    loop->post(EVENT_IR_RX);
+    loop->post(EVENT_UART);
+    VirtualClock::advance(200);
+    loop->runOnce();
+
+    TEST_ASSERT_EQUAL_INT(1, handled[EVENT_IR_RX]);
+    TEST_ASSERT_EQUAL_INT(1, handled[EVENT_UART]);
+    TEST_ASSERT_EQUAL_INT(0, handled[EVENT_TX_DONE]);
+
+    const EventLatencyStats& rx = loop->getLatency(EVENT_IR_RX);
+    TEST_ASSERT_EQUAL_UINT32(1, rx.count);
+    TEST_ASSERT_EQUAL_UINT32(500, rx.lastUs);
+    TEST_ASSERT_EQUAL_UINT32(200, loop->getLatency(EVENT_UART).lastUs);
+
+    // 没有处理函数的事件也记录延迟，不会触发回调
+    loop->post(EVENT_TX_DONE);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_UINT32(1, loop->getLatency(EVENT_TX_DONE).count);
+
+    loop->resetLatency();
+    TEST_ASSERT_EQUAL_UINT32(0, loop->getLatency(EVENT_IR_RX).count);
+}
+
+static void repost(void* ctx) {
+    handled[EVENT_IR_RX]++;
+    if (handled[EVENT_IR_RX] == 1) loop->post(EVENT_IR_RX);
+}
+
+// 处理函数中投递的事件在下一轮处理，本轮不等待；post-latency的最大值和累计值
+void test_post_during_dispatch(void) {
+    loop->onEvent(EVENT_IR_RX, repost);
+    loop->startTimer(100, countTimer, (void*)7);
+
+    loop->post(EVENT_IR_RX);
+    VirtualClock::advance(40);
+    uint32_t before = VirtualClock::now();
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(1, handled[EVENT_IR_RX]);
+    TEST_ASSERT_EQUAL_UINT32(before, VirtualClock::now());
+
+    // 之后空闲，等待到定时器截止时间
+    VirtualClock::advance(100);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(2, handled[EVENT_IR_RX]);
+    TEST_ASSERT_EQUAL_UINT32(1100000, VirtualClock::now());
+    TEST_ASSERT_EQUAL_INT(0, fired[7]);
+
+    const EventLatencyStats& rx = loop->getLatency(EVENT_IR_RX);
+    TEST_ASSERT_EQUAL_UINT32(2, rx.count);
+    TEST_ASSERT_EQUAL_UINT32(100, rx.lastUs);
+    TEST_ASSERT_EQUAL_UINT32(100, rx.maxUs);
+    TEST_ASSERT_EQUAL_UINT64(140, rx.totalUs);
+}
+
+static void postLaterEvent(void* ctx) {
+    handled[EVENT_UART]++;
+    VirtualClock::advance(100);
+    loop->post(EVENT_IR_RX);
+}
+
+// 同一轮中清除挂起位之后的投递覆盖了投递时间(晚于处理时间)：延迟按0计，不下溢
+void test_post_after_clear_clamps_latency(void) {
+    loop->onEvent(EVENT_UART, postLaterEvent);
+    loop->onEvent(EVENT_IR_RX, countEvent, (void*)EVENT_IR_RX);
+
+    loop->post(EVENT_UART);
+    loop->post(EVENT_IR_RX);
+    VirtualClock::advance(50);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(1, handled[EVENT_UART]);
+    TEST_ASSERT_EQUAL_INT(1, handled[EVENT_IR_RX]);
+
+    const EventLatencyStats& rx = loop->getLatency(EVENT_IR_RX);
+    TEST_ASSERT_EQUAL_UINT32(1, rx.count);
+    TEST_ASSERT_EQUAL_UINT32(0, rx.lastUs);
+    TEST_ASSERT_EQUAL_UINT32(0, rx.maxUs);
+    TEST_ASSERT_EQUAL_UINT64(0, rx.totalUs);
+    TEST_ASSERT_EQUAL_UINT32(50, loop->getLatency(EVENT_UART).lastUs);
+
+    // 处理函数中的投递在下一轮按新的投递时间计
+    VirtualClock::advance(30);
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_INT(2, handled[EVENT_IR_RX]);
+    TEST_ASSERT_EQUAL_UINT32(30, rx.lastUs);
+}
+
+static bool ledLevel;
+static int ledWrites;
+
+static void writeLed(bool level) {
+    ledLevel = level;
+    ledWrites++;
+}
+
+// LED模式按时长表翻转电平，结束后保持endLevel；set取消正在播放的模式
+void test_led_pattern(void) {
+    LedPattern led(loop, writeLed);
+    ledWrites = 0;
+    static const uint16_t blink[] = {100, 50, 100};
+    led.play(true, blink, 3, false);
+    TEST_ASSERT_TRUE(ledLevel);
+    TEST_ASSERT_TRUE(led.isPlaying());
+
+    loop->runOnce();
+    TEST_ASSERT_EQUAL_UINT32(1100000, VirtualClock::now());
+    TEST_ASSERT_TRUE(ledLevel);
+    loop->runOnce();
+    TEST_ASSERT_FALSE(ledLevel);
+    TEST_ASSERT_EQUAL_UINT32(1150000, VirtualClock::now());
+    loop->runOnce();
+    TEST_ASSERT_TRUE(ledLevel);
+    loop->runOnce(0);
+    TEST_ASSERT_FALSE(ledLevel);
+    TEST_ASSERT_FALSE(led.isPlaying());
+    TEST_ASSERT_EQUAL_UINT32(1250000, VirtualClock::now());
+    TEST_ASSERT_EQUAL_INT(4, ledWrites);
+
+    led.play(true, blink, 3, false);
+    led.set(true);
+    TEST_ASSERT_FALSE(led.isPlaying());
+    loop->runOnce(500);
+    TEST_ASSERT_TRUE(ledLevel);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_shot_timer);
+    RUN_TEST(test_periodic_timer);
+    RUN_TEST(test_timers_started_and_cancelled_in_callbacks);
+    RUN_TEST(test_timer_table_full);
+    RUN_TEST(test_clock_wraparound);
+    RUN_TEST(test_pending_bits_coalesce);
+    RUN_TEST(test_post_during_dispatch);
+    RUN_TEST(test_post_after_clear_clamps_latency);
+    RUN_TEST(test_led_pattern);
+    return UNITY_END();
+}
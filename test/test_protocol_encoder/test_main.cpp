@@ -0,0 +1,256 @@
+#include <unity.h>
+#include "ir_protocol_encoder.h"
+
+// 编码器输出与IRremoteESP8266的IRsend时序逐段比较
+// 参考实现按IRsend::sendGeneric/sendNEC/sendSony/sendRC5的调用顺序写出mark/space，
+// 常量取自ir_NEC.h、ir_Sony.cpp、ir_RC5_RC6.cpp(主机端不编译IRremoteESP8266)
+static const uint16_t kNecTick = 560;
+static const uint16_t kNecHdrMark = 16 * kNecTick;
+static const uint16_t kNecHdrSpace = 8 * kNecTick;
+static const uint16_t kNecBitMark = kNecTick;
+static const uint16_t kNecOneSpace = 3 * kNecTick;
+static const uint16_t kNecZeroSpace = kNecTick;
+static const uint16_t kNecRptSpace = 4 * kNecTick;
+static const uint32_t kNecMinCommandLength = 193 * kNecTick;
+static const uint32_t kNecMinGap =
+    kNecMinCommandLength - (kNecHdrMark + kNecHdrSpace + 32 * (kNecBitMark + kNecOneSpace) + kNecBitMark);
+
+static const uint16_t kSonyTick = 200;
+static const uint16_t kSonyHdrMark = 12 * kSonyTick;
+static const uint16_t kSonySpace = 3 * kSonyTick;
+static const uint16_t kSonyOneMark = 6 * kSonyTick;
+static const uint16_t kSonyZeroMark = 3 * kSonyTick;
+static const uint32_t kSonyRptLength = 225 * kSonyTick;
+static const uint32_t kSonyMinGap = 50 * kSonyTick;
+
+static const uint16_t kRc5T1 = 889;
+static const uint32_t kRc5MinCommandLength = 113778;
+static const uint16_t kRc5RawBits = 14;
+static const uint32_t kRc5MinGap = kRc5MinCommandLength - kRc5RawBits * (2 * kRc5T1);
+static const uint16_t kRc5XBits = 13;
+
+// 合并同电平后的波形段，mark为正、space为负，去掉序列开头的space
+static const int MAX_RUNS = 1024;
+
+struct Waveform {
+    int32_t runs[MAX_RUNS];
+    int count;
+    uint32_t elapsed;          // sendGeneric的usecs计时，每帧重新开始
+
+    void reset() {
+        count = 0;
+        elapsed = 0;
+    }
+
+    void add(int32_t run) {
+        if (count > 0 && (runs[count - 1] > 0) == (run > 0)) {
+            runs[count - 1] += run;
+        } else if (count > 0 || run > 0) {
+            runs[count++] = run;
+        }
+    }
+
+    void mark(uint32_t us) {
+        if (us == 0) return;
+        add((int32_t)us);
+        elapsed += us;
+    }
+
+    void space(uint32_t us) {
+        if (us == 0) return;
+        add(-(int32_t)us);
+        elapsed += us;
+    }
+};
+
+// IRsend::sendGeneric：每帧引导码、数据位、结束mark，帧尾间隔满足最小间隔并补足最小帧长
+static void refSendGeneric(Waveform& w, uint16_t hdrMark, uint32_t hdrSpace, uint16_t oneMark,
+                           uint32_t oneSpace, uint16_t zeroMark, uint32_t zeroSpace, uint16_t footerMark,
+                           uint32_t gap, uint32_t mesgTime, uint64_t data, uint16_t nbits, uint16_t repeat) {
+    for (uint16_t r = 0; r <= repeat; r++) {
+        w.elapsed = 0;
+        if (hdrMark) w.mark(hdrMark);
+        if (hdrSpace) w.space(hdrSpace);
+        for (uint64_t mask = nbits ? 1ULL << (nbits - 1) : 0; mask; mask >>= 1) {
+            if (data & mask) {
+                w.mark(oneMark);
+                w.space(oneSpace);
+            } else {
+                w.mark(zeroMark);
+                w.space(zeroSpace);
+            }
+        }
+        if (footerMark) w.mark(footerMark);
+        if (w.elapsed >= mesgTime) {
+            w.space(gap);
+        } else {
+            w.space(mesgTime - w.elapsed > gap ? mesgTime - w.elapsed : gap);
+        }
+    }
+}
+
+static void refSendNEC(Waveform& w, uint64_t data, uint16_t nbits, uint16_t repeat) {
+    refSendGeneric(w, kNecHdrMark, kNecHdrSpace, kNecBitMark, kNecOneSpace, kNecBitMark, kNecZeroSpace,
+                   kNecBitMark, kNecMinGap, kNecMinCommandLength, data, nbits, 0);
+    if (repeat) {
+        refSendGeneric(w, kNecHdrMark, kNecRptSpace, 0, 0, 0, 0, kNecBitMark, kNecMinGap,
+                       kNecMinCommandLength, 0, 0, repeat - 1);
+    }
+}
+
+static void refSendSony(Waveform& w, uint64_t data, uint16_t nbits, uint16_t repeat) {
+    refSendGeneric(w, kSonyHdrMark, kSonySpace, kSonyOneMark, kSonySpace, kSonyZeroMark, kSonySpace, 0,
+                   kSonyMinGap, kSonyRptLength, data, nbits, repeat);
+}
+
+// IRsend::sendRC5：第一帧省略开头的space且不计入帧长，13位及以上时最高位为RC5X场位(取反)
+static void refSendRC5(Waveform& w, uint64_t data, uint16_t nbits, uint16_t repeat) {
+    bool skipSpace = true;
+    bool fieldBit = true;
+    if (nbits >= kRc5XBits) {
+        fieldBit = ((data >> (nbits - 1)) & 1) == 0;
+        nbits--;
+    }
+    for (uint16_t r = 0; r <= repeat; r++) {
+        w.elapsed = 0;
+        if (skipSpace) {
+            skipSpace = false;
+        } else {
+            w.space(kRc5T1);
+        }
+        w.mark(kRc5T1);
+        if (fieldBit) {
+            w.space(kRc5T1);
+            w.mark(kRc5T1);
+        } else {
+            w.mark(kRc5T1);
+            w.space(kRc5T1);
+        }
+        for (uint64_t mask = 1ULL << (nbits - 1); mask; mask >>= 1) {
+            if (data & mask) {
+                w.space(kRc5T1);
+                w.mark(kRc5T1);
+            } else {
+                w.mark(kRc5T1);
+                w.space(kRc5T1);
+            }
+        }
+        w.space(kRc5MinCommandLength - w.elapsed > kRc5MinGap ? kRc5MinCommandLength - w.elapsed : kRc5MinGap);
+    }
+}
+
+// RMT数据项转为波形段，包括结束标记前的帧尾间隔
+static void itemsToWaveform(const rmt_item32_t* items, size_t count, Waveform& w) {
+    w.reset();
+    for (size_t i = 0; i < count * 2; i++) {
+        const rmt_item32_t& item = items[i / 2];
+        uint32_t dur = i % 2 == 0 ? item.duration0 : item.duration1;
+        bool level = (i % 2 == 0 ? item.level0 : item.level1) != 0;
+        if (dur == 0) break;
+        if (level) {
+            w.mark(dur);
+        } else {
+            w.space(dur);
+        }
+    }
+}
+
+static rmt_item32_t items[1024];
+static Waveform expected;
+static Waveform actual;
+
+static void checkSame(const ProtocolDescriptor& desc, uint64_t data, uint16_t bits, uint16_t repeat) {
+    size_t count = encodeProtocol(desc, data, bits, repeat, items, 1024);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    itemsToWaveform(items, count, actual);
+
+    TEST_ASSERT_EQUAL_INT(expected.count, actual.count);
+    for (int i = 0; i < expected.count; i++) {
+        TEST_ASSERT_EQUAL_INT32(expected.runs[i], actual.runs[i]);
+    }
+}
+
+void setUp(void) {
+    expected.reset();
+    actual.reset();
+}
+
+void tearDown(void) {}
+
+void test_nec_frame(void) {
+    refSendNEC(expected, 0x20DF10EF, 32, 0);
+    checkSame(kNecDescriptor, 0x20DF10EF, 32, 0);
+}
+
+void test_nec_repeat_codes(void) {
+    refSendNEC(expected, 0x00FF00FF, 32, 3);
+    checkSame(kNecDescriptor, 0x00FF00FF, 32, 3);
+}
+
+void test_sony_12_15_20_bits(void) {
+    refSendSony(expected, 0xA90, 12, 2);
+    checkSame(kSonyDescriptor, 0xA90, 12, 2);
+
+    expected.reset();
+    refSendSony(expected, 0x5A5A, 15, 0);
+    checkSame(kSonyDescriptor, 0x5A5A, 15, 0);
+
+    expected.reset();
+    refSendSony(expected, 0xB8F0F, 20, 1);
+    checkSame(kSonyDescriptor, 0xB8F0F, 20, 1);
+}
+
+void test_rc5_frame(void) {
+    refSendRC5(expected, 0x0C, 12, 0);
+    checkSame(kRc5Descriptor, 0x0C, 12, 0);
+
+    // 切换位置1，数据以0开头和以1开头时合并的段不同
+    expected.reset();
+    refSendRC5(expected, 0x835, 12, 1);
+    checkSame(kRc5Descriptor, 0x835, 12, 1);
+}
+
+void test_rc5x_field_bit(void) {
+    refSendRC5(expected, 0x1C0C, 13, 0);
+    checkSame(kRc5Descriptor, 0x1C0C, 13, 0);
+
+    expected.reset();
+    refSendRC5(expected, 0x0C0C, 13, 2);
+    checkSame(kRc5Descriptor, 0x0C0C, 13, 2);
+}
+
+// 载波参数与IRsend的enableIROut一致
+void test_descriptor_carrier(void) {
+    TEST_ASSERT_EQUAL_UINT16(38, kNecDescriptor.freq);
+    TEST_ASSERT_EQUAL_UINT8(33, kNecDescriptor.duty);
+    TEST_ASSERT_EQUAL_UINT16(40, kSonyDescriptor.freq);
+    TEST_ASSERT_EQUAL_UINT8(33, kSonyDescriptor.duty);
+    TEST_ASSERT_EQUAL_UINT16(36, kRc5Descriptor.freq);
+    TEST_ASSERT_EQUAL_UINT8(50, kRc5Descriptor.duty);
+}
+
+// 超过RMT单项上限(32767 ticks)的帧尾间隔被拆成多个半项，合并后总长不变；缓冲不足时返回0
+void test_long_gap_split_and_overflow(void) {
+    size_t count = encodeProtocol(kRc5Descriptor, 0x0C, 12, 0, items, 1024);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    int split = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].level0 == 0 && items[i].duration0 == RmtItemWriter::MAX_DURATION) split++;
+        if (items[i].level1 == 0 && items[i].duration1 == RmtItemWriter::MAX_DURATION) split++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, split);
+    TEST_ASSERT_TRUE(count <= Rc5Encoder::maxItems(12, 0));
+    TEST_ASSERT_EQUAL_UINT(0, encodeProtocol(kNecDescriptor, 0x20DF10EF, 32, 0, items, 8));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nec_frame);
+    RUN_TEST(test_nec_repeat_codes);
+    RUN_TEST(test_sony_12_15_20_bits);
+    RUN_TEST(test_rc5_frame);
+    RUN_TEST(test_rc5x_field_bit);
+    RUN_TEST(test_descriptor_carrier);
+    RUN_TEST(test_long_gap_split_and_overflow);
+    return UNITY_END();
+}
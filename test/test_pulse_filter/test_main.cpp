@@ -0,0 +1,242 @@
+#include <unity.h>
+#include <string.h>
+#include "ir_pulse_filter.h"
+
+// 脉冲过滤：毛刺合并、聚类吸附和各种拒绝条件
+static uint32_t rng_state;
+
+static int32_t jitter(int32_t range) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    if (range == 0) return 0;
+    return (int32_t)((rng_state >> 16) % (uint32_t)(2 * range + 1)) - range;
+}
+
+// 类NEC帧：引导码 + 32位 + 结束脉冲，共67个脉冲，每个脉冲加±jitterPct%抖动
+static const uint16_t NEC_PULSES = 67;
+
+static void necFrame(uint32_t data, uint16_t* pulses, int32_t jitterPct) {
+    int n = 0;
+    pulses[n++] = 9000;
+    pulses[n++] = 4500;
+    for (int bit = 0; bit < 32; bit++) {
+        pulses[n++] = 560;
+        pulses[n++] = (data >> bit) & 1 ? 1690 : 560;
+    }
+    pulses[n++] = 560;
+    for (int i = 0; i < n; i++) pulses[i] = (uint16_t)(pulses[i] + pulses[i] * jitter(jitterPct) / 100);
+}
+
+// 把第index个mark拆成 前半 + 毛刺space + 后半，总时长不变，返回新长度
+static uint16_t splitMark(uint16_t* pulses, uint16_t length, uint16_t index, uint16_t glitchUs) {
+    uint16_t mark = pulses[index];
+    memmove(pulses + index + 3, pulses + index + 1, (length - index - 1) * sizeof(uint16_t));
+    pulses[index] = (mark - glitchUs) / 2;
+    pulses[index + 1] = glitchUs;
+    pulses[index + 2] = mark - glitchUs - pulses[index];
+    return length + 2;
+}
+
+static PulseFilterConfig noSnap() {
+    PulseFilterConfig config = kDefaultPulseFilterConfig;
+    config.snapPercent = 0;
+    return config;
+}
+
+void setUp(void) {
+    rng_state = 20240601u;
+}
+
+void tearDown(void) {}
+
+// 帧中间的毛刺与前后脉冲合并为一个脉冲，mark/space交替不变
+void test_glitch_merged_into_neighbours(void) {
+    uint16_t clean[NEC_PULSES + 16];
+    uint16_t input[NEC_PULSES + 16];
+    uint16_t output[NEC_PULSES + 16];
+    necFrame(0xA55A0FF0, clean, 0);
+    memcpy(input, clean, sizeof(uint16_t) * NEC_PULSES);
+
+    uint16_t length = NEC_PULSES;
+    length = splitMark(input, length, 10, 40);
+    length = splitMark(input, length, 40, 60);
+    TEST_ASSERT_EQUAL_UINT16(NEC_PULSES + 4, length);
+
+    PulseFilterResult result = filterPulses(input, length, output, noSnap());
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(length, result.inputLength);
+    TEST_ASSERT_EQUAL_UINT16(NEC_PULSES, result.outputLength);
+    TEST_ASSERT_EQUAL_UINT16(2, result.glitches);
+    TEST_ASSERT_EQUAL_UINT16(0, result.snapped);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(clean, output, NEC_PULSES);
+}
+
+// 开头的毛刺连同其后的空闲space丢弃；末尾的毛刺丢弃后帧仍以mark结束
+void test_glitch_at_edges_dropped(void) {
+    uint16_t clean[NEC_PULSES];
+    uint16_t input[NEC_PULSES + 4];
+    uint16_t output[NEC_PULSES + 4];
+    necFrame(0x12345678, clean, 0);
+
+    input[0] = 30;
+    input[1] = 20000;
+    memcpy(input + 2, clean, sizeof(clean));
+    input[NEC_PULSES + 2] = 1690;
+    input[NEC_PULSES + 3] = 50;
+
+    PulseFilterResult result = filterPulses(input, NEC_PULSES + 4, output, noSnap());
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(2, result.glitches);
+    TEST_ASSERT_EQUAL_UINT16(NEC_PULSES, result.outputLength);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(clean, output, NEC_PULSES);
+}
+
+// 抖动的帧吸附到聚类中心：数据区mark只剩一个值，space只剩两个值，且接近标称时长
+void test_snap_to_cluster_centers(void) {
+    uint16_t pulses[NEC_PULSES];
+    necFrame(0xC3A5F00F, pulses, 10);
+
+    // 原地过滤
+    PulseFilterResult result = filterPulses(pulses, NEC_PULSES, pulses, kDefaultPulseFilterConfig);
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(NEC_PULSES, result.outputLength);
+    TEST_ASSERT_EQUAL_UINT8(2, result.markClusters);     // 引导mark、数据mark
+    TEST_ASSERT_EQUAL_UINT8(3, result.spaceClusters);    // 引导space、0、1
+    TEST_ASSERT_EQUAL_UINT16(0, result.irregular);
+    TEST_ASSERT_GREATER_THAN(NEC_PULSES / 2, result.snapped);
+
+    uint16_t mark = pulses[2];
+    uint16_t zero = 0;
+    uint16_t one = 0;
+    TEST_ASSERT_UINT_WITHIN(30, 560, mark);
+    for (int i = 2; i < NEC_PULSES; i++) {
+        if (i % 2 == 0) {
+            TEST_ASSERT_EQUAL_UINT16(mark, pulses[i]);
+        } else if (pulses[i] < 1000) {
+            if (zero == 0) zero = pulses[i];
+            TEST_ASSERT_EQUAL_UINT16(zero, pulses[i]);
+        } else {
+            if (one == 0) one = pulses[i];
+            TEST_ASSERT_EQUAL_UINT16(one, pulses[i]);
+        }
+    }
+    TEST_ASSERT_UINT_WITHIN(30, 560, zero);
+    TEST_ASSERT_UINT_WITHIN(90, 1690, one);
+}
+
+// 关闭吸附时只合并毛刺，仍按默认容差统计聚类
+void test_snap_disabled_keeps_values(void) {
+    uint16_t input[NEC_PULSES];
+    uint16_t output[NEC_PULSES];
+    necFrame(0xC3A5F00F, input, 10);
+
+    PulseFilterResult result = filterPulses(input, NEC_PULSES, output, noSnap());
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(0, result.snapped);
+    TEST_ASSERT_EQUAL_UINT8(2, result.markClusters);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(input, output, NEC_PULSES);
+}
+
+// NEC重复码和单个干扰脉冲过短
+void test_reject_too_short(void) {
+    const uint16_t repeatCode[] = {9000, 2250, 560};
+    uint16_t output[8];
+    PulseFilterResult result = filterPulses(repeatCode, 3, output, kDefaultPulseFilterConfig);
+    TEST_ASSERT_EQUAL_INT(FILTER_TOO_SHORT, result.verdict);
+
+    // 合并毛刺后才变短的帧同样拒绝
+    const uint16_t merged[] = {560, 30, 560, 40, 560, 50, 560, 20};
+    result = filterPulses(merged, 8, output, kDefaultPulseFilterConfig);
+    TEST_ASSERT_EQUAL_INT(FILTER_TOO_SHORT, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(1, result.outputLength);
+
+    result = filterPulses(nullptr, 8, output, kDefaultPulseFilterConfig);
+    TEST_ASSERT_EQUAL_INT(FILTER_TOO_SHORT, result.verdict);
+}
+
+// 毛刺占输入的比例超过上限时拒绝
+void test_reject_too_noisy(void) {
+    PulseFilterConfig config = noSnap();
+    config.maxGlitchPercent = 10;
+
+    uint16_t input[NEC_PULSES + 40];
+    uint16_t output[NEC_PULSES + 40];
+    uint16_t length = NEC_PULSES;
+    necFrame(0x0F0F0F0F, input, 0);
+    // 5个毛刺 / 77个脉冲 < 10%
+    for (int k = 0; k < 5; k++) length = splitMark(input, length, 2 + k * 6, 40);
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, filterPulses(input, length, output, config).verdict);
+
+    // 10个毛刺 / 87个脉冲 > 10%
+    length = NEC_PULSES;
+    necFrame(0x0F0F0F0F, input, 0);
+    for (int k = 0; k < 10; k++) length = splitMark(input, length, 2 + k * 6, 40);
+    PulseFilterResult result = filterPulses(input, length, output, config);
+    TEST_ASSERT_EQUAL_INT(FILTER_TOO_NOISY, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(10, result.glitches);
+}
+
+// 时长成几何级数分散：聚类表放不下，无法归类的脉冲超过上限
+void test_reject_irregular(void) {
+    uint16_t input[48];
+    uint16_t output[48];
+    uint32_t pulse = 150;
+    for (int i = 0; i < 48; i += 2) {
+        input[i] = (uint16_t)pulse;
+        input[i + 1] = (uint16_t)pulse;
+        pulse = pulse * 5 / 4;
+    }
+
+    PulseFilterResult result = filterPulses(input, 48, output, kDefaultPulseFilterConfig);
+    TEST_ASSERT_EQUAL_INT(FILTER_IRREGULAR, result.verdict);
+    TEST_ASSERT_EQUAL_UINT8(PulseFilter::MAX_CLUSTERS, result.markClusters);
+    TEST_ASSERT_GREATER_THAN(48 / 10, result.irregular);
+}
+
+// 关闭过滤时原样复制并总是接受
+void test_disabled_passthrough(void) {
+    PulseFilterConfig config = kDefaultPulseFilterConfig;
+    config.enabled = false;
+    const uint16_t input[] = {560, 30, 560};
+    uint16_t output[3];
+    PulseFilterResult result = filterPulses(input, 3, output, config);
+    TEST_ASSERT_EQUAL_INT(FILTER_OK, result.verdict);
+    TEST_ASSERT_EQUAL_UINT16(3, result.outputLength);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(input, output, 3);
+}
+
+// 累计统计：接受的帧计入吸附数和输出脉冲数，拒绝的帧按结论计数
+void test_filter_stats(void) {
+    PulseFilter filter;
+    uint16_t frame[NEC_PULSES];
+    uint16_t output[NEC_PULSES];
+    necFrame(0x55AA55AA, frame, 8);
+    PulseFilterResult ok = filter.process(frame, NEC_PULSES, output);
+    const uint16_t repeatCode[] = {9000, 2250, 560};
+    filter.process(repeatCode, 3, output);
+
+    const PulseFilterStats& stats = filter.getStats();
+    TEST_ASSERT_EQUAL_UINT32(2, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.accepted);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.rejected[FILTER_TOO_SHORT]);
+    TEST_ASSERT_EQUAL_UINT32(NEC_PULSES + 3, stats.pulsesIn);
+    TEST_ASSERT_EQUAL_UINT32(NEC_PULSES, stats.pulsesOut);
+    TEST_ASSERT_EQUAL_UINT32(ok.snapped, stats.snapped);
+    TEST_ASSERT_EQUAL_STRING("too short", PulseFilter::verdictName(FILTER_TOO_SHORT));
+
+    filter.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, filter.getStats().frames);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_glitch_merged_into_neighbours);
+    RUN_TEST(test_glitch_at_edges_dropped);
+    RUN_TEST(test_snap_to_cluster_centers);
+    RUN_TEST(test_snap_disabled_keeps_values);
+    RUN_TEST(test_reject_too_short);
+    RUN_TEST(test_reject_too_noisy);
+    RUN_TEST(test_reject_irregular);
+    RUN_TEST(test_disabled_passthrough);
+    RUN_TEST(test_filter_stats);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <math.h>
+#include "ir_retry_policy.h"
+
+static AdaptiveRetryPolicy policy;
+
+// 连续记录steps次相同结果的尝试，返回之后的单次确认率(千分比)
+static uint16_t driveRate(int id, bool confirmed, int steps) {
+    for (int i = 0; i < steps; i++) policy.recordAttempt(id, confirmed, 40);
+    return policy.getStats(id)->successRate;
+}
+
+void setUp(void) {
+    policy.resetAll();
+}
+
+void tearDown(void) {}
+
+// EWMA alpha = 1/4：确认率向1000或0靠近剩余距离的四分之一(整数截断)
+void test_ewma_success_rate(void) {
+    const RetryStats* s = policy.getStats(1);
+    TEST_ASSERT_EQUAL_UINT16(AdaptiveRetryPolicy::INITIAL_RATE, s->successRate);
+
+    policy.recordAttempt(1, true, 80);
+    TEST_ASSERT_EQUAL_UINT16(625, s->successRate);
+    policy.recordAttempt(1, false, 0);
+    TEST_ASSERT_EQUAL_UINT16(469, s->successRate);
+    policy.recordAttempt(1, true, 80);
+    TEST_ASSERT_EQUAL_UINT16(601, s->successRate);
+    TEST_ASSERT_EQUAL_UINT16(3, s->attempts);
+
+    // 持续确认时收敛到接近1000，持续失败时收敛到接近0
+    TEST_ASSERT_GREATER_OR_EQUAL(990, driveRate(1, true, 40));
+    TEST_ASSERT_LESS_OR_EQUAL(10, driveRate(1, false, 40));
+}
+
+// 回波延迟：第一次直接采用，之后按3:1平滑；未确认的尝试不影响延迟
+void test_ewma_echo_latency(void) {
+    const RetryStats* s = policy.getStats(2);
+    policy.recordAttempt(2, true, 100);
+    TEST_ASSERT_EQUAL_UINT16(100, s->echoLatencyMs);
+    policy.recordAttempt(2, true, 20);
+    TEST_ASSERT_EQUAL_UINT16(80, s->echoLatencyMs);
+    policy.recordAttempt(2, false, 0);
+    TEST_ASSERT_EQUAL_UINT16(80, s->echoLatencyMs);
+}
+
+// 尝试次数是满足 1-(1-p)^n >= 0.95 的最小n，不超过MAX_ATTEMPTS
+void test_attempts_reach_target_rate(void) {
+    static const struct { uint16_t rate; uint8_t attempts; } cases[] = {
+        {0, 4}, {500, 4}, {700, 3}, {800, 2}, {950, 1}, {1000, 1},
+    };
+    for (const auto& c : cases) {
+        policy.resetAll();
+        RetryStats* s = const_cast<RetryStats*>(policy.getStats(3));
+        s->successRate = c.rate;
+        TEST_ASSERT_EQUAL_UINT8(c.attempts, policy.plan(3, true).maxAttempts);
+    }
+
+    // 全部确认率上与浮点公式比较，整数累乘的截断误差只允许在目标附近0.5%内差一次
+    for (uint16_t rate = 0; rate <= 1000; rate++) {
+        RetryStats* s = const_cast<RetryStats*>(policy.getStats(3));
+        s->successRate = rate;
+        uint8_t attempts = policy.plan(3, true).maxAttempts;
+
+        double miss = 1.0 - rate / 1000.0;
+        uint8_t expected = 1;
+        while (1.0 - pow(miss, expected) < 0.95 && expected < AdaptiveRetryPolicy::MAX_ATTEMPTS) expected++;
+        if (attempts != expected) {
+            TEST_ASSERT_EQUAL_UINT8(expected - 1, attempts);
+            TEST_ASSERT_TRUE(1.0 - pow(miss, attempts) >= 0.945);
+        }
+    }
+}
+
+// 重复次数的回差：确认率>=90%时减少，<60%时增加，两者之间保持不变
+void test_repeat_hysteresis(void) {
+    const RetryStats* s = policy.getStats(4);
+    TEST_ASSERT_EQUAL_UINT8(1, s->repeat);
+
+    driveRate(4, false, 3);                       // 500 → 211
+    policy.recordSend(4, false);
+    TEST_ASSERT_EQUAL_UINT8(2, s->repeat);
+    policy.recordSend(4, false);
+    TEST_ASSERT_EQUAL_UINT8(AdaptiveRetryPolicy::MAX_REPEAT, s->repeat);
+
+    // 回升到60%~90%之间：不振荡
+    driveRate(4, true, 3);                        // 211 → 667
+    TEST_ASSERT_TRUE(s->successRate >= 600 && s->successRate < 900);
+    policy.recordSend(4, true);
+    policy.recordSend(4, true);
+    TEST_ASSERT_EQUAL_UINT8(2, s->repeat);
+
+    driveRate(4, true, 10);
+    TEST_ASSERT_GREATER_OR_EQUAL(900, s->successRate);
+    policy.recordSend(4, true);
+    TEST_ASSERT_EQUAL_UINT8(1, s->repeat);
+    policy.recordSend(4, true);
+    policy.recordSend(4, true);
+    TEST_ASSERT_EQUAL_UINT8(0, s->repeat);
+
+    // 掉到60%~90%之间仍保持0次重复
+    driveRate(4, false, 1);
+    TEST_ASSERT_TRUE(s->successRate >= 600 && s->successRate < 900);
+    policy.recordSend(4, false);
+    TEST_ASSERT_EQUAL_UINT8(0, s->repeat);
+
+    TEST_ASSERT_EQUAL_UINT16(8, s->sends);
+    TEST_ASSERT_EQUAL_UINT16(5, s->confirmed);
+    TEST_ASSERT_EQUAL_UINT8(0, policy.plan(4, true).repeat);
+}
+
+// UNKNOWN原始数据不使用协议重复；回波等待取延迟两倍加20ms并限制在范围内
+void test_plan_repeat_and_echo_timeout(void) {
+    RetryPlan plan = policy.plan(5, true);
+    TEST_ASSERT_EQUAL_UINT8(1, plan.repeat);
+    TEST_ASSERT_EQUAL_UINT16(150, plan.echoTimeoutMs);
+    TEST_ASSERT_EQUAL_UINT8(0, policy.plan(5, false).repeat);
+
+    policy.recordAttempt(5, true, 10);
+    TEST_ASSERT_EQUAL_UINT16(AdaptiveRetryPolicy::MIN_ECHO_TIMEOUT, policy.plan(5, true).echoTimeoutMs);
+    policy.reset(5);
+    policy.recordAttempt(5, true, 70);
+    TEST_ASSERT_EQUAL_UINT16(160, policy.plan(5, true).echoTimeoutMs);
+    policy.reset(5);
+    policy.recordAttempt(5, true, 500);
+    TEST_ASSERT_EQUAL_UINT16(AdaptiveRetryPolicy::MAX_ECHO_TIMEOUT, policy.plan(5, true).echoTimeoutMs);
+}
+
+// reset恢复初始值；超出范围的ID不记录统计，计划使用默认值
+void test_reset_and_invalid_ids(void) {
+    policy.recordAttempt(6, true, 30);
+    policy.recordSend(6, true);
+    policy.reset(6);
+    const RetryStats* s = policy.getStats(6);
+    TEST_ASSERT_EQUAL_UINT16(0, s->sends);
+    TEST_ASSERT_EQUAL_UINT16(0, s->attempts);
+    TEST_ASSERT_EQUAL_UINT16(0, s->echoLatencyMs);
+    TEST_ASSERT_EQUAL_UINT16(AdaptiveRetryPolicy::INITIAL_RATE, s->successRate);
+    TEST_ASSERT_EQUAL_UINT8(1, s->repeat);
+
+    TEST_ASSERT_NULL(policy.getStats(0));
+    TEST_ASSERT_NULL(policy.getStats(AdaptiveRetryPolicy::MAX_TRACKED + 1));
+    policy.recordAttempt(0, true, 30);
+    policy.recordSend(AdaptiveRetryPolicy::MAX_TRACKED + 1, true);
+    RetryPlan plan = policy.plan(0, true);
+    TEST_ASSERT_EQUAL_UINT8(3, plan.maxAttempts);
+    TEST_ASSERT_EQUAL_UINT8(AdaptiveRetryPolicy::MAX_REPEAT, plan.repeat);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ewma_success_rate);
+    RUN_TEST(test_ewma_echo_latency);
+    RUN_TEST(test_attempts_reach_target_rate);
+    RUN_TEST(test_repeat_hysteresis);
+    RUN_TEST(test_plan_repeat_and_echo_timeout);
+    RUN_TEST(test_reset_and_invalid_ids);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ir_heap.h"
+#include "ir_storage.h"
+#include "ir_storage_backend.h"
+#include "ir_protocol_encoder.h"
+#include "ir_protocol_decoder.h"
+#include "ir_protocol_name.h"
+#include "ir_pulse_filter.h"
+#include "ir_command.h"
+#include "ir_corpus.h"
+
+// 浸泡测试：发射和接收热路径上与平台无关的部分反复执行，期间不允许任何堆分配(包括释放掉的临时分配)
+// IRTransmitter::sendSignal的RMT驱动调用和IRReceiver的IRrecv捕获/重建依赖硬件，不在这里覆盖，由设备端soak命令检查
+// 分配次数由ir_heap的malloc链接重定向统计，需要native环境的IR_HEAP_COUNT_ALLOCATIONS和--wrap链接选项
+static const int SOAK_ITERATIONS = 2000;
+
+static RamStorageBackend backend;
+static IRStorage storage(&backend);
+static int necId;
+static int rawId;
+
+static IRSignal signal;
+static rmt_item32_t items[512];
+static uint16_t pulses[CorpusFrame::MAX_PULSES];
+static uint16_t filtered[CorpusFrame::MAX_PULSES];
+static CorpusFrame frame;
+static char line[CORPUS_MAX_LINE];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// 各测试先执行一次再开始统计，与设备上的soak命令相同：一次性的初始化分配不计入
+static uint32_t allocationsDuring(void (*body)()) {
+    body();
+    HeapSnapshot before = takeHeapSnapshot();
+    for (int i = 0; i < SOAK_ITERATIONS; i++) body();
+    HeapSnapshot after = takeHeapSnapshot();
+    return heapAllocationDelta(before, after);
+}
+
+// 计数确实生效：直接malloc和new都被统计，否则下面的0没有意义
+void test_counter_sees_allocations(void) {
+    TEST_ASSERT_TRUE(heapAllocationCounting());
+
+    HeapSnapshot before = takeHeapSnapshot();
+    void* volatile block = malloc(64);
+    free(block);
+    int* volatile object = new int(7);
+    delete object;
+    HeapSnapshot after = takeHeapSnapshot();
+    TEST_ASSERT_EQUAL_UINT32(2, heapAllocationDelta(before, after));
+}
+
+// 发射前取信号快照、按描述符编码、原始脉冲转换RMT数据项
+static void sendPath() {
+    storage.snapshot(necId, signal);
+    const ProtocolDescriptor* desc = descriptorForProtocol(signal.protocol);
+    encodeProtocol(*desc, signal.value, signal.bits, 2, items, 512);
+    protocolName(signal.protocol);
+
+    storage.snapshot(rawId, signal);
+    convertRawPulses(signal.rawData, signal.rawLength, items, 512);
+}
+
+void test_send_path_does_not_allocate(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, allocationsDuring(sendPath));
+}
+
+// 接收后过滤脉冲、按描述符解码
+static void receivePath() {
+    uint16_t length = 0;
+    encodeFramePulses(kNecDescriptor, false, 0x00FF02FDULL, 32, pulses, CorpusFrame::MAX_PULSES, length);
+    PulseFilterResult result = filterPulses(pulses, length, filtered, kDefaultPulseFilterConfig);
+    DecodedSignal decoded;
+    decodePulses(filtered, result.outputLength, decoded);
+}
+
+void test_receive_path_does_not_allocate(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, allocationsDuring(receivePath));
+}
+
+// 串口命令解析和语料行格式化/解析(dump、replay)
+static void commandPath() {
+    ParsedCommand parsed;
+    parseCommand("send <3> 5", parsed);
+    formatCorpusFrame(frame, line, sizeof(line));
+    parseCorpusFrame(line, frame);
+}
+
+void test_command_path_does_not_allocate(void) {
+    memset(&frame, 0, sizeof(frame));
+    strcpy(frame.model, "tv");
+    frame.protocol = NEC;
+    frame.value = 0x00FF02FDULL;
+    frame.bits = 32;
+    TEST_ASSERT_GREATER_THAN(0, encodeFramePulses(kNecDescriptor, false, frame.value, frame.bits, frame.pulses,
+                                                  CorpusFrame::MAX_PULSES, frame.length));
+    TEST_ASSERT_EQUAL_UINT32(0, allocationsDuring(commandPath));
+}
+
+int main() {
+    storage.setQuiet(true);
+    storage.begin();
+    uint16_t raw[67];
+    uint16_t length = 0;
+    encodeFramePulses(kNecDescriptor, false, 0x20DF10EFULL, 32, raw, 67, length);
+    necId = storage.addSignal(NEC, 0x20DF10EFULL, 32, raw, length, "power", 38, 33);
+    for (uint16_t i = 0; i < length; i++) raw[i] = (uint16_t)(raw[i] + 7);
+    rawId = storage.addSignal(UNKNOWN, 0, 0, raw, length, "raw", 38, 33);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_sees_allocations);
+    RUN_TEST(test_send_path_does_not_allocate);
+    RUN_TEST(test_receive_path_does_not_allocate);
+    RUN_TEST(test_command_path_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "ir_storage.h"
+#include "ir_storage_backend.h"
+
+// 存储容量测试：槽位未满而映像(4096字节)放不下时，addSignal和setSignalName必须失败，
+// 已返回成功的信号在重新加载后全部存在，不会在提交时被截断
+static const uint16_t CAPACITY_PULSES = 256;
+
+static RamStorageBackend backend;
+static IRStorage storage(&backend);
+static uint32_t lcg;
+
+// 互不相同的随机脉冲，不能共享模式表的片段，每条记录都按原始脉冲保存
+static void randomPulses(uint16_t* out, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        lcg = lcg * 1103515245u + 12345u;
+        out[i] = (uint16_t)(300 + (lcg >> 16) % 3000);
+    }
+}
+
+// 一直新增到失败，返回成功的个数
+static int fillStorage() {
+    static uint16_t raw[CAPACITY_PULSES];
+    char name[32];
+    int stored = 0;
+    for (int i = 0; i < storage.getCapacity(); i++) {
+        randomPulses(raw, CAPACITY_PULSES);
+        snprintf(name, sizeof(name), "k%d", i);
+        if (storage.addSignal(UNKNOWN, 0, 0, raw, CAPACITY_PULSES, name) < 0) break;
+        stored++;
+    }
+    return stored;
+}
+
+void setUp(void) {
+    lcg = 20240601u;
+    storage.clearAll();
+}
+
+void tearDown(void) {}
+
+void test_add_fails_when_image_is_full(void) {
+    int stored = fillStorage();
+    TEST_ASSERT_GREATER_THAN(0, stored);
+    TEST_ASSERT_GREATER_THAN(0, storage.getFreeSlots());
+    TEST_ASSERT_EQUAL(ADD_FULL, storage.getLastAddStatus());
+    TEST_ASSERT_EQUAL_INT(stored, storage.getSignalCount());
+    TEST_ASSERT_TRUE(storage.getUsedMemory() <= backend.size());
+
+    // 重新加载后与返回成功的信号一致
+    IRStorage reloaded(&backend);
+    reloaded.setQuiet(true);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_INT(stored, reloaded.getSignalCount());
+    for (int id = 1; id <= stored; id++) {
+        char name[32];
+        snprintf(name, sizeof(name), "k%d", id - 1);
+        TEST_ASSERT_TRUE(reloaded.isValidId(id));
+        TEST_ASSERT_EQUAL_STRING(name, reloaded.getSignal(id)->name);
+        TEST_ASSERT_EQUAL_UINT16(CAPACITY_PULSES, reloaded.getSignal(id)->rawLength);
+    }
+}
+
+void test_rename_fails_when_image_is_full(void) {
+    int stored = fillStorage();
+    // 再用没有脉冲的最短记录(记录头加1字节名称)填满剩余空间
+    while (storage.addSignal(NEC, 0x100 + stored, 32, nullptr, 0, "p") > 0) stored++;
+    TEST_ASSERT_GREATER_THAN(0, storage.getFreeSlots());
+    size_t room = backend.size() - storage.getUsedMemory();
+    TEST_ASSERT_TRUE(room < 29);
+
+    // 名称变长超过剩余空间时拒绝且保留原名称；同样长度或变短总是可以
+    TEST_ASSERT_FALSE(storage.setSignalName(1, "a_name_that_is_thirty_one_chars"));
+    TEST_ASSERT_EQUAL_STRING("k0", storage.getSignal(1)->name);
+    TEST_ASSERT_TRUE(storage.setSignalName(1, "kk"));
+    TEST_ASSERT_TRUE(storage.setSignalName(1, "k"));
+
+    IRStorage reloaded(&backend);
+    reloaded.setQuiet(true);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_INT(stored, reloaded.getSignalCount());
+    TEST_ASSERT_EQUAL_STRING("k", reloaded.getSignal(1)->name);
+}
+
+int main() {
+    storage.setQuiet(true);
+    storage.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_add_fails_when_image_is_full);
+    RUN_TEST(test_rename_fails_when_image_is_full);
+    return UNITY_END();
+}
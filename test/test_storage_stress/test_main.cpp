@@ -0,0 +1,127 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "ir_storage.h"
+#include "ir_storage_backend.h"
+
+// 存储seqlock并发测试：写者线程反复删除重建信号1、重命名信号2，读者在主线程不断取快照检查完整性
+// 与设备上的stress命令相同的约定：
+//   信号1  名称为 "s<值>"，第i个脉冲为 值+i
+//   信号2  名称由同一个字符重复构成
+// 快照被写入撕裂时上述关系不成立。pio test -e native_tsan 在ThreadSanitizer下运行
+static const uint16_t STRESS_PULSES = 64;
+static const uint32_t STRESS_READS = 20000;
+
+static RamStorageBackend backend;
+static IRStorage storage(&backend);
+static std::atomic<bool> running;
+static std::atomic<uint32_t> writes;
+
+static void writer() {
+    uint16_t raw[STRESS_PULSES];
+    char name[32];
+    uint32_t k = 0;
+
+    while (running.load(std::memory_order_relaxed)) {
+        k++;
+        if (k % 2) {
+            for (uint16_t i = 0; i < STRESS_PULSES; i++) raw[i] = (uint16_t)(k + i);
+            snprintf(name, sizeof(name), "s%u", k);
+            storage.deleteSignal(1);
+            storage.addSignal(UNKNOWN, k, 0, raw, STRESS_PULSES, name);
+        } else {
+            memset(name, 'a' + k % 26, 31);
+            name[31] = '\0';
+            storage.setSignalName(2, name);
+        }
+        writes.fetch_add(1, std::memory_order_relaxed);
+        // 单核主机上给读者留出调度机会
+        if (k % 64 == 0) std::this_thread::yield();
+    }
+}
+
+static bool snapshotIntact(int id, const IRSignal& signal) {
+    if (id == 2) {
+        for (int i = 1; i < 31; i++) {
+            if (signal.name[i] != signal.name[0]) return false;
+        }
+        return signal.name[31] == '\0';
+    }
+    char expected[32];
+    snprintf(expected, sizeof(expected), "s%u", (uint32_t)signal.value);
+    if (strcmp(signal.name, expected) != 0 || signal.rawLength != STRESS_PULSES) return false;
+    for (uint16_t i = 0; i < STRESS_PULSES; i++) {
+        if (signal.rawData[i] != (uint16_t)(signal.value + i)) return false;
+    }
+    return true;
+}
+
+void setUp(void) {
+    uint16_t raw[STRESS_PULSES];
+    for (uint16_t i = 0; i < STRESS_PULSES; i++) raw[i] = i;
+    storage.clearAll();
+    storage.addSignal(UNKNOWN, 0, 0, raw, STRESS_PULSES, "s0");
+    storage.addSignal(UNKNOWN, 0, 0, raw, STRESS_PULSES, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+    writes.store(0, std::memory_order_relaxed);
+}
+
+void tearDown(void) {}
+
+// 单线程：修改后修订号变化，快照与存储内容一致
+void test_snapshot_revision_follows_writes(void) {
+    static IRSignal signal;
+    uint32_t first = 0;
+    uint32_t second = 0;
+    TEST_ASSERT_TRUE(storage.snapshot(2, signal, &first));
+    TEST_ASSERT_NOT_EQUAL(0, first);
+    TEST_ASSERT_TRUE(storage.setSignalName(2, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"));
+    TEST_ASSERT_TRUE(storage.snapshot(2, signal, &second));
+    TEST_ASSERT_NOT_EQUAL(first, second);
+    TEST_ASSERT_EQUAL(storage.getRevision(2), second);
+    TEST_ASSERT_EQUAL_STRING("bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb", signal.name);
+
+    TEST_ASSERT_FALSE(storage.snapshot(3, signal, &second));
+    TEST_ASSERT_EQUAL_UINT32(0, second);
+    TEST_ASSERT_FALSE(storage.snapshot(0, signal));
+}
+
+// 并发：写者持续修改期间，读者取到的每个快照都完整(或信号1恰好处于删除与重建之间而无效)
+void test_concurrent_snapshots_are_intact(void) {
+    static IRSignal signal;
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t missing = 0;
+
+    running.store(true, std::memory_order_relaxed);
+    std::thread thread(writer);
+    for (uint32_t i = 0; i < STRESS_READS; i++) {
+        int id = 1 + i % 2;
+        if (!storage.snapshot(id, signal)) {
+            missing++;
+            continue;
+        }
+        reads++;
+        if (!snapshotIntact(id, signal)) torn++;
+    }
+    running.store(false, std::memory_order_relaxed);
+    thread.join();
+
+    char message[96];
+    snprintf(message, sizeof(message), "reads=%u writes=%u retries=%u missing=%u", reads,
+             writes.load(), storage.getSnapshotRetries(), missing);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, torn, message);
+    TEST_ASSERT_GREATER_THAN_MESSAGE(0, writes.load(), message);
+    TEST_ASSERT_GREATER_THAN_MESSAGE(0, reads, message);
+}
+
+int main() {
+    storage.setQuiet(true);
+    storage.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_revision_follows_writes);
+    RUN_TEST(test_concurrent_snapshots_are_intact);
+    return UNITY_END();
+}